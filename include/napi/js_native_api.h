@@ -9,6 +9,14 @@ EXTERN_C_START
 #include <stddef.h>  // NOLINT(modernize-deprecated-headers)
 #include <stdint.h>  // NOLINT(modernize-deprecated-headers)
 
+// C 语言没有 char16_t
+#ifndef __cplusplus
+typedef uint16_t char16_t;
+#endif
+
+// 代表字符串以 \0 结尾，由实现层计算长度
+#define NAPI_AUTO_LENGTH SIZE_MAX
+
 NAPI_EXPORT NAPICommonStatus napi_get_undefined(NAPIEnv env, NAPIValue *result);
 
 NAPI_EXPORT NAPICommonStatus napi_get_null(NAPIEnv env, NAPIValue *result);
@@ -23,6 +31,20 @@ NAPI_EXPORT NAPIErrorStatus napi_create_double(NAPIEnv env, double value, NAPIVa
 // 推荐实现层针对 str 为空情况做处理，比如当做 ""
 NAPI_EXPORT NAPIExceptionStatus napi_create_string_utf8(NAPIEnv env, const char *str, NAPIValue *result);
 
+// length 为 NAPI_AUTO_LENGTH 时等同于 napi_create_string_utf8，否则 str 不需要以 \0 结尾
+// str 为空时 length 必须为 0 或者 NAPI_AUTO_LENGTH，当做 ""
+// 非法 UTF-8 序列替换为 U+FFFD
+NAPI_EXPORT NAPIExceptionStatus napi_create_string_utf8_len(NAPIEnv env, const char *str, size_t length,
+                                                            NAPIValue *result);
+
+// str/length 规则同 napi_create_string_utf8_len
+NAPI_EXPORT NAPIExceptionStatus napi_create_string_latin1(NAPIEnv env, const char *str, size_t length,
+                                                          NAPIValue *result);
+
+// str/length 规则同 napi_create_string_utf8_len，length 为 code unit 数量，孤立代理项原样保留
+NAPI_EXPORT NAPIExceptionStatus napi_create_string_utf16(NAPIEnv env, const char16_t *str, size_t length,
+                                                         NAPIValue *result);
+
 // 推荐实现层针对 utf8name 为空情况做处理，比如当做 ""
 // data 可空
 NAPI_EXPORT NAPIExceptionStatus napi_create_function(NAPIEnv env, const char *utf8name, NAPICallback cb, void *data,
@@ -35,6 +57,16 @@ NAPI_EXPORT NAPIErrorStatus napi_get_value_double(NAPIEnv env, NAPIValue value,
 
 NAPI_EXPORT NAPIErrorStatus napi_get_value_bool(NAPIEnv env, NAPIValue value, bool *result);
 
+// buf 为空时 result 返回 UTF-8 字节数（不含 \0），用于预先分配缓冲区
+// buf 非空时最多写入 bufsize - 1 个字节并以 \0 结尾，截断时不拆分码点，result（可空）返回写入的字节数（不含 \0）
+// 不分配内存，适合使用栈上或复用的缓冲区
+NAPI_EXPORT NAPIErrorStatus napi_get_value_string_utf8(NAPIEnv env, NAPIValue value, char *buf, size_t bufsize,
+                                                       size_t *result);
+
+// 规则同 napi_get_value_string_utf8，单位为 code unit，截断时不拆分代理对
+NAPI_EXPORT NAPIErrorStatus napi_get_value_string_utf16(NAPIEnv env, NAPIValue value, char16_t *buf, size_t bufsize,
+                                                        size_t *result);
+
 NAPI_EXPORT NAPIExceptionStatus napi_coerce_to_bool(NAPIEnv env, NAPIValue value, NAPIValue *result);
 
 NAPI_EXPORT NAPIExceptionStatus napi_coerce_to_number(NAPIEnv env, NAPIValue value, NAPIValue *result);
@@ -50,8 +82,48 @@ NAPI_EXPORT NAPIExceptionStatus napi_get_property(NAPIEnv env, NAPIValue object,
 // result 可空
 NAPI_EXPORT NAPIExceptionStatus napi_delete_property(NAPIEnv env, NAPIValue object, NAPIValue key, bool *result);
 
+NAPI_EXPORT NAPIExceptionStatus napi_set_element(NAPIEnv env, NAPIValue object, uint32_t index, NAPIValue value);
+
+NAPI_EXPORT NAPIExceptionStatus napi_has_element(NAPIEnv env, NAPIValue object, uint32_t index, bool *result);
+
+NAPI_EXPORT NAPIExceptionStatus napi_get_element(NAPIEnv env, NAPIValue object, uint32_t index, NAPIValue *result);
+
+// result 可空
+NAPI_EXPORT NAPIExceptionStatus napi_delete_element(NAPIEnv env, NAPIValue object, uint32_t index, bool *result);
+
 NAPI_EXPORT NAPICommonStatus napi_is_array(NAPIEnv env, NAPIValue value, bool *result);
 
+// data 可空，返回的 data 在 ArrayBuffer 被回收或者分离前有效，内容初始化为 0
+NAPI_EXPORT NAPIExceptionStatus napi_create_arraybuffer(NAPIEnv env, size_t byteLength, void **data,
+                                                        NAPIValue *result);
+
+// 不拷贝 externalData，ArrayBuffer 被回收时调用 finalizeCB(externalData, finalizeHint)，finalizeCB/finalizeHint 可空
+// Hermes 不支持外部内存，会拷贝后立即调用 finalizeCB，此时 *copied（可空）为 true，调用方可以立即释放 externalData
+NAPI_EXPORT NAPIExceptionStatus napi_create_external_arraybuffer(NAPIEnv env, void *externalData, size_t byteLength,
+                                                                 NAPIFinalize finalizeCB, void *finalizeHint,
+                                                                 NAPIValue *result, bool *copied);
+
+NAPI_EXPORT NAPICommonStatus napi_is_arraybuffer(NAPIEnv env, NAPIValue value, bool *result);
+
+// data/byteLength 可空，不是 ArrayBuffer 或者已经分离返回 NAPIErrorInvalidArg
+NAPI_EXPORT NAPIErrorStatus napi_get_arraybuffer_info(NAPIEnv env, NAPIValue arraybuffer, void **data,
+                                                      size_t *byteLength);
+
+// 共享 arraybuffer 的内存，byteOffset 必须按元素大小对齐，越界或者不对齐会抛出 RangeError
+NAPI_EXPORT NAPIExceptionStatus napi_create_typedarray(NAPIEnv env, NAPITypedArrayType type, size_t length,
+                                                       NAPIValue arraybuffer, size_t byteOffset, NAPIValue *result);
+
+NAPI_EXPORT NAPICommonStatus napi_is_typedarray(NAPIEnv env, NAPIValue value, bool *result);
+
+// type/length/data/arraybuffer/byteOffset 可空，length 为元素数量，data 已经加上 byteOffset
+NAPI_EXPORT NAPIErrorStatus napi_get_typedarray_info(NAPIEnv env, NAPIValue typedarray, NAPITypedArrayType *type,
+                                                     size_t *length, void **data, NAPIValue *arraybuffer,
+                                                     size_t *byteOffset);
+
+// 按顺序定义属性，遇到失败立即返回，之前定义的属性会保留
+NAPI_EXPORT NAPIExceptionStatus napi_define_properties(NAPIEnv env, NAPIValue object, size_t propertyCount,
+                                                       const NAPIPropertyDescriptor *properties);
+
 // thisValue/result 可空
 NAPI_EXPORT NAPIExceptionStatus napi_call_function(NAPIEnv env, NAPIValue thisValue, NAPIValue func, size_t argc,
                                                    const NAPIValue *argv, NAPIValue *result);
@@ -62,6 +134,9 @@ NAPI_EXPORT NAPIExceptionStatus napi_new_instance(NAPIEnv env, NAPIValue constru
 // instanceof 本身就可能引发异常
 NAPI_EXPORT NAPIExceptionStatus napi_instanceof(NAPIEnv env, NAPIValue object, NAPIValue constructor, bool *result);
 
+// 语义与 Object.is 一致（SameValue），NaN 等于 NaN，+0 不等于 -0
+NAPI_EXPORT NAPIExceptionStatus napi_strict_equals(NAPIEnv env, NAPIValue lhs, NAPIValue rhs, bool *result);
+
 // argv/thisArg/data 可空，当 argv 非空时，argc 也必须非空
 // env callbackInfo 入参，argc 为 inout，其他出参
 NAPI_EXPORT NAPICommonStatus napi_get_cb_info(NAPIEnv env, NAPICallbackInfo callbackInfo, size_t *argc, NAPIValue *argv,
@@ -75,6 +150,12 @@ NAPI_EXPORT NAPIExceptionStatus napi_create_external(NAPIEnv env, void *data, NA
 
 NAPI_EXPORT NAPIErrorStatus napi_get_value_external(NAPIEnv env, NAPIValue value, void **result);
 
+// 登记 external 等对象持有的原生内存，让引擎根据真实占用决定 GC 时机，释放时传入负数
+// adjustedValue 返回当前 env 登记的总字节数，不会小于 0
+// QuickJS 计入 JSRuntime 的 malloc_size，同样受 JS_SetMemoryLimit 限制；Hermes 计入 GC 的 external 内存；JSC 只做统计
+// 可以在 finalizer 中调用
+NAPI_EXPORT NAPIErrorStatus napi_adjust_external_memory(NAPIEnv env, int64_t changeInBytes, int64_t *adjustedValue);
+
 // Set initial_refcount to 0 for a weak reference, >0 for a strong reference.
 // QuickJS 和 JavaScriptCore 实现弱引用会产生异常
 NAPI_EXPORT NAPIExceptionStatus napi_create_reference(NAPIEnv env, NAPIValue value, uint32_t initialRefCount,
@@ -94,6 +175,10 @@ NAPI_EXPORT NAPIErrorStatus napi_open_handle_scope(NAPIEnv env, NAPIHandleScope
 
 NAPI_EXPORT NAPICommonStatus napi_close_handle_scope(NAPIEnv env, NAPIHandleScope scope);
 
+// 释放 scope 内创建的所有句柄，scope 本身保持打开，用于在 native 循环中复用
+// scope 必须是最内层 handleScope，否则返回 NAPIErrorHandleScopeMismatch
+NAPI_EXPORT NAPIErrorStatus napi_reset_handle_scope(NAPIEnv env, NAPIHandleScope scope);
+
 NAPI_EXPORT NAPIErrorStatus napi_open_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandleScope *result);
 
 NAPI_EXPORT NAPICommonStatus napi_close_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandleScope scope);
@@ -112,6 +197,9 @@ NAPI_EXPORT NAPICommonStatus NAPIClearLastException(NAPIEnv env);
 NAPI_EXPORT NAPIExceptionStatus NAPIRunScript(NAPIEnv env, const char *script, const char *sourceUrl,
                                               NAPIValue *result);
 
+// 不受 JSON.parse 被 JS 代码替换影响，解析失败抛出 SyntaxError
+NAPI_EXPORT NAPIExceptionStatus NAPIParseUTF8JSONString(NAPIEnv env, const char *utf8String, NAPIValue *result);
+
 // 推荐实现层针对 utf8name 为空情况做处理，比如当做 ""
 // data 可空
 NAPI_EXPORT NAPIExceptionStatus NAPIDefineClass(NAPIEnv env, const char *utf8name, NAPICallback constructor, void *data,
@@ -121,6 +209,13 @@ NAPI_EXPORT NAPIErrorStatus NAPICreateRuntime(NAPIRuntime *runtime);
 
 NAPI_EXPORT NAPIErrorStatus NAPICreateEnv(NAPIEnv *env, NAPIRuntime runtime);
 
+// options 为 NULL 等价于 NAPICreateRuntime，version 不支持时返回 NAPIInvalidArg
+NAPI_EXPORT NAPIErrorStatus NAPICreateRuntimeWithOptions(const NAPIRuntimeOptions *options, NAPIRuntime *runtime);
+
+// options 为 NULL 等价于 NAPICreateEnv，version 不支持时返回 NAPIInvalidArg
+NAPI_EXPORT NAPIErrorStatus NAPICreateEnvWithOptions(NAPIEnv *env, NAPIRuntime runtime,
+                                                     const NAPIRuntimeOptions *options);
+
 NAPI_EXPORT NAPICommonStatus NAPIFreeEnv(NAPIEnv env);
 
 NAPI_EXPORT NAPICommonStatus NAPIFreeRuntime(NAPIRuntime runtime);
@@ -137,6 +232,104 @@ NAPI_EXPORT NAPICommonStatus NAPIFreeByteBuffer(NAPIEnv env, const uint8_t *byte
 NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBuffer(NAPIEnv env, const uint8_t *byteBuffer, size_t bufferSize,
                                                   NAPIValue *result);
 
+// 以只读方式映射 NAPICompileToByteBuffer 生成的字节码文件并执行
+// Hermes 直接从映射内存执行，映射随字节码模块回收，文件在此之前不应被截断或改写
+// QuickJS 读取完成后立即解除映射，函数使用堆上的拷贝
+// 文件无法打开或映射时返回 NAPIGenericFailure，JSC 不支持字节码，始终返回 NAPIGenericFailure
+NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBufferFile(NAPIEnv env, const char *path, NAPIValue *result);
+
+// options 为 NULL 等价于 NAPIRunScript，但不经过 NAPISetCodeCacheDirectory 设置的缓存
+NAPI_EXPORT NAPIExceptionStatus NAPIRunScriptWithOptions(NAPIEnv env, const char *script, const char *sourceUrl,
+                                                         const NAPIScriptOptions *options, NAPIValue *result);
+
+// options 为 NULL 等价于 NAPICompileToByteBuffer，byteBuffer 使用 NAPIFreeByteBuffer 释放
+NAPI_EXPORT NAPIExceptionStatus NAPICompileWithOptions(NAPIEnv env, const char *script, const char *sourceUrl,
+                                                       const NAPIScriptOptions *options, const uint8_t **byteBuffer,
+                                                       size_t *bufferSize);
+
+// 只编译不执行，之后可以通过 NAPIRunCompiledScript 反复执行而不必重新解析
+// script 归属于 env，必须在 NAPIFreeEnv 之前调用 NAPIFreeScript 释放
+// JSC 没有公开的预编译接口，编译时只检查语法，执行时依赖 JSC 内部的代码缓存
+NAPI_EXPORT NAPIExceptionStatus NAPICompileScript(NAPIEnv env, const char *script, const char *sourceUrl,
+                                                  NAPIScript *result);
+
+// 每次执行都等价于重新执行一次整个脚本，result 可空
+NAPI_EXPORT NAPIExceptionStatus NAPIRunCompiledScript(NAPIEnv env, NAPIScript script, NAPIValue *result);
+
+NAPI_EXPORT NAPICommonStatus NAPIFreeScript(NAPIEnv env, NAPIScript script);
+
+// 在后台线程预先创建 capacity 个 env，每个 env 使用独立的 NAPIRuntime，避免和调用线程共享引擎状态
+NAPI_EXPORT NAPIErrorStatus NAPICreateEnvPool(size_t capacity, NAPIEnvPool *result);
+
+// 池中有可用 env 时 O(1) 返回，否则在当前线程同步创建，取出后会通知后台线程补充
+// 取出的 env 只能在调用线程使用，QuickJS 的栈溢出检查会按调用线程的栈顶更新
+NAPI_EXPORT NAPIErrorStatus NAPIEnvPoolAcquire(NAPIEnvPool pool, NAPIEnv *result);
+
+// env 必须来自同一个池，释放在后台线程进行，调用后不能再使用 env
+NAPI_EXPORT NAPIErrorStatus NAPIEnvPoolRelease(NAPIEnvPool pool, NAPIEnv env);
+
+NAPI_EXPORT NAPIErrorStatus NAPIGetEnvPoolStatistics(NAPIEnvPool pool, NAPIEnvPoolStatistics *result);
+
+// 等待后台线程退出并释放池中所有 env，尚未归还的 env 也会被释放
+NAPI_EXPORT NAPICommonStatus NAPIFreeEnvPool(NAPIEnvPool pool);
+
+// 为 NAPIRunScript 开启磁盘字节码缓存，应当在 NAPICreateEnv 之后、执行脚本之前调用
+// 缓存以源码、sourceUrl 和引擎字节码版本为 key，首次执行时写入，之后直接加载字节码
+// directory 必须已经存在，传入 NULL 关闭缓存，JSC 不支持字节码，设置后不生效
+NAPI_EXPORT NAPIErrorStatus NAPISetCodeCacheDirectory(NAPIEnv env, const char *directory);
+
+NAPI_EXPORT NAPIErrorStatus NAPIGetCodeCacheStatistics(NAPIEnv env, NAPICodeCacheStatistics *result);
+
+// QuickJS 的 JS_ComputeMemoryUsage 会访问 JSRuntime 中的每个对象、字符串和 atom，耗时和堆大小成正比
+// 数十万对象的堆上单次调用可达毫秒级，适合秒级采集，不要在每帧或每次调用时采集
+// Hermes 只读取计数器，绑定层字段需要遍历 handleScope 和引用链表，耗时和其数量成正比
+// 同一个 NAPIRuntime 下有多个 env 时，引擎堆相关字段为整个 runtime 的统计
+NAPI_EXPORT NAPIErrorStatus NAPIGetHeapStatistics(NAPIEnv env, NAPIHeapStatistics *result);
+
+// 同步执行一次 GC，finalizer 在返回前执行，不能在 finalizer 中调用
+// JSC 只会通知引擎尽快回收
+NAPI_EXPORT NAPIErrorStatus NAPIRunGC(NAPIEnv env, NAPIGCMode mode);
+
+// 在空闲时间调用，idleMicroseconds 为本次空闲时间的预算
+// 引擎的 GC 不能中途暂停，根据之前 GC 的耗时估计，预算不足时不执行，*hasMoreWork（可空）为 true，调用方应在下一次空闲时
+// 再次调用；执行完成后 *hasMoreWork 为 false，在下一次有新的 JS 执行之前不需要再调用
+// 上一次 GC 之后没有新的分配时直接返回，*hasMoreWork 为 false
+NAPI_EXPORT NAPIErrorStatus NAPIIdleNotification(NAPIEnv env, uint64_t idleMicroseconds, bool *hasMoreWork);
+
+// 系统内存不足时调用，*reclaimedBytes（可空）返回释放的字节数，GC 部分按调用前后引擎堆大小的差值估计
+// 和 NAPIRunGC 一样不能在 finalizer 中调用
+NAPI_EXPORT NAPIErrorStatus NAPINotifyMemoryPressure(NAPIEnv env, NAPIMemoryPressureLevel level,
+                                                     size_t *reclaimedBytes);
+
+// 写入 Chrome DevTools 可以加载的 .heapsnapshot 文件，已存在时覆盖
+// Hermes 使用引擎自带的堆快照，绑定层的强引用和 handle 出现在 GC roots 中，需要 HERMES_MEMORY_INSTRUMENTATION
+// 第一次生成快照后 Hermes 会一直保留对象 ID 表，之后的每次 GC 都要维护，内存和 GC 耗时随对象数量增加
+// QuickJS 遍历 JSRuntime 中的全部 GC 对象，闭包变量、Map/Set 的元素等内部引用以 hidden 边出现
+// 遍历过程中不执行 JS，Proxy 作为叶子节点，不展开 target 和 handler，调用前未处理的异常保持不变
+// 绑定层持有的值在根节点下按 (Strong references)、(Handle scopes) 等合成节点分组
+// JavaScriptCore 不支持，返回 NAPIErrorGenericFailure
+NAPI_EXPORT NAPIErrorStatus NAPIWriteHeapSnapshot(NAPIEnv env, const char *path);
+
+// 预先将属性名转换为引擎内部的 atom/SymbolID，重复访问同一属性时避免创建字符串
+// key 归属于 env，必须在 NAPIFreeEnv 之前调用 NAPIFreePropertyKey 释放
+// utf8name 为空当做 ""
+NAPI_EXPORT NAPIExceptionStatus NAPICreatePropertyKey(NAPIEnv env, const char *utf8name, NAPIPropertyKey *result);
+
+NAPI_EXPORT NAPICommonStatus NAPIFreePropertyKey(NAPIEnv env, NAPIPropertyKey key);
+
+NAPI_EXPORT NAPIExceptionStatus NAPISetPropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key,
+                                                       NAPIValue value);
+
+NAPI_EXPORT NAPIExceptionStatus NAPIHasPropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key,
+                                                       bool *result);
+
+NAPI_EXPORT NAPIExceptionStatus NAPIGetPropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key,
+                                                       NAPIValue *result);
+
+// result 可空
+NAPI_EXPORT NAPIExceptionStatus NAPIDeletePropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key,
+                                                          bool *result);
+
 #pragma mark - 间接函数
 
 NAPI_EXPORT NAPIExceptionStatus napi_set_named_property(NAPIEnv env, NAPIValue object, const char *utf8name,
@@ -145,9 +338,18 @@ NAPI_EXPORT NAPIExceptionStatus napi_set_named_property(NAPIEnv env, NAPIValue o
 NAPI_EXPORT NAPIExceptionStatus napi_get_named_property(NAPIEnv env, NAPIValue object, const char *utf8name,
                                                         NAPIValue *result);
 
-NAPI_EXPORT NAPIExceptionStatus napi_strict_equals(NAPIEnv env, NAPIValue lhs, NAPIValue rhs, bool *result);
-
-NAPI_EXPORT NAPIExceptionStatus NAPIParseUTF8JSONString(NAPIEnv env, const char *utf8String, NAPIValue *result);
+// 目前三个引擎都没有可以引用外部内存并在回收时回调的字符串类型，因此总是拷贝
+// 创建成功时 *copied（可空）为 true，并且已经同步调用 finalizeCB（可空），调用方可以立即释放 str
+// 创建失败时不会调用 finalizeCB，str 依旧由调用方管理
+// str/length 规则同 napi_create_string_latin1
+NAPI_EXPORT NAPIExceptionStatus napi_create_external_string_latin1(NAPIEnv env, char *str, size_t length,
+                                                                   NAPIFinalize finalizeCB, void *finalizeHint,
+                                                                   NAPIValue *result, bool *copied);
+
+// 规则同 napi_create_external_string_latin1，str/length 规则同 napi_create_string_utf16
+NAPI_EXPORT NAPIExceptionStatus napi_create_external_string_utf16(NAPIEnv env, char16_t *str, size_t length,
+                                                                  NAPIFinalize finalizeCB, void *finalizeHint,
+                                                                  NAPIValue *result, bool *copied);
 
 EXTERN_C_END
 
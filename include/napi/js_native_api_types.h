@@ -15,6 +15,10 @@
 
 EXTERN_C_START
 
+#include <stdbool.h> // NOLINT(modernize-deprecated-headers)
+#include <stddef.h>  // NOLINT(modernize-deprecated-headers)
+#include <stdint.h>  // NOLINT(modernize-deprecated-headers)
+
 typedef struct OpaqueNAPIRuntime *NAPIRuntime;
 typedef struct OpaqueNAPIEnv *NAPIEnv;
 typedef struct OpaqueNAPIValue *NAPIValue;
@@ -22,6 +26,9 @@ typedef struct OpaqueNAPIRef *NAPIRef;
 typedef struct OpaqueNAPIHandleScope *NAPIHandleScope;
 typedef struct OpaqueNAPIEscapableHandleScope *NAPIEscapableHandleScope;
 typedef struct OpaqueNAPICallbackInfo *NAPICallbackInfo;
+typedef struct OpaqueNAPIPropertyKey *NAPIPropertyKey;
+typedef struct OpaqueNAPIScript *NAPIScript;
+typedef struct OpaqueNAPIEnvPool *NAPIEnvPool;
 
 typedef enum
 {
@@ -80,10 +87,163 @@ typedef enum
 #undef NAPI_STATUS
 } NAPIExceptionStatus;
 
+// Hermes 不支持 BigInt，因此不包含 BigInt64Array 和 BigUint64Array
+typedef enum
+{
+    NAPIInt8Array,
+    NAPIUint8Array,
+    NAPIUint8ClampedArray,
+    NAPIInt16Array,
+    NAPIUint16Array,
+    NAPIInt32Array,
+    NAPIUint32Array,
+    NAPIFloat32Array,
+    NAPIFloat64Array,
+} NAPITypedArrayType;
+
 typedef NAPIValue (*NAPICallback)(NAPIEnv env, NAPICallbackInfo callbackInfo);
 
 typedef void (*NAPIFinalize)(void *finalizeData, void *finalizeHint);
 
+typedef struct
+{
+    // utf8name 和 name 二选一，utf8name 优先
+    const char *utf8name;
+    NAPIValue name;
+
+    // method/getter + setter/value 三选一，getter 和 setter 至少一个非空即为访问器属性
+    NAPICallback method;
+    NAPICallback getter;
+    NAPICallback setter;
+    // value 为空当做 undefined
+    NAPIValue value;
+
+    // 访问器属性忽略 NAPIWritable
+    NAPIPropertyAttributes attributes;
+    void *data;
+} NAPIPropertyDescriptor;
+
+typedef struct
+{
+    // 读取到有效缓存并直接执行字节码的次数
+    size_t hitCount;
+    // 没有可用缓存、需要编译源码的次数，包含 rejectCount
+    size_t missCount;
+    // 缓存文件存在但因引擎版本不一致、源码不一致或内容损坏被丢弃的次数
+    size_t rejectCount;
+    // 成功写入缓存文件的次数
+    size_t writeCount;
+} NAPICodeCacheStatistics;
+
+// 全部为 false 时和 NAPIRunScript/NAPICompileToByteBuffer 行为一致
+// 引擎不支持的选项会被忽略，不支持 module 时返回 NAPIInvalidArg
+typedef struct
+{
+    // 启用编译期优化，只有 Hermes 支持，QuickJS 始终优化
+    bool optimize;
+    // 不生成行号等调试信息，QuickJS 中和 stripSource 等价
+    bool stripDebugInfo;
+    // 不保留函数源码，Function.prototype.toString 无法返回源码
+    bool stripSource;
+    // 立即编译所有函数，只影响 Hermes 执行源码，生成字节码时总是立即编译
+    bool eager;
+    bool strict;
+    // 作为 ES module 执行，只有 QuickJS 支持
+    bool module;
+} NAPIScriptOptions;
+
+typedef struct
+{
+    // NAPIEnvPoolAcquire 直接取到预先创建的 env 的次数
+    size_t hitCount;
+    // 池为空、需要等待后台线程或在调用线程同步创建 env 的次数
+    size_t missCount;
+    // 成功创建的 env 总数，包含后台线程和同步创建
+    size_t createCount;
+    // 创建单个 runtime + env 的总耗时和最大耗时
+    uint64_t totalCreateNanoseconds;
+    uint64_t maxCreateNanoseconds;
+} NAPIEnvPoolStatistics;
+
+// 当前头文件对应的 NAPIRuntimeOptions 版本，新增字段只追加在结构体末尾并递增版本
+#define NAPI_RUNTIME_OPTIONS_VERSION 1
+
+// 字段为 0 时使用默认值，引擎不支持的字段会被忽略
+// QuickJS 的堆和栈属于 JSRuntime，在 NAPICreateRuntimeWithOptions 中生效
+// Hermes 每个 env 拥有独立的 runtime，在 NAPICreateEnvWithOptions 中生效，传给 NAPICreateRuntimeWithOptions 则作为
+// 该 runtime 下 NAPICreateEnv 的默认值
+// JSC 没有公开的堆参数，全部忽略
+typedef struct
+{
+    // 必须设置为 NAPI_RUNTIME_OPTIONS_VERSION
+    uint32_t version;
+    // Hermes 堆上限，默认 1GB；QuickJS 为 JS_SetMemoryLimit，默认不限制
+    size_t maxHeapSize;
+    // 只有 Hermes 支持
+    size_t initialHeapSize;
+    // QuickJS 分配多少字节后触发 GC，只有 QuickJS 支持
+    size_t gcThreshold;
+    // QuickJS 原生栈上限，默认 4 * JS_DEFAULT_STACK_SIZE，只有 QuickJS 支持
+    size_t stackSize;
+    // Hermes 寄存器栈大小，决定最大调用深度，只有 Hermes 支持
+    uint32_t maxNumRegisters;
+} NAPIRuntimeOptions;
+
+// 引擎不提供的字段为 0，采集过程不会触发 GC
+typedef struct
+{
+    // 引擎堆中已使用的字节数，QuickJS 为 memory_used_size，Hermes 为 allocatedBytes
+    uint64_t usedHeapSize;
+    // 引擎从系统申请的字节数，QuickJS 为不含 external 内存的 malloc_size，Hermes 为 heapSize
+    uint64_t totalHeapSize;
+    // QuickJS 为 napi_adjust_external_memory 登记的字节数，Hermes 为 externalBytes，包含 ArrayBuffer
+    uint64_t externalMemorySize;
+    // 以下只有 QuickJS 支持
+    uint64_t mallocCount;
+    uint64_t objectCount;
+    uint64_t objectSize;
+    uint64_t stringCount;
+    uint64_t stringSize;
+    uint64_t atomCount;
+    uint64_t atomSize;
+    uint64_t functionCount;
+    // 函数字节码的字节数
+    uint64_t bytecodeSize;
+    // 以下只有 Hermes 支持，包含新生代和老生代
+    uint64_t gcCount;
+    uint64_t gcTotalNanoseconds;
+    uint64_t gcMaxPauseNanoseconds;
+    // 以下为绑定层统计
+    // 当前所有 handleScope 中的 handle 数量，只有 QuickJS 支持
+    size_t handleCount;
+    // 当前打开的 handleScope 数量，JSC 的 handleScope 为空实现，总是 0
+    size_t handleScopeCount;
+    // 引用计数大于 0 的 NAPIRef
+    size_t strongReferenceCount;
+    // 引用计数为 0、引用对象的 NAPIRef
+    size_t weakReferenceCount;
+    // 引用计数为 0、引用标量或对象已经被回收的 NAPIRef
+    size_t valueReferenceCount;
+    // 尚未被回收的 external，包含绑定层内部创建的 external，JSC 不支持
+    size_t externalCount;
+} NAPIHeapStatistics;
+
+// 没有分代 GC 的引擎会执行完整 GC
+typedef enum
+{
+    // QuickJS 为循环引用回收，引用计数为 0 的对象在任何时候都会被立即释放
+    NAPIFullGC,
+    NAPIYoungGC,
+} NAPIGCMode;
+
+typedef enum
+{
+    // 只释放绑定层缓存的空闲内存，不触发 GC
+    NAPIModerateMemoryPressure,
+    // 在 NAPIModerateMemoryPressure 的基础上执行完整 GC，并尽量将空闲内存归还给系统
+    NAPICriticalMemoryPressure,
+} NAPIMemoryPressureLevel;
+
 EXTERN_C_END
 
 #endif // SRC_JS_NATIVE_API_TYPES_H_
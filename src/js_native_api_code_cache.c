@@ -0,0 +1,311 @@
+#include "js_native_api_code_cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 缓存文件格式版本，修改 CodeCacheHeader 时需要递增
+#define CODE_CACHE_MAGIC "NAPICC\0\1"
+
+#define CODE_CACHE_FILE_EXTENSION ".napicache"
+
+// 临时文件后缀，mkstemp 要求以 XXXXXX 结尾
+#define CODE_CACHE_TEMPORARY_SUFFIX ".XXXXXX"
+
+#define HASH_MULTIPLIER_1 0x9E3779B97F4A7C15ULL
+#define HASH_MULTIPLIER_2 0xC2B2AE3D27D4EB4FULL
+
+// 文件名和 sourceHash 使用不同的种子，降低 64 位哈希冲突导致执行错误脚本的概率
+#define FILE_NAME_SEED 0x243F6A8885A308D3ULL
+#define SOURCE_HASH_SEED 0x13198A2E03707344ULL
+
+typedef struct
+{
+    char magic[8];
+    uint64_t versionHash;
+    uint64_t sourceLength;
+    uint64_t sourceHash;
+    uint64_t byteBufferLength;
+    uint64_t byteBufferHash;
+} CodeCacheHeader;
+
+struct NAPICodeCache
+{
+    // directory + "/" + 16 位十六进制 + 扩展名，之后存放临时文件路径，复用同一块内存拼接路径
+    char *pathBuffer;
+    size_t directoryLength;
+    uint64_t versionHash;
+    NAPICodeCacheStatistics statistics;
+};
+
+static inline uint64_t rotateLeft(uint64_t value, unsigned int shift)
+{
+    return (value << shift) | (value >> (64 - shift));
+}
+
+static inline uint64_t finalizeHash(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+// 每次处理 8 字节，源码通常在数百 KB 以上，逐字节的 FNV 会明显拖慢命中路径
+static uint64_t hashBytes(const void *data, size_t length, uint64_t seed)
+{
+    const uint8_t *bytes = data;
+    uint64_t hash = seed ^ ((uint64_t)length * HASH_MULTIPLIER_1);
+    for (; length >= 8; bytes += 8, length -= 8)
+    {
+        uint64_t block;
+        memcpy(&block, bytes, 8);
+        hash ^= rotateLeft(block * HASH_MULTIPLIER_2, 31) * HASH_MULTIPLIER_1;
+        hash = rotateLeft(hash, 27) * HASH_MULTIPLIER_1 + 0x52DCE729;
+    }
+    if (length)
+    {
+        uint64_t block = 0;
+        memcpy(&block, bytes, length);
+        hash ^= rotateLeft(block * HASH_MULTIPLIER_2, 31) * HASH_MULTIPLIER_1;
+    }
+
+    return finalizeHash(hash);
+}
+
+NAPICodeCache *NAPICodeCacheCreate(const char *directory, const char *versionTag)
+{
+    size_t directoryLength = strlen(directory);
+    // 去掉末尾的 /，保证拼接出的路径一致
+    while (directoryLength > 1 && directory[directoryLength - 1] == '/')
+    {
+        --directoryLength;
+    }
+    NAPICodeCache *codeCache = malloc(sizeof(NAPICodeCache));
+    if (!codeCache)
+    {
+        return NULL;
+    }
+    // 缓存文件路径之后紧跟临时文件路径
+    size_t pathLength = directoryLength + 1 + 16 + sizeof(CODE_CACHE_FILE_EXTENSION) - 1;
+    codeCache->pathBuffer = malloc(pathLength + 1 + pathLength + sizeof(CODE_CACHE_TEMPORARY_SUFFIX));
+    if (!codeCache->pathBuffer)
+    {
+        free(codeCache);
+
+        return NULL;
+    }
+    memcpy(codeCache->pathBuffer, directory, directoryLength);
+    codeCache->pathBuffer[directoryLength] = '/';
+    codeCache->directoryLength = directoryLength;
+    // 字节码和指针宽度、字节序相关，一并计入版本
+    uint64_t platformTag[2] = {sizeof(void *), 0x0102030405060708ULL};
+    codeCache->versionHash = hashBytes(versionTag, strlen(versionTag), hashBytes(platformTag, sizeof(platformTag), 0));
+    memset(&codeCache->statistics, 0, sizeof(NAPICodeCacheStatistics));
+
+    return codeCache;
+}
+
+void NAPICodeCacheFree(NAPICodeCache *codeCache)
+{
+    if (codeCache)
+    {
+        free(codeCache->pathBuffer);
+        free(codeCache);
+    }
+}
+
+void NAPICodeCacheGetStatistics(const NAPICodeCache *codeCache, NAPICodeCacheStatistics *result)
+{
+    *result = codeCache->statistics;
+}
+
+// 返回值指向 codeCache->pathBuffer，下一次调用前有效
+static const char *buildPath(NAPICodeCache *codeCache, uint64_t fileHash)
+{
+    snprintf(codeCache->pathBuffer + codeCache->directoryLength + 1,
+             16 + sizeof(CODE_CACHE_FILE_EXTENSION),
+             "%016" PRIx64 CODE_CACHE_FILE_EXTENSION, fileHash);
+
+    return codeCache->pathBuffer;
+}
+
+static bool readFully(int fd, void *buffer, size_t length)
+{
+    uint8_t *bytes = buffer;
+    while (length)
+    {
+        ssize_t readLength = read(fd, bytes, length);
+        if (readLength < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (readLength <= 0)
+        {
+            return false;
+        }
+        bytes += readLength;
+        length -= (size_t)readLength;
+    }
+
+    return true;
+}
+
+static bool writeFully(int fd, const void *buffer, size_t length)
+{
+    const uint8_t *bytes = buffer;
+    while (length)
+    {
+        ssize_t writeLength = write(fd, bytes, length);
+        if (writeLength < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (writeLength <= 0)
+        {
+            return false;
+        }
+        bytes += writeLength;
+        length -= (size_t)writeLength;
+    }
+
+    return true;
+}
+
+// 文件不存在返回 NULL 且 *isRejected 为 false，文件无效返回 NULL 且 *isRejected 为 true
+static uint8_t *loadByteBuffer(const char *path, const CodeCacheHeader *expectedHeader, size_t *bufferSize,
+                               bool *isRejected)
+{
+    *isRejected = false;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    *isRejected = true;
+    uint8_t *byteBuffer = NULL;
+    CodeCacheHeader header;
+    struct stat fileStat;
+    if (!readFully(fd, &header, sizeof(CodeCacheHeader)) ||
+        memcmp(header.magic, expectedHeader->magic, sizeof(header.magic)) ||
+        header.versionHash != expectedHeader->versionHash || header.sourceLength != expectedHeader->sourceLength ||
+        header.sourceHash != expectedHeader->sourceHash || fstat(fd, &fileStat) ||
+        (uint64_t)fileStat.st_size != sizeof(CodeCacheHeader) + header.byteBufferLength || !header.byteBufferLength)
+    {
+        goto cleanup;
+    }
+    byteBuffer = malloc(header.byteBufferLength);
+    if (!byteBuffer)
+    {
+        goto cleanup;
+    }
+    if (!readFully(fd, byteBuffer, header.byteBufferLength) ||
+        hashBytes(byteBuffer, header.byteBufferLength, SOURCE_HASH_SEED) != header.byteBufferHash)
+    {
+        free(byteBuffer);
+        byteBuffer = NULL;
+        goto cleanup;
+    }
+    *bufferSize = header.byteBufferLength;
+    *isRejected = false;
+
+cleanup:
+    close(fd);
+
+    return byteBuffer;
+}
+
+// 先写入同目录下的临时文件再 rename，其他进程或并发的 env 不会读到写了一半的文件
+static bool storeByteBuffer(char *path, CodeCacheHeader *header, const uint8_t *byteBuffer, size_t bufferSize)
+{
+    size_t pathLength = strlen(path);
+    char *temporaryPath = path + pathLength + 1;
+    memcpy(temporaryPath, path, pathLength);
+    memcpy(temporaryPath + pathLength, CODE_CACHE_TEMPORARY_SUFFIX, sizeof(CODE_CACHE_TEMPORARY_SUFFIX));
+    int fd = mkstemp(temporaryPath);
+    if (fd < 0)
+    {
+        return false;
+    }
+    header->byteBufferLength = bufferSize;
+    header->byteBufferHash = hashBytes(byteBuffer, bufferSize, SOURCE_HASH_SEED);
+    bool isWritten = writeFully(fd, header, sizeof(CodeCacheHeader)) && writeFully(fd, byteBuffer, bufferSize);
+    isWritten = !close(fd) && isWritten;
+    if (!isWritten || rename(temporaryPath, path))
+    {
+        unlink(temporaryPath);
+
+        return false;
+    }
+
+    return true;
+}
+
+NAPIExceptionStatus NAPICodeCacheRunScript(NAPIEnv env, NAPICodeCache *codeCache, const char *script,
+                                           const char *sourceUrl, NAPIValue *result)
+{
+    if (!script)
+    {
+        script = "";
+    }
+    if (!sourceUrl)
+    {
+        sourceUrl = "";
+    }
+    size_t scriptLength = strlen(script);
+    size_t sourceUrlLength = strlen(sourceUrl);
+    CodeCacheHeader header;
+    memcpy(header.magic, CODE_CACHE_MAGIC, sizeof(header.magic));
+    header.versionHash = codeCache->versionHash;
+    header.sourceLength = scriptLength;
+    header.sourceHash =
+        hashBytes(script, scriptLength, hashBytes(sourceUrl, sourceUrlLength, SOURCE_HASH_SEED));
+    // 文件名不包含版本，引擎升级后旧文件在读取时被丢弃并被新字节码覆盖，不会在目录中残留
+    const char *path = buildPath(
+        codeCache, hashBytes(script, scriptLength, hashBytes(sourceUrl, sourceUrlLength, FILE_NAME_SEED)));
+
+    bool isRejected;
+    size_t bufferSize = 0;
+    uint8_t *byteBuffer = loadByteBuffer(path, &header, &bufferSize, &isRejected);
+    if (byteBuffer)
+    {
+        NAPIExceptionStatus status = NAPIRunCachedByteBuffer(env, byteBuffer, bufferSize, result);
+        free(byteBuffer);
+        if (status != NAPIExceptionGenericFailure)
+        {
+            ++codeCache->statistics.hitCount;
+
+            return status;
+        }
+        // 通过了文件头校验但被引擎拒绝，按损坏的缓存处理
+        isRejected = true;
+    }
+    ++codeCache->statistics.missCount;
+    if (isRejected)
+    {
+        ++codeCache->statistics.rejectCount;
+    }
+
+    const uint8_t *compiledByteBuffer = NULL;
+    NAPIExceptionStatus status = NAPICompileToByteBuffer(env, script, sourceUrl, &compiledByteBuffer, &bufferSize);
+    if (status != NAPIExceptionOK)
+    {
+        return status;
+    }
+    if (storeByteBuffer(codeCache->pathBuffer, &header, compiledByteBuffer, bufferSize))
+    {
+        ++codeCache->statistics.writeCount;
+    }
+    status = NAPIRunByteBuffer(env, compiledByteBuffer, bufferSize, result);
+    NAPIFreeByteBuffer(env, compiledByteBuffer);
+
+    return status;
+}
@@ -0,0 +1,32 @@
+#ifndef SRC_JS_NATIVE_API_CODE_CACHE_H_
+#define SRC_JS_NATIVE_API_CODE_CACHE_H_
+
+// 内部使用的磁盘字节码缓存，不对外导出
+// 基于 NAPICompileToByteBuffer/NAPIRunByteBuffer 实现，由各引擎的 NAPIRunScript 调用
+
+#include <napi/js_native_api.h>
+
+EXTERN_C_START
+
+typedef struct NAPICodeCache NAPICodeCache;
+
+// versionTag 标识引擎和字节码格式版本，不一致的缓存文件会被丢弃
+// 返回 NULL 代表内存分配失败
+NAPICodeCache *NAPICodeCacheCreate(const char *directory, const char *versionTag);
+
+void NAPICodeCacheFree(NAPICodeCache *codeCache);
+
+// 命中时执行缓存的字节码，未命中时编译源码、写入缓存后执行，写入失败不影响执行结果
+NAPIExceptionStatus NAPICodeCacheRunScript(NAPIEnv env, NAPICodeCache *codeCache, const char *script,
+                                           const char *sourceUrl, NAPIValue *result);
+
+void NAPICodeCacheGetStatistics(const NAPICodeCache *codeCache, NAPICodeCacheStatistics *result);
+
+// 由各引擎实现，字节码被引擎拒绝时不留下异常并返回 NAPIExceptionGenericFailure，其余和 NAPIRunByteBuffer 一致
+// 文件头校验无法覆盖引擎内部的格式检查，拒绝后 NAPICodeCacheRunScript 回退到编译源码并覆盖缓存文件
+NAPIExceptionStatus NAPIRunCachedByteBuffer(NAPIEnv env, const uint8_t *byteBuffer, size_t bufferSize,
+                                            NAPIValue *result);
+
+EXTERN_C_END
+
+#endif // SRC_JS_NATIVE_API_CODE_CACHE_H_
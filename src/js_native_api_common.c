@@ -43,43 +43,42 @@ NAPIExceptionStatus napi_get_named_property(NAPIEnv env, NAPIValue object, const
     return NAPIExceptionOK;
 }
 
-// NAPIBooleanExpected
-NAPIExceptionStatus napi_strict_equals(NAPIEnv env, NAPIValue lhs, NAPIValue rhs, bool *result)
+// 引擎没有外部字符串支持，拷贝后立即调用 finalizeCB
+NAPIExceptionStatus napi_create_external_string_latin1(NAPIEnv env, char *str, size_t length, NAPIFinalize finalizeCB,
+                                                       void *finalizeHint, NAPIValue *result, bool *copied)
 {
     CHECK_ARG(env);
-    CHECK_ARG(lhs);
-    CHECK_ARG(rhs);
     CHECK_ARG(result);
 
-    NAPIValue global, objectCtor, is;
-    CHECK_NAPI(napi_get_global(env, &global), Error);
-    CHECK_NAPI(napi_get_named_property(env, global, "Object", &objectCtor), Exception);
-    CHECK_NAPI(napi_get_named_property(env, objectCtor, "is", &is), Exception);
-    NAPIValue argv[] = {lhs, rhs};
-    NAPIValue resultValue;
-    CHECK_NAPI(napi_call_function(env, objectCtor, is, 2, argv, &resultValue), Exception);
-    NAPIValueType valueType;
-    CHECK_NAPI(napi_typeof(env, resultValue, &valueType), Common);
-    RETURN_STATUS_IF_FALSE(valueType == NAPIBoolean, NAPIExceptionBooleanExpected);
-    CHECK_NAPI(napi_get_value_bool(env, resultValue, result), Error);
+    CHECK_NAPI(napi_create_string_latin1(env, str, length, result), Exception);
+    if (copied)
+    {
+        *copied = true;
+    }
+    if (finalizeCB)
+    {
+        finalizeCB(str, finalizeHint);
+    }
 
     return NAPIExceptionOK;
 }
 
-NAPIExceptionStatus NAPIParseUTF8JSONString(NAPIEnv env, const char *utf8String, NAPIValue *result)
+NAPIExceptionStatus napi_create_external_string_utf16(NAPIEnv env, char16_t *str, size_t length,
+                                                      NAPIFinalize finalizeCB, void *finalizeHint, NAPIValue *result,
+                                                      bool *copied)
 {
     CHECK_ARG(env);
-    CHECK_ARG(utf8String);
     CHECK_ARG(result);
 
-    NAPIValue stringValue;
-    CHECK_NAPI(napi_create_string_utf8(env, utf8String, &stringValue), Exception);
-    NAPIValue global;
-    CHECK_NAPI(napi_get_global(env, &global), Error);
-    NAPIValue json, parse;
-    CHECK_NAPI(napi_get_named_property(env, global, "JSON", &json), Exception);
-    CHECK_NAPI(napi_get_named_property(env, json, "parse", &parse), Exception);
-    CHECK_NAPI(napi_call_function(env, json, parse, 1, &stringValue, result), Exception);
+    CHECK_NAPI(napi_create_string_utf16(env, str, length, result), Exception);
+    if (copied)
+    {
+        *copied = true;
+    }
+    if (finalizeCB)
+    {
+        finalizeCB(str, finalizeHint);
+    }
 
     return NAPIExceptionOK;
 }
@@ -0,0 +1,310 @@
+#include <napi/js_native_api.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/queue.h>
+#include <time.h>
+
+#include "js_native_api_env_pool.h"
+
+// 只依赖公开的 NAPICreateRuntime/NAPICreateEnv 和各引擎实现的 NAPIAttachEnvToCurrentThread，三个引擎共用同一份实现
+// 引擎本身没有办法把一个 env 恢复到刚创建的状态，因此归还的 env 不做重置，而是交给后台线程销毁后重新创建
+
+#define RETURN_STATUS_IF_FALSE(condition, status)                                                                      \
+    if (!(condition))                                                                                                  \
+    {                                                                                                                  \
+        return status;                                                                                                 \
+    }
+
+#define CHECK_ARG(arg, status) RETURN_STATUS_IF_FALSE(arg, NAPI##status##InvalidArg)
+
+struct PooledEnv
+{
+    SLIST_ENTRY(PooledEnv) node; // size_t
+    NAPIRuntime runtime;         // size_t
+    NAPIEnv env;                 // size_t
+};
+
+SLIST_HEAD(PooledEnvList, PooledEnv);
+
+struct OpaqueNAPIEnvPool
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+    pthread_t thread;
+    // 已经创建好、可以直接取出的 env
+    struct PooledEnvList readyList;
+    // 已经借出的 env，归还时用于找到对应的 runtime
+    struct PooledEnvList acquiredList;
+    // 已经归还、等待后台线程销毁的 env
+    struct PooledEnvList releaseList;
+    size_t capacity;
+    size_t readyCount;
+    NAPIEnvPoolStatistics statistics;
+    // 后台线程创建失败后不再重试，直到下一次 NAPIEnvPoolAcquire 唤醒
+    bool isCreateFailed;
+    // 同一时间只允许一个线程创建 env，避免后台线程和 NAPIEnvPoolAcquire 重复创建
+    bool isCreating;
+    bool isStopping;
+};
+
+static uint64_t getNanoseconds(void)
+{
+    struct timespec timeSpec;
+    clock_gettime(CLOCK_MONOTONIC, &timeSpec);
+
+    return (uint64_t)timeSpec.tv_sec * 1000000000 + (uint64_t)timeSpec.tv_nsec;
+}
+
+// 不需要持有锁，*elapsedNanoseconds 返回创建耗时
+static struct PooledEnv *createPooledEnv(uint64_t *elapsedNanoseconds)
+{
+    uint64_t begin = getNanoseconds();
+    struct PooledEnv *pooledEnv = malloc(sizeof(struct PooledEnv));
+    if (!pooledEnv)
+    {
+        return NULL;
+    }
+    pooledEnv->runtime = NULL;
+    if (NAPICreateRuntime(&pooledEnv->runtime) != NAPIErrorOK)
+    {
+        free(pooledEnv);
+
+        return NULL;
+    }
+    if (NAPICreateEnv(&pooledEnv->env, pooledEnv->runtime) != NAPIErrorOK)
+    {
+        NAPIFreeRuntime(pooledEnv->runtime);
+        free(pooledEnv);
+
+        return NULL;
+    }
+    *elapsedNanoseconds = getNanoseconds() - begin;
+
+    return pooledEnv;
+}
+
+static void destroyPooledEnv(struct PooledEnv *pooledEnv)
+{
+    NAPIFreeEnv(pooledEnv->env);
+    NAPIFreeRuntime(pooledEnv->runtime);
+    free(pooledEnv);
+}
+
+static void destroyPooledEnvList(struct PooledEnvList *list)
+{
+    while (!SLIST_EMPTY(list))
+    {
+        struct PooledEnv *pooledEnv = SLIST_FIRST(list);
+        SLIST_REMOVE_HEAD(list, node);
+        destroyPooledEnv(pooledEnv);
+    }
+}
+
+// 需要持有锁
+static void recordCreate(NAPIEnvPool pool, uint64_t elapsedNanoseconds)
+{
+    ++pool->statistics.createCount;
+    pool->statistics.totalCreateNanoseconds += elapsedNanoseconds;
+    if (elapsedNanoseconds > pool->statistics.maxCreateNanoseconds)
+    {
+        pool->statistics.maxCreateNanoseconds = elapsedNanoseconds;
+    }
+}
+
+static void *poolThreadMain(void *data)
+{
+    NAPIEnvPool pool = data;
+    pthread_mutex_lock(&pool->mutex);
+    while (true)
+    {
+        // 先销毁归还的 env，退出前也需要处理完
+        if (!SLIST_EMPTY(&pool->releaseList))
+        {
+            struct PooledEnvList releaseList = pool->releaseList;
+            SLIST_INIT(&pool->releaseList);
+            pthread_mutex_unlock(&pool->mutex);
+            destroyPooledEnvList(&releaseList);
+            pthread_mutex_lock(&pool->mutex);
+            continue;
+        }
+        if (pool->isStopping)
+        {
+            break;
+        }
+        if (pool->readyCount < pool->capacity && !pool->isCreateFailed && !pool->isCreating)
+        {
+            pool->isCreating = true;
+            pthread_mutex_unlock(&pool->mutex);
+            uint64_t elapsedNanoseconds = 0;
+            struct PooledEnv *pooledEnv = createPooledEnv(&elapsedNanoseconds);
+            pthread_mutex_lock(&pool->mutex);
+            pool->isCreating = false;
+            // 唤醒等待后台线程创建完成的 NAPIEnvPoolAcquire
+            pthread_cond_broadcast(&pool->condition);
+            if (pooledEnv)
+            {
+                recordCreate(pool, elapsedNanoseconds);
+                SLIST_INSERT_HEAD(&pool->readyList, pooledEnv, node);
+                ++pool->readyCount;
+            }
+            else
+            {
+                pool->isCreateFailed = true;
+            }
+            continue;
+        }
+        pthread_cond_wait(&pool->condition, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+NAPIErrorStatus NAPICreateEnvPool(size_t capacity, NAPIEnvPool *result)
+{
+    CHECK_ARG(capacity, Error)
+    CHECK_ARG(result, Error)
+
+    NAPIEnvPool pool = calloc(1, sizeof(struct OpaqueNAPIEnvPool));
+    RETURN_STATUS_IF_FALSE(pool, NAPIErrorMemoryError)
+    pool->capacity = capacity;
+    SLIST_INIT(&pool->readyList);
+    SLIST_INIT(&pool->acquiredList);
+    SLIST_INIT(&pool->releaseList);
+    if (pthread_mutex_init(&pool->mutex, NULL))
+    {
+        free(pool);
+
+        return NAPIErrorGenericFailure;
+    }
+    if (pthread_cond_init(&pool->condition, NULL))
+    {
+        pthread_mutex_destroy(&pool->mutex);
+        free(pool);
+
+        return NAPIErrorGenericFailure;
+    }
+    if (pthread_create(&pool->thread, NULL, poolThreadMain, pool))
+    {
+        pthread_cond_destroy(&pool->condition);
+        pthread_mutex_destroy(&pool->mutex);
+        free(pool);
+
+        return NAPIErrorGenericFailure;
+    }
+    *result = pool;
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus NAPIEnvPoolAcquire(NAPIEnvPool pool, NAPIEnv *result)
+{
+    CHECK_ARG(pool, Error)
+    CHECK_ARG(result, Error)
+
+    pthread_mutex_lock(&pool->mutex);
+    if (SLIST_EMPTY(&pool->readyList))
+    {
+        ++pool->statistics.missCount;
+        // 后台线程正在创建时等待它完成，比在当前线程重新创建更快
+        while (SLIST_EMPTY(&pool->readyList) && pool->isCreating)
+        {
+            pthread_cond_wait(&pool->condition, &pool->mutex);
+        }
+    }
+    else
+    {
+        ++pool->statistics.hitCount;
+    }
+    struct PooledEnv *pooledEnv = SLIST_FIRST(&pool->readyList);
+    if (pooledEnv)
+    {
+        SLIST_REMOVE_HEAD(&pool->readyList, node);
+        --pool->readyCount;
+    }
+    else
+    {
+        pool->isCreating = true;
+        pthread_mutex_unlock(&pool->mutex);
+        uint64_t elapsedNanoseconds = 0;
+        pooledEnv = createPooledEnv(&elapsedNanoseconds);
+        pthread_mutex_lock(&pool->mutex);
+        pool->isCreating = false;
+        if (pooledEnv)
+        {
+            recordCreate(pool, elapsedNanoseconds);
+        }
+    }
+    if (pooledEnv)
+    {
+        SLIST_INSERT_HEAD(&pool->acquiredList, pooledEnv, node);
+    }
+    pool->isCreateFailed = false;
+    pthread_cond_broadcast(&pool->condition);
+    pthread_mutex_unlock(&pool->mutex);
+    RETURN_STATUS_IF_FALSE(pooledEnv, NAPIErrorMemoryError)
+    NAPIAttachEnvToCurrentThread(pooledEnv->env);
+    *result = pooledEnv->env;
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus NAPIEnvPoolRelease(NAPIEnvPool pool, NAPIEnv env)
+{
+    CHECK_ARG(pool, Error)
+    CHECK_ARG(env, Error)
+
+    pthread_mutex_lock(&pool->mutex);
+    struct PooledEnv *pooledEnv;
+    SLIST_FOREACH(pooledEnv, &pool->acquiredList, node)
+    {
+        if (pooledEnv->env == env)
+        {
+            break;
+        }
+    }
+    if (!pooledEnv)
+    {
+        pthread_mutex_unlock(&pool->mutex);
+
+        return NAPIErrorInvalidArg;
+    }
+    SLIST_REMOVE(&pool->acquiredList, pooledEnv, PooledEnv, node);
+    SLIST_INSERT_HEAD(&pool->releaseList, pooledEnv, node);
+    pthread_cond_broadcast(&pool->condition);
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus NAPIGetEnvPoolStatistics(NAPIEnvPool pool, NAPIEnvPoolStatistics *result)
+{
+    CHECK_ARG(pool, Error)
+    CHECK_ARG(result, Error)
+
+    pthread_mutex_lock(&pool->mutex);
+    *result = pool->statistics;
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus NAPIFreeEnvPool(NAPIEnvPool pool)
+{
+    CHECK_ARG(pool, Common)
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->isStopping = true;
+    pthread_cond_broadcast(&pool->condition);
+    pthread_mutex_unlock(&pool->mutex);
+    pthread_join(pool->thread, NULL);
+
+    destroyPooledEnvList(&pool->readyList);
+    destroyPooledEnvList(&pool->acquiredList);
+    destroyPooledEnvList(&pool->releaseList);
+    pthread_cond_destroy(&pool->condition);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+
+    return NAPICommonOK;
+}
@@ -0,0 +1,17 @@
+#ifndef SRC_JS_NATIVE_API_ENV_POOL_H_
+#define SRC_JS_NATIVE_API_ENV_POOL_H_
+
+// 内部使用的 env 池钩子，不对外导出
+// 由各引擎实现，NAPIEnvPoolAcquire 在调用线程取出 env 后调用
+
+#include <napi/js_native_api.h>
+
+EXTERN_C_START
+
+// env 可能在池的后台线程创建，借出后需要更新引擎记录的线程相关状态
+// 例如 QuickJS 的栈溢出检查依赖创建 runtime 时记录的栈顶
+void NAPIAttachEnvToCurrentThread(NAPIEnv env);
+
+EXTERN_C_END
+
+#endif // SRC_JS_NATIVE_API_ENV_POOL_H_
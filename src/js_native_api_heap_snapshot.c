@@ -0,0 +1,405 @@
+#include "js_native_api_heap_snapshot.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 每个节点在 nodes 数组中占用的字段数，需要和 meta 中的 node_fields 保持一致
+#define NODE_FIELD_COUNT 6
+
+#define INITIAL_CAPACITY 256
+
+static const char *const snapshotMeta =
+    "{\"snapshot\":{\"meta\":{"
+    "\"node_fields\":[\"type\",\"name\",\"id\",\"self_size\",\"edge_count\",\"trace_node_id\"],"
+    "\"node_types\":[[\"hidden\",\"array\",\"string\",\"object\",\"code\",\"closure\",\"regexp\",\"number\","
+    "\"native\",\"synthetic\",\"concatenated string\",\"sliced string\",\"symbol\",\"bigint\"],"
+    "\"string\",\"number\",\"number\",\"number\",\"number\",\"number\"],"
+    "\"edge_fields\":[\"type\",\"name_or_index\",\"to_node\"],"
+    "\"edge_types\":[[\"context\",\"element\",\"property\",\"internal\",\"hidden\",\"shortcut\",\"weak\"],"
+    "\"string_or_number\",\"node\"],"
+    "\"trace_function_info_fields\":[],\"trace_node_fields\":[],\"sample_fields\":[],\"location_fields\":[]},";
+
+typedef struct
+{
+    size_t nameIndex;
+    size_t selfSize;
+    size_t edgeCount;
+    NAPIHeapSnapshotNodeType type;
+} HeapSnapshotNode;
+
+typedef struct
+{
+    size_t from;
+    size_t to;
+    // element/hidden 为下标，其他为 strings 中的序号
+    size_t nameOrIndex;
+    NAPIHeapSnapshotEdgeType type;
+} HeapSnapshotEdge;
+
+typedef struct
+{
+    const void *address;
+    size_t nodeIndex;
+} AddressEntry;
+
+struct NAPIHeapSnapshot
+{
+    HeapSnapshotNode *nodes;
+    size_t nodeCount;
+    size_t nodeCapacity;
+    HeapSnapshotEdge *edges;
+    size_t edgeCount;
+    size_t edgeCapacity;
+    char **strings;
+    size_t stringCount;
+    size_t stringCapacity;
+    // 开放寻址哈希表，容量为 2 的幂，负载不超过一半
+    // 存放 strings 序号 + 1，0 代表空位
+    size_t *stringTable;
+    size_t stringTableCapacity;
+    AddressEntry *addressTable;
+    size_t addressCount;
+    size_t addressTableCapacity;
+};
+
+static bool reserve(void **array, size_t *capacity, size_t count, size_t elementSize)
+{
+    if (count < *capacity)
+    {
+        return true;
+    }
+    size_t newCapacity = *capacity ? *capacity * 2 : INITIAL_CAPACITY;
+    void *newArray = realloc(*array, newCapacity * elementSize);
+    if (!newArray)
+    {
+        return false;
+    }
+    *array = newArray;
+    *capacity = newCapacity;
+
+    return true;
+}
+
+static inline size_t hashString(const char *string)
+{
+    // FNV-1a，属性名通常很短
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (; *string; ++string)
+    {
+        hash ^= (uint8_t)*string;
+        hash *= 0x100000001B3ULL;
+    }
+
+    return (size_t)hash;
+}
+
+static inline size_t hashAddress(const void *address)
+{
+    uint64_t hash = (uint64_t)(uintptr_t)address * 0x9E3779B97F4A7C15ULL;
+
+    return (size_t)(hash ^ (hash >> 32));
+}
+
+static bool rehashStrings(NAPIHeapSnapshot *snapshot)
+{
+    size_t capacity = snapshot->stringTableCapacity ? snapshot->stringTableCapacity * 2 : INITIAL_CAPACITY;
+    size_t *table = calloc(capacity, sizeof(size_t));
+    if (!table)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < snapshot->stringCount; ++i)
+    {
+        size_t slot = hashString(snapshot->strings[i]) & (capacity - 1);
+        while (table[slot])
+        {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        table[slot] = i + 1;
+    }
+    free(snapshot->stringTable);
+    snapshot->stringTable = table;
+    snapshot->stringTableCapacity = capacity;
+
+    return true;
+}
+
+// 相同的字符串只保存一份，返回 SIZE_MAX 代表内存分配失败
+static size_t internString(NAPIHeapSnapshot *snapshot, const char *string)
+{
+    if (!string)
+    {
+        string = "";
+    }
+    if ((snapshot->stringCount + 1) * 2 > snapshot->stringTableCapacity && !rehashStrings(snapshot))
+    {
+        return SIZE_MAX;
+    }
+    size_t slot = hashString(string) & (snapshot->stringTableCapacity - 1);
+    while (snapshot->stringTable[slot])
+    {
+        size_t stringIndex = snapshot->stringTable[slot] - 1;
+        if (!strcmp(snapshot->strings[stringIndex], string))
+        {
+            return stringIndex;
+        }
+        slot = (slot + 1) & (snapshot->stringTableCapacity - 1);
+    }
+    if (!reserve((void **)&snapshot->strings, &snapshot->stringCapacity, snapshot->stringCount, sizeof(char *)))
+    {
+        return SIZE_MAX;
+    }
+    char *copiedString = strdup(string);
+    if (!copiedString)
+    {
+        return SIZE_MAX;
+    }
+    snapshot->strings[snapshot->stringCount] = copiedString;
+    snapshot->stringTable[slot] = ++snapshot->stringCount;
+
+    return snapshot->stringCount - 1;
+}
+
+static bool rehashAddresses(NAPIHeapSnapshot *snapshot)
+{
+    size_t capacity = snapshot->addressTableCapacity ? snapshot->addressTableCapacity * 2 : INITIAL_CAPACITY;
+    AddressEntry *table = calloc(capacity, sizeof(AddressEntry));
+    if (!table)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < snapshot->addressTableCapacity; ++i)
+    {
+        if (!snapshot->addressTable[i].address)
+        {
+            continue;
+        }
+        size_t slot = hashAddress(snapshot->addressTable[i].address) & (capacity - 1);
+        while (table[slot].address)
+        {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        table[slot] = snapshot->addressTable[i];
+    }
+    free(snapshot->addressTable);
+    snapshot->addressTable = table;
+    snapshot->addressTableCapacity = capacity;
+
+    return true;
+}
+
+NAPIHeapSnapshot *NAPIHeapSnapshotCreate(void)
+{
+    return calloc(1, sizeof(NAPIHeapSnapshot));
+}
+
+void NAPIHeapSnapshotFree(NAPIHeapSnapshot *snapshot)
+{
+    if (!snapshot)
+    {
+        return;
+    }
+    for (size_t i = 0; i < snapshot->stringCount; ++i)
+    {
+        free(snapshot->strings[i]);
+    }
+    free(snapshot->strings);
+    free(snapshot->stringTable);
+    free(snapshot->addressTable);
+    free(snapshot->nodes);
+    free(snapshot->edges);
+    free(snapshot);
+}
+
+size_t NAPIHeapSnapshotAddNode(NAPIHeapSnapshot *snapshot, const void *address, NAPIHeapSnapshotNodeType type,
+                               const char *name, size_t selfSize, bool *isNew)
+{
+    if (isNew)
+    {
+        *isNew = false;
+    }
+    size_t slot = 0;
+    if (address)
+    {
+        if ((snapshot->addressCount + 1) * 2 > snapshot->addressTableCapacity && !rehashAddresses(snapshot))
+        {
+            return NAPI_HEAP_SNAPSHOT_INVALID_NODE;
+        }
+        slot = hashAddress(address) & (snapshot->addressTableCapacity - 1);
+        while (snapshot->addressTable[slot].address)
+        {
+            if (snapshot->addressTable[slot].address == address)
+            {
+                return snapshot->addressTable[slot].nodeIndex;
+            }
+            slot = (slot + 1) & (snapshot->addressTableCapacity - 1);
+        }
+    }
+    size_t nameIndex = internString(snapshot, name);
+    if (nameIndex == SIZE_MAX ||
+        !reserve((void **)&snapshot->nodes, &snapshot->nodeCapacity, snapshot->nodeCount, sizeof(HeapSnapshotNode)))
+    {
+        return NAPI_HEAP_SNAPSHOT_INVALID_NODE;
+    }
+    HeapSnapshotNode *node = &snapshot->nodes[snapshot->nodeCount];
+    node->type = type;
+    node->nameIndex = nameIndex;
+    node->selfSize = selfSize;
+    node->edgeCount = 0;
+    if (address)
+    {
+        snapshot->addressTable[slot].address = address;
+        snapshot->addressTable[slot].nodeIndex = snapshot->nodeCount;
+        ++snapshot->addressCount;
+    }
+    if (isNew)
+    {
+        *isNew = true;
+    }
+
+    return snapshot->nodeCount++;
+}
+
+size_t NAPIHeapSnapshotFindNode(const NAPIHeapSnapshot *snapshot, const void *address)
+{
+    if (!snapshot->addressTableCapacity)
+    {
+        return NAPI_HEAP_SNAPSHOT_INVALID_NODE;
+    }
+    size_t slot = hashAddress(address) & (snapshot->addressTableCapacity - 1);
+    while (snapshot->addressTable[slot].address)
+    {
+        if (snapshot->addressTable[slot].address == address)
+        {
+            return snapshot->addressTable[slot].nodeIndex;
+        }
+        slot = (slot + 1) & (snapshot->addressTableCapacity - 1);
+    }
+
+    return NAPI_HEAP_SNAPSHOT_INVALID_NODE;
+}
+
+static bool addEdge(NAPIHeapSnapshot *snapshot, size_t from, size_t to, NAPIHeapSnapshotEdgeType type,
+                    size_t nameOrIndex)
+{
+    if (from >= snapshot->nodeCount || to >= snapshot->nodeCount ||
+        !reserve((void **)&snapshot->edges, &snapshot->edgeCapacity, snapshot->edgeCount, sizeof(HeapSnapshotEdge)))
+    {
+        return false;
+    }
+    HeapSnapshotEdge *edge = &snapshot->edges[snapshot->edgeCount++];
+    edge->from = from;
+    edge->to = to;
+    edge->nameOrIndex = nameOrIndex;
+    edge->type = type;
+    ++snapshot->nodes[from].edgeCount;
+
+    return true;
+}
+
+bool NAPIHeapSnapshotAddEdge(NAPIHeapSnapshot *snapshot, size_t from, size_t to, NAPIHeapSnapshotEdgeType type,
+                             const char *name)
+{
+    size_t nameIndex = internString(snapshot, name);
+
+    return nameIndex != SIZE_MAX && addEdge(snapshot, from, to, type, nameIndex);
+}
+
+bool NAPIHeapSnapshotAddIndexedEdge(NAPIHeapSnapshot *snapshot, size_t from, size_t to,
+                                    NAPIHeapSnapshotEdgeType type, size_t index)
+{
+    return addEdge(snapshot, from, to, type, index);
+}
+
+static void writeString(FILE *file, const char *string)
+{
+    fputc('"', file);
+    for (; *string; ++string)
+    {
+        unsigned char character = (unsigned char)*string;
+        if (character == '"' || character == '\\')
+        {
+            fputc('\\', file);
+            fputc(character, file);
+        }
+        else if (character == '\n')
+        {
+            fputs("\\n", file);
+        }
+        else if (character < 0x20)
+        {
+            fprintf(file, "\\u%04x", character);
+        }
+        else
+        {
+            fputc(character, file);
+        }
+    }
+    fputc('"', file);
+}
+
+bool NAPIHeapSnapshotWrite(const NAPIHeapSnapshot *snapshot, const char *path)
+{
+    // 格式要求同一个节点的边连续存放，并且按节点顺序排列，这里做一次计数排序
+    size_t *edgeOrder = malloc((snapshot->edgeCount ? snapshot->edgeCount : 1) * sizeof(size_t));
+    size_t *edgeOffsets = malloc((snapshot->nodeCount + 1) * sizeof(size_t));
+    if (!edgeOrder || !edgeOffsets)
+    {
+        free(edgeOrder);
+        free(edgeOffsets);
+
+        return false;
+    }
+    edgeOffsets[0] = 0;
+    for (size_t i = 0; i < snapshot->nodeCount; ++i)
+    {
+        edgeOffsets[i + 1] = edgeOffsets[i] + snapshot->nodes[i].edgeCount;
+    }
+    for (size_t i = 0; i < snapshot->edgeCount; ++i)
+    {
+        edgeOrder[edgeOffsets[snapshot->edges[i].from]++] = i;
+    }
+    free(edgeOffsets);
+
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        free(edgeOrder);
+
+        return false;
+    }
+    fputs(snapshotMeta, file);
+    fprintf(file, "\"node_count\":%zu,\"edge_count\":%zu,\"trace_function_count\":0},\n\"nodes\":[",
+            snapshot->nodeCount, snapshot->edgeCount);
+    for (size_t i = 0; i < snapshot->nodeCount; ++i)
+    {
+        const HeapSnapshotNode *node = &snapshot->nodes[i];
+        // V8 中 JS 对象的 id 为奇数
+        fprintf(file, "%s%d,%zu,%zu,%zu,%zu,0", i ? ",\n" : "", (int)node->type, node->nameIndex, i * 2 + 1,
+                node->selfSize, node->edgeCount);
+    }
+    fputs("],\n\"edges\":[", file);
+    for (size_t i = 0; i < snapshot->edgeCount; ++i)
+    {
+        const HeapSnapshotEdge *edge = &snapshot->edges[edgeOrder[i]];
+        // to_node 为目标节点在 nodes 数组中的偏移
+        fprintf(file, "%s%d,%zu,%zu", i ? ",\n" : "", (int)edge->type, edge->nameOrIndex,
+                edge->to * NODE_FIELD_COUNT);
+    }
+    free(edgeOrder);
+    fputs("],\n\"trace_function_infos\":[],\"trace_tree\":[],\"samples\":[],\"locations\":[],\n\"strings\":[", file);
+    for (size_t i = 0; i < snapshot->stringCount; ++i)
+    {
+        if (i)
+        {
+            fputs(",\n", file);
+        }
+        writeString(file, snapshot->strings[i]);
+    }
+    fputs("]}\n", file);
+    bool isWritten = !ferror(file);
+
+    return !fclose(file) && isWritten;
+}
@@ -0,0 +1,72 @@
+#ifndef SRC_JS_NATIVE_API_HEAP_SNAPSHOT_H_
+#define SRC_JS_NATIVE_API_HEAP_SNAPSHOT_H_
+
+// 内部使用的 Chrome .heapsnapshot 写入器，不对外导出
+// 用于引擎本身不支持堆快照时，由绑定层遍历对象图后生成
+
+#include <napi/js_native_api.h>
+
+EXTERN_C_START
+
+typedef struct NAPIHeapSnapshot NAPIHeapSnapshot;
+
+// 顺序和 snapshot.meta.node_types 一致
+typedef enum
+{
+    NAPIHeapSnapshotHiddenNode,
+    NAPIHeapSnapshotArrayNode,
+    NAPIHeapSnapshotStringNode,
+    NAPIHeapSnapshotObjectNode,
+    NAPIHeapSnapshotCodeNode,
+    NAPIHeapSnapshotClosureNode,
+    NAPIHeapSnapshotRegExpNode,
+    NAPIHeapSnapshotNumberNode,
+    NAPIHeapSnapshotNativeNode,
+    NAPIHeapSnapshotSyntheticNode,
+    NAPIHeapSnapshotConcatenatedStringNode,
+    NAPIHeapSnapshotSlicedStringNode,
+    NAPIHeapSnapshotSymbolNode,
+    NAPIHeapSnapshotBigIntNode,
+} NAPIHeapSnapshotNodeType;
+
+// 顺序和 snapshot.meta.edge_types 一致
+typedef enum
+{
+    NAPIHeapSnapshotContextEdge,
+    NAPIHeapSnapshotElementEdge,
+    NAPIHeapSnapshotPropertyEdge,
+    NAPIHeapSnapshotInternalEdge,
+    NAPIHeapSnapshotHiddenEdge,
+    NAPIHeapSnapshotShortcutEdge,
+    NAPIHeapSnapshotWeakEdge,
+} NAPIHeapSnapshotEdgeType;
+
+#define NAPI_HEAP_SNAPSHOT_INVALID_NODE ((size_t)-1)
+
+// 返回 NULL 代表内存分配失败
+NAPIHeapSnapshot *NAPIHeapSnapshotCreate(void);
+
+void NAPIHeapSnapshotFree(NAPIHeapSnapshot *snapshot);
+
+// 节点序号从 0 开始连续分配，第一个节点作为快照的根
+// address 非空时用于去重，已经存在时返回原有节点，*isNew（可空）为 false
+// 返回 NAPI_HEAP_SNAPSHOT_INVALID_NODE 代表内存分配失败
+size_t NAPIHeapSnapshotAddNode(NAPIHeapSnapshot *snapshot, const void *address, NAPIHeapSnapshotNodeType type,
+                               const char *name, size_t selfSize, bool *isNew);
+
+// 返回 NAPI_HEAP_SNAPSHOT_INVALID_NODE 代表 address 还没有对应的节点，用于在计算名称之前去重
+size_t NAPIHeapSnapshotFindNode(const NAPIHeapSnapshot *snapshot, const void *address);
+
+// 边可以按任意顺序添加，写入时按 from 排序，返回 false 代表内存分配失败
+bool NAPIHeapSnapshotAddEdge(NAPIHeapSnapshot *snapshot, size_t from, size_t to, NAPIHeapSnapshotEdgeType type,
+                             const char *name);
+
+// element 和 hidden 类型的边使用下标而不是名称
+bool NAPIHeapSnapshotAddIndexedEdge(NAPIHeapSnapshot *snapshot, size_t from, size_t to,
+                                    NAPIHeapSnapshotEdgeType type, size_t index);
+
+bool NAPIHeapSnapshotWrite(const NAPIHeapSnapshot *snapshot, const char *path);
+
+EXTERN_C_END
+
+#endif // SRC_JS_NATIVE_API_HEAP_SNAPSHOT_H_
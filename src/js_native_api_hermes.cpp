@@ -1,24 +1,41 @@
+#include <fcntl.h>
+#include <hermes/BCGen/HBC/BytecodeDataProvider.h>
 #include <hermes/BCGen/HBC/BytecodeProviderFromSrc.h>
+#include <hermes/BCGen/HBC/BytecodeStream.h>
+#include <hermes/BCGen/HBC/BytecodeVersion.h>
 #include <hermes/Public/GCConfig.h>
 #include <hermes/VM/Callable.h>
 #include <hermes/VM/GCBase.h>
 #include <hermes/VM/HostModel.h>
+#include <hermes/VM/JSArrayBuffer.h>
+#include <hermes/VM/JSLib/RuntimeJSONUtils.h>
 #include <hermes/VM/JSArray.h>
+#include <hermes/VM/JSTypedArray.h>
 #include <hermes/VM/Operations.h>
+#include <hermes/VM/PropertyAccessor.h>
 #include <hermes/VM/Runtime.h>
 #include <hermes/VM/StringPrimitive.h>
 #include <hermes/VM/WeakRef.h>
 #include <hermes/hermes.h>
 #include <jsi/decorator.h>
-#include <llvh/Support/ConvertUTF.h>
+#include <llvh/ADT/Optional.h>
+#include <llvh/Support/FileSystem.h>
+#include <llvh/Support/SHA1.h>
+#include <llvh/Support/raw_ostream.h>
 #include <napi/js_native_api.h>
 #include <napi/js_native_api_debugger.h>
 #include <napi/js_native_api_debugger_hermes_types.h>
+#include <sys/mman.h>
 #include <sys/queue.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <unordered_set>
 
 // private header
 #include "inspector/js_native_api_hermes_inspector.h"
+#include "js_native_api_code_cache.h"
+#include "js_native_api_env_pool.h"
+#include "js_native_api_unicode.h"
 
 #ifdef HERMES_ENABLE_DEBUGGER
 #include <cxxreact/MessageQueueThread.h>
@@ -30,6 +47,8 @@
     for ((var) = LIST_FIRST((head)); (var) && ((tvar) = LIST_NEXT((var), field), 1); (var) = (tvar))
 #endif
 
+#include <algorithm>
+#include <limits>
 #include <utility>
 
 #define RETURN_STATUS_IF_FALSE(condition, status)                                                                      \
@@ -68,7 +87,9 @@ namespace
 class External final : public hermes::vm::HostObjectProxy
 {
   public:
-    External(hermes::vm::Runtime *runtime, void *data, NAPIFinalize finalizeCallback, void *finalizeHint);
+    // externalCount 指向 env 中的计数，构造时加一，析构时减一
+    External(hermes::vm::Runtime *runtime, size_t &externalCount, void *data, NAPIFinalize finalizeCallback,
+             void *finalizeHint);
 
     void *getData() const;
 
@@ -94,6 +115,7 @@ class External final : public hermes::vm::HostObjectProxy
 
   private:
     hermes::vm::Runtime *runtime;
+    size_t &externalCount;
     void *data;
     NAPIFinalize finalizeCallback;
     void *finalizeHint;
@@ -148,9 +170,12 @@ class HermesExecutorRuntimeAdapter final : public facebook::hermes::inspector::R
 #endif
 } // namespace
 
-External::External(hermes::vm::Runtime *runtime, void *data, NAPIFinalize finalizeCallback, void *finalizeHint)
-    : runtime(runtime), data(data), finalizeCallback(finalizeCallback), finalizeHint(finalizeHint)
+External::External(hermes::vm::Runtime *runtime, size_t &externalCount, void *data, NAPIFinalize finalizeCallback,
+                   void *finalizeHint)
+    : runtime(runtime), externalCount(externalCount), data(data), finalizeCallback(finalizeCallback),
+      finalizeHint(finalizeHint)
 {
+    ++externalCount;
 }
 
 void *External::getData() const
@@ -159,6 +184,7 @@ void *External::getData() const
 }
 External::~External()
 {
+    --externalCount;
     if (finalizeCallback)
     {
         finalizeCallback(data, finalizeHint);
@@ -181,6 +207,52 @@ EXTERN_C_START
 
 struct OpaqueNAPIRef;
 
+// 两种 handleScope 统一按 OpaqueNAPIEscapableHandleScope 分配，关闭后放入 env 空闲链表复用
+struct OpaqueNAPIHandleScope
+{
+    OpaqueNAPIHandleScope() = default;
+
+    OpaqueNAPIHandleScope(const OpaqueNAPIHandleScope &) = delete;
+    OpaqueNAPIHandleScope(OpaqueNAPIHandleScope &&) = delete;
+    OpaqueNAPIHandleScope &operator=(const OpaqueNAPIHandleScope &) = delete;
+    OpaqueNAPIHandleScope &operator=(OpaqueNAPIHandleScope &&) = delete;
+
+    bool isEscapeCalled() const
+    {
+        return escapeCalled;
+    }
+
+    void setEscapeCalled(bool escapeCalled1)
+    {
+        escapeCalled = escapeCalled1;
+    }
+
+    LIST_ENTRY(OpaqueNAPIHandleScope) node;
+
+    // 只在打开期间有值
+    llvh::Optional<hermes::vm::GCScope> gcScope;
+
+  private:
+    bool escapeCalled = false;
+};
+
+struct OpaqueNAPIEscapableHandleScope final : OpaqueNAPIHandleScope
+{
+};
+
+// SymbolID 需要作为 GC root 才能保证不被 IdentifierTable 回收
+struct OpaqueNAPIPropertyKey final
+{
+    LIST_ENTRY(OpaqueNAPIPropertyKey) node;
+
+    hermes::vm::PinnedHermesValue symbolValue;
+
+    hermes::vm::SymbolID getSymbolID() const
+    {
+        return symbolValue.getSymbol();
+    }
+};
+
 struct OpaqueNAPIEnv final
 {
     explicit OpaqueNAPIEnv(const hermes::vm::RuntimeConfig &runtimeConfig);
@@ -206,6 +278,35 @@ struct OpaqueNAPIEnv final
 
     LIST_HEAD(, OpaqueNAPIRef) strongRefList;
 
+    LIST_HEAD(, OpaqueNAPIPropertyKey) propertyKeyList;
+
+    // NAPISetCodeCacheDirectory 开启后非空
+    NAPICodeCache *codeCache = nullptr;
+
+    // 尚未析构的 External，runtime 销毁时仍会访问，必须声明在 hermesRuntimeSharedPtr 之前
+    size_t externalCount = 0;
+
+    // 已经打开、尚未关闭的 handleScope
+    size_t handleScopeCount = 0;
+
+    // napi_adjust_external_memory 登记的总字节数
+    int64_t externalMemorySize = 0;
+
+    // 已经计入 GC 的字节数，GC 过程中（finalizer）无法修改 GC 的统计
+    // 差值在之后的 napi_adjust_external_memory、GC 和 NAPIGetHeapStatistics 中补上
+    int64_t creditedExternalMemorySize = 0;
+
+    // 上一次主动 GC 完成后的 allocatedBytes，NAPIIdleNotification 据此判断之后是否有新的分配
+    uint64_t lastGCAllocatedBytes = 0;
+
+    // 返回 nullptr 代表内存分配失败
+    NAPIEscapableHandleScope acquireHandleScope();
+
+    void releaseHandleScope(NAPIHandleScope handleScope);
+
+    // 释放空闲链表中的 handleScope，返回释放的字节数
+    size_t trimHandleScopes();
+
     void enableDebugger(const char *debuggerTitle, bool waitForDebugger);
 
     void disableDebugger();
@@ -222,6 +323,8 @@ struct OpaqueNAPIEnv final
 #endif
 
   private:
+    LIST_HEAD(, OpaqueNAPIHandleScope) freeHandleScopeList;
+
     hermes::vm::Runtime *runtime;
 
     std::shared_ptr<facebook::hermes::HermesRuntime> hermesRuntimeSharedPtr;
@@ -231,6 +334,49 @@ struct OpaqueNAPIEnv final
     std::shared_ptr<facebook::react::MessageQueueThread> thread_;
 };
 
+NAPIEscapableHandleScope OpaqueNAPIEnv::acquireHandleScope()
+{
+    auto handleScope = (NAPIEscapableHandleScope)LIST_FIRST(&freeHandleScopeList);
+    if (handleScope)
+    {
+        LIST_REMOVE(handleScope, node);
+    }
+    else
+    {
+        handleScope = new (std::nothrow) OpaqueNAPIEscapableHandleScope();
+        if (!handleScope)
+        {
+            return nullptr;
+        }
+    }
+    handleScope->gcScope.emplace(runtime);
+    handleScope->setEscapeCalled(false);
+    ++handleScopeCount;
+
+    return handleScope;
+}
+
+void OpaqueNAPIEnv::releaseHandleScope(NAPIHandleScope handleScope)
+{
+    handleScope->gcScope.reset();
+    LIST_INSERT_HEAD(&freeHandleScopeList, handleScope, node);
+    --handleScopeCount;
+}
+
+size_t OpaqueNAPIEnv::trimHandleScopes()
+{
+    size_t reclaimedBytes = 0;
+    NAPIHandleScope handleScope, tempHandleScope;
+    LIST_FOREACH_SAFE(handleScope, &freeHandleScopeList, node, tempHandleScope)
+    {
+        LIST_REMOVE(handleScope, node);
+        delete (NAPIEscapableHandleScope)handleScope;
+        reclaimedBytes += sizeof(OpaqueNAPIEscapableHandleScope);
+    }
+
+    return reclaimedBytes;
+}
+
 void OpaqueNAPIEnv::enableDebugger(const char *debuggerTitle, bool waitForDebugger)
 {
 #ifdef HERMES_ENABLE_DEBUGGER
@@ -408,6 +554,19 @@ OpaqueNAPIEnv::~OpaqueNAPIEnv()
     {
         delete ref;
     }
+    NAPIPropertyKey propertyKey, tempPropertyKey;
+    LIST_FOREACH_SAFE(propertyKey, &propertyKeyList, node, tempPropertyKey)
+    {
+        LIST_REMOVE(propertyKey, node);
+        delete propertyKey;
+    }
+    NAPIHandleScope handleScope, tempHandleScope;
+    LIST_FOREACH_SAFE(handleScope, &freeHandleScopeList, node, tempHandleScope)
+    {
+        LIST_REMOVE(handleScope, node);
+        delete (NAPIEscapableHandleScope)handleScope;
+    }
+    NAPICodeCacheFree(codeCache);
 }
 
 OpaqueNAPIEnv::OpaqueNAPIEnv(const hermes::vm::RuntimeConfig &runtimeConfig)
@@ -437,6 +596,8 @@ OpaqueNAPIEnv::OpaqueNAPIEnv(const hermes::vm::RuntimeConfig &runtimeConfig)
     LIST_INIT(&valueList);
     LIST_INIT(&weakRefList);
     LIST_INIT(&strongRefList);
+    LIST_INIT(&propertyKeyList);
+    LIST_INIT(&freeHandleScopeList);
 
     runtime->addCustomRootsFunction([this](hermes::vm::GC *, hermes::vm::RootAcceptor &rootAcceptor) {
         NAPIRef ref;
@@ -444,6 +605,11 @@ OpaqueNAPIEnv::OpaqueNAPIEnv(const hermes::vm::RuntimeConfig &runtimeConfig)
         {
             rootAcceptor.accept(ref->pinnedHermesValue);
         }
+        NAPIPropertyKey propertyKey;
+        LIST_FOREACH(propertyKey, &this->propertyKeyList, node)
+        {
+            rootAcceptor.accept(propertyKey->symbolValue);
+        }
     });
     runtime->addCustomWeakRootsFunction([this](hermes::vm::GC *, hermes::vm::WeakRefAcceptor &weakRefAcceptor) {
         NAPIRef ref;
@@ -574,58 +740,128 @@ NAPIErrorStatus napi_create_double(NAPIEnv env, double value, NAPIValue *result)
 
 NAPIExceptionStatus napi_create_string_utf8(NAPIEnv env, const char *str, NAPIValue *result)
 {
-    NAPI_PREAMBLE(env)
-    CHECK_ARG(result, Exception)
+    return napi_create_string_utf8_len(env, str, NAPI_AUTO_LENGTH, result);
+}
+
+namespace
+{
 
+// 不超过该长度的字符串转换使用栈上缓冲区，避免 malloc
+constexpr size_t kStackStringBufferLength = 256;
+
+// str 为 NULL 时必须 length 为 0 或 NAPI_AUTO_LENGTH，并视为 ""
+template <typename CharType> bool normalizeStringArgument(const CharType *&str, size_t &length)
+{
     if (!str)
     {
-        str = "";
-    }
-    size_t length = strlen(str);
-    hermes::vm::CallResult<hermes::vm::HermesValue> callResult(hermes::vm::ExecutionStatus::EXCEPTION);
-    if (hermes::isAllASCII(str, str + length))
-    {
-        // length 0 也算 ASCII，但是 hermes::vm::createASCIIRef 不能传入 nullptr，因此不能直接使用 (nullptr, 0) 构造
-        callResult = hermes::vm::StringPrimitive::createEfficient(env->getRuntime(), hermes::vm::createASCIIRef(str));
-    }
-    else
-    {
-        // 多一个 \0
-        auto out = static_cast<uint16_t *>(malloc(sizeof(uint16_t) * (length + 1)));
-        RETURN_STATUS_IF_FALSE(out, NAPIExceptionMemoryError)
-        // std::u16string resize 失败会抛出异常，因此使用 malloc
-        auto sourceStart = (const llvh::UTF8 *)str;
-        auto sourceEnd = sourceStart + length;
-        auto targetStart = out;
-        auto targetEnd = targetStart + length;
-        llvh::ConversionResult conversionResult;
-        conversionResult =
-            llvh::ConvertUTF8toUTF16(&sourceStart, sourceEnd, &targetStart, targetEnd - 1, llvh::lenientConversion);
-        if (conversionResult == llvh::ConversionResult::targetExhausted)
+        if (length && length != NAPI_AUTO_LENGTH)
         {
-            assert(false);
-            free(out);
-
-            return NAPIExceptionMemoryError;
+            return false;
         }
-        else if (conversionResult != llvh::ConversionResult::conversionOK)
+        // hermes::vm::createASCIIRef 不能传入 nullptr
+        static const CharType emptyString[] = {0};
+        str = emptyString;
+        length = 0;
+    }
+    else if (length == NAPI_AUTO_LENGTH)
+    {
+        length = 0;
+        while (str[length])
         {
-            free(out);
-
-            return NAPIExceptionMemoryError;
+            ++length;
         }
-        *targetStart = '\0';
-        // std::u16string 会作为后备存储使用并调用 std::move，但是这里不是
-        callResult = hermes::vm::StringPrimitive::createEfficient(
-            env->getRuntime(), hermes::vm::createUTF16Ref(reinterpret_cast<const char16_t *>(out)));
-        free(out);
     }
+
+    return true;
+}
+
+} // namespace
+
+static NAPIExceptionStatus setStringResult(NAPIEnv env, hermes::vm::CallResult<hermes::vm::HermesValue> callResult,
+                                           NAPIValue *result)
+{
     CHECK_HERMES(callResult)
     *result = (NAPIValue)env->getRuntime()->makeHandle(callResult.getValue()).unsafeGetPinnedHermesValue();
 
     return NAPIExceptionOK;
 }
 
+NAPIExceptionStatus napi_create_string_utf8_len(NAPIEnv env, const char *str, size_t length, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(result, Exception)
+    RETURN_STATUS_IF_FALSE(normalizeStringArgument(str, length), NAPIExceptionInvalidArg)
+
+    if (NAPIUnicodeIsASCII(str, length))
+    {
+        return setStringResult(
+            env, hermes::vm::StringPrimitive::createEfficient(env->getRuntime(), hermes::vm::ASCIIRef(str, length)),
+            result);
+    }
+    // UTF-16 code unit 数量不会超过 UTF-8 字节数，一次转换即可，短字符串使用栈上缓冲区
+    // std::u16string resize 失败会抛出异常，因此使用 malloc
+    uint16_t stackBuffer[kStackStringBufferLength];
+    auto out = length <= kStackStringBufferLength ? stackBuffer
+                                                  : static_cast<uint16_t *>(malloc(sizeof(uint16_t) * length));
+    RETURN_STATUS_IF_FALSE(out, NAPIExceptionMemoryError)
+    size_t utf16Length = NAPIUnicodeConvertUTF8ToUTF16(str, length, out);
+    // std::u16string 会作为后备存储使用并调用 std::move，但是这里不是，createEfficient 会拷贝
+    auto status = setStringResult(env,
+                                  hermes::vm::StringPrimitive::createEfficient(
+                                      env->getRuntime(),
+                                      hermes::vm::UTF16Ref(reinterpret_cast<const char16_t *>(out), utf16Length)),
+                                  result);
+    if (out != stackBuffer)
+    {
+        free(out);
+    }
+
+    return status;
+}
+
+NAPIExceptionStatus napi_create_string_latin1(NAPIEnv env, const char *str, size_t length, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(result, Exception)
+    RETURN_STATUS_IF_FALSE(normalizeStringArgument(str, length), NAPIExceptionInvalidArg)
+
+    if (NAPIUnicodeIsASCII(str, length))
+    {
+        return setStringResult(
+            env, hermes::vm::StringPrimitive::createEfficient(env->getRuntime(), hermes::vm::ASCIIRef(str, length)),
+            result);
+    }
+    // Hermes 的 8 位字符串只接受 ASCII，Latin-1 需要扩展为 UTF-16
+    uint16_t stackBuffer[kStackStringBufferLength];
+    auto out = length <= kStackStringBufferLength ? stackBuffer
+                                                  : static_cast<uint16_t *>(malloc(sizeof(uint16_t) * length));
+    RETURN_STATUS_IF_FALSE(out, NAPIExceptionMemoryError)
+    NAPIUnicodeConvertLatin1ToUTF16(str, length, out);
+    auto status = setStringResult(env,
+                                  hermes::vm::StringPrimitive::createEfficient(
+                                      env->getRuntime(),
+                                      hermes::vm::UTF16Ref(reinterpret_cast<const char16_t *>(out), length)),
+                                  result);
+    if (out != stackBuffer)
+    {
+        free(out);
+    }
+
+    return status;
+}
+
+NAPIExceptionStatus napi_create_string_utf16(NAPIEnv env, const char16_t *str, size_t length, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(result, Exception)
+    RETURN_STATUS_IF_FALSE(normalizeStringArgument(str, length), NAPIExceptionInvalidArg)
+
+    // JS 字符串本身允许孤立代理项，直接拷贝
+    return setStringResult(
+        env, hermes::vm::StringPrimitive::createEfficient(env->getRuntime(), hermes::vm::UTF16Ref(str, length)),
+        result);
+}
+
 NAPIExceptionStatus napi_create_function(NAPIEnv env, const char *utf8name, NAPICallback callback, void *data,
                                          NAPIValue *result)
 {
@@ -767,6 +1003,93 @@ NAPIErrorStatus napi_get_value_bool(NAPIEnv /*env*/, NAPIValue value, bool *resu
     return NAPIErrorOK;
 }
 
+// 只读取 StringPrimitive 的存储，不会触发 GC
+NAPIErrorStatus napi_get_value_string_utf8(NAPIEnv /*env*/, NAPIValue value, char *buf, size_t bufsize,
+                                           size_t *result)
+{
+    CHECK_ARG(value, Error)
+    RETURN_STATUS_IF_FALSE(buf || result, NAPIErrorInvalidArg)
+
+    auto stringPrimitive =
+        hermes::vm::dyn_vmcast_or_null<hermes::vm::StringPrimitive>(*(const hermes::vm::PinnedHermesValue *)value);
+    RETURN_STATUS_IF_FALSE(stringPrimitive, NAPIErrorStringExpected)
+    size_t length;
+    if (stringPrimitive->isASCII())
+    {
+        auto asciiStringRef = stringPrimitive->getStringRef<char>();
+        length = asciiStringRef.size();
+        if (buf)
+        {
+            length = bufsize ? std::min(length, bufsize - 1) : 0;
+            std::memcpy(buf, asciiStringRef.data(), length);
+        }
+    }
+    else
+    {
+        auto utf16StringRef = stringPrimitive->getStringRef<char16_t>();
+        auto utf16String = reinterpret_cast<const uint16_t *>(utf16StringRef.data());
+        if (!buf)
+        {
+            length = NAPIUnicodeUTF8LengthOfUTF16(utf16String, utf16StringRef.size());
+        }
+        else
+        {
+            length = bufsize ? NAPIUnicodeConvertUTF16ToUTF8Partial(utf16String, utf16StringRef.size(), buf,
+                                                                    bufsize - 1)
+                             : 0;
+        }
+    }
+    if (buf && bufsize)
+    {
+        buf[length] = '\0';
+    }
+    if (result)
+    {
+        *result = length;
+    }
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus napi_get_value_string_utf16(NAPIEnv /*env*/, NAPIValue value, char16_t *buf, size_t bufsize,
+                                            size_t *result)
+{
+    CHECK_ARG(value, Error)
+    RETURN_STATUS_IF_FALSE(buf || result, NAPIErrorInvalidArg)
+
+    auto stringPrimitive =
+        hermes::vm::dyn_vmcast_or_null<hermes::vm::StringPrimitive>(*(const hermes::vm::PinnedHermesValue *)value);
+    RETURN_STATUS_IF_FALSE(stringPrimitive, NAPIErrorStringExpected)
+    size_t length = stringPrimitive->getStringLength();
+    if (buf && !bufsize)
+    {
+        length = 0;
+    }
+    else if (buf)
+    {
+        if (stringPrimitive->isASCII())
+        {
+            length = std::min(length, bufsize - 1);
+            NAPIUnicodeConvertLatin1ToUTF16(stringPrimitive->getStringRef<char>().data(), length,
+                                            reinterpret_cast<uint16_t *>(buf));
+        }
+        else
+        {
+            auto utf16StringRef = stringPrimitive->getStringRef<char16_t>();
+            length = NAPIUnicodeTruncateUTF16(reinterpret_cast<const uint16_t *>(utf16StringRef.data()), length,
+                                              bufsize - 1);
+            std::memcpy(buf, utf16StringRef.data(), sizeof(char16_t) * length);
+        }
+        buf[length] = u'\0';
+    }
+    if (result)
+    {
+        *result = length;
+    }
+
+    return NAPIErrorOK;
+}
+
 NAPIExceptionStatus napi_coerce_to_bool(NAPIEnv env, NAPIValue value, NAPIValue *result)
 {
     CHECK_ARG(env, Exception)
@@ -918,659 +1241,1773 @@ NAPIExceptionStatus napi_delete_property(NAPIEnv env, NAPIValue object, NAPIValu
     return NAPIExceptionOK;
 }
 
-NAPICommonStatus napi_is_array(NAPIEnv /*env*/, NAPIValue value, bool *result)
-{
-    CHECK_ARG(value, Common)
-    CHECK_ARG(result, Common)
-
-    // 虽然有 ArrayImpl，但是主要是为了提供给 Arguments 使用
-    *result = hermes::vm::vmisa<hermes::vm::JSArray>(*(const hermes::vm::PinnedHermesValue *)value);
-
-    return NAPICommonOK;
-}
-
-NAPIExceptionStatus napi_call_function(NAPIEnv env, NAPIValue thisValue, NAPIValue func, size_t argc,
-                                       const NAPIValue *argv, NAPIValue *result)
+// 数字 key 走 *Computed 接口，数组等带有快速索引存储的对象不需要转换为 SymbolID
+NAPIExceptionStatus napi_set_element(NAPIEnv env, NAPIValue object, uint32_t index, NAPIValue value)
 {
     NAPI_PREAMBLE(env)
-    CHECK_ARG(func, Exception)
-    if (argc)
-    {
-        CHECK_ARG(argv, Exception)
-    }
-
-    RETURN_STATUS_IF_FALSE(hermes::vm::vmisa<hermes::vm::Callable>(*(const hermes::vm::PinnedHermesValue *)func),
-                           NAPIExceptionFunctionExpected)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(value, Exception)
 
     hermes::vm::GCScope gcScope(env->getRuntime());
 
-    // this
-    if (!thisValue)
-    {
-        CHECK_NAPI(napi_get_global(env, &thisValue), Error, Exception)
-    }
-
-    // 开启严格模式后，可以直接传入空句柄
-    auto callResult = hermes::vm::Arguments::create(
-        env->getRuntime(), argc, hermes::vm::HandleRootOwner::makeNullHandle<hermes::vm::Callable>(), true);
-    CHECK_HERMES(callResult)
-    for (size_t i = 0; i < argc; ++i)
-    {
-        hermes::vm::ArrayImpl::setElementAt(
-            callResult.getValue(), env->getRuntime(), i,
-            env->getRuntime()->makeHandle(*(const hermes::vm::PinnedHermesValue *)argv[i]));
-    }
-    auto function = hermes::vm::dyn_vmcast_or_null<hermes::vm::Callable>(*(const hermes::vm::PinnedHermesValue *)func);
-    if (!function)
-    {
-        assert(false && "func is not a Callable");
-    }
-    auto executeCallResult = hermes::vm::Callable::executeCall(
-        env->getRuntime()->makeHandle(function), env->getRuntime(), hermes::vm::Runtime::getUndefinedValue(),
-        env->getRuntime()->makeHandle(*(const hermes::vm::PinnedHermesValue *)thisValue), callResult.getValue());
-    CHECK_HERMES(executeCallResult)
-    if (result)
-    {
-        *result = (NAPIValue)hermes::vm::Handle<hermes::vm::HermesValue>(gcScope.getParentScope(),
-                                                                         executeCallResult.getValue().get())
-                      .unsafeGetPinnedHermesValue();
-    }
+    auto jsObject =
+        hermes::vm::dyn_vmcast_or_null<hermes::vm::JSObject>(*(const hermes::vm::PinnedHermesValue *)object);
+    RETURN_STATUS_IF_FALSE(jsObject, NAPIExceptionObjectExpected)
+    auto setCallResult = hermes::vm::JSObject::putComputed_RJS(
+        env->getRuntime()->makeHandle(jsObject), env->getRuntime(),
+        env->getRuntime()->makeHandle(hermes::vm::HermesValue::encodeNumberValue(index)),
+        env->getRuntime()->makeHandle(*(const hermes::vm::PinnedHermesValue *)value));
+    CHECK_HERMES(setCallResult)
+    RETURN_STATUS_IF_FALSE(setCallResult.getValue(), NAPIExceptionGenericFailure)
 
     return NAPIExceptionOK;
 }
 
-NAPIExceptionStatus napi_new_instance(NAPIEnv env, NAPIValue constructor, size_t argc, const NAPIValue *argv,
-                                      NAPIValue *result)
+NAPIExceptionStatus napi_has_element(NAPIEnv env, NAPIValue object, uint32_t index, bool *result)
 {
     NAPI_PREAMBLE(env)
-    CHECK_ARG(constructor, Exception)
-    if (argc)
-    {
-        CHECK_ARG(argv, Exception)
-    }
+    CHECK_ARG(object, Exception)
     CHECK_ARG(result, Exception)
 
-    RETURN_STATUS_IF_FALSE(
-        hermes::vm::isConstructor(env->getRuntime(), *(const hermes::vm::PinnedHermesValue *)constructor),
-        NAPIExceptionFunctionExpected)
-
     hermes::vm::GCScope gcScope(env->getRuntime());
 
-    // 开启严格模式后，可以直接传入空句柄
-    auto callResult = hermes::vm::Arguments::create(
-        env->getRuntime(), argc, hermes::vm::HandleRootOwner::makeNullHandle<hermes::vm::Callable>(), true);
-    CHECK_HERMES(callResult)
-    for (size_t i = 0; i < argc; ++i)
-    {
-        hermes::vm::ArrayImpl::setElementAt(
-            callResult.getValue(), env->getRuntime(), i,
-            env->getRuntime()->makeHandle(*(const hermes::vm::PinnedHermesValue *)argv[i]));
-    }
-    auto function =
-        hermes::vm::dyn_vmcast_or_null<hermes::vm::Callable>(*(const hermes::vm::PinnedHermesValue *)constructor);
-    auto functionHandle = env->getRuntime()->makeHandle(function);
-    auto thisCallResult = hermes::vm::Callable::createThisForConstruct(functionHandle, env->getRuntime());
-    auto thisHandle = env->getRuntime()->makeHandle(thisCallResult->getHermesValue());
-    CHECK_HERMES(thisCallResult)
-    auto executeCallResult = hermes::vm::Callable::executeCall(functionHandle, env->getRuntime(), functionHandle,
-                                                               thisHandle, callResult.getValue());
-    CHECK_HERMES(executeCallResult)
-    if (executeCallResult.getValue()->isObject())
-    {
-        *result = (NAPIValue)hermes::vm::Handle<hermes::vm::HermesValue>(gcScope.getParentScope(),
-                                                                         executeCallResult.getValue().get())
-                      .unsafeGetPinnedHermesValue();
-    }
-    else
-    {
-        // TODO(ChasonTang): 返回标量的情况添加单测
-        *result = (NAPIValue)hermes::vm::Handle<hermes::vm::HermesValue>(gcScope.getParentScope(), thisHandle.get())
-                      .unsafeGetPinnedHermesValue();
-    }
+    auto jsObject =
+        hermes::vm::dyn_vmcast_or_null<hermes::vm::JSObject>(*(const hermes::vm::PinnedHermesValue *)object);
+    RETURN_STATUS_IF_FALSE(jsObject, NAPIExceptionObjectExpected)
+    auto hasCallResult = hermes::vm::JSObject::hasComputed(
+        env->getRuntime()->makeHandle(jsObject), env->getRuntime(),
+        env->getRuntime()->makeHandle(hermes::vm::HermesValue::encodeNumberValue(index)));
+    CHECK_HERMES(hasCallResult)
+    *result = hasCallResult.getValue();
 
     return NAPIExceptionOK;
 }
 
-NAPIExceptionStatus napi_instanceof(NAPIEnv env, NAPIValue object, NAPIValue constructor, bool *result)
+NAPIExceptionStatus napi_get_element(NAPIEnv env, NAPIValue object, uint32_t index, NAPIValue *result)
 {
     NAPI_PREAMBLE(env)
     CHECK_ARG(object, Exception)
-    CHECK_ARG(constructor, Exception)
     CHECK_ARG(result, Exception)
 
     hermes::vm::GCScope gcScope(env->getRuntime());
 
-    auto callResult = hermes::vm::instanceOfOperator_RJS(
-        env->getRuntime(), env->getRuntime()->makeHandle(*(const hermes::vm::PinnedHermesValue *)object),
-        env->getRuntime()->makeHandle(*(const hermes::vm::PinnedHermesValue *)constructor));
-    CHECK_HERMES(callResult)
-    *result = callResult.getValue();
-
+    auto jsObject =
+        hermes::vm::dyn_vmcast_or_null<hermes::vm::JSObject>(*(const hermes::vm::PinnedHermesValue *)object);
+    RETURN_STATUS_IF_FALSE(jsObject, NAPIExceptionObjectExpected)
+    auto getCallResult = hermes::vm::JSObject::getComputed_RJS(
+        env->getRuntime()->makeHandle(jsObject), env->getRuntime(),
+        env->getRuntime()->makeHandle(hermes::vm::HermesValue::encodeNumberValue(index)));
+    CHECK_HERMES(getCallResult)
+    *result =
+        (NAPIValue)hermes::vm::Handle<hermes::vm::HermesValue>(gcScope.getParentScope(), getCallResult.getValue().get())
+            .unsafeGetPinnedHermesValue();
+
     return NAPIExceptionOK;
 }
 
-NAPICommonStatus napi_get_cb_info(NAPIEnv env, NAPICallbackInfo callbackInfo, size_t *argc, NAPIValue *argv,
-                                  NAPIValue *thisArg, void **data)
+NAPIExceptionStatus napi_delete_element(NAPIEnv env, NAPIValue object, uint32_t index, bool *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(object, Exception)
+
+    hermes::vm::GCScope gcScope(env->getRuntime());
+
+    auto jsObject =
+        hermes::vm::dyn_vmcast_or_null<hermes::vm::JSObject>(*(const hermes::vm::PinnedHermesValue *)object);
+    RETURN_STATUS_IF_FALSE(jsObject, NAPIExceptionObjectExpected)
+    auto deleteCallResult = hermes::vm::JSObject::deleteComputed(
+        env->getRuntime()->makeHandle(jsObject), env->getRuntime(),
+        env->getRuntime()->makeHandle(hermes::vm::HermesValue::encodeNumberValue(index)));
+    CHECK_HERMES(deleteCallResult)
+    if (result)
+    {
+        *result = deleteCallResult.getValue();
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus NAPICreatePropertyKey(NAPIEnv env, const char *utf8name, NAPIPropertyKey *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(result, Exception)
+
+    hermes::vm::GCScope gcScope(env->getRuntime());
+    NAPIValue stringValue;
+    CHECK_NAPI(napi_create_string_utf8(env, utf8name, &stringValue), Exception, Exception)
+    auto stringPrimitive = hermes::vm::dyn_vmcast_or_null<hermes::vm::StringPrimitive>(
+        *(const hermes::vm::PinnedHermesValue *)stringValue);
+    RETURN_STATUS_IF_FALSE(stringPrimitive, NAPIExceptionMemoryError)
+    auto callResult = hermes::vm::stringToSymbolID(env->getRuntime(), hermes::vm::createPseudoHandle(stringPrimitive));
+    CHECK_HERMES(callResult)
+    auto propertyKey = new (std::nothrow) OpaqueNAPIPropertyKey();
+    RETURN_STATUS_IF_FALSE(propertyKey, NAPIExceptionMemoryError)
+    propertyKey->symbolValue = hermes::vm::HermesValue::encodeSymbolValue(callResult.getValue().get());
+    LIST_INSERT_HEAD(&env->propertyKeyList, propertyKey, node);
+    *result = propertyKey;
+
+    return NAPIExceptionOK;
+}
+
+NAPICommonStatus NAPIFreePropertyKey(NAPIEnv env, NAPIPropertyKey key)
 {
     CHECK_ARG(env, Common)
-    CHECK_ARG(callbackInfo, Common)
+    CHECK_ARG(key, Common)
 
-    if (argv)
+    LIST_REMOVE(key, node);
+    delete key;
+
+    return NAPICommonOK;
+}
+
+NAPIExceptionStatus NAPISetPropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key, NAPIValue value)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(key, Exception)
+    CHECK_ARG(value, Exception)
+
+    hermes::vm::GCScope gcScope(env->getRuntime());
+
+    auto jsObject =
+        hermes::vm::dyn_vmcast_or_null<hermes::vm::JSObject>(*(const hermes::vm::PinnedHermesValue *)object);
+    RETURN_STATUS_IF_FALSE(jsObject, NAPIExceptionObjectExpected)
+    auto setCallResult = hermes::vm::JSObject::putNamedOrIndexed(
+        env->getRuntime()->makeHandle(jsObject), env->getRuntime(), key->getSymbolID(),
+        env->getRuntime()->makeHandle(*(const hermes::vm::PinnedHermesValue *)value));
+    CHECK_HERMES(setCallResult)
+    RETURN_STATUS_IF_FALSE(setCallResult.getValue(), NAPIExceptionGenericFailure)
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus NAPIHasPropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key, bool *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(key, Exception)
+    CHECK_ARG(result, Exception)
+
+    hermes::vm::GCScope gcScope(env->getRuntime());
+
+    auto jsObject =
+        hermes::vm::dyn_vmcast_or_null<hermes::vm::JSObject>(*(const hermes::vm::PinnedHermesValue *)object);
+    RETURN_STATUS_IF_FALSE(jsObject, NAPIExceptionObjectExpected)
+    auto hasCallResult = hermes::vm::JSObject::hasNamedOrIndexed(env->getRuntime()->makeHandle(jsObject),
+                                                                 env->getRuntime(), key->getSymbolID());
+    CHECK_HERMES(hasCallResult)
+    *result = hasCallResult.getValue();
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus NAPIGetPropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(key, Exception)
+    CHECK_ARG(result, Exception)
+
+    hermes::vm::GCScope gcScope(env->getRuntime());
+
+    auto jsObject =
+        hermes::vm::dyn_vmcast_or_null<hermes::vm::JSObject>(*(const hermes::vm::PinnedHermesValue *)object);
+    RETURN_STATUS_IF_FALSE(jsObject, NAPIExceptionObjectExpected)
+    auto getCallResult = hermes::vm::JSObject::getNamedOrIndexed(env->getRuntime()->makeHandle(jsObject),
+                                                                 env->getRuntime(), key->getSymbolID());
+    CHECK_HERMES(getCallResult)
+    *result =
+        (NAPIValue)hermes::vm::Handle<hermes::vm::HermesValue>(gcScope.getParentScope(), getCallResult.getValue().get())
+            .unsafeGetPinnedHermesValue();
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus NAPIDeletePropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key, bool *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(key, Exception)
+
+    hermes::vm::GCScope gcScope(env->getRuntime());
+
+    auto jsObject =
+        hermes::vm::dyn_vmcast_or_null<hermes::vm::JSObject>(*(const hermes::vm::PinnedHermesValue *)object);
+    RETURN_STATUS_IF_FALSE(jsObject, NAPIExceptionObjectExpected)
+    auto deleteCallResult = hermes::vm::JSObject::deleteNamed(env->getRuntime()->makeHandle(jsObject),
+                                                              env->getRuntime(), key->getSymbolID());
+    CHECK_HERMES(deleteCallResult)
+    if (result)
     {
-        CHECK_ARG(argc, Common)
-        unsigned int i = 0;
-        size_t min = std::min(callbackInfo->getNativeArgs().getArgCount(), (unsigned int)*argc);
-        for (; i < min; ++i)
+        *result = deleteCallResult.getValue();
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPICommonStatus napi_is_array(NAPIEnv /*env*/, NAPIValue value, bool *result)
+{
+    CHECK_ARG(value, Common)
+    CHECK_ARG(result, Common)
+
+    // 虽然有 ArrayImpl，但是主要是为了提供给 Arguments 使用
+    *result = hermes::vm::vmisa<hermes::vm::JSArray>(*(const hermes::vm::PinnedHermesValue *)value);
+
+    return NAPICommonOK;
+}
+
+namespace
+{
+// 创建的函数属于当前 GCScope
+NAPIExceptionStatus defineProperty(NAPIEnv env, hermes::vm::Handle<hermes::vm::JSObject> objectHandle,
+                                   const NAPIPropertyDescriptor *descriptor)
+{
+    NAPIValue nameValue = descriptor->name;
+    if (descriptor->utf8name)
+    {
+        CHECK_NAPI(napi_create_string_utf8(env, descriptor->utf8name, &nameValue), Exception, Exception)
+    }
+    RETURN_STATUS_IF_FALSE(nameValue, NAPIExceptionNameExpected)
+
+    auto dpFlags = hermes::vm::DefinePropertyFlags::getDefaultNewPropertyFlags();
+    dpFlags.enumerable = (descriptor->attributes & NAPIEnumerable) != 0;
+    dpFlags.configurable = (descriptor->attributes & NAPIConfigurable) != 0;
+    hermes::vm::MutableHandle<> valueOrAccessor(env->getRuntime());
+    if (descriptor->getter || descriptor->setter)
+    {
+        NAPIValue getterValue = nullptr, setterValue = nullptr;
+        if (descriptor->getter)
         {
-            argv[i] = (NAPIValue)callbackInfo->getNativeArgs().getArgHandle(i).unsafeGetPinnedHermesValue();
+            CHECK_NAPI(
+                napi_create_function(env, descriptor->utf8name, descriptor->getter, descriptor->data, &getterValue),
+                Exception, Exception)
         }
-        if (i < *argc)
+        if (descriptor->setter)
         {
-            NAPIValue undefined = (NAPIValue)hermes::vm::Runtime::getUndefinedValue().unsafeGetPinnedHermesValue();
-            for (; i < *argc; ++i)
-            {
-                argv[i] = undefined;
-            }
+            CHECK_NAPI(
+                napi_create_function(env, descriptor->utf8name, descriptor->setter, descriptor->data, &setterValue),
+                Exception, Exception)
+        }
+        auto accessorCallResult = hermes::vm::PropertyAccessor::create(
+            env->getRuntime(),
+            getterValue ? env->getRuntime()->makeHandle(hermes::vm::vmcast<hermes::vm::Callable>(
+                              *(const hermes::vm::PinnedHermesValue *)getterValue))
+                        : hermes::vm::Runtime::makeNullHandle<hermes::vm::Callable>(),
+            setterValue ? env->getRuntime()->makeHandle(hermes::vm::vmcast<hermes::vm::Callable>(
+                              *(const hermes::vm::PinnedHermesValue *)setterValue))
+                        : hermes::vm::Runtime::makeNullHandle<hermes::vm::Callable>());
+        CHECK_HERMES(accessorCallResult)
+        valueOrAccessor.set(accessorCallResult.getValue());
+        dpFlags.setValue = 0;
+        dpFlags.setWritable = 0;
+        dpFlags.writable = 0;
+        dpFlags.setGetter = 1;
+        dpFlags.setSetter = 1;
+    }
+    else
+    {
+        if (descriptor->method)
+        {
+            NAPIValue functionValue;
+            CHECK_NAPI(napi_create_function(env, descriptor->utf8name, descriptor->method, descriptor->data,
+                                            &functionValue),
+                       Exception, Exception)
+            valueOrAccessor.set(*(const hermes::vm::PinnedHermesValue *)functionValue);
+        }
+        else if (descriptor->value)
+        {
+            valueOrAccessor.set(*(const hermes::vm::PinnedHermesValue *)descriptor->value);
+        }
+        else
+        {
+            valueOrAccessor.set(hermes::vm::HermesValue::encodeUndefinedValue());
         }
+        dpFlags.writable = (descriptor->attributes & NAPIWritable) != 0;
     }
+    auto defineCallResult = hermes::vm::JSObject::defineOwnComputed(
+        objectHandle, env->getRuntime(),
+        env->getRuntime()->makeHandle(*(const hermes::vm::PinnedHermesValue *)nameValue), dpFlags, valueOrAccessor,
+        hermes::vm::PropOpFlags().plusThrowOnError());
+    CHECK_HERMES(defineCallResult)
+    RETURN_STATUS_IF_FALSE(defineCallResult.getValue(), NAPIExceptionGenericFailure)
+
+    return NAPIExceptionOK;
+}
+} // namespace
+
+NAPIExceptionStatus napi_define_properties(NAPIEnv env, NAPIValue object, size_t propertyCount,
+                                           const NAPIPropertyDescriptor *properties)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(object, Exception)
+    if (propertyCount)
+    {
+        CHECK_ARG(properties, Exception)
+    }
+
+    auto jsObject =
+        hermes::vm::dyn_vmcast_or_null<hermes::vm::JSObject>(*(const hermes::vm::PinnedHermesValue *)object);
+    RETURN_STATUS_IF_FALSE(jsObject, NAPIExceptionObjectExpected)
+
+    hermes::vm::GCScope gcScope(env->getRuntime());
+    auto objectHandle = env->getRuntime()->makeHandle(jsObject);
+    // 每个属性定义完成后释放其间创建的句柄，避免批量注册时 GCScope 持续增长
+    auto marker = gcScope.createMarker();
+    for (size_t i = 0; i < propertyCount; ++i)
+    {
+        CHECK_NAPI(defineProperty(env, objectHandle, &properties[i]), Exception, Exception)
+        gcScope.flushToMarker(marker);
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_call_function(NAPIEnv env, NAPIValue thisValue, NAPIValue func, size_t argc,
+                                       const NAPIValue *argv, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(func, Exception)
     if (argc)
     {
-        *argc = callbackInfo->getNativeArgs().getArgCount();
+        CHECK_ARG(argv, Exception)
     }
-    if (thisArg)
+
+    RETURN_STATUS_IF_FALSE(hermes::vm::vmisa<hermes::vm::Callable>(*(const hermes::vm::PinnedHermesValue *)func),
+                           NAPIExceptionFunctionExpected)
+
+    hermes::vm::GCScope gcScope(env->getRuntime());
+
+    // this
+    if (!thisValue)
+    {
+        CHECK_NAPI(napi_get_global(env, &thisValue), Error, Exception)
+    }
+
+    RETURN_STATUS_IF_FALSE(argc <= UINT32_MAX, NAPIExceptionInvalidArg)
+    auto functionHandle = env->getRuntime()->makeHandle(
+        hermes::vm::vmcast<hermes::vm::Callable>(*(const hermes::vm::PinnedHermesValue *)func));
+    // 参数直接写入寄存器栈上的 native 调用帧，不再创建 Arguments 对象
+    hermes::vm::ScopedNativeCallFrame newFrame(env->getRuntime(), (uint32_t)argc, functionHandle.getHermesValue(),
+                                               hermes::vm::HermesValue::encodeUndefinedValue(),
+                                               *(const hermes::vm::PinnedHermesValue *)thisValue);
+    if (newFrame.overflowed())
+    {
+        env->getRuntime()->raiseStackOverflow(hermes::vm::Runtime::StackOverflowKind::NativeStack);
+
+        return NAPIExceptionPendingException;
+    }
+    for (uint32_t i = 0; i < (uint32_t)argc; ++i)
+    {
+        newFrame->getArgRef(i) = *(const hermes::vm::PinnedHermesValue *)argv[i];
+    }
+    auto executeCallResult = hermes::vm::Callable::call(functionHandle, env->getRuntime());
+    CHECK_HERMES(executeCallResult)
+    if (result)
+    {
+        *result = (NAPIValue)hermes::vm::Handle<hermes::vm::HermesValue>(gcScope.getParentScope(),
+                                                                         executeCallResult.getValue().get())
+                      .unsafeGetPinnedHermesValue();
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_new_instance(NAPIEnv env, NAPIValue constructor, size_t argc, const NAPIValue *argv,
+                                      NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(constructor, Exception)
+    if (argc)
+    {
+        CHECK_ARG(argv, Exception)
+    }
+    CHECK_ARG(result, Exception)
+
+    RETURN_STATUS_IF_FALSE(
+        hermes::vm::isConstructor(env->getRuntime(), *(const hermes::vm::PinnedHermesValue *)constructor),
+        NAPIExceptionFunctionExpected)
+
+    hermes::vm::GCScope gcScope(env->getRuntime());
+
+    RETURN_STATUS_IF_FALSE(argc <= UINT32_MAX, NAPIExceptionInvalidArg)
+    auto functionHandle = env->getRuntime()->makeHandle(
+        hermes::vm::vmcast<hermes::vm::Callable>(*(const hermes::vm::PinnedHermesValue *)constructor));
+    auto thisCallResult = hermes::vm::Callable::createThisForConstruct(functionHandle, env->getRuntime());
+    CHECK_HERMES(thisCallResult)
+    auto thisHandle = env->getRuntime()->makeHandle(thisCallResult->getHermesValue());
+    hermes::vm::ScopedNativeCallFrame newFrame(env->getRuntime(), (uint32_t)argc, functionHandle.getHermesValue(),
+                                               functionHandle.getHermesValue(), thisHandle.getHermesValue());
+    if (newFrame.overflowed())
+    {
+        env->getRuntime()->raiseStackOverflow(hermes::vm::Runtime::StackOverflowKind::NativeStack);
+
+        return NAPIExceptionPendingException;
+    }
+    for (uint32_t i = 0; i < (uint32_t)argc; ++i)
+    {
+        newFrame->getArgRef(i) = *(const hermes::vm::PinnedHermesValue *)argv[i];
+    }
+    auto executeCallResult = hermes::vm::Callable::call(functionHandle, env->getRuntime());
+    CHECK_HERMES(executeCallResult)
+    if (executeCallResult.getValue()->isObject())
+    {
+        *result = (NAPIValue)hermes::vm::Handle<hermes::vm::HermesValue>(gcScope.getParentScope(),
+                                                                         executeCallResult.getValue().get())
+                      .unsafeGetPinnedHermesValue();
+    }
+    else
+    {
+        // TODO(ChasonTang): 返回标量的情况添加单测
+        *result = (NAPIValue)hermes::vm::Handle<hermes::vm::HermesValue>(gcScope.getParentScope(), thisHandle.get())
+                      .unsafeGetPinnedHermesValue();
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_instanceof(NAPIEnv env, NAPIValue object, NAPIValue constructor, bool *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(constructor, Exception)
+    CHECK_ARG(result, Exception)
+
+    hermes::vm::GCScope gcScope(env->getRuntime());
+
+    auto callResult = hermes::vm::instanceOfOperator_RJS(
+        env->getRuntime(), env->getRuntime()->makeHandle(*(const hermes::vm::PinnedHermesValue *)object),
+        env->getRuntime()->makeHandle(*(const hermes::vm::PinnedHermesValue *)constructor));
+    CHECK_HERMES(callResult)
+    *result = callResult.getValue();
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_strict_equals(NAPIEnv env, NAPIValue lhs, NAPIValue rhs, bool *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(lhs, Exception)
+    CHECK_ARG(rhs, Exception)
+    CHECK_ARG(result, Exception)
+
+    *result = hermes::vm::isSameValue(*(const hermes::vm::PinnedHermesValue *)lhs,
+                                      *(const hermes::vm::PinnedHermesValue *)rhs);
+
+    return NAPIExceptionOK;
+}
+
+NAPICommonStatus napi_get_cb_info(NAPIEnv env, NAPICallbackInfo callbackInfo, size_t *argc, NAPIValue *argv,
+                                  NAPIValue *thisArg, void **data)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(callbackInfo, Common)
+
+    if (argv)
+    {
+        CHECK_ARG(argc, Common)
+        unsigned int i = 0;
+        size_t min = std::min(callbackInfo->getNativeArgs().getArgCount(), (unsigned int)*argc);
+        for (; i < min; ++i)
+        {
+            argv[i] = (NAPIValue)callbackInfo->getNativeArgs().getArgHandle(i).unsafeGetPinnedHermesValue();
+        }
+        if (i < *argc)
+        {
+            NAPIValue undefined = (NAPIValue)hermes::vm::Runtime::getUndefinedValue().unsafeGetPinnedHermesValue();
+            for (; i < *argc; ++i)
+            {
+                argv[i] = undefined;
+            }
+        }
+    }
+    if (argc)
+    {
+        *argc = callbackInfo->getNativeArgs().getArgCount();
+    }
+    if (thisArg)
+    {
+        *thisArg = (NAPIValue)callbackInfo->getNativeArgs().getThisHandle().unsafeGetPinnedHermesValue();
+    }
+    if (data)
+    {
+        *data = callbackInfo->getData();
+    }
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus napi_get_new_target(NAPIEnv env, NAPICallbackInfo callbackInfo, NAPIValue *result)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(callbackInfo, Common)
+    CHECK_ARG(result, Common)
+
+    if (callbackInfo->getNativeArgs().getNewTarget().isUndefined())
+    {
+        *result = nullptr;
+    }
+    else
+    {
+        *result = (NAPIValue)callbackInfo->getNativeArgs().getNewTargetHandle().unsafeGetPinnedHermesValue();
+    }
+
+    return NAPICommonOK;
+}
+
+NAPIExceptionStatus napi_create_external(NAPIEnv env, void *data, NAPIFinalize finalizeCB, void *finalizeHint,
+                                         NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(result, Exception)
+
+    auto hermesExternalObject =
+        new (std::nothrow)::External(env->getRuntime(), env->externalCount, data, finalizeCB, finalizeHint);
+    RETURN_STATUS_IF_FALSE(hermesExternalObject, NAPIExceptionMemoryError)
+
+    auto callResult = hermes::vm::HostObject::createWithoutPrototype(env->getRuntime(),
+                                                                     std::unique_ptr<External>(hermesExternalObject));
+    CHECK_HERMES(callResult)
+    *result = (NAPIValue)env->getRuntime()->makeHandle(callResult.getValue()).unsafeGetPinnedHermesValue();
+
+    return NAPIExceptionOK;
+}
+
+NAPIErrorStatus napi_get_value_external(NAPIEnv env, NAPIValue value, void **result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(value, Error)
+    CHECK_ARG(result, Error)
+
+    auto hostObject =
+        hermes::vm::dyn_vmcast_or_null<hermes::vm::HostObject>(*(const hermes::vm::PinnedHermesValue *)value);
+    RETURN_STATUS_IF_FALSE(hostObject, NAPIErrorExternalExpected)
+
+    auto external = (External *)hostObject->getProxy();
+    *result = external ? external->getData() : nullptr;
+
+    return NAPIErrorOK;
+}
+
+NAPIExceptionStatus napi_create_arraybuffer(NAPIEnv env, size_t byteLength, void **data, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(result, Exception)
+    RETURN_STATUS_IF_FALSE(byteLength <= std::numeric_limits<hermes::vm::JSArrayBuffer::size_type>::max(),
+                           NAPIExceptionInvalidArg)
+
+    hermes::vm::GCScope gcScope(env->getRuntime());
+    auto arrayBufferHandle = env->getRuntime()->makeHandle(hermes::vm::JSArrayBuffer::create(
+        env->getRuntime(), hermes::vm::Handle<hermes::vm::JSObject>::vmcast(&env->getRuntime()->arrayBufferPrototype)));
+    // 默认初始化为 0
+    CHECK_HERMES(arrayBufferHandle->createDataBlock(env->getRuntime(), byteLength))
+    if (data)
+    {
+        *data = arrayBufferHandle->getDataBlock();
+    }
+    *result = (NAPIValue)hermes::vm::Handle<hermes::vm::HermesValue>(gcScope.getParentScope(),
+                                                                     arrayBufferHandle.getHermesValue())
+                  .unsafeGetPinnedHermesValue();
+
+    return NAPIExceptionOK;
+}
+
+// JSArrayBuffer 只能持有自己通过 malloc 分配的数据块，因此拷贝后立即调用 finalizeCB
+NAPIExceptionStatus napi_create_external_arraybuffer(NAPIEnv env, void *externalData, size_t byteLength,
+                                                     NAPIFinalize finalizeCB, void *finalizeHint, NAPIValue *result,
+                                                     bool *copied)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(result, Exception)
+    if (byteLength)
+    {
+        CHECK_ARG(externalData, Exception)
+    }
+
+    void *data;
+    CHECK_NAPI(napi_create_arraybuffer(env, byteLength, &data, result), Exception, Exception)
+    if (byteLength)
+    {
+        std::memcpy(data, externalData, byteLength);
+    }
+    if (finalizeCB)
+    {
+        finalizeCB(externalData, finalizeHint);
+    }
+    if (copied)
+    {
+        *copied = true;
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPICommonStatus napi_is_arraybuffer(NAPIEnv /*env*/, NAPIValue value, bool *result)
+{
+    CHECK_ARG(value, Common)
+    CHECK_ARG(result, Common)
+
+    *result = hermes::vm::vmisa<hermes::vm::JSArrayBuffer>(*(const hermes::vm::PinnedHermesValue *)value);
+
+    return NAPICommonOK;
+}
+
+NAPIErrorStatus napi_get_arraybuffer_info(NAPIEnv /*env*/, NAPIValue arraybuffer, void **data, size_t *byteLength)
+{
+    CHECK_ARG(arraybuffer, Error)
+
+    auto jsArrayBuffer =
+        hermes::vm::dyn_vmcast_or_null<hermes::vm::JSArrayBuffer>(*(const hermes::vm::PinnedHermesValue *)arraybuffer);
+    RETURN_STATUS_IF_FALSE(jsArrayBuffer && jsArrayBuffer->attached(), NAPIErrorInvalidArg)
+    if (data)
+    {
+        *data = jsArrayBuffer->getDataBlock();
+    }
+    if (byteLength)
+    {
+        *byteLength = jsArrayBuffer->size();
+    }
+
+    return NAPIErrorOK;
+}
+
+namespace
+{
+
+// 下标与 NAPITypedArrayType 一致
+constexpr uint8_t kTypedArrayElementSizes[] = {1, 1, 1, 2, 2, 4, 4, 4, 8};
+
+template <typename TypedArray>
+hermes::vm::HermesValue createTypedArray(hermes::vm::Runtime *runtime,
+                                         hermes::vm::Handle<hermes::vm::JSArrayBuffer> arrayBufferHandle,
+                                         size_t byteOffset, size_t byteLength, uint8_t elementSize)
+{
+    auto typedArray = TypedArray::create(runtime, TypedArray::getPrototype(runtime));
+    hermes::vm::JSTypedArrayBase::setBuffer(runtime, typedArray.get(), *arrayBufferHandle, byteOffset, byteLength,
+                                            elementSize);
+
+    return typedArray.getHermesValue();
+}
+
+} // namespace
+
+NAPIExceptionStatus napi_create_typedarray(NAPIEnv env, NAPITypedArrayType type, size_t length, NAPIValue arraybuffer,
+                                           size_t byteOffset, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(arraybuffer, Exception)
+    CHECK_ARG(result, Exception)
+    RETURN_STATUS_IF_FALSE(type >= NAPIInt8Array && type <= NAPIFloat64Array, NAPIExceptionInvalidArg)
+
+    auto jsArrayBuffer =
+        hermes::vm::dyn_vmcast_or_null<hermes::vm::JSArrayBuffer>(*(const hermes::vm::PinnedHermesValue *)arraybuffer);
+    RETURN_STATUS_IF_FALSE(jsArrayBuffer && jsArrayBuffer->attached(), NAPIExceptionInvalidArg)
+    uint8_t elementSize = kTypedArrayElementSizes[type];
+    if (byteOffset % elementSize)
+    {
+        (void)env->getRuntime()->raiseRangeError("Start offset of TypedArray should be a multiple of element size");
+
+        return NAPIExceptionPendingException;
+    }
+    size_t arrayBufferLength = jsArrayBuffer->size();
+    if (byteOffset > arrayBufferLength || length > (arrayBufferLength - byteOffset) / elementSize)
+    {
+        (void)env->getRuntime()->raiseRangeError("Invalid TypedArray length");
+
+        return NAPIExceptionPendingException;
+    }
+
+    hermes::vm::GCScope gcScope(env->getRuntime());
+    auto arrayBufferHandle = env->getRuntime()->makeHandle(jsArrayBuffer);
+    size_t byteLength = length * elementSize;
+    hermes::vm::HermesValue typedArrayValue;
+    switch (type)
+    {
+    case NAPIInt8Array:
+        typedArrayValue = createTypedArray<hermes::vm::Int8Array>(env->getRuntime(), arrayBufferHandle, byteOffset,
+                                                                  byteLength, elementSize);
+        break;
+    case NAPIUint8Array:
+        typedArrayValue = createTypedArray<hermes::vm::Uint8Array>(env->getRuntime(), arrayBufferHandle, byteOffset,
+                                                                   byteLength, elementSize);
+        break;
+    case NAPIUint8ClampedArray:
+        typedArrayValue = createTypedArray<hermes::vm::Uint8ClampedArray>(env->getRuntime(), arrayBufferHandle,
+                                                                          byteOffset, byteLength, elementSize);
+        break;
+    case NAPIInt16Array:
+        typedArrayValue = createTypedArray<hermes::vm::Int16Array>(env->getRuntime(), arrayBufferHandle, byteOffset,
+                                                                   byteLength, elementSize);
+        break;
+    case NAPIUint16Array:
+        typedArrayValue = createTypedArray<hermes::vm::Uint16Array>(env->getRuntime(), arrayBufferHandle, byteOffset,
+                                                                    byteLength, elementSize);
+        break;
+    case NAPIInt32Array:
+        typedArrayValue = createTypedArray<hermes::vm::Int32Array>(env->getRuntime(), arrayBufferHandle, byteOffset,
+                                                                   byteLength, elementSize);
+        break;
+    case NAPIUint32Array:
+        typedArrayValue = createTypedArray<hermes::vm::Uint32Array>(env->getRuntime(), arrayBufferHandle, byteOffset,
+                                                                    byteLength, elementSize);
+        break;
+    case NAPIFloat32Array:
+        typedArrayValue = createTypedArray<hermes::vm::Float32Array>(env->getRuntime(), arrayBufferHandle,
+                                                                     byteOffset, byteLength, elementSize);
+        break;
+    case NAPIFloat64Array:
+        typedArrayValue = createTypedArray<hermes::vm::Float64Array>(env->getRuntime(), arrayBufferHandle,
+                                                                     byteOffset, byteLength, elementSize);
+        break;
+    }
+    *result = (NAPIValue)hermes::vm::Handle<hermes::vm::HermesValue>(gcScope.getParentScope(), typedArrayValue)
+                  .unsafeGetPinnedHermesValue();
+
+    return NAPIExceptionOK;
+}
+
+NAPICommonStatus napi_is_typedarray(NAPIEnv /*env*/, NAPIValue value, bool *result)
+{
+    CHECK_ARG(value, Common)
+    CHECK_ARG(result, Common)
+
+    *result = hermes::vm::vmisa<hermes::vm::JSTypedArrayBase>(*(const hermes::vm::PinnedHermesValue *)value);
+
+    return NAPICommonOK;
+}
+
+NAPIErrorStatus napi_get_typedarray_info(NAPIEnv env, NAPIValue typedarray, NAPITypedArrayType *type, size_t *length,
+                                         void **data, NAPIValue *arraybuffer, size_t *byteOffset)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(typedarray, Error)
+
+    auto typedArray = hermes::vm::dyn_vmcast_or_null<hermes::vm::JSTypedArrayBase>(
+        *(const hermes::vm::PinnedHermesValue *)typedarray);
+    RETURN_STATUS_IF_FALSE(typedArray, NAPIErrorInvalidArg)
+    if (type)
+    {
+        switch (typedArray->getKind())
+        {
+        case hermes::vm::CellKind::Int8ArrayKind:
+            *type = NAPIInt8Array;
+            break;
+        case hermes::vm::CellKind::Uint8ArrayKind:
+            *type = NAPIUint8Array;
+            break;
+        case hermes::vm::CellKind::Uint8ClampedArrayKind:
+            *type = NAPIUint8ClampedArray;
+            break;
+        case hermes::vm::CellKind::Int16ArrayKind:
+            *type = NAPIInt16Array;
+            break;
+        case hermes::vm::CellKind::Uint16ArrayKind:
+            *type = NAPIUint16Array;
+            break;
+        case hermes::vm::CellKind::Int32ArrayKind:
+            *type = NAPIInt32Array;
+            break;
+        case hermes::vm::CellKind::Uint32ArrayKind:
+            *type = NAPIUint32Array;
+            break;
+        case hermes::vm::CellKind::Float32ArrayKind:
+            *type = NAPIFloat32Array;
+            break;
+        case hermes::vm::CellKind::Float64ArrayKind:
+            *type = NAPIFloat64Array;
+            break;
+        default:
+            // BigInt64Array 等
+            return NAPIErrorInvalidArg;
+        }
+    }
+    if (length)
+    {
+        *length = typedArray->getLength();
+    }
+    if (byteOffset)
+    {
+        *byteOffset = typedArray->getByteOffset();
+    }
+    auto jsArrayBuffer = typedArray->getBuffer(env->getRuntime());
+    if (data)
+    {
+        // 分离后 data 为 NULL
+        *data = jsArrayBuffer && jsArrayBuffer->attached()
+                    ? jsArrayBuffer->getDataBlock() + typedArray->getByteOffset()
+                    : nullptr;
+    }
+    if (arraybuffer)
+    {
+        RETURN_STATUS_IF_FALSE(jsArrayBuffer, NAPIErrorInvalidArg)
+        *arraybuffer = (NAPIValue)env->getRuntime()
+                           ->makeHandle(hermes::vm::HermesValue::encodeObjectValue(jsArrayBuffer))
+                           .unsafeGetPinnedHermesValue();
+    }
+
+    return NAPIErrorOK;
+}
+
+NAPIExceptionStatus napi_create_reference(NAPIEnv env, NAPIValue value, uint32_t initialRefCount, NAPIRef *result)
+{
+    CHECK_ARG(env, Exception)
+    CHECK_ARG(value, Exception)
+    CHECK_ARG(result, Exception)
+
+    *result = new (std::nothrow) OpaqueNAPIRef(env, *(const hermes::vm::PinnedHermesValue *)value, initialRefCount);
+    RETURN_STATUS_IF_FALSE(*result, NAPIExceptionMemoryError)
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_delete_reference(NAPIEnv env, NAPIRef ref)
+{
+    CHECK_ARG(env, Exception)
+    CHECK_ARG(ref, Exception)
+
+    delete ref;
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_reference_ref(NAPIEnv env, NAPIRef ref, uint32_t *result)
+{
+    CHECK_ARG(env, Exception)
+    CHECK_ARG(ref, Exception)
+
+    ref->ref();
+    if (result)
+    {
+        *result = ref->getReferenceCount();
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_reference_unref(NAPIEnv env, NAPIRef ref, uint32_t *result)
+{
+    CHECK_ARG(env, Exception)
+    CHECK_ARG(ref, Exception)
+
+    RETURN_STATUS_IF_FALSE(ref->getReferenceCount(), NAPIExceptionGenericFailure)
+    ref->unref();
+    if (result)
+    {
+        *result = ref->getReferenceCount();
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_get_reference_value(NAPIEnv env, NAPIRef ref, NAPIValue *result)
+{
+    CHECK_ARG(env, Exception)
+    CHECK_ARG(ref, Exception)
+    CHECK_ARG(result, Exception)
+
+    RETURN_STATUS_IF_FALSE(env->getRuntime()->getTopGCScope(), NAPIExceptionHandleScopeEmpty)
+
+    *result = (NAPIValue)ref->getHermesValue();
+
+    return NAPIExceptionOK;
+}
+
+NAPIErrorStatus napi_open_handle_scope(NAPIEnv env, NAPIHandleScope *result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(result, Error)
+
+    *result = env->acquireHandleScope();
+    RETURN_STATUS_IF_FALSE(*result, NAPIErrorMemoryError)
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus napi_close_handle_scope(NAPIEnv env, NAPIHandleScope scope)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(scope, Common)
+
+    env->releaseHandleScope(scope);
+
+    return NAPICommonOK;
+}
+
+// NAPIHandleScopeMismatch
+NAPIErrorStatus napi_reset_handle_scope(NAPIEnv env, NAPIHandleScope scope)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(scope, Error)
+
+    RETURN_STATUS_IF_FALSE(scope->gcScope.hasValue() &&
+                               env->getRuntime()->getTopGCScope() == scope->gcScope.getPointer(),
+                           NAPIErrorHandleScopeMismatch)
+    scope->gcScope->flushToSmallCount(0);
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus napi_open_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandleScope *result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(result, Error)
+
+    RETURN_STATUS_IF_FALSE(env->getRuntime()->getTopGCScope(), NAPIErrorHandleScopeMismatch)
+
+    *result = env->acquireHandleScope();
+    RETURN_STATUS_IF_FALSE(*result, NAPIErrorMemoryError)
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus napi_close_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandleScope scope)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(scope, Common)
+
+    env->releaseHandleScope(scope);
+
+    return NAPICommonOK;
+}
+
+NAPIErrorStatus napi_escape_handle(NAPIEnv env, NAPIEscapableHandleScope scope, NAPIValue escapee, NAPIValue *result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(scope, Error)
+    CHECK_ARG(escapee, Error)
+    CHECK_ARG(result, Error)
+
+    RETURN_STATUS_IF_FALSE(!scope->isEscapeCalled(), NAPIErrorEscapeCalledTwice)
+
+    *result = (NAPIValue)hermes::vm::Handle<hermes::vm::HermesValue>(scope->gcScope->getParentScope(),
+                                                                     *(const hermes::vm::PinnedHermesValue *)escapee)
+                  .unsafeGetPinnedHermesValue();
+    scope->setEscapeCalled(true);
+
+    return NAPIErrorOK;
+}
+
+NAPIExceptionStatus napi_throw(NAPIEnv env, NAPIValue error)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(error, Exception)
+
+    // 直接忽略返回值
+    env->getRuntime()->setThrownValue(*(const hermes::vm::PinnedHermesValue *)error);
+
+    return NAPIExceptionOK;
+}
+
+NAPIErrorStatus napi_get_and_clear_last_exception(NAPIEnv env, NAPIValue *result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(result, Error)
+
+    if (env->getRuntime()->getThrownValue().isEmpty())
+    {
+        *result = (NAPIValue)hermes::vm::Runtime::getUndefinedValue().unsafeGetPinnedHermesValue();
+    }
+    else
+    {
+        *result =
+            (NAPIValue)env->getRuntime()->makeHandle(env->getRuntime()->getThrownValue()).unsafeGetPinnedHermesValue();
+        env->getRuntime()->clearThrownValue();
+    }
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus NAPIClearLastException(NAPIEnv env)
+{
+    CHECK_ARG(env, Common)
+
+    env->getRuntime()->clearThrownValue();
+
+    return NAPICommonOK;
+}
+
+NAPIExceptionStatus NAPIRunScript(NAPIEnv env, const char *script, const char *sourceUrl, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+
+    if (env->codeCache)
     {
-        *thisArg = (NAPIValue)callbackInfo->getNativeArgs().getThisHandle().unsafeGetPinnedHermesValue();
+        return NAPICodeCacheRunScript(env, env->codeCache, script, sourceUrl, result);
     }
-    if (data)
+
+    return NAPIRunScriptWithOptions(env, script, sourceUrl, nullptr, result);
+}
+
+namespace
+{
+// options 为空时保持 NAPIRunScript 原有行为：lazy 编译并生成完整调试信息
+// Hermes 不保留函数源码，忽略 stripSource
+hermes::hbc::CompileFlags getCompileFlags(const NAPIScriptOptions *options)
+{
+    hermes::hbc::CompileFlags compileFlags = {};
+    compileFlags.lazy = !options || !options->eager;
+    compileFlags.debug = !options || !options->stripDebugInfo;
+    if (options)
     {
-        *data = callbackInfo->getData();
+        compileFlags.optimize = options->optimize;
+        compileFlags.strict = options->strict;
     }
 
-    return NAPICommonOK;
+    return compileFlags;
 }
+} // namespace
 
-NAPICommonStatus napi_get_new_target(NAPIEnv env, NAPICallbackInfo callbackInfo, NAPIValue *result)
+NAPIExceptionStatus NAPIRunScriptWithOptions(NAPIEnv env, const char *script, const char *sourceUrl,
+                                             const NAPIScriptOptions *options, NAPIValue *result)
 {
-    CHECK_ARG(env, Common)
-    CHECK_ARG(callbackInfo, Common)
-    CHECK_ARG(result, Common)
+    NAPI_PREAMBLE(env)
+    // 当前 Hermes 版本不支持执行 ES module
+    RETURN_STATUS_IF_FALSE(!options || !options->module, NAPIExceptionInvalidArg)
 
-    if (callbackInfo->getNativeArgs().getNewTarget().isUndefined())
-    {
-        *result = nullptr;
-    }
-    else
+    auto callResult = env->getRuntime()->run(script, sourceUrl, getCompileFlags(options));
+    CHECK_HERMES(callResult)
+    if (result)
     {
-        *result = (NAPIValue)callbackInfo->getNativeArgs().getNewTargetHandle().unsafeGetPinnedHermesValue();
+        *result = (NAPIValue)env->getRuntime()->makeHandle(callResult.getValue()).unsafeGetPinnedHermesValue();
     }
 
-    return NAPICommonOK;
+    return NAPIExceptionOK;
 }
 
-NAPIExceptionStatus napi_create_external(NAPIEnv env, void *data, NAPIFinalize finalizeCB, void *finalizeHint,
-                                         NAPIValue *result)
+NAPIExceptionStatus NAPIParseUTF8JSONString(NAPIEnv env, const char *utf8String, NAPIValue *result)
 {
     NAPI_PREAMBLE(env)
+    CHECK_ARG(utf8String, Exception)
     CHECK_ARG(result, Exception)
 
-    auto hermesExternalObject = new (std::nothrow)::External(env->getRuntime(), data, finalizeCB, finalizeHint);
-    RETURN_STATUS_IF_FALSE(hermesExternalObject, NAPIExceptionMemoryError)
+    hermes::vm::GCScope gcScope(env->getRuntime());
+    NAPIValue stringValue;
+    CHECK_NAPI(napi_create_string_utf8(env, utf8String, &stringValue), Exception, Exception)
+    // 直接使用引擎内部 JSON 解析器，不经过 JSON.parse
+    auto callResult = hermes::vm::runtimeJSONParse(
+        env->getRuntime(),
+        env->getRuntime()->makeHandle(
+            hermes::vm::vmcast<hermes::vm::StringPrimitive>(*(const hermes::vm::PinnedHermesValue *)stringValue)),
+        hermes::vm::Runtime::makeNullHandle<hermes::vm::Callable>());
+    CHECK_HERMES(callResult)
+    *result = (NAPIValue)hermes::vm::Handle<hermes::vm::HermesValue>(gcScope.getParentScope(), callResult.getValue())
+                  .unsafeGetPinnedHermesValue();
 
-    auto callResult = hermes::vm::HostObject::createWithoutPrototype(env->getRuntime(),
-                                                                     std::unique_ptr<External>(hermesExternalObject));
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus NAPIDefineClass(NAPIEnv env, const char *utf8name, NAPICallback constructor, void *data,
+                                    NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(constructor, Exception)
+    CHECK_ARG(result, Exception)
+
+    hermes::vm::GCScope gcScope(env->getRuntime());
+
+    auto functionInfo = new (std::nothrow) FunctionInfo(env, constructor, data);
+    RETURN_STATUS_IF_FALSE(functionInfo, NAPIExceptionMemoryError)
+    NAPIValue externalValue;
+    auto finalizeCallback = [](void *finalizeData, void * /*finalizeHint*/) { delete (FunctionInfo *)finalizeData; };
+    auto createExternalStatus = napi_create_external(env, functionInfo, finalizeCallback, nullptr, &externalValue);
+    if (createExternalStatus != NAPIExceptionOK)
+    {
+        delete functionInfo;
+
+        return createExternalStatus;
+    }
+
+    hermes::vm::NativeFunctionPtr nativeFunctionPtr =
+        [](void *context, hermes::vm::Runtime *runtime,
+           hermes::vm::NativeArgs args) -> hermes::vm::CallResult<hermes::vm::HermesValue> {
+        hermes::vm::GCScope inlineGCScope(runtime);
+        auto innerFunctionInfo = (FunctionInfo *)context;
+        if (!innerFunctionInfo->getCallback() || !innerFunctionInfo->getEnv())
+        {
+            assert(false);
+
+            return args.getThisArg();
+        }
+        struct OpaqueNAPICallbackInfo callbackInfo(args, innerFunctionInfo->getData());
+        NAPIValue returnValue = innerFunctionInfo->getCallback()(innerFunctionInfo->getEnv(), &callbackInfo);
+        RETURN_STATUS_IF_FALSE(innerFunctionInfo->getEnv()->getRuntime()->getThrownValue().isEmpty(),
+                               hermes::vm::ExecutionStatus::EXCEPTION)
+        if (!returnValue || !((const hermes::vm::PinnedHermesValue *)returnValue)->isObject())
+        {
+            return args.getThisArg();
+        }
+
+        return {*(const hermes::vm::PinnedHermesValue *)returnValue};
+    };
+    auto nativeConstructor = hermes::vm::NativeConstructor::create(
+        env->getRuntime(), hermes::vm::Handle<hermes::vm::JSObject>::vmcast(&env->getRuntime()->functionPrototype),
+        functionInfo, nativeFunctionPtr, 0, hermes::vm::NativeConstructor::creatorFunction<hermes::vm::JSObject>,
+        hermes::vm::CellKind::ObjectKind);
+
+    NAPIValue stringValue;
+    CHECK_NAPI(napi_create_string_utf8(env, utf8name, &stringValue), Exception, Exception)
+    auto stringPrimitive = hermes::vm::dyn_vmcast_or_null<hermes::vm::StringPrimitive>(
+        *(const hermes::vm::PinnedHermesValue *)stringValue);
+    RETURN_STATUS_IF_FALSE(stringPrimitive, NAPIExceptionMemoryError)
+    auto callResult = hermes::vm::stringToSymbolID(env->getRuntime(), hermes::vm::createPseudoHandle(stringPrimitive));
     CHECK_HERMES(callResult)
-    *result = (NAPIValue)env->getRuntime()->makeHandle(callResult.getValue()).unsafeGetPinnedHermesValue();
+    auto symbolId = callResult.getValue().get();
+    auto rawObject = hermes::vm::JSObject::create(env->getRuntime());
+    auto defineCallResult = hermes::vm::Callable::defineNameLengthAndPrototype(
+        env->getRuntime()->makeHandle(nativeConstructor.get()), env->getRuntime(), symbolId, 0,
+        env->getRuntime()->makeHandle(rawObject.get()), hermes::vm::Callable::WritablePrototype::No, false);
+    CHECK_HERMES(defineCallResult)
+    *result = (NAPIValue)hermes::vm::Handle<hermes::vm::HermesValue>(gcScope.getParentScope(),
+                                                                     nativeConstructor.getHermesValue())
+                  .unsafeGetPinnedHermesValue();
+    NAPIValue privateKeyString;
+    CHECK_NAPI(napi_create_string_utf8(env, "__constructor__", &privateKeyString), Exception, Exception)
+    CHECK_NAPI(napi_set_property(env, *result, privateKeyString, externalValue), Exception, Exception)
 
     return NAPIExceptionOK;
 }
 
-NAPIErrorStatus napi_get_value_external(NAPIEnv env, NAPIValue value, void **result)
+// Hermes 每个 env 都有独立的 hermes::vm::Runtime，NAPIRuntime 只用于保存 NAPICreateEnv 的默认参数
+struct OpaqueNAPIRuntime final
 {
-    CHECK_ARG(env, Error)
-    CHECK_ARG(value, Error)
-    CHECK_ARG(result, Error)
+    NAPIRuntimeOptions options;
+};
 
-    auto hostObject =
-        hermes::vm::dyn_vmcast_or_null<hermes::vm::HostObject>(*(const hermes::vm::PinnedHermesValue *)value);
-    RETURN_STATUS_IF_FALSE(hostObject, NAPIErrorExternalExpected)
+namespace
+{
+inline bool isRuntimeOptionsValid(const NAPIRuntimeOptions *options)
+{
+    return !options || (options->version && options->version <= NAPI_RUNTIME_OPTIONS_VERSION);
+}
+} // namespace
 
-    auto external = (External *)hostObject->getProxy();
-    *result = external ? external->getData() : nullptr;
+NAPIErrorStatus NAPICreateRuntime(NAPIRuntime *runtime)
+{
+    CHECK_ARG(runtime, Error)
+
+    *runtime = nullptr;
 
     return NAPIErrorOK;
 }
 
-NAPIExceptionStatus napi_create_reference(NAPIEnv env, NAPIValue value, uint32_t initialRefCount, NAPIRef *result)
+NAPIErrorStatus NAPICreateRuntimeWithOptions(const NAPIRuntimeOptions *options, NAPIRuntime *runtime)
 {
-    CHECK_ARG(env, Exception)
-    CHECK_ARG(value, Exception)
-    CHECK_ARG(result, Exception)
+    CHECK_ARG(runtime, Error)
+    RETURN_STATUS_IF_FALSE(isRuntimeOptionsValid(options), NAPIErrorInvalidArg)
 
-    *result = new (std::nothrow) OpaqueNAPIRef(env, *(const hermes::vm::PinnedHermesValue *)value, initialRefCount);
-    RETURN_STATUS_IF_FALSE(*result, NAPIExceptionMemoryError)
+    if (!options)
+    {
+        return NAPICreateRuntime(runtime);
+    }
+    *runtime = new (std::nothrow) OpaqueNAPIRuntime{*options};
+    RETURN_STATUS_IF_FALSE(*runtime, NAPIErrorMemoryError)
 
-    return NAPIExceptionOK;
+    return NAPIErrorOK;
 }
 
-NAPIExceptionStatus napi_delete_reference(NAPIEnv env, NAPIRef ref)
+NAPICommonStatus NAPIFreeRuntime(NAPIRuntime runtime)
 {
-    CHECK_ARG(env, Exception)
-    CHECK_ARG(ref, Exception)
+    delete runtime;
 
-    delete ref;
+    return NAPICommonOK;
+}
 
-    return NAPIExceptionOK;
+NAPIErrorStatus NAPICreateEnv(NAPIEnv *env, NAPIRuntime runtime)
+{
+    return NAPICreateEnvWithOptions(env, runtime, runtime ? &runtime->options : nullptr);
 }
 
-NAPIExceptionStatus napi_reference_ref(NAPIEnv env, NAPIRef ref, uint32_t *result)
+// gcThreshold 和 stackSize 没有对应配置，Hermes 的 GC 时机由堆大小决定，调用深度由寄存器栈决定
+NAPIErrorStatus NAPICreateEnvWithOptions(NAPIEnv *env, NAPIRuntime runtime, const NAPIRuntimeOptions *options)
 {
-    CHECK_ARG(env, Exception)
-    CHECK_ARG(ref, Exception)
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(isRuntimeOptionsValid(options), NAPIErrorInvalidArg)
 
-    ref->ref();
-    if (result)
+    auto gcConfigBuilder = hermes::vm::GCConfig::Builder()
+                               .withName("N-API")
+                               //                                   .withAllocInYoung(false)
+                               //                                   .withRevertToYGAtTTI(true)
+                               .withMaxHeapSize(options && options->maxHeapSize ? options->maxHeapSize : 1024 << 20);
+    if (options && options->initialHeapSize)
     {
-        *result = ref->getReferenceCount();
+        gcConfigBuilder.withInitHeapSize(options->initialHeapSize);
     }
+    auto runtimeConfig =
+        hermes::vm::RuntimeConfig::Builder()
+            .withGCConfig(gcConfigBuilder.build())
+            //                                 .withRegisterStack(nullptr)
+            .withMaxNumRegisters(options && options->maxNumRegisters ? options->maxNumRegisters : kMaxNumRegisters)
+            .build();
+    *env = new (std::nothrow) OpaqueNAPIEnv(runtimeConfig);
+    RETURN_STATUS_IF_FALSE(*env, NAPIErrorMemoryError)
 
-    return NAPIExceptionOK;
+    return NAPIErrorOK;
 }
 
-NAPIExceptionStatus napi_reference_unref(NAPIEnv env, NAPIRef ref, uint32_t *result)
+NAPICommonStatus NAPIEnableDebugger(NAPIEnv env, const char *debuggerTitle, bool waitForDebugger)
 {
-    CHECK_ARG(env, Exception)
-    CHECK_ARG(ref, Exception)
+    CHECK_ARG(env, Common)
 
-    RETURN_STATUS_IF_FALSE(ref->getReferenceCount(), NAPIExceptionGenericFailure)
-    ref->unref();
-    if (result)
-    {
-        *result = ref->getReferenceCount();
-    }
+    env->enableDebugger(debuggerTitle, waitForDebugger);
 
-    return NAPIExceptionOK;
+    return NAPICommonOK;
 }
 
-NAPIExceptionStatus napi_get_reference_value(NAPIEnv env, NAPIRef ref, NAPIValue *result)
+NAPICommonStatus NAPIDisableDebugger(NAPIEnv env)
 {
-    CHECK_ARG(env, Exception)
-    CHECK_ARG(ref, Exception)
-    CHECK_ARG(result, Exception)
+    CHECK_ARG(env, Common)
 
-    RETURN_STATUS_IF_FALSE(env->getRuntime()->getTopGCScope(), NAPIExceptionHandleScopeEmpty)
+    env->disableDebugger();
 
-    *result = (NAPIValue)ref->getHermesValue();
+    return NAPICommonOK;
+}
 
-    return NAPIExceptionOK;
+NAPICommonStatus NAPISetMessageQueueThread(NAPIEnv env, MessageQueueThreadWrapper jsQueueWrapper)
+{
+#ifdef HERMES_ENABLE_DEBUGGER
+    CHECK_ARG(env, Common);
+    env->setMessageQueueThread(jsQueueWrapper->thread_);
+#endif
+    return NAPICommonOK;
 }
 
-NAPIErrorStatus napi_open_handle_scope(NAPIEnv env, NAPIHandleScope *result)
+NAPICommonStatus NAPIFreeEnv(NAPIEnv env)
+{
+    CHECK_ARG(env, Common)
+
+    delete env;
+
+    return NAPICommonOK;
+}
+
+NAPIErrorStatus NAPIGetValueStringUTF8(NAPIEnv env, NAPIValue value, const char **result)
 {
     CHECK_ARG(env, Error)
+    CHECK_ARG(value, Error)
     CHECK_ARG(result, Error)
 
-    *result = (NAPIHandleScope) new (std::nothrow) hermes::vm::GCScope(env->getRuntime());
-    RETURN_STATUS_IF_FALSE(*result, NAPIErrorMemoryError)
+    // 先计算准确长度，避免按 size() * 3 + 1 分配
+    size_t length;
+    CHECK_NAPI(napi_get_value_string_utf8(env, value, nullptr, 0, &length), Error, Error)
+    char *buffer = static_cast<char *>(malloc(sizeof(char) * (length + 1)));
+    RETURN_STATUS_IF_FALSE(buffer, NAPIErrorMemoryError)
+    // 第一次调用已经校验过参数，不会失败
+    napi_get_value_string_utf8(env, value, buffer, length + 1, nullptr);
+    *result = buffer;
 
     return NAPIErrorOK;
 }
 
-NAPICommonStatus napi_close_handle_scope(NAPIEnv env, NAPIHandleScope scope)
+NAPICommonStatus NAPIFreeUTF8String(NAPIEnv env, const char *cString)
 {
     CHECK_ARG(env, Common)
-    CHECK_ARG(scope, Common)
+    CHECK_ARG(cString, Common)
 
-    delete (hermes::vm::GCScope *)scope;
+    free((void *)cString);
 
     return NAPICommonOK;
 }
 
-EXTERN_C_START
-
-struct OpaqueNAPIEscapableHandleScope
+namespace
 {
-    OpaqueNAPIEscapableHandleScope() : escapeCalled(false)
+// 持有一份数据拷贝并在末尾补 '\0'，源码和字节码都需要在 BCProvider 存活期间保持有效
+class CopiedBuffer final : public hermes::Buffer
+{
+  public:
+    CopiedBuffer(const uint8_t *data, size_t size) : hermes::Buffer(copyData(data, size), size)
     {
     }
 
-    OpaqueNAPIEscapableHandleScope(const OpaqueNAPIEscapableHandleScope &) = delete;
-    OpaqueNAPIEscapableHandleScope(OpaqueNAPIEscapableHandleScope &&) = delete;
-    OpaqueNAPIEscapableHandleScope &operator=(const OpaqueNAPIEscapableHandleScope &) = delete;
-    OpaqueNAPIEscapableHandleScope &operator=(OpaqueNAPIEscapableHandleScope &&) = delete;
+    ~CopiedBuffer() override
+    {
+        free((void *)data());
+    }
 
-    bool isEscapeCalled() const
+    bool isValid() const
     {
-        return escapeCalled;
+        return data();
     }
 
-    void setEscapeCalled(bool escapeCalled1)
+  private:
+    static const uint8_t *copyData(const uint8_t *data, size_t size)
     {
-        escapeCalled = escapeCalled1;
+        auto copy = static_cast<uint8_t *>(malloc(size + 1));
+        if (copy)
+        {
+            if (size)
+            {
+                memcpy(copy, data, size);
+            }
+            copy[size] = '\0';
+        }
+
+        return copy;
     }
+};
 
-    hermes::vm::GCScope *gcScope = nullptr;
+// 只读映射的字节码文件，由 BCProvider 持有，RuntimeModule 存活期间不会解除映射
+class MappedBuffer final : public hermes::Buffer
+{
+  public:
+    MappedBuffer(const uint8_t *data, size_t size) : hermes::Buffer(data, size)
+    {
+    }
 
-  private:
-    bool escapeCalled;
+    ~MappedBuffer() override
+    {
+        munmap(const_cast<uint8_t *>(data()), size());
+    }
 };
 
-EXTERN_C_END
+// isRejectionSilent 为 true 时，字节码被拒绝不抛出异常，返回 NAPIExceptionGenericFailure
+NAPIExceptionStatus runBytecodeBuffer(NAPIEnv env, std::unique_ptr<hermes::Buffer> buffer,
+                                      hermes::vm::RuntimeModuleFlags runtimeModuleFlags, bool isRejectionSilent,
+                                      NAPIValue *result)
+{
+    // 会检查文件头、字节码版本和长度
+    auto providerResult = hermes::hbc::BCProviderFromBuffer::createBCProviderFromBuffer(std::move(buffer));
+    if (!providerResult.first)
+    {
+        RETURN_STATUS_IF_FALSE(!isRejectionSilent, NAPIExceptionGenericFailure)
+        (void)env->getRuntime()->raiseTypeError(hermes::vm::TwineChar16(providerResult.second.c_str()));
+
+        return NAPIExceptionPendingException;
+    }
+
+    auto callResult = env->getRuntime()->runBytecode(std::move(providerResult.first), runtimeModuleFlags, "",
+                                                     hermes::vm::Runtime::makeNullHandle<hermes::vm::Environment>());
+    CHECK_HERMES(callResult)
+    if (result)
+    {
+        *result = (NAPIValue)env->getRuntime()->makeHandle(callResult.getValue()).unsafeGetPinnedHermesValue();
+    }
+
+    return NAPIExceptionOK;
+}
+} // namespace
+
+NAPI_EXPORT NAPIExceptionStatus NAPICompileToByteBuffer(NAPIEnv env, const char *script, const char *sourceUrl,
+                                                        const uint8_t **byteBuffer, size_t *bufferSize)
+{
+    return NAPICompileWithOptions(env, script, sourceUrl, nullptr, byteBuffer, bufferSize);
+}
 
-NAPIErrorStatus napi_open_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandleScope *result)
+NAPI_EXPORT NAPIExceptionStatus NAPICompileWithOptions(NAPIEnv env, const char *script, const char *sourceUrl,
+                                                       const NAPIScriptOptions *options, const uint8_t **byteBuffer,
+                                                       size_t *bufferSize)
 {
-    CHECK_ARG(env, Error)
-    CHECK_ARG(result, Error)
+    NAPI_PREAMBLE(env)
+    RETURN_STATUS_IF_FALSE(!options || !options->module, NAPIExceptionInvalidArg)
+    CHECK_ARG(byteBuffer, Exception)
+    CHECK_ARG(bufferSize, Exception)
 
-    RETURN_STATUS_IF_FALSE(env->getRuntime()->getTopGCScope(), NAPIErrorHandleScopeMismatch)
+    if (!script)
+    {
+        script = "";
+    }
+    if (!sourceUrl)
+    {
+        sourceUrl = "";
+    }
+    size_t scriptLength = strlen(script);
+    auto sourceBuffer = std::make_unique<CopiedBuffer>(reinterpret_cast<const uint8_t *>(script), scriptLength);
+    RETURN_STATUS_IF_FALSE(sourceBuffer->isValid(), NAPIExceptionMemoryError)
+    auto sourceHash = llvh::SHA1::hash(llvh::makeArrayRef(sourceBuffer->data(), scriptLength));
 
-    auto gcScope = new (std::nothrow) hermes::vm::GCScope(env->getRuntime());
-    RETURN_STATUS_IF_FALSE(gcScope, NAPIErrorMemoryError)
-    *result = new (std::nothrow) OpaqueNAPIEscapableHandleScope();
-    if (!*result)
+    // 序列化要求所有函数都已生成字节码，因此不能使用 lazy 编译
+    hermes::hbc::CompileFlags compileFlags = getCompileFlags(options);
+    compileFlags.lazy = false;
+    auto providerResult =
+        hermes::hbc::BCProviderFromSrc::createBCProviderFromSrc(std::move(sourceBuffer), sourceUrl, compileFlags);
+    if (!providerResult.first)
     {
-        delete gcScope;
+        (void)env->getRuntime()->raiseSyntaxError(hermes::vm::TwineChar16(providerResult.second.c_str()));
 
-        return NAPIErrorMemoryError;
+        return NAPIExceptionPendingException;
     }
-    (*result)->gcScope = gcScope;
 
-    return NAPIErrorOK;
+    llvh::SmallVector<char, 0> bytecode;
+    llvh::raw_svector_ostream outputStream(bytecode);
+    auto generationOptions = hermes::BytecodeGenerationOptions::defaults();
+    // CompileFlags.debug 为 false 时仍然保留抛出异常所需的位置信息，序列化时再去除整个调试信息段
+    generationOptions.stripDebugInfoSection = options && options->stripDebugInfo;
+    hermes::hbc::BytecodeSerializer serializer(outputStream, generationOptions);
+    serializer.serialize(*providerResult.first->getBytecodeModule(), sourceHash);
+
+    auto buffer = static_cast<uint8_t *>(malloc(bytecode.size()));
+    RETURN_STATUS_IF_FALSE(buffer, NAPIExceptionMemoryError)
+    memcpy(buffer, bytecode.data(), bytecode.size());
+    *byteBuffer = buffer;
+    *bufferSize = bytecode.size();
+
+    return NAPIExceptionOK;
 }
 
-NAPICommonStatus napi_close_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandleScope scope)
+NAPI_EXPORT NAPICommonStatus NAPIFreeByteBuffer(NAPIEnv env, const uint8_t *byteBuffer)
 {
     CHECK_ARG(env, Common)
-    CHECK_ARG(scope, Common)
 
-    delete scope->gcScope;
-    delete scope;
+    free((void *)byteBuffer);
 
     return NAPICommonOK;
 }
 
-NAPIErrorStatus napi_escape_handle(NAPIEnv env, NAPIEscapableHandleScope scope, NAPIValue escapee, NAPIValue *result)
+NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBuffer(NAPIEnv env, const uint8_t *byteBuffer, size_t bufferSize,
+                                                  NAPIValue *result)
 {
-    CHECK_ARG(env, Error)
-    CHECK_ARG(scope, Error)
-    CHECK_ARG(escapee, Error)
-    CHECK_ARG(result, Error)
-
-    RETURN_STATUS_IF_FALSE(!scope->isEscapeCalled(), NAPIErrorEscapeCalledTwice)
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(byteBuffer, Exception)
 
-    *result = (NAPIValue)hermes::vm::Handle<hermes::vm::HermesValue>(scope->gcScope->getParentScope(),
-                                                                     *(const hermes::vm::PinnedHermesValue *)escapee)
-                  .unsafeGetPinnedHermesValue();
-    scope->setEscapeCalled(true);
+    // 运行时会按需读取字符串表等数据，调用方的 buffer 可能在返回后释放，因此拷贝一份交给 BCProvider
+    auto buffer = std::make_unique<CopiedBuffer>(byteBuffer, bufferSize);
+    RETURN_STATUS_IF_FALSE(buffer->isValid(), NAPIExceptionMemoryError)
 
-    return NAPIErrorOK;
+    return runBytecodeBuffer(env, std::move(buffer), hermes::vm::RuntimeModuleFlags{}, false, result);
 }
 
-NAPIExceptionStatus napi_throw(NAPIEnv env, NAPIValue error)
+NAPIExceptionStatus NAPIRunCachedByteBuffer(NAPIEnv env, const uint8_t *byteBuffer, size_t bufferSize,
+                                            NAPIValue *result)
 {
     NAPI_PREAMBLE(env)
-    CHECK_ARG(error, Exception)
+    CHECK_ARG(byteBuffer, Exception)
 
-    // 直接忽略返回值
-    env->getRuntime()->setThrownValue(*(const hermes::vm::PinnedHermesValue *)error);
+    auto buffer = std::make_unique<CopiedBuffer>(byteBuffer, bufferSize);
+    RETURN_STATUS_IF_FALSE(buffer->isValid(), NAPIExceptionMemoryError)
 
-    return NAPIExceptionOK;
+    return runBytecodeBuffer(env, std::move(buffer), hermes::vm::RuntimeModuleFlags{}, true, result);
 }
 
-NAPIErrorStatus napi_get_and_clear_last_exception(NAPIEnv env, NAPIValue *result)
+NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBufferFile(NAPIEnv env, const char *path, NAPIValue *result)
 {
-    CHECK_ARG(env, Error)
-    CHECK_ARG(result, Error)
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(path, Exception)
 
-    if (env->getRuntime()->getThrownValue().isEmpty())
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    RETURN_STATUS_IF_FALSE(fd >= 0, NAPIExceptionGenericFailure)
+    struct stat fileStat = {};
+    if (fstat(fd, &fileStat) || fileStat.st_size <= 0)
     {
-        *result = (NAPIValue)hermes::vm::Runtime::getUndefinedValue().unsafeGetPinnedHermesValue();
+        close(fd);
+
+        return NAPIExceptionGenericFailure;
     }
-    else
+    // Hermes 直接从映射内存执行字节码，页面按需加载并在进程间共享
+    void *address = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    RETURN_STATUS_IF_FALSE(address != MAP_FAILED, NAPIExceptionGenericFailure)
+    auto buffer = std::unique_ptr<hermes::Buffer>(
+        new (std::nothrow) MappedBuffer(static_cast<const uint8_t *>(address), (size_t)fileStat.st_size));
+    if (!buffer)
     {
-        *result =
-            (NAPIValue)env->getRuntime()->makeHandle(env->getRuntime()->getThrownValue()).unsafeGetPinnedHermesValue();
-        env->getRuntime()->clearThrownValue();
-    }
+        munmap(address, (size_t)fileStat.st_size);
 
-    return NAPIErrorOK;
+        return NAPIExceptionMemoryError;
+    }
+    // 映射由 BCProvider 持有，跟随 RuntimeModule 回收
+    // 不能使用 persistent，否则 RuntimeModule 和映射都不会被释放
+    return runBytecodeBuffer(env, std::move(buffer), hermes::vm::RuntimeModuleFlags{}, false, result);
 }
 
-NAPICommonStatus NAPIClearLastException(NAPIEnv env)
+// 每次执行都基于同一个 BCProvider 创建新的 RuntimeModule，RuntimeModule 随 Domain 被 GC 回收
+struct OpaqueNAPIScript final
 {
-    CHECK_ARG(env, Common)
+    std::shared_ptr<hermes::hbc::BCProvider> provider;
 
-    env->getRuntime()->clearThrownValue();
-
-    return NAPICommonOK;
-}
+    std::string sourceUrl;
+};
 
-NAPIExceptionStatus NAPIRunScript(NAPIEnv env, const char *script, const char *sourceUrl, NAPIValue *result)
+NAPIExceptionStatus NAPICompileScript(NAPIEnv env, const char *script, const char *sourceUrl, NAPIScript *result)
 {
     NAPI_PREAMBLE(env)
+    CHECK_ARG(result, Exception)
 
-    hermes::hbc::CompileFlags compileFlags = {};
-    compileFlags.lazy = true;
-    compileFlags.debug = true;
-    auto callResult = env->getRuntime()->run(script, sourceUrl, compileFlags);
-    CHECK_HERMES(callResult)
-    if (result)
+    if (!script)
     {
-        *result = (NAPIValue)env->getRuntime()->makeHandle(callResult.getValue()).unsafeGetPinnedHermesValue();
+        script = "";
+    }
+    if (!sourceUrl)
+    {
+        sourceUrl = "";
+    }
+    auto sourceBuffer = std::make_unique<CopiedBuffer>(reinterpret_cast<const uint8_t *>(script), strlen(script));
+    RETURN_STATUS_IF_FALSE(sourceBuffer->isValid(), NAPIExceptionMemoryError)
+    // lazy 编译会修改 BCProvider，不能在多个 RuntimeModule 之间共享，因此立即编译
+    hermes::hbc::CompileFlags compileFlags = getCompileFlags(nullptr);
+    compileFlags.lazy = false;
+    auto providerResult =
+        hermes::hbc::BCProviderFromSrc::createBCProviderFromSrc(std::move(sourceBuffer), sourceUrl, compileFlags);
+    if (!providerResult.first)
+    {
+        (void)env->getRuntime()->raiseSyntaxError(hermes::vm::TwineChar16(providerResult.second.c_str()));
+
+        return NAPIExceptionPendingException;
     }
+    *result = new (std::nothrow) OpaqueNAPIScript();
+    RETURN_STATUS_IF_FALSE(*result, NAPIExceptionMemoryError)
+    (*result)->provider = std::move(providerResult.first);
+    (*result)->sourceUrl = sourceUrl;
 
     return NAPIExceptionOK;
 }
 
-NAPIExceptionStatus NAPIDefineClass(NAPIEnv env, const char *utf8name, NAPICallback constructor, void *data,
-                                    NAPIValue *result)
+NAPIExceptionStatus NAPIRunCompiledScript(NAPIEnv env, NAPIScript script, NAPIValue *result)
 {
     NAPI_PREAMBLE(env)
-    CHECK_ARG(constructor, Exception)
-    CHECK_ARG(result, Exception)
-
-    hermes::vm::GCScope gcScope(env->getRuntime());
+    CHECK_ARG(script, Exception)
 
-    auto functionInfo = new (std::nothrow) FunctionInfo(env, constructor, data);
-    RETURN_STATUS_IF_FALSE(functionInfo, NAPIExceptionMemoryError)
-    NAPIValue externalValue;
-    auto finalizeCallback = [](void *finalizeData, void * /*finalizeHint*/) { delete (FunctionInfo *)finalizeData; };
-    auto createExternalStatus = napi_create_external(env, functionInfo, finalizeCallback, nullptr, &externalValue);
-    if (createExternalStatus != NAPIExceptionOK)
+    auto callResult = env->getRuntime()->runBytecode(
+        std::shared_ptr<hermes::hbc::BCProvider>(script->provider), hermes::vm::RuntimeModuleFlags{},
+        script->sourceUrl, hermes::vm::Runtime::makeNullHandle<hermes::vm::Environment>());
+    CHECK_HERMES(callResult)
+    if (result)
     {
-        delete functionInfo;
-
-        return createExternalStatus;
+        *result = (NAPIValue)env->getRuntime()->makeHandle(callResult.getValue()).unsafeGetPinnedHermesValue();
     }
 
-    hermes::vm::NativeFunctionPtr nativeFunctionPtr =
-        [](void *context, hermes::vm::Runtime *runtime,
-           hermes::vm::NativeArgs args) -> hermes::vm::CallResult<hermes::vm::HermesValue> {
-        hermes::vm::GCScope inlineGCScope(runtime);
-        auto innerFunctionInfo = (FunctionInfo *)context;
-        if (!innerFunctionInfo->getCallback() || !innerFunctionInfo->getEnv())
-        {
-            assert(false);
-
-            return args.getThisArg();
-        }
-        struct OpaqueNAPICallbackInfo callbackInfo(args, innerFunctionInfo->getData());
-        NAPIValue returnValue = innerFunctionInfo->getCallback()(innerFunctionInfo->getEnv(), &callbackInfo);
-        RETURN_STATUS_IF_FALSE(innerFunctionInfo->getEnv()->getRuntime()->getThrownValue().isEmpty(),
-                               hermes::vm::ExecutionStatus::EXCEPTION)
-        if (!returnValue || !((const hermes::vm::PinnedHermesValue *)returnValue)->isObject())
-        {
-            return args.getThisArg();
-        }
+    return NAPIExceptionOK;
+}
 
-        return {*(const hermes::vm::PinnedHermesValue *)returnValue};
-    };
-    auto nativeConstructor = hermes::vm::NativeConstructor::create(
-        env->getRuntime(), hermes::vm::Handle<hermes::vm::JSObject>::vmcast(&env->getRuntime()->functionPrototype),
-        functionInfo, nativeFunctionPtr, 0, hermes::vm::NativeConstructor::creatorFunction<hermes::vm::JSObject>,
-        hermes::vm::CellKind::ObjectKind);
+NAPICommonStatus NAPIFreeScript(NAPIEnv env, NAPIScript script)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(script, Common)
 
-    NAPIValue stringValue;
-    CHECK_NAPI(napi_create_string_utf8(env, utf8name, &stringValue), Exception, Exception)
-    auto stringPrimitive = hermes::vm::dyn_vmcast_or_null<hermes::vm::StringPrimitive>(
-        *(const hermes::vm::PinnedHermesValue *)stringValue);
-    RETURN_STATUS_IF_FALSE(stringPrimitive, NAPIExceptionMemoryError)
-    auto callResult = hermes::vm::stringToSymbolID(env->getRuntime(), hermes::vm::createPseudoHandle(stringPrimitive));
-    CHECK_HERMES(callResult)
-    auto symbolId = callResult.getValue().get();
-    auto rawObject = hermes::vm::JSObject::create(env->getRuntime());
-    auto defineCallResult = hermes::vm::Callable::defineNameLengthAndPrototype(
-        env->getRuntime()->makeHandle(nativeConstructor.get()), env->getRuntime(), symbolId, 0,
-        env->getRuntime()->makeHandle(rawObject.get()), hermes::vm::Callable::WritablePrototype::No, false);
-    CHECK_HERMES(defineCallResult)
-    *result = (NAPIValue)hermes::vm::Handle<hermes::vm::HermesValue>(gcScope.getParentScope(),
-                                                                     nativeConstructor.getHermesValue())
-                  .unsafeGetPinnedHermesValue();
-    NAPIValue privateKeyString;
-    CHECK_NAPI(napi_create_string_utf8(env, "__constructor__", &privateKeyString), Exception, Exception)
-    CHECK_NAPI(napi_set_property(env, *result, privateKeyString, externalValue), Exception, Exception)
+    delete script;
 
-    return NAPIExceptionOK;
+    return NAPICommonOK;
 }
 
-NAPIErrorStatus NAPICreateRuntime(NAPIRuntime *runtime)
+// Hermes 按调用深度和寄存器栈限制递归，不依赖创建 runtime 的线程
+void NAPIAttachEnvToCurrentThread(NAPIEnv /*env*/)
 {
-    return NAPIErrorOK;
 }
 
-NAPICommonStatus NAPIFreeRuntime(NAPIRuntime runtime)
+NAPIErrorStatus NAPISetCodeCacheDirectory(NAPIEnv env, const char *directory)
 {
-    return NAPICommonOK;
+    CHECK_ARG(env, Error)
+
+    NAPICodeCache *codeCache = nullptr;
+    if (directory)
+    {
+        std::string versionTag = "Hermes bytecode " + std::to_string(hermes::hbc::BYTECODE_VERSION);
+        codeCache = NAPICodeCacheCreate(directory, versionTag.c_str());
+        RETURN_STATUS_IF_FALSE(codeCache, NAPIErrorMemoryError)
+    }
+    NAPICodeCacheFree(env->codeCache);
+    env->codeCache = codeCache;
+
+    return NAPIErrorOK;
 }
 
-NAPIErrorStatus NAPICreateEnv(NAPIEnv *env, NAPIRuntime runtime)
+NAPIErrorStatus NAPIGetCodeCacheStatistics(NAPIEnv env, NAPICodeCacheStatistics *result)
 {
     CHECK_ARG(env, Error)
+    CHECK_ARG(result, Error)
 
-    auto gcConfigBuilder = hermes::vm::GCConfig::Builder()
-                               .withName("N-API")
-                               //                                   .withAllocInYoung(false)
-                               //                                   .withRevertToYGAtTTI(true)
-                               .withMaxHeapSize(1024 << 20);
-    auto runtimeConfig = hermes::vm::RuntimeConfig::Builder()
-                             .withGCConfig(gcConfigBuilder.build())
-                             //                                 .withRegisterStack(nullptr)
-                             .withMaxNumRegisters(kMaxNumRegisters)
-                             .build();
-    *env = new (std::nothrow) OpaqueNAPIEnv(runtimeConfig);
-    RETURN_STATUS_IF_FALSE(*env, NAPIErrorMemoryError)
+    if (env->codeCache)
+    {
+        NAPICodeCacheGetStatistics(env->codeCache, result);
+    }
+    else
+    {
+        *result = {};
+    }
 
     return NAPIErrorOK;
 }
 
-NAPICommonStatus NAPIEnableDebugger(NAPIEnv env, const char *debuggerTitle, bool waitForDebugger)
+namespace
 {
-    CHECK_ARG(env, Common)
-
-    env->enableDebugger(debuggerTitle, waitForDebugger);
+// external 内存统一记在全局对象上，credit 和 debit 必须对应同一个 GCCell，单次不能超过 uint32_t
+void creditExternalMemory(NAPIEnv env, int64_t size)
+{
+    auto &heap = env->getRuntime()->getHeap();
+    auto globalObject = env->getRuntime()->getGlobal().get();
+    while (size > 0)
+    {
+        auto chunkSize = (uint32_t)std::min<int64_t>(size, std::numeric_limits<uint32_t>::max());
+        heap.creditExternalMemory(globalObject, chunkSize);
+        size -= chunkSize;
+    }
+    while (size < 0)
+    {
+        auto chunkSize = (uint32_t)std::min<int64_t>(-size, std::numeric_limits<uint32_t>::max());
+        heap.debitExternalMemory(globalObject, chunkSize);
+        size += chunkSize;
+    }
+}
 
-    return NAPICommonOK;
+// napi_adjust_external_memory 在 GC 过程中（finalizer）登记的差值，在之后不在 GC 中的入口补上
+void creditPendingExternalMemory(NAPIEnv env)
+{
+    if (env->externalMemorySize != env->creditedExternalMemorySize && !env->getRuntime()->getHeap().inGC())
+    {
+        creditExternalMemory(env, env->externalMemorySize - env->creditedExternalMemorySize);
+        env->creditedExternalMemorySize = env->externalMemorySize;
+    }
 }
+} // namespace
 
-NAPICommonStatus NAPIDisableDebugger(NAPIEnv env)
+NAPIErrorStatus NAPIGetHeapStatistics(NAPIEnv env, NAPIHeapStatistics *result)
 {
-    CHECK_ARG(env, Common)
+    CHECK_ARG(env, Error)
+    CHECK_ARG(result, Error)
 
-    env->disableDebugger();
+    creditPendingExternalMemory(env);
+    *result = {};
+    // getHeapInfoWithMallocSize 需要遍历所有对象，这里只读取 GC 已有的计数
+    hermes::vm::GCBase::HeapInfo heapInfo;
+    env->getRuntime()->getHeap().getHeapInfo(heapInfo);
+    result->usedHeapSize = heapInfo.allocatedBytes;
+    result->totalHeapSize = heapInfo.heapSize;
+    result->externalMemorySize = heapInfo.externalBytes;
+    result->gcCount = heapInfo.numCollections;
+    // gcWallTime 单位为秒
+    result->gcTotalNanoseconds =
+        (uint64_t)((heapInfo.youngGenStats.gcWallTime.sum() + heapInfo.fullStats.gcWallTime.sum()) * 1e9);
+    result->gcMaxPauseNanoseconds =
+        (uint64_t)(std::max(heapInfo.youngGenStats.gcWallTime.max(), heapInfo.fullStats.gcWallTime.max()) * 1e9);
 
-    return NAPICommonOK;
+    // GCScope 在 Release 构建下不记录 handle 数量，handleCount 为 0
+    result->handleScopeCount = env->handleScopeCount;
+    NAPIRef ref;
+    LIST_FOREACH(ref, &env->strongRefList, node)
+    {
+        ++result->strongReferenceCount;
+    }
+    LIST_FOREACH(ref, &env->weakRefList, node)
+    {
+        ++result->weakReferenceCount;
+    }
+    LIST_FOREACH(ref, &env->valueList, node)
+    {
+        ++result->valueReferenceCount;
+    }
+    result->externalCount = env->externalCount;
+
+    return NAPIErrorOK;
 }
 
-NAPICommonStatus NAPISetMessageQueueThread(NAPIEnv env, MessageQueueThreadWrapper jsQueueWrapper)
+namespace
 {
-#ifdef HERMES_ENABLE_DEBUGGER
-    CHECK_ARG(env, Common);
-    env->setMessageQueueThread(jsQueueWrapper->thread_);
-#endif
-    return NAPICommonOK;
+// Runtime::collect 总是执行完整 GC，新生代回收没有对外接口
+void collect(NAPIEnv env, const char *cause, hermes::vm::GCBase::HeapInfo &heapInfo)
+{
+    creditPendingExternalMemory(env);
+    env->getRuntime()->collect(cause);
+    // finalizer 中释放的 external 内存
+    creditPendingExternalMemory(env);
+    env->getRuntime()->getHeap().getHeapInfo(heapInfo);
+    env->lastGCAllocatedBytes = heapInfo.allocatedBytes;
 }
+} // namespace
 
-NAPICommonStatus NAPIFreeEnv(NAPIEnv env)
+NAPIErrorStatus NAPIRunGC(NAPIEnv env, NAPIGCMode mode)
 {
-    CHECK_ARG(env, Common)
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(mode == NAPIFullGC || mode == NAPIYoungGC, NAPIErrorInvalidArg)
 
-    delete env;
+    hermes::vm::GCBase::HeapInfo heapInfo;
+    collect(env, "NAPIRunGC", heapInfo);
 
-    return NAPICommonOK;
+    return NAPIErrorOK;
 }
 
-NAPIErrorStatus NAPIGetValueStringUTF8(NAPIEnv env, NAPIValue value, const char **result)
+NAPIErrorStatus NAPIIdleNotification(NAPIEnv env, uint64_t idleMicroseconds, bool *hasMoreWork)
 {
     CHECK_ARG(env, Error)
-    CHECK_ARG(value, Error)
-    CHECK_ARG(result, Error)
 
-    RETURN_STATUS_IF_FALSE(
-        hermes::vm::vmisa<hermes::vm::StringPrimitive>(*(const hermes::vm::PinnedHermesValue *)value),
-        NAPIErrorStringExpected)
+    hermes::vm::GCBase::HeapInfo heapInfo;
+    env->getRuntime()->getHeap().getHeapInfo(heapInfo);
+    // 上一次 GC 之后 allocatedBytes 没有增长时不会产生新的垃圾，跳过
+    if (heapInfo.allocatedBytes <= env->lastGCAllocatedBytes)
+    {
+        if (hasMoreWork)
+        {
+            *hasMoreWork = false;
+        }
 
-    auto stringPrimitive =
-        hermes::vm::dyn_vmcast_or_null<hermes::vm::StringPrimitive>(*(const hermes::vm::PinnedHermesValue *)value);
-    if (stringPrimitive->isASCII())
+        return NAPIErrorOK;
+    }
+    // 用完整 GC 的平均耗时估计，还没有执行过完整 GC 时直接执行
+    double estimatedMicroseconds =
+        heapInfo.fullStats.numCollections
+            ? heapInfo.fullStats.gcWallTime.sum() / heapInfo.fullStats.numCollections * 1e6
+            : 0;
+    bool canRun = estimatedMicroseconds <= (double)idleMicroseconds;
+    if (canRun)
     {
-        auto asciiStringRef = stringPrimitive->getStringRef<char>();
-        char *buffer = static_cast<char *>(malloc(sizeof(char) * (asciiStringRef.size() + 1)));
-        RETURN_STATUS_IF_FALSE(buffer, NAPIErrorMemoryError)
-        std::memmove(buffer, asciiStringRef.data(), asciiStringRef.size());
-        buffer[asciiStringRef.size()] = '\0';
-        *result = buffer;
+        collect(env, "NAPIIdleNotification", heapInfo);
     }
-    else
+    if (hasMoreWork)
     {
-        auto utf16StringRef = stringPrimitive->getStringRef<char16_t>();
-        auto length = utf16StringRef.size() * 3 + 1;
-        char *buffer = static_cast<char *>(malloc(sizeof(char) * length));
-        RETURN_STATUS_IF_FALSE(buffer, NAPIErrorMemoryError) auto sourceStart = utf16StringRef.begin();
-        char *targetStart = buffer;
-        auto conversionResult = llvh::ConvertUTF16toUTF8(
-            reinterpret_cast<const llvh::UTF16 **>(&sourceStart),
-            reinterpret_cast<const llvh::UTF16 *>(utf16StringRef.end()), reinterpret_cast<llvh::UTF8 **>(&targetStart),
-            reinterpret_cast<llvh::UTF8 *>(buffer + length - 1), llvh::strictConversion);
-        if (conversionResult == llvh::ConversionResult::targetExhausted)
-        {
-            assert(false);
-            free(buffer);
+        *hasMoreWork = !canRun;
+    }
 
-            return NAPIErrorMemoryError;
-        }
-        else if (conversionResult != llvh::ConversionResult::conversionOK)
-        {
-            free(buffer);
+    return NAPIErrorOK;
+}
 
-            return NAPIErrorMemoryError;
+NAPIErrorStatus NAPINotifyMemoryPressure(NAPIEnv env, NAPIMemoryPressureLevel level, size_t *reclaimedBytes)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(level == NAPIModerateMemoryPressure || level == NAPICriticalMemoryPressure,
+                           NAPIErrorInvalidArg)
+
+    size_t totalReclaimedBytes = env->trimHandleScopes();
+    if (level == NAPICriticalMemoryPressure)
+    {
+        // 完整 GC 之后空闲的 segment 由 GC 自身归还给系统
+        hermes::vm::GCBase::HeapInfo heapInfo;
+        env->getRuntime()->getHeap().getHeapInfo(heapInfo);
+        uint64_t allocatedBytes = heapInfo.allocatedBytes;
+        collect(env, "NAPINotifyMemoryPressure", heapInfo);
+        if (allocatedBytes > heapInfo.allocatedBytes)
+        {
+            totalReclaimedBytes += (size_t)(allocatedBytes - heapInfo.allocatedBytes);
         }
-        *targetStart = '\0';
-        *result = buffer;
+    }
+    if (reclaimedBytes)
+    {
+        *reclaimedBytes = totalReclaimedBytes;
     }
 
     return NAPIErrorOK;
 }
 
-NAPICommonStatus NAPIFreeUTF8String(NAPIEnv env, const char *cString)
+NAPIErrorStatus napi_adjust_external_memory(NAPIEnv env, int64_t changeInBytes, int64_t *adjustedValue)
 {
-    CHECK_ARG(env, Common)
-    CHECK_ARG(cString, Common)
-
-    free((void *)cString);
+    CHECK_ARG(env, Error)
+    CHECK_ARG(adjustedValue, Error)
 
-    return NAPICommonOK;
-}
+    // 释放的字节数超过登记的总数时按总数撤销
+    if (changeInBytes < -env->externalMemorySize)
+    {
+        changeInBytes = -env->externalMemorySize;
+    }
+    env->externalMemorySize += changeInBytes;
+    creditPendingExternalMemory(env);
+    *adjustedValue = env->externalMemorySize;
 
-NAPI_EXPORT NAPIExceptionStatus NAPICompileToByteBuffer(NAPIEnv, const char *, const char *, const uint8_t **, size_t *)
-{
-    return NAPIExceptionOK;
+    return NAPIErrorOK;
 }
 
-NAPI_EXPORT NAPICommonStatus NAPIFreeByteBuffer(NAPIEnv, const uint8_t *)
+NAPIErrorStatus NAPIWriteHeapSnapshot(NAPIEnv env, const char *path)
 {
-    return NAPICommonOK;
-}
+    CHECK_ARG(env, Error)
+    CHECK_ARG(path, Error)
+
+#ifdef HERMES_MEMORY_INSTRUMENTATION
+    // 快照过程中会执行一次完整 GC，不能在 finalizer 中调用
+    RETURN_STATUS_IF_FALSE(!env->getRuntime()->getHeap().inGC(), NAPIErrorGenericFailure)
+    std::error_code errorCode;
+    llvh::raw_fd_ostream outputStream(path, errorCode, llvh::sys::fs::F_None);
+    RETURN_STATUS_IF_FALSE(!errorCode, NAPIErrorGenericFailure)
+    // 强引用和 NAPIPropertyKey 位于 (Custom) 分组，handleScope 中的值位于 GCScope 对应的分组
+    env->getRuntime()->getHeap().createSnapshot(outputStream);
+    outputStream.close();
+    RETURN_STATUS_IF_FALSE(!outputStream.has_error(), NAPIErrorGenericFailure)
 
-NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBuffer(NAPIEnv, const uint8_t *byteBuffer, size_t, NAPIValue *)
-{
-    return NAPIExceptionOK;
+    return NAPIErrorOK;
+#else
+    return NAPIErrorGenericFailure;
+#endif
 }
@@ -30,10 +30,16 @@
 
 #include <JavaScriptCore/JavaScriptCore.h>
 #include <assert.h>
+#include <math.h>
 #include <napi/js_native_api_debugger.h>
 #include <napi/js_native_api_types.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "js_native_api_code_cache.h"
+#include "js_native_api_env_pool.h"
+#include "js_native_api_unicode.h"
 
 struct OpaqueNAPIRef
 {
@@ -52,6 +58,12 @@ struct ReferenceInfo
 
 // undefined 和 null 实际上也可以当做 exception
 // 抛出，所以异常检查只需要检查是否为 C NULL
+struct OpaqueNAPIEscapableHandleScope
+{
+    SLIST_ENTRY(OpaqueNAPIEscapableHandleScope) node; // size_t
+    bool escapeCalled;
+};
+
 struct OpaqueNAPIEnv
 {
     JSGlobalContextRef context; // size_t
@@ -60,6 +72,10 @@ struct OpaqueNAPIEnv
     LIST_HEAD(, ReferenceInfo) referenceList;
     LIST_HEAD(, OpaqueNAPIRef) strongRefList;
     LIST_HEAD(, OpaqueNAPIRef) valueList;
+    // 已关闭的 EscapableHandleScope，复用
+    SLIST_HEAD(, OpaqueNAPIEscapableHandleScope) freeEscapableHandleScopeList;
+    // napi_adjust_external_memory 登记的总字节数
+    int64_t externalMemorySize;
 };
 
 // NAPIMemoryError
@@ -125,21 +141,103 @@ NAPIErrorStatus napi_create_double(NAPIEnv env, double value, NAPIValue *result)
 // V8 引擎传入 NULL 直接崩溃
 // NAPIMemoryError
 NAPIExceptionStatus napi_create_string_utf8(NAPIEnv env, const char *str, NAPIValue *result)
+{
+    return napi_create_string_utf8_len(env, str, NAPI_AUTO_LENGTH, result);
+}
+
+// stringRef 所有权转移
+static NAPIExceptionStatus createStringValue(NAPIEnv env, JSStringRef stringRef, NAPIValue *result)
+{
+    RETURN_STATUS_IF_FALSE(stringRef, NAPIExceptionMemoryError)
+    *result = (NAPIValue)JSValueMakeString(env->context, stringRef);
+    JSStringRelease(stringRef);
+    RETURN_STATUS_IF_FALSE(*result, NAPIExceptionMemoryError)
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_create_string_utf8_len(NAPIEnv env, const char *str, size_t length, NAPIValue *result)
 {
     CHECK_ARG(env, Exception)
     CHECK_ARG(result, Exception)
 
-    // 传入 NULL，触发 OpaqueJSString()
-    JSStringRef stringRef = JSStringCreateWithUTF8CString(str);
-    // stringRef == NULL，会调用 String()
-    *result = (NAPIValue)JSValueMakeString(env->context, stringRef);
-    if (stringRef)
+    if (!str)
     {
-        JSStringRelease(stringRef);
+        RETURN_STATUS_IF_FALSE(!length || length == NAPI_AUTO_LENGTH, NAPIExceptionInvalidArg)
+        str = "";
+        length = 0;
     }
-    RETURN_STATUS_IF_FALSE(*result, NAPIExceptionMemoryError)
+    else if (length == NAPI_AUTO_LENGTH)
+    {
+        length = strlen(str);
+        // JSStringCreateWithUTF8CString 遇到非法 UTF-8 会返回空字符串，因此只用于纯 ASCII
+        if (NAPIUnicodeIsASCII(str, length))
+        {
+            return createStringValue(env, JSStringCreateWithUTF8CString(str), result);
+        }
+    }
+    if (!length)
+    {
+        return createStringValue(env, JSStringCreateWithCharacters(NULL, 0), result);
+    }
+    size_t utf16Length = NAPIUnicodeUTF16LengthOfUTF8(str, length);
+    JSChar *buffer = malloc(sizeof(JSChar) * utf16Length);
+    RETURN_STATUS_IF_FALSE(buffer, NAPIExceptionMemoryError)
+    NAPIUnicodeConvertUTF8ToUTF16(str, length, buffer);
+    JSStringRef stringRef = JSStringCreateWithCharacters(buffer, utf16Length);
+    free(buffer);
 
-    return NAPIExceptionOK;
+    return createStringValue(env, stringRef, result);
+}
+
+NAPIExceptionStatus napi_create_string_latin1(NAPIEnv env, const char *str, size_t length, NAPIValue *result)
+{
+    CHECK_ARG(env, Exception)
+    CHECK_ARG(result, Exception)
+
+    if (!str)
+    {
+        RETURN_STATUS_IF_FALSE(!length || length == NAPI_AUTO_LENGTH, NAPIExceptionInvalidArg)
+        length = 0;
+    }
+    else if (length == NAPI_AUTO_LENGTH)
+    {
+        length = strlen(str);
+    }
+    if (!length)
+    {
+        return createStringValue(env, JSStringCreateWithCharacters(NULL, 0), result);
+    }
+    JSChar *buffer = malloc(sizeof(JSChar) * length);
+    RETURN_STATUS_IF_FALSE(buffer, NAPIExceptionMemoryError)
+    NAPIUnicodeConvertLatin1ToUTF16(str, length, buffer);
+    JSStringRef stringRef = JSStringCreateWithCharacters(buffer, length);
+    free(buffer);
+
+    return createStringValue(env, stringRef, result);
+}
+
+NAPIExceptionStatus napi_create_string_utf16(NAPIEnv env, const char16_t *str, size_t length, NAPIValue *result)
+{
+    CHECK_ARG(env, Exception)
+    CHECK_ARG(result, Exception)
+
+    if (!str)
+    {
+        RETURN_STATUS_IF_FALSE(!length || length == NAPI_AUTO_LENGTH, NAPIExceptionInvalidArg)
+        length = 0;
+    }
+    else if (length == NAPI_AUTO_LENGTH)
+    {
+        length = 0;
+        while (str[length])
+        {
+            ++length;
+        }
+    }
+
+    // JSChar 即 UTF-16 code unit，可以直接拷贝
+    return createStringValue(env, JSStringCreateWithCharacters(str, length), result);
 }
 
 // 1. external -> 不透明指针 + finalizer + 调用一个回调
@@ -394,6 +492,74 @@ NAPIErrorStatus napi_get_value_bool(NAPIEnv env, NAPIValue value, bool *result)
     return NAPIErrorOK;
 }
 
+// JSStringGetCharactersPtr 直接返回 UTF-16 存储，不需要额外分配缓冲区
+NAPIErrorStatus napi_get_value_string_utf8(NAPIEnv env, NAPIValue value, char *buf, size_t bufsize, size_t *result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(value, Error)
+    RETURN_STATUS_IF_FALSE(buf || result, NAPIErrorInvalidArg)
+
+    RETURN_STATUS_IF_FALSE(JSValueIsString(env->context, (JSValueRef)value), NAPIErrorStringExpected)
+    JSValueRef exception = NULL;
+    JSStringRef stringRef = JSValueToStringCopy(env->context, (JSValueRef)value, &exception);
+    RETURN_STATUS_IF_FALSE(!exception && stringRef, NAPIErrorStringExpected)
+    const JSChar *utf16String = JSStringGetCharactersPtr(stringRef);
+    size_t utf16Length = JSStringGetLength(stringRef);
+    size_t length;
+    if (!buf)
+    {
+        length = NAPIUnicodeUTF8LengthOfUTF16(utf16String, utf16Length);
+    }
+    else if (bufsize)
+    {
+        length = NAPIUnicodeConvertUTF16ToUTF8Partial(utf16String, utf16Length, buf, bufsize - 1);
+        buf[length] = '\0';
+    }
+    else
+    {
+        length = 0;
+    }
+    JSStringRelease(stringRef);
+    if (result)
+    {
+        *result = length;
+    }
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus napi_get_value_string_utf16(NAPIEnv env, NAPIValue value, char16_t *buf, size_t bufsize,
+                                            size_t *result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(value, Error)
+    RETURN_STATUS_IF_FALSE(buf || result, NAPIErrorInvalidArg)
+
+    RETURN_STATUS_IF_FALSE(JSValueIsString(env->context, (JSValueRef)value), NAPIErrorStringExpected)
+    JSValueRef exception = NULL;
+    JSStringRef stringRef = JSValueToStringCopy(env->context, (JSValueRef)value, &exception);
+    RETURN_STATUS_IF_FALSE(!exception && stringRef, NAPIErrorStringExpected)
+    const JSChar *utf16String = JSStringGetCharactersPtr(stringRef);
+    size_t length = JSStringGetLength(stringRef);
+    if (buf && !bufsize)
+    {
+        length = 0;
+    }
+    else if (buf)
+    {
+        length = NAPIUnicodeTruncateUTF16(utf16String, length, bufsize - 1);
+        memcpy(buf, utf16String, sizeof(JSChar) * length);
+        buf[length] = 0;
+    }
+    JSStringRelease(stringRef);
+    if (result)
+    {
+        *result = length;
+    }
+
+    return NAPIErrorOK;
+}
+
 // NAPIMemoryError
 NAPIExceptionStatus napi_coerce_to_bool(NAPIEnv env, NAPIValue value, NAPIValue *result)
 {
@@ -573,6 +739,313 @@ NAPIExceptionStatus napi_delete_property(NAPIEnv env, NAPIValue object, NAPIValu
     return NAPIExceptionOK;
 }
 
+NAPIExceptionStatus napi_set_element(NAPIEnv env, NAPIValue object, uint32_t index, NAPIValue value)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(value, Exception)
+
+    RETURN_STATUS_IF_FALSE(JSValueIsObject(env->context, (JSValueRef)object), NAPIExceptionObjectExpected)
+    JSObjectSetPropertyAtIndex(env->context, (JSObjectRef)object, index, (JSValueRef)value, &env->lastException);
+    CHECK_JSC(env)
+
+    return NAPIExceptionOK;
+}
+
+// JavaScriptCore C API 没有按索引判断/删除的接口，转为字符串 key
+NAPIExceptionStatus napi_has_element(NAPIEnv env, NAPIValue object, uint32_t index, bool *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(result, Exception)
+
+    RETURN_STATUS_IF_FALSE(JSValueIsObject(env->context, (JSValueRef)object), NAPIExceptionObjectExpected)
+    char buffer[11];
+    snprintf(buffer, sizeof(buffer), "%u", index);
+    JSStringRef stringRef = JSStringCreateWithUTF8CString(buffer);
+    RETURN_STATUS_IF_FALSE(stringRef, NAPIExceptionMemoryError)
+    *result = JSObjectHasProperty(env->context, (JSObjectRef)object, stringRef);
+    JSStringRelease(stringRef);
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_get_element(NAPIEnv env, NAPIValue object, uint32_t index, NAPIValue *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(result, Exception)
+
+    RETURN_STATUS_IF_FALSE(JSValueIsObject(env->context, (JSValueRef)object), NAPIExceptionObjectExpected)
+    JSValueRef valueRef = JSObjectGetPropertyAtIndex(env->context, (JSObjectRef)object, index, &env->lastException);
+    CHECK_JSC(env)
+    *result = (NAPIValue)valueRef;
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_delete_element(NAPIEnv env, NAPIValue object, uint32_t index, bool *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(object, Exception)
+
+    RETURN_STATUS_IF_FALSE(JSValueIsObject(env->context, (JSValueRef)object), NAPIExceptionObjectExpected)
+    char buffer[11];
+    snprintf(buffer, sizeof(buffer), "%u", index);
+    JSStringRef stringRef = JSStringCreateWithUTF8CString(buffer);
+    RETURN_STATUS_IF_FALSE(stringRef, NAPIExceptionMemoryError)
+    bool deleteResult = JSObjectDeleteProperty(env->context, (JSObjectRef)object, stringRef, &env->lastException);
+    JSStringRelease(stringRef);
+    CHECK_JSC(env)
+    if (result)
+    {
+        *result = deleteResult;
+    }
+
+    return NAPIExceptionOK;
+}
+
+static NAPIExceptionStatus getUTF8NamedProperty(NAPIEnv env, JSObjectRef objectRef, const char *utf8name,
+                                                JSValueRef *result)
+{
+    JSStringRef stringRef = JSStringCreateWithUTF8CString(utf8name);
+    RETURN_STATUS_IF_FALSE(stringRef, NAPIExceptionMemoryError)
+    *result = JSObjectGetProperty(env->context, objectRef, stringRef, &env->lastException);
+    JSStringRelease(stringRef);
+    CHECK_JSC(env)
+
+    return NAPIExceptionOK;
+}
+
+static NAPIExceptionStatus setUTF8NamedProperty(NAPIEnv env, JSObjectRef objectRef, const char *utf8name,
+                                                JSValueRef value)
+{
+    JSStringRef stringRef = JSStringCreateWithUTF8CString(utf8name);
+    RETURN_STATUS_IF_FALSE(stringRef, NAPIExceptionMemoryError)
+    JSObjectSetProperty(env->context, objectRef, stringRef, value, kJSPropertyAttributeNone, &env->lastException);
+    JSStringRelease(stringRef);
+    CHECK_JSC(env)
+
+    return NAPIExceptionOK;
+}
+
+// definePropertyRef 缓存 Object.defineProperty，只在需要时查找一次
+static NAPIExceptionStatus defineProperty(NAPIEnv env, JSObjectRef objectRef, const NAPIPropertyDescriptor *descriptor,
+                                          JSObjectRef *definePropertyRef)
+{
+    NAPIValue nameValue = descriptor->name;
+    if (descriptor->utf8name)
+    {
+        CHECK_NAPI(napi_create_string_utf8(env, descriptor->utf8name, &nameValue), Exception, Exception)
+    }
+    RETURN_STATUS_IF_FALSE(nameValue, NAPIExceptionNameExpected)
+
+    NAPIValue getterValue = NULL, setterValue = NULL, value = descriptor->value;
+    bool isAccessor = descriptor->getter || descriptor->setter;
+    if (descriptor->getter)
+    {
+        CHECK_NAPI(napi_create_function(env, descriptor->utf8name, descriptor->getter, descriptor->data, &getterValue),
+                   Exception, Exception)
+    }
+    if (descriptor->setter)
+    {
+        CHECK_NAPI(napi_create_function(env, descriptor->utf8name, descriptor->setter, descriptor->data, &setterValue),
+                   Exception, Exception)
+    }
+    if (!isAccessor && descriptor->method)
+    {
+        CHECK_NAPI(napi_create_function(env, descriptor->utf8name, descriptor->method, descriptor->data, &value),
+                   Exception, Exception)
+    }
+    if (!value)
+    {
+        value = (NAPIValue)JSValueMakeUndefined(env->context);
+    }
+
+    // 原型链上不存在同名属性时，JSObjectSetProperty 会以给定 attributes 定义自有属性
+    if (!isAccessor && JSValueIsString(env->context, (JSValueRef)nameValue))
+    {
+        JSStringRef nameStringRef = JSValueToStringCopy(env->context, (JSValueRef)nameValue, &env->lastException);
+        CHECK_JSC(env)
+        RETURN_STATUS_IF_FALSE(nameStringRef, NAPIExceptionMemoryError)
+        bool hasProperty = JSObjectHasProperty(env->context, objectRef, nameStringRef);
+        if (!hasProperty)
+        {
+            JSPropertyAttributes attributes = kJSPropertyAttributeNone;
+            if (!(descriptor->attributes & NAPIWritable))
+            {
+                attributes |= kJSPropertyAttributeReadOnly;
+            }
+            if (!(descriptor->attributes & NAPIEnumerable))
+            {
+                attributes |= kJSPropertyAttributeDontEnum;
+            }
+            if (!(descriptor->attributes & NAPIConfigurable))
+            {
+                attributes |= kJSPropertyAttributeDontDelete;
+            }
+            JSObjectSetProperty(env->context, objectRef, nameStringRef, (JSValueRef)value, attributes,
+                                &env->lastException);
+        }
+        JSStringRelease(nameStringRef);
+        CHECK_JSC(env)
+        if (!hasProperty)
+        {
+            return NAPIExceptionOK;
+        }
+    }
+
+    // 访问器属性或者覆盖已有属性，只能通过 Object.defineProperty
+    if (!*definePropertyRef)
+    {
+        JSValueRef objectConstructor, definePropertyFunction;
+        CHECK_NAPI(
+            getUTF8NamedProperty(env, JSContextGetGlobalObject(env->context), "Object", &objectConstructor),
+            Exception, Exception)
+        RETURN_STATUS_IF_FALSE(JSValueIsObject(env->context, objectConstructor), NAPIExceptionObjectExpected)
+        CHECK_NAPI(getUTF8NamedProperty(env, (JSObjectRef)objectConstructor, "defineProperty", &definePropertyFunction),
+                   Exception, Exception)
+        RETURN_STATUS_IF_FALSE(JSValueIsObject(env->context, definePropertyFunction) &&
+                                   JSObjectIsFunction(env->context, (JSObjectRef)definePropertyFunction),
+                               NAPIExceptionFunctionExpected)
+        *definePropertyRef = (JSObjectRef)definePropertyFunction;
+    }
+    JSObjectRef descriptorRef = JSObjectMake(env->context, NULL, NULL);
+    RETURN_STATUS_IF_FALSE(descriptorRef, NAPIExceptionMemoryError)
+    if (isAccessor)
+    {
+        CHECK_NAPI(setUTF8NamedProperty(env, descriptorRef, "get",
+                                        getterValue ? (JSValueRef)getterValue : JSValueMakeUndefined(env->context)),
+                   Exception, Exception)
+        CHECK_NAPI(setUTF8NamedProperty(env, descriptorRef, "set",
+                                        setterValue ? (JSValueRef)setterValue : JSValueMakeUndefined(env->context)),
+                   Exception, Exception)
+    }
+    else
+    {
+        CHECK_NAPI(setUTF8NamedProperty(env, descriptorRef, "value", (JSValueRef)value), Exception, Exception)
+        CHECK_NAPI(setUTF8NamedProperty(env, descriptorRef, "writable",
+                                        JSValueMakeBoolean(env->context, descriptor->attributes & NAPIWritable)),
+                   Exception, Exception)
+    }
+    CHECK_NAPI(setUTF8NamedProperty(env, descriptorRef, "enumerable",
+                                    JSValueMakeBoolean(env->context, descriptor->attributes & NAPIEnumerable)),
+               Exception, Exception)
+    CHECK_NAPI(setUTF8NamedProperty(env, descriptorRef, "configurable",
+                                    JSValueMakeBoolean(env->context, descriptor->attributes & NAPIConfigurable)),
+               Exception, Exception)
+    JSValueRef arguments[] = {objectRef, (JSValueRef)nameValue, descriptorRef};
+    JSObjectCallAsFunction(env->context, *definePropertyRef, NULL, 3, arguments, &env->lastException);
+    CHECK_JSC(env)
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_define_properties(NAPIEnv env, NAPIValue object, size_t propertyCount,
+                                           const NAPIPropertyDescriptor *properties)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(object, Exception)
+    if (propertyCount)
+    {
+        CHECK_ARG(properties, Exception)
+    }
+
+    RETURN_STATUS_IF_FALSE(JSValueIsObject(env->context, (JSValueRef)object), NAPIExceptionObjectExpected)
+    JSObjectRef definePropertyRef = NULL;
+    for (size_t i = 0; i < propertyCount; ++i)
+    {
+        CHECK_NAPI(defineProperty(env, (JSObjectRef)object, &properties[i], &definePropertyRef), Exception, Exception)
+    }
+
+    return NAPIExceptionOK;
+}
+
+// JSStringRef 引用计数，可以跨 env 使用
+NAPIExceptionStatus NAPICreatePropertyKey(NAPIEnv env, const char *utf8name, NAPIPropertyKey *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(result, Exception)
+
+    JSStringRef stringRef = JSStringCreateWithUTF8CString(utf8name ? utf8name : "");
+    RETURN_STATUS_IF_FALSE(stringRef, NAPIExceptionMemoryError)
+    *result = (NAPIPropertyKey)stringRef;
+
+    return NAPIExceptionOK;
+}
+
+NAPICommonStatus NAPIFreePropertyKey(NAPIEnv env, NAPIPropertyKey key)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(key, Common)
+
+    JSStringRelease((JSStringRef)key);
+
+    return NAPICommonOK;
+}
+
+NAPIExceptionStatus NAPISetPropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key, NAPIValue value)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(key, Exception)
+    CHECK_ARG(value, Exception)
+
+    RETURN_STATUS_IF_FALSE(JSValueIsObject(env->context, (JSValueRef)object), NAPIExceptionObjectExpected)
+    JSObjectSetProperty(env->context, (JSObjectRef)object, (JSStringRef)key, (JSValueRef)value,
+                        kJSPropertyAttributeNone, &env->lastException);
+    CHECK_JSC(env)
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus NAPIHasPropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key, bool *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(key, Exception)
+    CHECK_ARG(result, Exception)
+
+    RETURN_STATUS_IF_FALSE(JSValueIsObject(env->context, (JSValueRef)object), NAPIExceptionObjectExpected)
+    *result = JSObjectHasProperty(env->context, (JSObjectRef)object, (JSStringRef)key);
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus NAPIGetPropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key, NAPIValue *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(key, Exception)
+    CHECK_ARG(result, Exception)
+
+    RETURN_STATUS_IF_FALSE(JSValueIsObject(env->context, (JSValueRef)object), NAPIExceptionObjectExpected)
+    JSValueRef valueRef =
+        JSObjectGetProperty(env->context, (JSObjectRef)object, (JSStringRef)key, &env->lastException);
+    CHECK_JSC(env)
+    *result = (NAPIValue)valueRef;
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus NAPIDeletePropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key, bool *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(key, Exception)
+
+    RETURN_STATUS_IF_FALSE(JSValueIsObject(env->context, (JSValueRef)object), NAPIExceptionObjectExpected)
+    bool deleteResult =
+        JSObjectDeleteProperty(env->context, (JSObjectRef)object, (JSStringRef)key, &env->lastException);
+    CHECK_JSC(env)
+    if (result)
+    {
+        *result = deleteResult;
+    }
+
+    return NAPIExceptionOK;
+}
+
 NAPICommonStatus napi_is_array(NAPIEnv env, NAPIValue value, bool *result)
 {
     CHECK_ARG(env, Common)
@@ -696,6 +1169,35 @@ NAPIExceptionStatus napi_instanceof(NAPIEnv env, NAPIValue object, NAPIValue con
     return NAPIExceptionOK;
 }
 
+// JSValueIsStrictEqual 是 === 语义，number 需要单独处理 NaN 和 +0/-0
+NAPIExceptionStatus napi_strict_equals(NAPIEnv env, NAPIValue lhs, NAPIValue rhs, bool *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(lhs, Exception)
+    CHECK_ARG(rhs, Exception)
+    CHECK_ARG(result, Exception)
+
+    if (JSValueIsNumber(env->context, (JSValueRef)lhs) && JSValueIsNumber(env->context, (JSValueRef)rhs))
+    {
+        double lhsDouble, rhsDouble;
+        CHECK_NAPI(napi_get_value_double(env, lhs, &lhsDouble), Error, Exception)
+        CHECK_NAPI(napi_get_value_double(env, rhs, &rhsDouble), Error, Exception)
+        if (isnan(lhsDouble) || isnan(rhsDouble))
+        {
+            *result = isnan(lhsDouble) && isnan(rhsDouble);
+        }
+        else
+        {
+            *result = lhsDouble == rhsDouble && signbit(lhsDouble) == signbit(rhsDouble);
+        }
+
+        return NAPIExceptionOK;
+    }
+    *result = JSValueIsStrictEqual(env->context, (JSValueRef)lhs, (JSValueRef)rhs);
+
+    return NAPIExceptionOK;
+}
+
 NAPICommonStatus napi_get_cb_info(NAPIEnv env, NAPICallbackInfo callbackInfo, size_t *argc, NAPIValue *argv,
                                   NAPIValue *thisArg, void **data)
 {
@@ -946,36 +1448,243 @@ NAPIExceptionStatus napi_create_external(NAPIEnv env, void *data, NAPIFinalize f
     JSClassRef classRef = JSClassCreate(&classDefinition);
     if (!classRef)
     {
-        free(externalInfo);
-
-        return NAPIExceptionMemoryError;
+        free(externalInfo);
+
+        return NAPIExceptionMemoryError;
+    }
+    JSObjectRef objectRef = JSObjectMake(env->context, classRef, externalInfo);
+    JSClassRelease(classRef);
+    if (!objectRef)
+    {
+        free(externalInfo);
+
+        return NAPIExceptionMemoryError;
+    }
+    *result = (NAPIValue)objectRef;
+
+    return NAPIExceptionOK;
+}
+
+NAPIErrorStatus napi_get_value_external(NAPIEnv env, NAPIValue value, void **result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(value, Error)
+    CHECK_ARG(result, Error)
+
+    RETURN_STATUS_IF_FALSE(JSValueIsObject(env->context, (JSValueRef)value), NAPIErrorExternalExpected)
+    JSValueRef exception = NULL;
+    JSObjectRef objectRef = JSValueToObject(env->context, (JSValueRef)value, &exception);
+    RETURN_STATUS_IF_FALSE(!exception && objectRef, NAPIErrorExternalExpected)
+
+    ExternalInfo *info = JSObjectGetPrivate(objectRef);
+    *result = info ? info->data : NULL;
+
+    return NAPIErrorOK;
+}
+
+static void arrayBufferFree(void *bytes, __attribute__((unused)) void *deallocatorContext)
+{
+    free(bytes);
+}
+
+// JavaScriptCore C API 只能通过 NoCopy 创建 ArrayBuffer，因此自行分配内存
+NAPIExceptionStatus napi_create_arraybuffer(NAPIEnv env, size_t byteLength, void **data, NAPIValue *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(result, Exception)
+
+    // calloc(0) 可能返回 NULL
+    void *bytes = calloc(byteLength ? byteLength : 1, 1);
+    RETURN_STATUS_IF_FALSE(bytes, NAPIExceptionMemoryError)
+    JSObjectRef objectRef = JSObjectMakeArrayBufferWithBytesNoCopy(env->context, bytes, byteLength, arrayBufferFree,
+                                                                   NULL, &env->lastException);
+    if (!objectRef)
+    {
+        free(bytes);
+    }
+    CHECK_JSC(env)
+    RETURN_STATUS_IF_FALSE(objectRef, NAPIExceptionMemoryError)
+    if (data)
+    {
+        *data = bytes;
+    }
+    *result = (NAPIValue)objectRef;
+
+    return NAPIExceptionOK;
+}
+
+static void externalArrayBufferFinalize(void *bytes, void *deallocatorContext)
+{
+    ExternalInfo *externalInfo = deallocatorContext;
+    if (externalInfo->finalizeCallback)
+    {
+        externalInfo->finalizeCallback(bytes, externalInfo->finalizeHint);
+    }
+    free(externalInfo);
+}
+
+NAPIExceptionStatus napi_create_external_arraybuffer(NAPIEnv env, void *externalData, size_t byteLength,
+                                                     NAPIFinalize finalizeCB, void *finalizeHint, NAPIValue *result,
+                                                     bool *copied)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(result, Exception)
+
+    ExternalInfo *externalInfo = malloc(sizeof(ExternalInfo));
+    RETURN_STATUS_IF_FALSE(externalInfo, NAPIExceptionMemoryError)
+    externalInfo->data = externalData;
+    externalInfo->finalizeCallback = finalizeCB;
+    externalInfo->finalizeHint = finalizeHint;
+    JSObjectRef objectRef = JSObjectMakeArrayBufferWithBytesNoCopy(
+        env->context, externalData, byteLength, externalArrayBufferFinalize, externalInfo, &env->lastException);
+    if (!objectRef)
+    {
+        // 失败时不会调用 deallocator，业务方也不应该收到回调
+        free(externalInfo);
+    }
+    CHECK_JSC(env)
+    RETURN_STATUS_IF_FALSE(objectRef, NAPIExceptionMemoryError)
+    *result = (NAPIValue)objectRef;
+    if (copied)
+    {
+        *copied = false;
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPICommonStatus napi_is_arraybuffer(NAPIEnv env, NAPIValue value, bool *result)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(value, Common)
+    CHECK_ARG(result, Common)
+
+    // 不会产生异常
+    *result = JSValueGetTypedArrayType(env->context, (JSValueRef)value, NULL) == kJSTypedArrayTypeArrayBuffer;
+
+    return NAPICommonOK;
+}
+
+NAPIErrorStatus napi_get_arraybuffer_info(NAPIEnv env, NAPIValue arraybuffer, void **data, size_t *byteLength)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(arraybuffer, Error)
+
+    RETURN_STATUS_IF_FALSE(JSValueGetTypedArrayType(env->context, (JSValueRef)arraybuffer, NULL) ==
+                               kJSTypedArrayTypeArrayBuffer,
+                           NAPIErrorInvalidArg)
+    JSValueRef exception = NULL;
+    if (data)
+    {
+        *data = JSObjectGetArrayBufferBytesPtr(env->context, (JSObjectRef)arraybuffer, &exception);
+        RETURN_STATUS_IF_FALSE(!exception && *data, NAPIErrorInvalidArg)
+    }
+    if (byteLength)
+    {
+        *byteLength = JSObjectGetArrayBufferByteLength(env->context, (JSObjectRef)arraybuffer, &exception);
+        RETURN_STATUS_IF_FALSE(!exception, NAPIErrorInvalidArg)
     }
-    JSObjectRef objectRef = JSObjectMake(env->context, classRef, externalInfo);
-    JSClassRelease(classRef);
-    if (!objectRef)
+
+    return NAPIErrorOK;
+}
+
+// 下标与 NAPITypedArrayType 一致
+static const JSTypedArrayType typedArrayTypes[] = {
+    kJSTypedArrayTypeInt8Array,   kJSTypedArrayTypeUint8Array,   kJSTypedArrayTypeUint8ClampedArray,
+    kJSTypedArrayTypeInt16Array,  kJSTypedArrayTypeUint16Array,  kJSTypedArrayTypeInt32Array,
+    kJSTypedArrayTypeUint32Array, kJSTypedArrayTypeFloat32Array, kJSTypedArrayTypeFloat64Array};
+
+static bool getTypedArrayType(NAPIEnv env, JSValueRef value, NAPITypedArrayType *type)
+{
+    JSTypedArrayType typedArrayType = JSValueGetTypedArrayType(env->context, value, NULL);
+    for (size_t i = 0; i < sizeof(typedArrayTypes) / sizeof(typedArrayTypes[0]); ++i)
     {
-        free(externalInfo);
+        if (typedArrayTypes[i] == typedArrayType)
+        {
+            *type = (NAPITypedArrayType)i;
 
-        return NAPIExceptionMemoryError;
+            return true;
+        }
     }
+
+    return false;
+}
+
+// 越界和不对齐由 JavaScriptCore 抛出 RangeError
+NAPIExceptionStatus napi_create_typedarray(NAPIEnv env, NAPITypedArrayType type, size_t length, NAPIValue arraybuffer,
+                                           size_t byteOffset, NAPIValue *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(arraybuffer, Exception)
+    CHECK_ARG(result, Exception)
+    RETURN_STATUS_IF_FALSE(type >= NAPIInt8Array && type <= NAPIFloat64Array, NAPIExceptionInvalidArg)
+    RETURN_STATUS_IF_FALSE(JSValueGetTypedArrayType(env->context, (JSValueRef)arraybuffer, NULL) ==
+                               kJSTypedArrayTypeArrayBuffer,
+                           NAPIExceptionInvalidArg)
+
+    JSObjectRef objectRef = JSObjectMakeTypedArrayWithArrayBufferAndOffset(
+        env->context, typedArrayTypes[type], (JSObjectRef)arraybuffer, byteOffset, length, &env->lastException);
+    CHECK_JSC(env)
+    RETURN_STATUS_IF_FALSE(objectRef, NAPIExceptionMemoryError)
     *result = (NAPIValue)objectRef;
 
     return NAPIExceptionOK;
 }
 
-NAPIErrorStatus napi_get_value_external(NAPIEnv env, NAPIValue value, void **result)
+NAPICommonStatus napi_is_typedarray(NAPIEnv env, NAPIValue value, bool *result)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(value, Common)
+    CHECK_ARG(result, Common)
+
+    NAPITypedArrayType type;
+    *result = getTypedArrayType(env, (JSValueRef)value, &type);
+
+    return NAPICommonOK;
+}
+
+NAPIErrorStatus napi_get_typedarray_info(NAPIEnv env, NAPIValue typedarray, NAPITypedArrayType *type, size_t *length,
+                                         void **data, NAPIValue *arraybuffer, size_t *byteOffset)
 {
     CHECK_ARG(env, Error)
-    CHECK_ARG(value, Error)
-    CHECK_ARG(result, Error)
+    CHECK_ARG(typedarray, Error)
 
-    RETURN_STATUS_IF_FALSE(JSValueIsObject(env->context, (JSValueRef)value), NAPIErrorExternalExpected)
+    NAPITypedArrayType typedArrayType;
+    RETURN_STATUS_IF_FALSE(getTypedArrayType(env, (JSValueRef)typedarray, &typedArrayType), NAPIErrorInvalidArg)
+    JSObjectRef objectRef = (JSObjectRef)typedarray;
     JSValueRef exception = NULL;
-    JSObjectRef objectRef = JSValueToObject(env->context, (JSValueRef)value, &exception);
-    RETURN_STATUS_IF_FALSE(!exception && objectRef, NAPIErrorExternalExpected)
-
-    ExternalInfo *info = JSObjectGetPrivate(objectRef);
-    *result = info ? info->data : NULL;
+    size_t offset = JSObjectGetTypedArrayByteOffset(env->context, objectRef, &exception);
+    RETURN_STATUS_IF_FALSE(!exception, NAPIErrorInvalidArg)
+    if (type)
+    {
+        *type = typedArrayType;
+    }
+    if (length)
+    {
+        *length = JSObjectGetTypedArrayLength(env->context, objectRef, &exception);
+        RETURN_STATUS_IF_FALSE(!exception, NAPIErrorInvalidArg)
+    }
+    if (byteOffset)
+    {
+        *byteOffset = offset;
+    }
+    if (data || arraybuffer)
+    {
+        JSObjectRef arrayBufferRef = JSObjectGetTypedArrayBuffer(env->context, objectRef, &exception);
+        RETURN_STATUS_IF_FALSE(!exception && arrayBufferRef, NAPIErrorInvalidArg)
+        if (data)
+        {
+            // JSObjectGetTypedArrayBytesPtr 不同版本是否包含 byteOffset 不一致，因此从 ArrayBuffer 计算
+            uint8_t *bytes = JSObjectGetArrayBufferBytesPtr(env->context, arrayBufferRef, &exception);
+            RETURN_STATUS_IF_FALSE(!exception, NAPIErrorInvalidArg)
+            // 分离后 data 为 NULL
+            *data = bytes ? bytes + offset : NULL;
+        }
+        if (arraybuffer)
+        {
+            *arraybuffer = (NAPIValue)arrayBufferRef;
+        }
+    }
 
     return NAPIErrorOK;
 }
@@ -1328,28 +2037,41 @@ NAPICommonStatus napi_close_handle_scope(__attribute__((unused)) NAPIEnv env,
     return NAPICommonOK;
 }
 
-struct OpaqueNAPIEscapableHandleScope
+// JavaScriptCore 由 GC 保守扫描栈，没有句柄需要释放
+NAPIErrorStatus napi_reset_handle_scope(NAPIEnv env, NAPIHandleScope scope)
 {
-    bool escapeCalled;
-};
+    CHECK_ARG(env, Error)
+    CHECK_ARG(scope, Error)
+
+    return NAPIErrorOK;
+}
 
 NAPIErrorStatus napi_open_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandleScope *result)
 {
     CHECK_ARG(env, Error)
     CHECK_ARG(result, Error)
 
-    *result = malloc(sizeof(struct OpaqueNAPIEscapableHandleScope));
-    RETURN_STATUS_IF_FALSE(*result, NAPIErrorMemoryError)
+    *result = SLIST_FIRST(&env->freeEscapableHandleScopeList);
+    if (*result)
+    {
+        SLIST_REMOVE_HEAD(&env->freeEscapableHandleScopeList, node);
+    }
+    else
+    {
+        *result = malloc(sizeof(struct OpaqueNAPIEscapableHandleScope));
+        RETURN_STATUS_IF_FALSE(*result, NAPIErrorMemoryError)
+    }
     (*result)->escapeCalled = false;
 
     return NAPIErrorOK;
 }
 
-NAPICommonStatus napi_close_escapable_handle_scope(__attribute__((unused)) NAPIEnv env, NAPIEscapableHandleScope scope)
+NAPICommonStatus napi_close_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandleScope scope)
 {
+    CHECK_ARG(env, Common)
     CHECK_ARG(scope, Common)
 
-    free(scope);
+    SLIST_INSERT_HEAD(&env->freeEscapableHandleScopeList, scope, node);
 
     return NAPICommonOK;
 }
@@ -1406,10 +2128,40 @@ NAPICommonStatus NAPIClearLastException(NAPIEnv env)
 }
 
 NAPIExceptionStatus NAPIRunScript(NAPIEnv env, const char *utf8Script, const char *utf8SourceUrl, NAPIValue *result)
+{
+    return NAPIRunScriptWithOptions(env, utf8Script, utf8SourceUrl, NULL, result);
+}
+
+#define STRICT_DIRECTIVE "\"use strict\";"
+
+// JSC 不支持关闭优化、剥离调试信息和控制延迟编译，只支持 strict
+// JSEvaluateScript 没有 strict 参数，在脚本同一行前面插入指令，不改变行号
+NAPIExceptionStatus NAPIRunScriptWithOptions(NAPIEnv env, const char *utf8Script, const char *utf8SourceUrl,
+                                             const NAPIScriptOptions *options, NAPIValue *result)
 {
     CHECK_JSC(env)
+    RETURN_STATUS_IF_FALSE(!options || !options->module, NAPIExceptionInvalidArg)
 
-    JSStringRef scriptStringRef = JSStringCreateWithUTF8CString(utf8Script);
+    JSStringRef scriptStringRef;
+    if (options && options->strict)
+    {
+        size_t scriptLength = utf8Script ? strlen(utf8Script) : 0;
+        size_t directiveLength = sizeof(STRICT_DIRECTIVE) - 1;
+        char *buffer = malloc(directiveLength + scriptLength + 1);
+        RETURN_STATUS_IF_FALSE(buffer, NAPIExceptionMemoryError)
+        memcpy(buffer, STRICT_DIRECTIVE, directiveLength);
+        if (scriptLength)
+        {
+            memcpy(buffer + directiveLength, utf8Script, scriptLength);
+        }
+        buffer[directiveLength + scriptLength] = '\0';
+        scriptStringRef = JSStringCreateWithUTF8CString(buffer);
+        free(buffer);
+    }
+    else
+    {
+        scriptStringRef = JSStringCreateWithUTF8CString(utf8Script);
+    }
     JSStringRef sourceUrl = NULL;
     if (utf8SourceUrl)
     {
@@ -1431,6 +2183,120 @@ NAPIExceptionStatus NAPIRunScript(NAPIEnv env, const char *utf8Script, const cha
     return NAPIExceptionOK;
 }
 
+// JSScriptRef 属于私有 API，这里只保存源码，重复执行时依赖 JSC 内部按源码缓存的字节码
+struct OpaqueNAPIScript
+{
+    JSStringRef script;    // size_t
+    JSStringRef sourceUrl; // size_t
+};
+
+NAPIExceptionStatus NAPICompileScript(NAPIEnv env, const char *utf8Script, const char *utf8SourceUrl,
+                                      NAPIScript *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(result, Exception)
+
+    JSStringRef scriptStringRef = JSStringCreateWithUTF8CString(utf8Script);
+    RETURN_STATUS_IF_FALSE(scriptStringRef, NAPIExceptionMemoryError)
+    JSStringRef sourceUrl = NULL;
+    if (utf8SourceUrl)
+    {
+        sourceUrl = JSStringCreateWithUTF8CString(utf8SourceUrl);
+    }
+    // 提前报告语法错误，和其他引擎行为一致
+    if (!JSCheckScriptSyntax(env->context, scriptStringRef, sourceUrl, 1, &env->lastException))
+    {
+        JSStringRelease(scriptStringRef);
+        if (sourceUrl)
+        {
+            JSStringRelease(sourceUrl);
+        }
+
+        return NAPIExceptionPendingException;
+    }
+    *result = malloc(sizeof(struct OpaqueNAPIScript));
+    if (!*result)
+    {
+        JSStringRelease(scriptStringRef);
+        if (sourceUrl)
+        {
+            JSStringRelease(sourceUrl);
+        }
+
+        return NAPIExceptionMemoryError;
+    }
+    (*result)->script = scriptStringRef;
+    (*result)->sourceUrl = sourceUrl;
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus NAPIRunCompiledScript(NAPIEnv env, NAPIScript script, NAPIValue *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(script, Exception)
+
+    JSValueRef valueRef =
+        JSEvaluateScript(env->context, script->script, NULL, script->sourceUrl, 1, &env->lastException);
+    CHECK_JSC(env)
+    if (result)
+    {
+        *result = (NAPIValue)valueRef;
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPICommonStatus NAPIFreeScript(NAPIEnv env, NAPIScript script)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(script, Common)
+
+    JSStringRelease(script->script);
+    if (script->sourceUrl)
+    {
+        JSStringRelease(script->sourceUrl);
+    }
+    free(script);
+
+    return NAPICommonOK;
+}
+
+NAPIExceptionStatus NAPIParseUTF8JSONString(NAPIEnv env, const char *utf8String, NAPIValue *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(utf8String, Exception)
+    CHECK_ARG(result, Exception)
+
+    JSStringRef stringRef = JSStringCreateWithUTF8CString(utf8String);
+    RETURN_STATUS_IF_FALSE(stringRef, NAPIExceptionMemoryError)
+    JSValueRef valueRef = JSValueMakeFromJSONString(env->context, stringRef);
+    JSStringRelease(stringRef);
+    if (valueRef)
+    {
+        *result = (NAPIValue)valueRef;
+
+        return NAPIExceptionOK;
+    }
+
+    // JSValueMakeFromJSONString 解析失败只返回 NULL，这里补充抛出 SyntaxError
+    JSValueRef syntaxErrorConstructor;
+    CHECK_NAPI(getUTF8NamedProperty(env, JSContextGetGlobalObject(env->context), "SyntaxError",
+                                    &syntaxErrorConstructor),
+               Exception, Exception)
+    RETURN_STATUS_IF_FALSE(JSValueIsObject(env->context, syntaxErrorConstructor), NAPIExceptionObjectExpected)
+    JSStringRef messageStringRef = JSStringCreateWithUTF8CString("JSON Parse error");
+    RETURN_STATUS_IF_FALSE(messageStringRef, NAPIExceptionMemoryError)
+    JSValueRef messageRef = JSValueMakeString(env->context, messageStringRef);
+    JSStringRelease(messageStringRef);
+    JSObjectRef errorRef = JSObjectCallAsConstructor(env->context, (JSObjectRef)syntaxErrorConstructor, 1,
+                                                     &messageRef, &env->lastException);
+    CHECK_JSC(env)
+    env->lastException = errorRef;
+
+    return NAPIExceptionPendingException;
+}
+
 // static JSContextGroupRef virtualMachine = NULL;
 
 // static uint8_t contextCount = 0;
@@ -1463,6 +2329,19 @@ NAPIErrorStatus NAPICreateRuntime(NAPIRuntime *runtime)
     return NAPIErrorOK;
 }
 
+static inline bool isRuntimeOptionsValid(const NAPIRuntimeOptions *options)
+{
+    return !options || (options->version && options->version <= NAPI_RUNTIME_OPTIONS_VERSION);
+}
+
+// JavaScriptCore 没有公开堆和栈的配置接口，参数只做校验
+NAPIErrorStatus NAPICreateRuntimeWithOptions(const NAPIRuntimeOptions *options, NAPIRuntime *runtime)
+{
+    RETURN_STATUS_IF_FALSE(isRuntimeOptionsValid(options), NAPIErrorInvalidArg)
+
+    return NAPICreateRuntime(runtime);
+}
+
 NAPICommonStatus NAPIFreeRuntime(NAPIRuntime runtime)
 {
     CHECK_ARG(runtime, Common)
@@ -1491,6 +2370,8 @@ NAPIErrorStatus NAPICreateEnv(NAPIEnv *env, NAPIRuntime runtime)
     LIST_INIT(&(*env)->strongRefList);
     LIST_INIT(&(*env)->valueList);
     LIST_INIT(&(*env)->referenceList);
+    SLIST_INIT(&(*env)->freeEscapableHandleScopeList);
+    (*env)->externalMemorySize = 0;
 
     JSStringRef scriptStringRef = JSStringCreateWithUTF8CString("(() => {\
                                                                     return new WeakMap();\
@@ -1514,6 +2395,13 @@ NAPIErrorStatus NAPICreateEnv(NAPIEnv *env, NAPIRuntime runtime)
     return NAPIErrorOK;
 }
 
+NAPIErrorStatus NAPICreateEnvWithOptions(NAPIEnv *env, NAPIRuntime runtime, const NAPIRuntimeOptions *options)
+{
+    RETURN_STATUS_IF_FALSE(isRuntimeOptionsValid(options), NAPIErrorInvalidArg)
+
+    return NAPICreateEnv(env, runtime);
+}
+
 NAPICommonStatus NAPIFreeEnv(NAPIEnv env)
 {
     CHECK_ARG(env, Common)
@@ -1541,6 +2429,12 @@ NAPICommonStatus NAPIFreeEnv(NAPIEnv env)
         LIST_REMOVE(ref, node);
         free(ref);
     }
+    NAPIEscapableHandleScope escapableHandleScope;
+    while ((escapableHandleScope = SLIST_FIRST(&env->freeEscapableHandleScopeList)))
+    {
+        SLIST_REMOVE_HEAD(&env->freeEscapableHandleScopeList, node);
+        free(escapableHandleScope);
+    }
     JSValueUnprotect(env->context, env->weakMap);
     JSGlobalContextRelease(env->context);
     free(env);
@@ -1554,20 +2448,13 @@ NAPIErrorStatus NAPIGetValueStringUTF8(NAPIEnv env, NAPIValue value, const char
     CHECK_ARG(value, Error)
     CHECK_ARG(result, Error)
 
-    RETURN_STATUS_IF_FALSE(JSValueIsString(env->context, (JSValueRef)value), NAPIErrorStringExpected)
-    JSValueRef exception = NULL;
-    JSStringRef stringRef = JSValueToStringCopy(env->context, (JSValueRef)value, &exception);
-    RETURN_STATUS_IF_FALSE(!exception && stringRef, NAPIErrorStringExpected)
-    // 不为 0
-    size_t length = JSStringGetMaximumUTF8CStringSize(stringRef);
-    char *string = malloc(sizeof(char) * length);
+    // 先计算准确长度，避免按 JSStringGetMaximumUTF8CStringSize 分配
+    size_t length;
+    CHECK_NAPI(napi_get_value_string_utf8(env, value, NULL, 0, &length), Error, Error)
+    char *string = malloc(sizeof(char) * (length + 1));
     RETURN_STATUS_IF_FALSE(string, NAPIErrorMemoryError)
-    if (!JSStringGetUTF8CString(stringRef, string, length))
-    {
-        free(string);
-
-        return NAPIErrorGenericFailure;
-    }
+    // 第一次调用已经校验过参数，不会失败
+    napi_get_value_string_utf8(env, value, string, length + 1, NULL);
     *result = string;
 
     return NAPIErrorOK;
@@ -1592,6 +2479,16 @@ NAPI_EXPORT NAPIExceptionStatus NAPICompileToByteBuffer(__attribute__((unused))
     return NAPIExceptionOK;
 }
 
+NAPI_EXPORT NAPIExceptionStatus NAPICompileWithOptions(__attribute__((unused)) NAPIEnv env,
+                                                       __attribute__((unused)) const char *script,
+                                                       __attribute__((unused)) const char *sourceUrl,
+                                                       __attribute__((unused)) const NAPIScriptOptions *options,
+                                                       __attribute__((unused)) const uint8_t **byteBuffer,
+                                                       __attribute__((unused)) size_t *bufferSize)
+{
+    return NAPIExceptionOK;
+}
+
 NAPI_EXPORT NAPICommonStatus NAPIFreeByteBuffer(__attribute__((unused)) NAPIEnv env,
                                                 __attribute__((unused)) const uint8_t *byteBuffer)
 {
@@ -1605,3 +2502,147 @@ NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBuffer(__attribute__((unused)) NAPIEn
 {
     return NAPIExceptionOK;
 }
+
+// 没有可以执行的字节码，不能返回成功
+NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBufferFile(__attribute__((unused)) NAPIEnv env,
+                                                      __attribute__((unused)) const char *path,
+                                                      __attribute__((unused)) NAPIValue *result)
+{
+    return NAPIExceptionGenericFailure;
+}
+
+// JSC 进入 VM 时按当前线程设置栈范围
+void NAPIAttachEnvToCurrentThread(__attribute__((unused)) NAPIEnv env)
+{
+}
+
+// NAPISetCodeCacheDirectory 不会开启缓存，不会被调用
+NAPIExceptionStatus NAPIRunCachedByteBuffer(__attribute__((unused)) NAPIEnv env,
+                                            __attribute__((unused)) const uint8_t *byteBuffer,
+                                            __attribute__((unused)) size_t bufferSize,
+                                            __attribute__((unused)) NAPIValue *result)
+{
+    return NAPIExceptionGenericFailure;
+}
+
+// JSC 不支持导出字节码，不开启缓存
+NAPIErrorStatus NAPISetCodeCacheDirectory(NAPIEnv env, __attribute__((unused)) const char *directory)
+{
+    CHECK_ARG(env, Error)
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus NAPIGetCodeCacheStatistics(NAPIEnv env, NAPICodeCacheStatistics *result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(result, Error)
+
+    memset(result, 0, sizeof(NAPICodeCacheStatistics));
+
+    return NAPIErrorOK;
+}
+
+// JavaScriptCore 没有公开的堆统计接口，只统计绑定层的 NAPIRef
+NAPIErrorStatus NAPIGetHeapStatistics(NAPIEnv env, NAPIHeapStatistics *result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(result, Error)
+
+    memset(result, 0, sizeof(NAPIHeapStatistics));
+    NAPIRef ref;
+    LIST_FOREACH(ref, &env->strongRefList, node)
+    {
+        ++result->strongReferenceCount;
+    }
+    struct ReferenceInfo *referenceInfo;
+    LIST_FOREACH(referenceInfo, &env->referenceList, node)
+    {
+        LIST_FOREACH(ref, &referenceInfo->referenceList, node)
+        {
+            ++result->weakReferenceCount;
+        }
+    }
+    LIST_FOREACH(ref, &env->valueList, node)
+    {
+        ++result->valueReferenceCount;
+    }
+
+    return NAPIErrorOK;
+}
+
+// JSGarbageCollect 只会通知引擎尽快回收，不区分新生代
+NAPIErrorStatus NAPIRunGC(NAPIEnv env, NAPIGCMode mode)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(mode == NAPIFullGC || mode == NAPIYoungGC, NAPIErrorInvalidArg)
+
+    JSGarbageCollect(env->context);
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus NAPIIdleNotification(NAPIEnv env, __attribute__((unused)) uint64_t idleMicroseconds, bool *hasMoreWork)
+{
+    CHECK_ARG(env, Error)
+
+    JSGarbageCollect(env->context);
+    if (hasMoreWork)
+    {
+        *hasMoreWork = false;
+    }
+
+    return NAPIErrorOK;
+}
+
+// JSGarbageCollect 不是同步回收，无法统计 GC 释放的内存，只返回绑定层释放的字节数
+NAPIErrorStatus NAPINotifyMemoryPressure(NAPIEnv env, NAPIMemoryPressureLevel level, size_t *reclaimedBytes)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(level == NAPIModerateMemoryPressure || level == NAPICriticalMemoryPressure,
+                           NAPIErrorInvalidArg)
+
+    size_t totalReclaimedBytes = 0;
+    NAPIEscapableHandleScope escapableHandleScope;
+    while ((escapableHandleScope = SLIST_FIRST(&env->freeEscapableHandleScopeList)))
+    {
+        SLIST_REMOVE_HEAD(&env->freeEscapableHandleScopeList, node);
+        free(escapableHandleScope);
+        totalReclaimedBytes += sizeof(struct OpaqueNAPIEscapableHandleScope);
+    }
+    if (level == NAPICriticalMemoryPressure)
+    {
+        JSGarbageCollect(env->context);
+    }
+    if (reclaimedBytes)
+    {
+        *reclaimedBytes = totalReclaimedBytes;
+    }
+
+    return NAPIErrorOK;
+}
+
+// JSReportExtraMemoryCost 是私有接口，只做统计，不影响 GC
+NAPIErrorStatus napi_adjust_external_memory(NAPIEnv env, int64_t changeInBytes, int64_t *adjustedValue)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(adjustedValue, Error)
+
+    if (changeInBytes < -env->externalMemorySize)
+    {
+        changeInBytes = -env->externalMemorySize;
+    }
+    env->externalMemorySize += changeInBytes;
+    *adjustedValue = env->externalMemorySize;
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus NAPIWriteHeapSnapshot(NAPIEnv env, const char *path)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(path, Error)
+
+    // JSC 的堆快照接口（JSC::HeapSnapshotBuilder）不在公开 API 中
+    return NAPIErrorGenericFailure;
+}
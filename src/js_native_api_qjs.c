@@ -9,9 +9,27 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/queue.h>
+#include <sys/stat.h>
 
+#include <fcntl.h>
 #include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__linux__)
+#include <malloc.h>
+#endif
+
+#include "js_native_api_code_cache.h"
+#include "js_native_api_env_pool.h"
+#include "js_native_api_heap_snapshot.h"
+#include "js_native_api_unicode.h"
 
 #ifndef SLIST_FOREACH_SAFE
 #define SLIST_FOREACH_SAFE(var, head, field, tvar)                                                                     \
@@ -63,16 +81,32 @@
         RETURN_STATUS_IF_FALSE(!(env)->isThrowNull, NAPIExceptionPendingException)                                     \
     }
 
-struct Handle
+// 一个 HandleBlock 约 1KB，第一个内嵌在 OpaqueNAPIEnv 中
+#define HANDLE_BLOCK_CAPACITY 64
+
+// HandleBlock 组成按块增长的 handle 栈，只在 NAPIFreeEnv 中释放，不同 handleScope 之间复用
+struct HandleBlock
 {
-    JSValue value;            // size_t * 2
-    SLIST_ENTRY(Handle) node; // size_t
+    struct HandleBlock *previous;          // size_t
+    struct HandleBlock *next;              // size_t
+    JSValue values[HANDLE_BLOCK_CAPACITY]; // size_t * 2 * HANDLE_BLOCK_CAPACITY
 };
 
+// handleScope 只记录打开时 handle 栈的水位线，关闭时释放水位线以上的所有 JSValue
 struct OpaqueNAPIHandleScope
 {
-    LIST_ENTRY(OpaqueNAPIHandleScope) node; // size_t
-    SLIST_HEAD(, Handle) handleList;        // size_t
+    LIST_ENTRY(OpaqueNAPIHandleScope) node; // size_t * 2
+    struct HandleBlock *handleBlock;        // size_t
+    size_t handleIndex;                     // size_t
+};
+
+// 两种 handleScope 统一按 OpaqueNAPIEscapableHandleScope 大小分配，共用 env 中的空闲链表
+struct OpaqueNAPIEscapableHandleScope
+{
+    struct OpaqueNAPIHandleScope handleScope;
+    // 打开时在上层 handleScope 中预留的位置，没有上层 handleScope 则为 NULL
+    JSValue *escapeSlot; // size_t
+    bool escapeCalled;
 };
 
 struct OpaqueNAPIRef
@@ -96,16 +130,36 @@ struct WeakReference
 // 3. Constructor -> .[[prototype]] = new External()
 // 4. Reference -> 引用计数 + setWeak/clearWeak -> referenceSymbolValue
 
+// 只编译未执行的脚本，每次执行时基于同一份字节码创建新的闭包
+struct OpaqueNAPIScript
+{
+    JSValue functionValue; // size_t * 2
+};
+
 struct OpaqueNAPIEnv
 {
     JSValue referenceSymbolValue;                       // size_t * 2
+    // JS_GetGlobalObject() 缓存，生命周期和 env 一致
+    JSValue globalValue;                                // size_t * 2
     NAPIRuntime runtime;                                // size_t
     JSContext *context;                                 // size_t
     LIST_HEAD(, OpaqueNAPIHandleScope) handleScopeList; // size_t
+    // 已关闭的 handleScope，复用 node 字段
+    LIST_HEAD(, OpaqueNAPIHandleScope) freeHandleScopeList; // size_t
     LIST_HEAD(, WeakReference) weakReferenceList;       // size_t
     LIST_HEAD(, OpaqueNAPIRef) strongRefList;           // size_t
     LIST_HEAD(, OpaqueNAPIRef) valueList;               // size_t
+    // 当前栈顶所在的 HandleBlock 和下一个可用位置
+    struct HandleBlock *handleBlock; // size_t
+    size_t handleIndex;              // size_t
+    // NAPISetCodeCacheDirectory 开启后非空
+    NAPICodeCache *codeCache; // size_t
+    // 上一次 JS_RunGC 的耗时，用于估计 NAPIIdleNotification 能否在预算内完成
+    uint64_t lastGCNanoseconds; // uint64_t
+    // napi_adjust_external_memory 登记的总字节数
+    int64_t externalMemorySize; // int64_t
     bool isThrowNull;
+    struct HandleBlock firstHandleBlock;
 };
 
 struct OpaqueNAPIRuntime
@@ -114,26 +168,66 @@ struct OpaqueNAPIRuntime
     JSClassID constructorClassId; // uint32_t
     JSClassID functionClassId;    // uint32_t
     JSClassID externalClassId;    // uint32_t
+    // 尚未被 externalFinalizer 回收的 external 数量
+    size_t externalCount; // size_t
+    // napi_adjust_external_memory 登记、还没有计入 JSMallocState 的字节数，在下一次内存分配时计入
+    int64_t pendingExternalMemorySize; // int64_t
+    // QuickJS 当前分配的字节数，不包含 external 内存，O(1) 读取，用于检查 malloc_limit 和统计
+    size_t mallocSize; // size_t
+    // 自创建以来累计分配的字节数，只增不减，和上一次 GC 时的值比较可以知道之后是否有新的分配
+    uint64_t allocatedSize;       // uint64_t
+    uint64_t lastGCAllocatedSize; // uint64_t
 };
 
 // 这个函数不会修改引用计数和所有权
 // NAPIHandleScopeEmpty/NAPIMemoryError
-static NAPIErrorStatus addValueToHandleScope(NAPIEnv env, JSValue value, struct Handle **result)
+static NAPIErrorStatus addValueToHandleScope(NAPIEnv env, JSValue value, JSValue **result)
 {
 
     CHECK_ARG(env, Error)
     CHECK_ARG(result, Error)
 
     RETURN_STATUS_IF_FALSE(!LIST_EMPTY(&env->handleScopeList), NAPIErrorHandleScopeEmpty)
-    *result = malloc(sizeof(struct Handle));
-    RETURN_STATUS_IF_FALSE(*result, NAPIErrorMemoryError)
-    (*result)->value = value;
-    NAPIHandleScope handleScope = LIST_FIRST(&env->handleScopeList);
-    SLIST_INSERT_HEAD(&handleScope->handleList, *result, node);
+    if (__builtin_expect(env->handleIndex == HANDLE_BLOCK_CAPACITY, false))
+    {
+        // 优先复用之前分配过的 HandleBlock
+        struct HandleBlock *handleBlock = env->handleBlock->next;
+        if (!handleBlock)
+        {
+            handleBlock = malloc(sizeof(struct HandleBlock));
+            RETURN_STATUS_IF_FALSE(handleBlock, NAPIErrorMemoryError)
+            handleBlock->previous = env->handleBlock;
+            handleBlock->next = NULL;
+            env->handleBlock->next = handleBlock;
+        }
+        env->handleBlock = handleBlock;
+        env->handleIndex = 0;
+    }
+    *result = &env->handleBlock->values[env->handleIndex++];
+    **result = value;
 
     return NAPIErrorOK;
 }
 
+// 释放 handle 栈中水位线以上的 JSValue，HandleBlock 本身保留
+static void popHandlesToWatermark(NAPIEnv env, struct HandleBlock *handleBlock, size_t handleIndex)
+{
+    while (env->handleBlock != handleBlock)
+    {
+        for (size_t i = 0; i < env->handleIndex; ++i)
+        {
+            JS_FreeValue(env->context, env->handleBlock->values[i]);
+        }
+        env->handleBlock = env->handleBlock->previous;
+        env->handleIndex = HANDLE_BLOCK_CAPACITY;
+    }
+    for (size_t i = handleIndex; i < env->handleIndex; ++i)
+    {
+        JS_FreeValue(env->context, handleBlock->values[i]);
+    }
+    env->handleIndex = handleIndex;
+}
+
 static JSValueConst undefinedValue = JS_UNDEFINED;
 
 NAPICommonStatus napi_get_undefined(NAPIEnv env, NAPIValue *result)
@@ -161,38 +255,20 @@ NAPICommonStatus napi_get_null(NAPIEnv env, NAPIValue *result)
 }
 
 #ifndef NDEBUG
-static char *const JS_GET_GLOBAL_OBJECT_EXCEPTION = "JS_GetGlobalObject() -> JS_EXCEPTION.";
 static char *const FUNCTION_CLASS_ID_ZERO = "functionClassId must not be 0.";
 
 static char *const CONSTRUCTOR_CLASS_ID_ZERO = "constructorClassId must not be 0.";
 static char *const NAPI_CLOSE_HANDLE_SCOPE_ERROR = "napi_close_handle_scope() return error.";
 #endif
 
-// NAPIGenericFailure + addValueToHandleScope
 NAPIErrorStatus napi_get_global(NAPIEnv env, NAPIValue *result)
 {
 
     CHECK_ARG(env, Error)
     CHECK_ARG(result, Error)
 
-    // JS_GetGlobalObject 返回已经引用计数 +1
-    // 实际上 globalValue 可能为 JS_EXCEPTION，但是由于不是 JS_GetGlobalObject 中发生的异常，因此返回 generic failure
-    JSValue globalValue = JS_GetGlobalObject(env->context);
-    if (__builtin_expect(JS_IsException(globalValue), false))
-    {
-        assert(false && JS_GET_GLOBAL_OBJECT_EXCEPTION);
-
-        return NAPIErrorGenericFailure;
-    }
-    struct Handle *globalHandle;
-    NAPIErrorStatus status = addValueToHandleScope(env, globalValue, &globalHandle);
-    if (__builtin_expect(status != NAPIErrorOK, false))
-    {
-        JS_FreeValue(env->context, globalValue);
-
-        return status;
-    }
-    *result = (NAPIValue)&globalHandle->value;
+    // globalValue 由 env 持有，不需要放入 handleScope
+    *result = (NAPIValue)&env->globalValue;
 
     return NAPIErrorOK;
 }
@@ -220,44 +296,121 @@ NAPIErrorStatus napi_create_double(NAPIEnv env, double value, NAPIValue *result)
     CHECK_ARG(result, Error)
 
     JSValue jsValue = JS_NewFloat64(env->context, value);
-    struct Handle *handle;
+    JSValue *handle;
     CHECK_NAPI(addValueToHandleScope(env, jsValue, &handle), Error, Error)
-    *result = (NAPIValue)&handle->value;
+    *result = (NAPIValue)handle;
 
     return NAPIErrorOK;
 }
 
 // NAPIPendingException + addValueToHandleScope
 NAPIExceptionStatus napi_create_string_utf8(NAPIEnv env, const char *str, NAPIValue *result)
+{
+    return napi_create_string_utf8_len(env, str, NAPI_AUTO_LENGTH, result);
+}
+
+// NAPIPendingException + addValueToHandleScope
+// 接管 stringValue 所有权
+static NAPIExceptionStatus addStringValueToHandleScope(NAPIEnv env, JSValue stringValue, NAPIValue *result)
+{
+    RETURN_STATUS_IF_FALSE(!JS_IsException(stringValue), NAPIExceptionPendingException)
+    JSValue *stringHandle;
+    NAPIErrorStatus status = addValueToHandleScope(env, stringValue, &stringHandle);
+    if (__builtin_expect(status != NAPIErrorOK, false))
+    {
+        JS_FreeValue(env->context, stringValue);
+
+        return (NAPIExceptionStatus)status;
+    }
+    *result = (NAPIValue)stringHandle;
+
+    return NAPIExceptionOK;
+}
+
+// NAPIMemoryError/NAPIPendingException + addValueToHandleScope
+// utf8String 长度为 length，不要求 \0 结尾
+// JS_NewStringLen 对非法 UTF-8 的处理和其他引擎不一致，非 ASCII 统一转换为 UTF-16 后创建
+static NAPIExceptionStatus createStringValue(NAPIEnv env, const char *utf8String, size_t length, NAPIValue *result)
+{
+    if (NAPIUnicodeIsASCII(utf8String, length))
+    {
+        // length == 0 的情况下会返回 ""
+        return addStringValueToHandleScope(env, JS_NewStringLatin1(env->context, utf8String, length), result);
+    }
+    uint16_t *utf16String = malloc(NAPIUnicodeUTF16LengthOfUTF8(utf8String, length) * sizeof(uint16_t));
+    RETURN_STATUS_IF_FALSE(utf16String, NAPIExceptionMemoryError)
+    size_t utf16Length = NAPIUnicodeConvertUTF8ToUTF16(utf8String, length, utf16String);
+    JSValue stringValue = JS_NewString16(env->context, utf16String, utf16Length);
+    free(utf16String);
+
+    return addStringValueToHandleScope(env, stringValue, result);
+}
+
+// NAPIMemoryError/NAPIPendingException + addValueToHandleScope
+NAPIExceptionStatus napi_create_string_utf8_len(NAPIEnv env, const char *str, size_t length, NAPIValue *result)
 {
 
     NAPI_PREAMBLE(env)
     CHECK_ARG(result, Exception)
 
-    size_t length;
-    if (str)
+    if (!str)
+    {
+        RETURN_STATUS_IF_FALSE(!length || length == NAPI_AUTO_LENGTH, NAPIExceptionInvalidArg)
+        // str 依旧保持 NULL
+        length = 0;
+    }
+    else if (length == NAPI_AUTO_LENGTH)
     {
         length = strlen(str);
     }
-    else
+
+    return createStringValue(env, str, length, result);
+}
+
+// NAPIPendingException + addValueToHandleScope
+// JS_NewStringLatin1 来自 quickjs_patch.diff，QuickJS 的 8 位字符串就是 Latin-1，直接拷贝
+NAPIExceptionStatus napi_create_string_latin1(NAPIEnv env, const char *str, size_t length, NAPIValue *result)
+{
+
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(result, Exception)
+
+    if (!str)
     {
-        // str 依旧保持 NULL
+        RETURN_STATUS_IF_FALSE(!length || length == NAPI_AUTO_LENGTH, NAPIExceptionInvalidArg)
         length = 0;
     }
-    // length == 0 的情况下会返回 ""
-    JSValue stringValue = JS_NewStringLen(env->context, str, length);
-    RETURN_STATUS_IF_FALSE(!JS_IsException(stringValue), NAPIExceptionPendingException)
-    struct Handle *stringHandle;
-    NAPIErrorStatus status = addValueToHandleScope(env, stringValue, &stringHandle);
-    if (__builtin_expect(status != NAPIErrorOK, false))
+    else if (length == NAPI_AUTO_LENGTH)
     {
-        JS_FreeValue(env->context, stringValue);
+        length = strlen(str);
+    }
 
-        return (NAPIExceptionStatus)status;
+    return addStringValueToHandleScope(env, JS_NewStringLatin1(env->context, str, length), result);
+}
+
+// NAPIPendingException + addValueToHandleScope
+// JS_NewString16 来自 quickjs_patch.diff，直接使用 UTF-16 码元构造，孤立代理项保持不变
+NAPIExceptionStatus napi_create_string_utf16(NAPIEnv env, const char16_t *str, size_t length, NAPIValue *result)
+{
+
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(result, Exception)
+
+    if (!str)
+    {
+        RETURN_STATUS_IF_FALSE(!length || length == NAPI_AUTO_LENGTH, NAPIExceptionInvalidArg)
+        length = 0;
+    }
+    else if (length == NAPI_AUTO_LENGTH)
+    {
+        length = 0;
+        while (str[length])
+        {
+            ++length;
+        }
     }
-    *result = (NAPIValue)&stringHandle->value;
 
-    return NAPIExceptionOK;
+    return addStringValueToHandleScope(env, JS_NewString16(env->context, (const uint16_t *)str, length), result);
 }
 
 typedef struct
@@ -305,17 +458,9 @@ static JSValue callAsFunction(JSContext *ctx, JSValueConst thisVal, int argc, JS
         return undefinedValue;
     }
     // thisVal 有可能为 undefined，如果直接调用函数，比如 test() 而不是 this.test() 或者 globalThis.test()
-    bool useGlobalValue = false;
     if (JS_IsUndefined(thisVal))
     {
-        useGlobalValue = true;
-        thisVal = JS_GetGlobalObject(ctx);
-        if (__builtin_expect(JS_IsException(thisVal), false))
-        {
-            assert(false && JS_GET_GLOBAL_OBJECT_EXCEPTION);
-
-            return undefinedValue;
-        }
+        thisVal = functionInfo->baseInfo.env->globalValue;
     }
     struct OpaqueNAPICallbackInfo callbackInfo = {undefinedValue, thisVal, argv, functionInfo->baseInfo.data, argc};
     // napi_open_handle_scope 失败需要容错，这里需要初始化为 NULL 判断
@@ -328,11 +473,6 @@ static JSValue callAsFunction(JSContext *ctx, JSValueConst thisVal, int argc, JS
     }
     // callback 调用后，返回值应当属于当前 handleScope 管理，否则业务方后果自负
     NAPIValue retVal = functionInfo->callback(functionInfo->baseInfo.env, &callbackInfo);
-    if (useGlobalValue)
-    {
-        // 释放 thisVal = JS_GetGlobalObject(ctx); 的情况
-        JS_FreeValue(ctx, thisVal);
-    }
     // Check NULL
     JSValue returnValue = undefinedValue;
     if (retVal)
@@ -435,7 +575,7 @@ NAPIExceptionStatus napi_create_function(NAPIEnv env, const char *utf8name, NAPI
             return NAPIExceptionPendingException;
         }
     }
-    struct Handle *functionHandle;
+    JSValue *functionHandle;
     NAPIErrorStatus status = addValueToHandleScope(env, functionValue, &functionHandle);
     if (__builtin_expect(status != NAPIErrorOK, false))
     {
@@ -444,7 +584,7 @@ NAPIExceptionStatus napi_create_function(NAPIEnv env, const char *utf8name, NAPI
 
         return (NAPIExceptionStatus)status;
     }
-    *result = (NAPIValue)&functionHandle->value;
+    *result = (NAPIValue)functionHandle;
 
     return NAPIExceptionOK;
 }
@@ -544,6 +684,73 @@ NAPIErrorStatus napi_get_value_bool(NAPIEnv env, NAPIValue value, bool *result)
     return NAPIErrorOK;
 }
 
+// 纯 ASCII 字符串 JS_ToCStringLen 不会拷贝
+NAPIErrorStatus napi_get_value_string_utf8(NAPIEnv env, NAPIValue value, char *buf, size_t bufsize, size_t *result)
+{
+
+    CHECK_ARG(env, Error)
+    CHECK_ARG(value, Error)
+    RETURN_STATUS_IF_FALSE(buf || result, NAPIErrorInvalidArg)
+
+    RETURN_STATUS_IF_FALSE(JS_IsString(*((JSValue *)value)), NAPIErrorStringExpected)
+    size_t length;
+    const char *cString = JS_ToCStringLen(env->context, &length, *((JSValue *)value));
+    RETURN_STATUS_IF_FALSE(cString, NAPIErrorMemoryError)
+    if (buf)
+    {
+        if (bufsize)
+        {
+            length = NAPIUnicodeTruncateUTF8(cString, length, bufsize - 1);
+            memcpy(buf, cString, length);
+            buf[length] = '\0';
+        }
+        else
+        {
+            length = 0;
+        }
+    }
+    JS_FreeCString(env->context, cString);
+    if (result)
+    {
+        *result = length;
+    }
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus napi_get_value_string_utf16(NAPIEnv env, NAPIValue value, char16_t *buf, size_t bufsize,
+                                            size_t *result)
+{
+
+    CHECK_ARG(env, Error)
+    CHECK_ARG(value, Error)
+    RETURN_STATUS_IF_FALSE(buf || result, NAPIErrorInvalidArg)
+
+    RETURN_STATUS_IF_FALSE(JS_IsString(*((JSValue *)value)), NAPIErrorStringExpected)
+    size_t length;
+    if (!buf)
+    {
+        length = JS_GetString16(*((JSValue *)value), NULL, 0);
+    }
+    else if (bufsize)
+    {
+        // 多拷贝一个码元用于判断代理对，buf[bufsize - 1] 最终会被 \0 覆盖
+        length = JS_GetString16(*((JSValue *)value), (uint16_t *)buf, bufsize);
+        length = NAPIUnicodeTruncateUTF16((const uint16_t *)buf, length < bufsize ? length : bufsize, bufsize - 1);
+        buf[length] = 0;
+    }
+    else
+    {
+        length = 0;
+    }
+    if (result)
+    {
+        *result = length;
+    }
+
+    return NAPIErrorOK;
+}
+
 // NAPIPendingException + napi_get_boolean
 NAPIExceptionStatus napi_coerce_to_bool(NAPIEnv env, NAPIValue value, NAPIValue *result)
 {
@@ -586,7 +793,7 @@ NAPIExceptionStatus napi_coerce_to_string(NAPIEnv env, NAPIValue value, NAPIValu
 
     JSValue stringValue = JS_ToString(env->context, *((JSValue *)value));
     RETURN_STATUS_IF_FALSE(!JS_IsException(stringValue), NAPIExceptionPendingException)
-    struct Handle *stringHandle;
+    JSValue *stringHandle;
     NAPIErrorStatus status = addValueToHandleScope(env, stringValue, &stringHandle);
     if (__builtin_expect(status != NAPIErrorOK, false))
     {
@@ -594,7 +801,7 @@ NAPIExceptionStatus napi_coerce_to_string(NAPIEnv env, NAPIValue value, NAPIValu
 
         return (NAPIExceptionStatus)status;
     }
-    *result = (NAPIValue)&stringHandle->value;
+    *result = (NAPIValue)stringHandle;
 
     return NAPIExceptionOK;
 }
@@ -661,7 +868,7 @@ NAPIExceptionStatus napi_get_property(NAPIEnv env, NAPIValue object, NAPIValue k
     JSValue value = JS_GetProperty(env->context, *((JSValue *)object), atom);
     JS_FreeAtom(env->context, atom);
     RETURN_STATUS_IF_FALSE(!JS_IsException(value), NAPIExceptionPendingException)
-    struct Handle *handle;
+    JSValue *handle;
     NAPIErrorStatus status = addValueToHandleScope(env, value, &handle);
     if (__builtin_expect(status != NAPIErrorOK, false))
     {
@@ -669,7 +876,7 @@ NAPIExceptionStatus napi_get_property(NAPIEnv env, NAPIValue object, NAPIValue k
 
         return (NAPIExceptionStatus)status;
     }
-    *result = (NAPIValue)&handle->value;
+    *result = (NAPIValue)handle;
 
     return NAPIExceptionOK;
 }
@@ -697,1347 +904,3021 @@ NAPIExceptionStatus napi_delete_property(NAPIEnv env, NAPIValue object, NAPIValu
     return NAPIExceptionOK;
 }
 
-NAPICommonStatus napi_is_array(NAPIEnv env, NAPIValue value, bool *result)
+// NAPIPendingException
+NAPIExceptionStatus napi_set_element(NAPIEnv env, NAPIValue object, uint32_t index, NAPIValue value)
 {
 
-    CHECK_ARG(env, Common)
-    CHECK_ARG(value, Common)
-    CHECK_ARG(result, Common)
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(value, Exception)
 
-    // 正常情况下 napi_is_array 不会检查 Proxy 的情况
-    int isArrayStatus = JS_IsArray(env->context, *((JSValue *)value));
-    if (isArrayStatus == -1)
+    // JS_SetPropertyUint32 转移 value 所有权
+    int status =
+        JS_SetPropertyUint32(env->context, *((JSValue *)object), index, JS_DupValue(env->context, *((JSValue *)value)));
+    RETURN_STATUS_IF_FALSE(status != -1, NAPIExceptionPendingException)
+    if (__builtin_expect(!status, false))
     {
-        CHECK_NAPI(NAPIClearLastException(env), Common, Common)
-    }
-    *result = isArrayStatus;
+        assert(false && "JS_SetPropertyUint32() -> false");
 
-    return NAPICommonOK;
-}
-
-static void processPendingTask(NAPIEnv env)
-{
-    if (__builtin_expect(!env, false))
-    {
-        return;
+        return NAPIExceptionGenericFailure;
     }
 
-    int error = 1;
-    do
-    {
-        JSContext *context;
-        error = JS_ExecutePendingJob(JS_GetRuntime(env->context), &context);
-        if (error == -1)
-        {
-            // 正常情况下 JS_ExecutePendingJob 返回 -1
-            // 代表引擎内部异常，比如内存分配失败等
-            // TODO(ChasonTang): 测试 Promise 抛出异常的情况
-            JSValue inlineExceptionValue = JS_GetException(context);
-            JS_FreeValue(context, inlineExceptionValue);
-        }
-    } while (error != 0);
+    return NAPIExceptionOK;
 }
 
-// NAPIMemoryError/NAPIPendingException + addValueToHandleScope
-NAPIExceptionStatus napi_call_function(NAPIEnv env, NAPIValue thisValue, NAPIValue func, size_t argc,
-                                       const NAPIValue *argv, NAPIValue *result)
+// NAPIPendingException
+// 小于 2^31 的索引在 QuickJS 中是标记整数 atom，不需要分配和释放
+NAPIExceptionStatus napi_has_element(NAPIEnv env, NAPIValue object, uint32_t index, bool *result)
 {
 
     NAPI_PREAMBLE(env)
-    CHECK_ARG(func, Exception)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(result, Exception)
 
-    // TODO(ChasonTang): napi_open_handle_scope()
+    JSAtom atom = JS_NewAtomUInt32(env->context, index);
+    RETURN_STATUS_IF_FALSE(atom != JS_ATOM_NULL, NAPIExceptionPendingException)
+    int status = JS_HasProperty(env->context, *((JSValue *)object), atom);
+    JS_FreeAtom(env->context, atom);
+    RETURN_STATUS_IF_FALSE(status != -1, NAPIExceptionPendingException)
+    *result = status;
 
-    if (!thisValue)
-    {
-        CHECK_NAPI(napi_get_global(env, &thisValue), Error, Exception)
-    }
+    return NAPIExceptionOK;
+}
 
-    JSValue *internalArgv = NULL;
-    if (argc > 0)
-    {
-        RETURN_STATUS_IF_FALSE(argc <= INT_MAX, NAPIExceptionInvalidArg)
-        CHECK_ARG(argv, Exception)
-        internalArgv = malloc(sizeof(JSValue) * argc);
-        RETURN_STATUS_IF_FALSE(internalArgv, NAPIExceptionMemoryError)
-        for (size_t i = 0; i < argc; ++i)
-        {
-            internalArgv[i] = *((JSValue *)argv[i]);
-        }
-    }
+// NAPIPendingException + addValueToHandleScope
+NAPIExceptionStatus napi_get_element(NAPIEnv env, NAPIValue object, uint32_t index, NAPIValue *result)
+{
 
-    // JS_Call 返回值带所有权
-    JSValue returnValue = JS_Call(env->context, *((JSValue *)func), *((JSValue *)thisValue), (int)argc, internalArgv);
-    free(internalArgv);
-    if (JS_IsException(returnValue))
-    {
-        JSValue exceptionValue = JS_GetException(env->context);
-        processPendingTask(env);
-        if (JS_IsNull(exceptionValue))
-        {
-            env->isThrowNull = true;
-        }
-        else
-        {
-            JS_Throw(env->context, exceptionValue);
-        }
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(result, Exception)
 
-        return NAPIExceptionPendingException;
-    }
-    processPendingTask(env);
-    if (result)
+    JSValue value = JS_GetPropertyUint32(env->context, *((JSValue *)object), index);
+    RETURN_STATUS_IF_FALSE(!JS_IsException(value), NAPIExceptionPendingException)
+    JSValue *handle;
+    NAPIErrorStatus status = addValueToHandleScope(env, value, &handle);
+    if (__builtin_expect(status != NAPIErrorOK, false))
     {
-        struct Handle *handle;
-        NAPIErrorStatus status = addValueToHandleScope(env, returnValue, &handle);
-        if (__builtin_expect(status != NAPIErrorOK, false))
-        {
-            JS_FreeValue(env->context, returnValue);
+        JS_FreeValue(env->context, value);
 
-            return (NAPIExceptionStatus)status;
-        }
-        *result = (NAPIValue)&handle->value;
-    }
-    else
-    {
-        JS_FreeValue(env->context, returnValue);
+        return (NAPIExceptionStatus)status;
     }
+    *result = (NAPIValue)handle;
 
     return NAPIExceptionOK;
 }
 
-// NAPIPendingException/NAPIMemoryError + addValueToHandleScope
-NAPIExceptionStatus napi_new_instance(NAPIEnv env, NAPIValue constructor, size_t argc, const NAPIValue *argv,
-                                      NAPIValue *result)
+// NAPIPendingException
+NAPIExceptionStatus napi_delete_element(NAPIEnv env, NAPIValue object, uint32_t index, bool *result)
 {
 
     NAPI_PREAMBLE(env)
-    CHECK_ARG(constructor, Exception)
-    CHECK_ARG(result, Exception)
+    CHECK_ARG(object, Exception)
 
-    JSValue *internalArgv = NULL;
-    if (argc > 0)
+    JSAtom atom = JS_NewAtomUInt32(env->context, index);
+    RETURN_STATUS_IF_FALSE(atom != JS_ATOM_NULL, NAPIExceptionPendingException)
+    int status = JS_DeleteProperty(env->context, *((JSValue *)object), atom, JS_PROP_NORMAL);
+    JS_FreeAtom(env->context, atom);
+    RETURN_STATUS_IF_FALSE(status != -1, NAPIExceptionPendingException)
+    if (result)
     {
-        RETURN_STATUS_IF_FALSE(argc <= INT_MAX, NAPIExceptionInvalidArg)
-        CHECK_ARG(argv, Exception)
-        internalArgv = malloc(sizeof(JSValue) * argc);
-        RETURN_STATUS_IF_FALSE(internalArgv, NAPIExceptionMemoryError)
-        for (size_t i = 0; i < argc; ++i)
-        {
-            internalArgv[i] = *((JSValue *)argv[i]);
-        }
+        *result = status;
     }
 
-    JSValue returnValue = JS_CallConstructor(env->context, *((JSValue *)constructor), (int)argc, internalArgv);
-    free(internalArgv);
-    if (JS_IsException(returnValue))
-    {
-        JSValue exceptionValue = JS_GetException(env->context);
-        processPendingTask(env);
-        if (JS_IsNull(exceptionValue))
-        {
-            env->isThrowNull = true;
-        }
-        else
-        {
-            JS_Throw(env->context, exceptionValue);
-        }
+    return NAPIExceptionOK;
+}
 
-        return NAPIExceptionPendingException;
-    }
-    processPendingTask(env);
-    struct Handle *handle;
-    NAPIErrorStatus status = addValueToHandleScope(env, returnValue, &handle);
-    if (__builtin_expect(status != NAPIErrorOK, false))
+// NAPIMemoryError
+// JSAtom 本身就是 uint32_t 索引，直接存放在指针中，JS_ATOM_NULL 代表无效
+NAPIExceptionStatus NAPICreatePropertyKey(NAPIEnv env, const char *utf8name, NAPIPropertyKey *result)
+{
+
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(result, Exception)
+
+    JSAtom atom = JS_NewAtom(env->context, utf8name ? utf8name : "");
+    RETURN_STATUS_IF_FALSE(atom != JS_ATOM_NULL, NAPIExceptionMemoryError)
+    *result = (NAPIPropertyKey)(uintptr_t)atom;
+
+    return NAPIExceptionOK;
+}
+
+NAPICommonStatus NAPIFreePropertyKey(NAPIEnv env, NAPIPropertyKey key)
+{
+
+    CHECK_ARG(env, Common)
+    CHECK_ARG(key, Common)
+
+    JS_FreeAtom(env->context, (JSAtom)(uintptr_t)key);
+
+    return NAPICommonOK;
+}
+
+// NAPIPendingException
+NAPIExceptionStatus NAPISetPropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key, NAPIValue value)
+{
+
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(key, Exception)
+    CHECK_ARG(value, Exception)
+
+    // JS_SetProperty 转移 value 所有权，不转移 atom 所有权
+    int status = JS_SetProperty(env->context, *((JSValue *)object), (JSAtom)(uintptr_t)key,
+                                JS_DupValue(env->context, *((JSValue *)value)));
+    RETURN_STATUS_IF_FALSE(status != -1, NAPIExceptionPendingException)
+    if (__builtin_expect(!status, false))
     {
-        JS_FreeValue(env->context, returnValue);
+        assert(false && "JS_SetProperty() -> false");
 
-        return (NAPIExceptionStatus)status;
+        return NAPIExceptionGenericFailure;
     }
-    *result = (NAPIValue)&handle->value;
 
     return NAPIExceptionOK;
 }
 
 // NAPIPendingException
-NAPIExceptionStatus napi_instanceof(NAPIEnv env, NAPIValue object, NAPIValue constructor, bool *result)
+NAPIExceptionStatus NAPIHasPropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key, bool *result)
 {
 
     NAPI_PREAMBLE(env)
     CHECK_ARG(object, Exception)
-    CHECK_ARG(constructor, Exception)
+    CHECK_ARG(key, Exception)
     CHECK_ARG(result, Exception)
 
-    int status = JS_IsInstanceOf(env->context, *((JSValue *)object), *((JSValue *)constructor));
+    int status = JS_HasProperty(env->context, *((JSValue *)object), (JSAtom)(uintptr_t)key);
     RETURN_STATUS_IF_FALSE(status != -1, NAPIExceptionPendingException)
     *result = status;
 
     return NAPIExceptionOK;
 }
 
-NAPICommonStatus napi_get_cb_info(NAPIEnv env, NAPICallbackInfo callbackInfo, size_t *argc, NAPIValue *argv,
-                                  NAPIValue *thisArg, void **data)
+// NAPIPendingException + addValueToHandleScope
+NAPIExceptionStatus NAPIGetPropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key, NAPIValue *result)
 {
 
-    CHECK_ARG(env, Common)
-    CHECK_ARG(callbackInfo, Common)
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(key, Exception)
+    CHECK_ARG(result, Exception)
 
-    if (argv)
-    {
-        CHECK_ARG(argc, Common)
-        size_t i = 0;
-        size_t min = callbackInfo->argc < 0 || *argc > (size_t)callbackInfo->argc ? callbackInfo->argc : *argc;
-        for (; i < min; ++i)
-        {
-            argv[i] = (NAPIValue)&callbackInfo->argv[i];
-        }
-        if (i < *argc)
-        {
-            for (; i < *argc; ++i)
-            {
-                argv[i] = (NAPIValue)&undefinedValue;
-            }
-        }
-    }
-    if (argc)
-    {
-        *argc = callbackInfo->argc;
-    }
-    if (thisArg)
+    JSValue value = JS_GetProperty(env->context, *((JSValue *)object), (JSAtom)(uintptr_t)key);
+    RETURN_STATUS_IF_FALSE(!JS_IsException(value), NAPIExceptionPendingException)
+    JSValue *handle;
+    NAPIErrorStatus status = addValueToHandleScope(env, value, &handle);
+    if (__builtin_expect(status != NAPIErrorOK, false))
     {
-        *thisArg = (NAPIValue)&callbackInfo->thisArg;
+        JS_FreeValue(env->context, value);
+
+        return (NAPIExceptionStatus)status;
     }
-    if (data)
+    *result = (NAPIValue)handle;
+
+    return NAPIExceptionOK;
+}
+
+// NAPIPendingException
+NAPIExceptionStatus NAPIDeletePropertyWithKey(NAPIEnv env, NAPIValue object, NAPIPropertyKey key, bool *result)
+{
+
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(key, Exception)
+
+    int status = JS_DeleteProperty(env->context, *((JSValue *)object), (JSAtom)(uintptr_t)key, JS_PROP_NORMAL);
+    RETURN_STATUS_IF_FALSE(status != -1, NAPIExceptionPendingException)
+    if (result)
     {
-        *data = callbackInfo->data;
+        *result = status;
     }
 
-    return NAPICommonOK;
+    return NAPIExceptionOK;
 }
 
-NAPICommonStatus napi_get_new_target(NAPIEnv env, NAPICallbackInfo callbackInfo, NAPIValue *result)
+NAPICommonStatus napi_is_array(NAPIEnv env, NAPIValue value, bool *result)
 {
 
     CHECK_ARG(env, Common)
-    CHECK_ARG(callbackInfo, Common)
+    CHECK_ARG(value, Common)
     CHECK_ARG(result, Common)
 
-    if (!JS_IsUndefined(callbackInfo->newTarget))
-    {
-        *result = (NAPIValue)&callbackInfo->newTarget;
-    }
-    else
+    // 正常情况下 napi_is_array 不会检查 Proxy 的情况
+    int isArrayStatus = JS_IsArray(env->context, *((JSValue *)value));
+    if (isArrayStatus == -1)
     {
-        *result = NULL;
+        CHECK_NAPI(NAPIClearLastException(env), Common, Common)
     }
+    *result = isArrayStatus;
 
     return NAPICommonOK;
 }
 
-typedef struct
-{
-    void *data;                    // size_t
-    void *finalizeHint;            // size_t
-    NAPIFinalize finalizeCallback; // size_t
-} ExternalInfo;
-
-// NAPIMemoryError/NAPIPendingException + addValueToHandleScope
-NAPIExceptionStatus napi_create_external(NAPIEnv env, void *data, NAPIFinalize finalizeCB, void *finalizeHint,
-                                         NAPIValue *result)
+// NAPINameExpected/NAPIPendingException + napi_create_function
+// 创建的函数属于当前 handleScope
+static NAPIExceptionStatus defineProperty(NAPIEnv env, JSValueConst object, const NAPIPropertyDescriptor *descriptor)
 {
-
-    NAPI_PREAMBLE(env)
-    CHECK_ARG(result, Exception)
-
-    ExternalInfo *externalInfo = malloc(sizeof(ExternalInfo));
-    RETURN_STATUS_IF_FALSE(externalInfo, NAPIExceptionMemoryError)
-    externalInfo->data = data;
-    externalInfo->finalizeHint = finalizeHint;
-    externalInfo->finalizeCallback = NULL;
-    if (__builtin_expect(!env->runtime->externalClassId, false))
+    JSAtom atom;
+    if (descriptor->utf8name)
     {
-        assert(false && "externalClassId must not be 0.");
-        free(externalInfo);
+        atom = JS_NewAtom(env->context, descriptor->utf8name);
+    }
+    else
+    {
+        RETURN_STATUS_IF_FALSE(descriptor->name, NAPIExceptionNameExpected)
+        atom = JS_ValueToAtom(env->context, *((JSValue *)descriptor->name));
+    }
+    RETURN_STATUS_IF_FALSE(atom != JS_ATOM_NULL, NAPIExceptionPendingException)
 
-        return NAPIExceptionGenericFailure;
+    // 传入 JS_PROP_THROW 后所有 false 情况都会变成 exception
+    int flags = JS_PROP_THROW | JS_PROP_HAS_CONFIGURABLE | JS_PROP_HAS_ENUMERABLE;
+    if (descriptor->attributes & NAPIConfigurable)
+    {
+        flags |= JS_PROP_CONFIGURABLE;
     }
-    JSValue object = JS_NewObjectClass(env->context, (int)env->runtime->externalClassId);
-    if (__builtin_expect(JS_IsException(object), false))
+    if (descriptor->attributes & NAPIEnumerable)
     {
-        free(externalInfo);
+        flags |= JS_PROP_ENUMERABLE;
+    }
+    int returnStatus;
+    if (descriptor->getter || descriptor->setter)
+    {
+        JSValue getterValue = undefinedValue;
+        JSValue setterValue = undefinedValue;
+        NAPIValue functionValue;
+        NAPIExceptionStatus status;
+        if (descriptor->getter)
+        {
+            status =
+                napi_create_function(env, descriptor->utf8name, descriptor->getter, descriptor->data, &functionValue);
+            if (__builtin_expect(status != NAPIExceptionOK, false))
+            {
+                JS_FreeAtom(env->context, atom);
 
-        return NAPIExceptionPendingException;
+                return status;
+            }
+            getterValue = *((JSValue *)functionValue);
+        }
+        if (descriptor->setter)
+        {
+            status =
+                napi_create_function(env, descriptor->utf8name, descriptor->setter, descriptor->data, &functionValue);
+            if (__builtin_expect(status != NAPIExceptionOK, false))
+            {
+                JS_FreeAtom(env->context, atom);
+
+                return status;
+            }
+            setterValue = *((JSValue *)functionValue);
+        }
+        // JS_DefineProperty 不转移 getter/setter 所有权
+        returnStatus = JS_DefineProperty(env->context, object, atom, undefinedValue, getterValue, setterValue,
+                                         flags | JS_PROP_HAS_GET | JS_PROP_HAS_SET);
     }
-    JS_SetOpaque(object, externalInfo);
-    struct Handle *handle;
-    NAPIErrorStatus status = addValueToHandleScope(env, object, &handle);
-    if (__builtin_expect(status != NAPIErrorOK, false))
+    else
     {
-        JS_FreeValue(env->context, object);
+        JSValue value = undefinedValue;
+        if (descriptor->method)
+        {
+            NAPIValue functionValue;
+            NAPIExceptionStatus status =
+                napi_create_function(env, descriptor->utf8name, descriptor->method, descriptor->data, &functionValue);
+            if (__builtin_expect(status != NAPIExceptionOK, false))
+            {
+                JS_FreeAtom(env->context, atom);
 
-        return (NAPIExceptionStatus)status;
+                return status;
+            }
+            value = *((JSValue *)functionValue);
+        }
+        else if (descriptor->value)
+        {
+            value = *((JSValue *)descriptor->value);
+        }
+        if (descriptor->attributes & NAPIWritable)
+        {
+            flags |= JS_PROP_WRITABLE;
+        }
+        // JS_DefinePropertyValue 转移 value 所有权
+        returnStatus = JS_DefinePropertyValue(env->context, object, atom, JS_DupValue(env->context, value), flags);
     }
-    *result = (NAPIValue)&handle->value;
-    // 不能先设置回调，万一出错，业务方也会收到回调
-    externalInfo->finalizeCallback = finalizeCB;
+    JS_FreeAtom(env->context, atom);
+    RETURN_STATUS_IF_FALSE(returnStatus != -1, NAPIExceptionPendingException)
 
     return NAPIExceptionOK;
 }
 
-NAPIErrorStatus napi_get_value_external(NAPIEnv env, NAPIValue value, void **result)
+// NAPIObjectExpected/NAPINameExpected/NAPIPendingException + napi_create_function
+NAPIExceptionStatus napi_define_properties(NAPIEnv env, NAPIValue object, size_t propertyCount,
+                                           const NAPIPropertyDescriptor *properties)
 {
 
-    CHECK_ARG(env, Error)
-    CHECK_ARG(value, Error)
-    CHECK_ARG(result, Error)
-
-    if (__builtin_expect(!env->runtime->externalClassId, false))
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(object, Exception)
+    if (propertyCount)
     {
-        assert(false && "externalClassId must not be 0.");
+        CHECK_ARG(properties, Exception)
+    }
 
-        return NAPIErrorGenericFailure;
+    RETURN_STATUS_IF_FALSE(JS_IsObject(*((JSValue *)object)), NAPIExceptionObjectExpected)
+
+    // 批量创建的函数在定义完成后即可释放句柄
+    NAPIHandleScope handleScope;
+    CHECK_NAPI(napi_open_handle_scope(env, &handleScope), Error, Exception)
+    NAPIExceptionStatus status = NAPIExceptionOK;
+    for (size_t i = 0; i < propertyCount && status == NAPIExceptionOK; ++i)
+    {
+        status = defineProperty(env, *((JSValue *)object), &properties[i]);
     }
-    ExternalInfo *externalInfo = JS_GetOpaque(*((JSValue *)value), env->runtime->externalClassId);
-    *result = externalInfo ? externalInfo->data : NULL;
+    CHECK_NAPI(napi_close_handle_scope(env, handleScope), Common, Exception)
 
-    return NAPIErrorOK;
+    return status;
 }
 
-// static uint8_t contextCount = 0;
+// argc 不超过该值时，napi_call_function/napi_new_instance 使用栈上数组传递参数
+#define INLINE_ARGUMENT_COUNT 8
 
-static void referenceFinalize(void *finalizeData, void *finalizeHint)
+static void processPendingTask(NAPIEnv env)
 {
-    // finalizeHint => env 不可靠
-    if (!finalizeData)
+    if (__builtin_expect(!env, false))
     {
-        assert(false);
-
         return;
     }
-    struct WeakReference *referenceInfo = finalizeData;
-    // isEnvFreed 需要存在，因为有三种情况
-    // 1. env 被析构
-    // 2. env 还在，也有 referenceInfo，但是没有 weakRef
-    // 3. env 还在，也有 referenceInfo，也有 weakRef
-    if (!referenceInfo->isEnvFreed)
+
+    int error = 1;
+    do
     {
-        NAPIRef reference, temp;
-        LIST_FOREACH_SAFE(reference, &referenceInfo->weakRefList, node, temp)
+        JSContext *context;
+        error = JS_ExecutePendingJob(JS_GetRuntime(env->context), &context);
+        if (error == -1)
         {
-            // 如果进入循环，说明 env 是有效的
-            assert(!reference->referenceCount);
-            reference->value = undefinedValue;
-            LIST_REMOVE(reference, node);
-            // 所以这里 finalizeHint 还是有效的 env
-            LIST_INSERT_HEAD(&((NAPIEnv)finalizeHint)->valueList, reference, node);
+            // 正常情况下 JS_ExecutePendingJob 返回 -1
+            // 代表引擎内部异常，比如内存分配失败等
+            // TODO(ChasonTang): 测试 Promise 抛出异常的情况
+            JSValue inlineExceptionValue = JS_GetException(context);
+            JS_FreeValue(context, inlineExceptionValue);
         }
-        // 当前不是 last GC
-        // LIST_REMOVE 会影响 env 结构体
-        LIST_REMOVE(referenceInfo, node);
-    }
-
-    free(referenceInfo);
+    } while (error != 0);
 }
 
-// NAPINameExpected/NAPIMemoryError/NAPIGenericFailure + napi_create_string_utf8 + napi_get_property + napi_typeof +
-// napi_create_external
-// + napi_get_value_external + napi_set_property
-static NAPIExceptionStatus setWeak(NAPIEnv env, NAPIValue value, NAPIRef ref)
+// NAPIMemoryError/NAPIPendingException + addValueToHandleScope
+NAPIExceptionStatus napi_call_function(NAPIEnv env, NAPIValue thisValue, NAPIValue func, size_t argc,
+                                       const NAPIValue *argv, NAPIValue *result)
 {
-    NAPI_PREAMBLE(env)
-    CHECK_ARG(value, Exception)
-    CHECK_ARG(ref, Exception)
 
-    RETURN_STATUS_IF_FALSE(JS_IsSymbol(env->referenceSymbolValue), NAPIExceptionNameExpected)
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(func, Exception)
 
     // TODO(ChasonTang): napi_open_handle_scope()
 
-    NAPIValue referenceValue;
-    CHECK_NAPI(napi_get_property(env, value, (NAPIValue)&env->referenceSymbolValue, &referenceValue), Exception,
-               Exception)
-    NAPIValueType valueType;
-    CHECK_NAPI(napi_typeof(env, referenceValue, &valueType), Common, Exception)
-    RETURN_STATUS_IF_FALSE(valueType == NAPIUndefined || valueType == NAPIExternal, NAPIExceptionGenericFailure)
-    struct WeakReference *referenceInfo;
-    if (valueType == NAPIUndefined)
+    if (!thisValue)
     {
-        referenceInfo = malloc(sizeof(struct WeakReference));
-        RETURN_STATUS_IF_FALSE(referenceInfo, NAPIExceptionMemoryError)
-        referenceInfo->isEnvFreed = false;
-        LIST_INIT(&referenceInfo->weakRefList);
+        CHECK_NAPI(napi_get_global(env, &thisValue), Error, Exception)
+    }
+
+    JSValue inlineArgv[INLINE_ARGUMENT_COUNT];
+    JSValue *internalArgv = inlineArgv;
+    if (argc > 0)
+    {
+        RETURN_STATUS_IF_FALSE(argc <= INT_MAX, NAPIExceptionInvalidArg)
+        CHECK_ARG(argv, Exception)
+        if (argc > INLINE_ARGUMENT_COUNT)
         {
-            NAPIExceptionStatus status =
-                napi_create_external(env, referenceInfo, referenceFinalize, env, &referenceValue);
-            if (__builtin_expect(status != NAPIExceptionOK, false))
-            {
-                free(referenceInfo);
+            internalArgv = malloc(sizeof(JSValue) * argc);
+            RETURN_STATUS_IF_FALSE(internalArgv, NAPIExceptionMemoryError)
+        }
+        for (size_t i = 0; i < argc; ++i)
+        {
+            internalArgv[i] = *((JSValue *)argv[i]);
+        }
+    }
 
-                return status;
-            }
+    // JS_Call 返回值带所有权
+    JSValue returnValue = JS_Call(env->context, *((JSValue *)func), *((JSValue *)thisValue), (int)argc, internalArgv);
+    if (internalArgv != inlineArgv)
+    {
+        free(internalArgv);
+    }
+    if (JS_IsException(returnValue))
+    {
+        JSValue exceptionValue = JS_GetException(env->context);
+        processPendingTask(env);
+        if (JS_IsNull(exceptionValue))
+        {
+            env->isThrowNull = true;
         }
-        CHECK_NAPI(napi_set_property(env, value, (NAPIValue)&env->referenceSymbolValue, referenceValue), Exception,
-                   Exception)
-        LIST_INSERT_HEAD(&env->weakReferenceList, referenceInfo, node);
+        else
+        {
+            JS_Throw(env->context, exceptionValue);
+        }
+
+        return NAPIExceptionPendingException;
     }
-    else
+    processPendingTask(env);
+    if (result)
     {
-        CHECK_NAPI(napi_get_value_external(env, referenceValue, (void **)&referenceInfo), Error, Exception)
-        if (__builtin_expect(!referenceInfo, false))
+        JSValue *handle;
+        NAPIErrorStatus status = addValueToHandleScope(env, returnValue, &handle);
+        if (__builtin_expect(status != NAPIErrorOK, false))
         {
-            assert(false);
+            JS_FreeValue(env->context, returnValue);
 
-            return NAPIExceptionGenericFailure;
+            return (NAPIExceptionStatus)status;
         }
+        *result = (NAPIValue)handle;
+    }
+    else
+    {
+        JS_FreeValue(env->context, returnValue);
     }
-    LIST_INSERT_HEAD(&referenceInfo->weakRefList, ref, node);
 
     return NAPIExceptionOK;
 }
 
-// NAPIMemoryError + setWeak
-NAPIExceptionStatus napi_create_reference(NAPIEnv env, NAPIValue value, uint32_t initialRefCount, NAPIRef *result)
+// NAPIPendingException/NAPIMemoryError + addValueToHandleScope
+NAPIExceptionStatus napi_new_instance(NAPIEnv env, NAPIValue constructor, size_t argc, const NAPIValue *argv,
+                                      NAPIValue *result)
 {
 
     NAPI_PREAMBLE(env)
-    CHECK_ARG(value, Exception)
+    CHECK_ARG(constructor, Exception)
     CHECK_ARG(result, Exception)
 
-    *result = malloc(sizeof(struct OpaqueNAPIRef));
-    RETURN_STATUS_IF_FALSE(*result, NAPIExceptionMemoryError)
-    // 标量 && 弱引用
-    if (!JS_IsObject(*((JSValue *)value)) && !initialRefCount)
+    JSValue inlineArgv[INLINE_ARGUMENT_COUNT];
+    JSValue *internalArgv = inlineArgv;
+    if (argc > 0)
     {
-        (*result)->referenceCount = 0;
-        (*result)->value = undefinedValue;
-        LIST_INSERT_HEAD(&env->valueList, *result, node);
+        RETURN_STATUS_IF_FALSE(argc <= INT_MAX, NAPIExceptionInvalidArg)
+        CHECK_ARG(argv, Exception)
+        if (argc > INLINE_ARGUMENT_COUNT)
+        {
+            internalArgv = malloc(sizeof(JSValue) * argc);
+            RETURN_STATUS_IF_FALSE(internalArgv, NAPIExceptionMemoryError)
+        }
+        for (size_t i = 0; i < argc; ++i)
+        {
+            internalArgv[i] = *((JSValue *)argv[i]);
+        }
+    }
 
-        return NAPIExceptionOK;
+    JSValue returnValue = JS_CallConstructor(env->context, *((JSValue *)constructor), (int)argc, internalArgv);
+    if (internalArgv != inlineArgv)
+    {
+        free(internalArgv);
     }
-    // 对象 || 强引用
-    (*result)->value = *((JSValue *)value);
-    (*result)->referenceCount = initialRefCount;
-    // 强引用
-    if (initialRefCount)
+    if (JS_IsException(returnValue))
     {
-        (*result)->value = JS_DupValue(env->context, (*result)->value);
-        LIST_INSERT_HEAD(&env->strongRefList, *result, node);
+        JSValue exceptionValue = JS_GetException(env->context);
+        processPendingTask(env);
+        if (JS_IsNull(exceptionValue))
+        {
+            env->isThrowNull = true;
+        }
+        else
+        {
+            JS_Throw(env->context, exceptionValue);
+        }
 
-        return NAPIExceptionOK;
+        return NAPIExceptionPendingException;
     }
-    // 对象 && 弱引用
-    // setWeak
-    NAPIExceptionStatus status = setWeak(env, value, *result);
-    if (__builtin_expect(status != NAPIExceptionOK, false))
+    processPendingTask(env);
+    JSValue *handle;
+    NAPIErrorStatus status = addValueToHandleScope(env, returnValue, &handle);
+    if (__builtin_expect(status != NAPIErrorOK, false))
     {
-        free(*result);
+        JS_FreeValue(env->context, returnValue);
 
-        return status;
+        return (NAPIExceptionStatus)status;
     }
+    *result = (NAPIValue)handle;
 
     return NAPIExceptionOK;
 }
 
-// NAPINameExpected/NAPIGenericFailure + napi_create_string_utf8 + napi_get_property + napi_get_value_external +
-// napi_delete_property
-static NAPIExceptionStatus clearWeak(NAPIEnv env, NAPIRef ref)
+// NAPIPendingException
+NAPIExceptionStatus napi_instanceof(NAPIEnv env, NAPIValue object, NAPIValue constructor, bool *result)
 {
-    NAPI_PREAMBLE(env)
-    CHECK_ARG(ref, Exception)
 
-    RETURN_STATUS_IF_FALSE(JS_IsSymbol(env->referenceSymbolValue), NAPIExceptionNameExpected)
-
-    // TODO(ChasonTang): napi_open_handle_scope()
-
-    NAPIValue externalValue;
-    CHECK_NAPI(napi_get_property(env, (NAPIValue)&ref->value, (NAPIValue)&env->referenceSymbolValue, &externalValue),
-               Exception, Exception)
-    struct WeakReference *referenceInfo;
-    CHECK_NAPI(napi_get_value_external(env, externalValue, (void **)&referenceInfo), Error, Exception)
-    if (__builtin_expect(!referenceInfo, false))
-    {
-        assert(false);
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(object, Exception)
+    CHECK_ARG(constructor, Exception)
+    CHECK_ARG(result, Exception)
 
-        return NAPIExceptionGenericFailure;
-    }
-    bool needDelete = LIST_FIRST(&referenceInfo->weakRefList) == ref && !LIST_NEXT(ref, node);
-    LIST_REMOVE(ref, node);
-    if (needDelete)
-    {
-        bool deleteResult;
-        // 一定不会在这里触发 GC
-        CHECK_NAPI(
-            napi_delete_property(env, (NAPIValue)&ref->value, (NAPIValue)&env->referenceSymbolValue, &deleteResult),
-            Exception, Exception)
-        RETURN_STATUS_IF_FALSE(deleteResult, NAPIExceptionGenericFailure)
-    }
+    int status = JS_IsInstanceOf(env->context, *((JSValue *)object), *((JSValue *)constructor));
+    RETURN_STATUS_IF_FALSE(status != -1, NAPIExceptionPendingException)
+    *result = status;
 
     return NAPIExceptionOK;
 }
 
-// NAPIGenericFailure + clearWeak
-NAPIExceptionStatus napi_delete_reference(NAPIEnv env, NAPIRef ref)
+// NAPIPendingException
+// SameValue 语义，不会调用 JS 代码
+NAPIExceptionStatus napi_strict_equals(NAPIEnv env, NAPIValue lhs, NAPIValue rhs, bool *result)
 {
 
     NAPI_PREAMBLE(env)
-    CHECK_ARG(ref, Exception)
+    CHECK_ARG(lhs, Exception)
+    CHECK_ARG(rhs, Exception)
+    CHECK_ARG(result, Exception)
 
-    // 标量 && 弱引用（被 GC 也会这样）
-    if (!JS_IsObject(ref->value) && !ref->referenceCount)
+    JSValue lhsValue = *((JSValue *)lhs);
+    JSValue rhsValue = *((JSValue *)rhs);
+    // int 和 float64 两种 tag 都是 number
+    if (JS_IsNumber(lhsValue) && JS_IsNumber(rhsValue))
     {
-        LIST_REMOVE(ref, node);
-        free(ref);
+        double lhsDouble, rhsDouble;
+        JS_ToFloat64(env->context, &lhsDouble, lhsValue);
+        JS_ToFloat64(env->context, &rhsDouble, rhsValue);
+        if (isnan(lhsDouble) || isnan(rhsDouble))
+        {
+            *result = isnan(lhsDouble) && isnan(rhsDouble);
+        }
+        else
+        {
+            *result = lhsDouble == rhsDouble && signbit(lhsDouble) == signbit(rhsDouble);
+        }
 
         return NAPIExceptionOK;
     }
-    // 对象 || 强引用
-    if (ref->referenceCount)
+    int tag = JS_VALUE_GET_NORM_TAG(lhsValue);
+    if (tag != JS_VALUE_GET_NORM_TAG(rhsValue))
     {
-        LIST_REMOVE(ref, node);
-        JS_FreeValue(env->context, ref->value);
-        free(ref);
+        *result = false;
 
         return NAPIExceptionOK;
     }
-    // 对象 && 弱引用
-    CHECK_NAPI(clearWeak(env, ref), Exception, Exception)
-    free(ref);
+    switch (tag)
+    {
+    case JS_TAG_UNDEFINED:
+    case JS_TAG_NULL:
+        *result = true;
+        break;
+    case JS_TAG_BOOL:
+        *result = JS_VALUE_GET_BOOL(lhsValue) == JS_VALUE_GET_BOOL(rhsValue);
+        break;
+    case JS_TAG_STRING:
+    case JS_TAG_BIG_INT:
+    case JS_TAG_BIG_FLOAT:
+    case JS_TAG_BIG_DECIMAL:
+        // 直接比较内部存储，不转换为 UTF-8，也不会抛出异常
+        *result = JS_StrictEqPrimitive(lhsValue, rhsValue);
+        break;
+    default:
+        // object/symbol 比较指针
+        *result = JS_VALUE_GET_PTR(lhsValue) == JS_VALUE_GET_PTR(rhsValue);
+        break;
+    }
 
     return NAPIExceptionOK;
 }
 
-// NAPIGenericFailure + clearWeak
-NAPIExceptionStatus napi_reference_ref(NAPIEnv env, NAPIRef ref, uint32_t *result)
+NAPICommonStatus napi_get_cb_info(NAPIEnv env, NAPICallbackInfo callbackInfo, size_t *argc, NAPIValue *argv,
+                                  NAPIValue *thisArg, void **data)
 {
 
-    NAPI_PREAMBLE(env)
-    CHECK_ARG(ref, Exception)
+    CHECK_ARG(env, Common)
+    CHECK_ARG(callbackInfo, Common)
 
-    if (!ref->referenceCount)
+    if (argv)
     {
-        // 弱引用
-        JSValue value = JS_DupValue(env->context, ref->value);
-        if (JS_IsObject(ref->value))
+        CHECK_ARG(argc, Common)
+        size_t i = 0;
+        size_t min = callbackInfo->argc < 0 || *argc > (size_t)callbackInfo->argc ? callbackInfo->argc : *argc;
+        for (; i < min; ++i)
         {
-            CHECK_NAPI(clearWeak(env, ref), Exception, Exception)
+            argv[i] = (NAPIValue)&callbackInfo->argv[i];
         }
-        else
+        if (i < *argc)
         {
-            LIST_REMOVE(ref, node);
+            for (; i < *argc; ++i)
+            {
+                argv[i] = (NAPIValue)&undefinedValue;
+            }
         }
-        LIST_INSERT_HEAD(&env->strongRefList, ref, node);
-        ref->value = value;
     }
-    uint8_t count = ++ref->referenceCount;
-    if (result)
+    if (argc)
     {
-        *result = count;
+        *argc = callbackInfo->argc;
+    }
+    if (thisArg)
+    {
+        *thisArg = (NAPIValue)&callbackInfo->thisArg;
+    }
+    if (data)
+    {
+        *data = callbackInfo->data;
     }
 
-    return NAPIExceptionOK;
+    return NAPICommonOK;
 }
 
-// NAPIGenericFailure + setWeak
-NAPIExceptionStatus napi_reference_unref(NAPIEnv env, NAPIRef ref, uint32_t *result)
+NAPICommonStatus napi_get_new_target(NAPIEnv env, NAPICallbackInfo callbackInfo, NAPIValue *result)
 {
 
-    NAPI_PREAMBLE(env)
-    CHECK_ARG(ref, Exception)
-
-    RETURN_STATUS_IF_FALSE(ref->referenceCount, NAPIExceptionGenericFailure)
+    CHECK_ARG(env, Common)
+    CHECK_ARG(callbackInfo, Common)
+    CHECK_ARG(result, Common)
 
-    if (ref->referenceCount == 1)
+    if (!JS_IsUndefined(callbackInfo->newTarget))
     {
-        LIST_REMOVE(ref, node);
-        if (JS_IsObject(ref->value))
-        {
-            CHECK_NAPI(setWeak(env, (NAPIValue)&ref->value, ref), Exception, Exception)
-            JS_FreeValue(env->context, ref->value);
-        }
-        else
-        {
-            LIST_INSERT_HEAD(&env->valueList, ref, node);
-            JS_FreeValue(env->context, ref->value);
-            ref->value = undefinedValue;
-        }
+        *result = (NAPIValue)&callbackInfo->newTarget;
     }
-    uint8_t count = --ref->referenceCount;
-    if (result)
+    else
     {
-        *result = count;
+        *result = NULL;
     }
 
-    return NAPIExceptionOK;
+    return NAPICommonOK;
 }
 
-NAPIExceptionStatus napi_get_reference_value(NAPIEnv env, NAPIRef ref, NAPIValue *result)
+typedef struct
+{
+    void *data;                    // size_t
+    void *finalizeHint;            // size_t
+    NAPIFinalize finalizeCallback; // size_t
+} ExternalInfo;
+
+// NAPIMemoryError/NAPIPendingException + addValueToHandleScope
+NAPIExceptionStatus napi_create_external(NAPIEnv env, void *data, NAPIFinalize finalizeCB, void *finalizeHint,
+                                         NAPIValue *result)
 {
 
-    CHECK_ARG(env, Exception)
-    CHECK_ARG(ref, Exception)
+    NAPI_PREAMBLE(env)
     CHECK_ARG(result, Exception)
 
-    if (!ref->referenceCount && JS_IsUndefined(ref->value))
+    ExternalInfo *externalInfo = malloc(sizeof(ExternalInfo));
+    RETURN_STATUS_IF_FALSE(externalInfo, NAPIExceptionMemoryError)
+    externalInfo->data = data;
+    externalInfo->finalizeHint = finalizeHint;
+    externalInfo->finalizeCallback = NULL;
+    if (__builtin_expect(!env->runtime->externalClassId, false))
     {
-        *result = NULL;
+        assert(false && "externalClassId must not be 0.");
+        free(externalInfo);
+
+        return NAPIExceptionGenericFailure;
     }
-    else
+    JSValue object = JS_NewObjectClass(env->context, (int)env->runtime->externalClassId);
+    if (__builtin_expect(JS_IsException(object), false))
     {
-        JSValue strongValue = JS_DupValue(env->context, ref->value);
-        struct Handle *handleScope;
-        NAPIErrorStatus errorStatus = addValueToHandleScope(env, strongValue, &handleScope);
-        if (__builtin_expect(errorStatus != NAPIErrorOK, false))
-        {
-            JS_FreeValue(env->context, strongValue);
+        free(externalInfo);
 
-            return NAPIExceptionHandleScopeEmpty;
-        }
-        *result = (NAPIValue)&handleScope->value;
+        return NAPIExceptionPendingException;
+    }
+    JS_SetOpaque(object, externalInfo);
+    ++env->runtime->externalCount;
+    JSValue *handle;
+    NAPIErrorStatus status = addValueToHandleScope(env, object, &handle);
+    if (__builtin_expect(status != NAPIErrorOK, false))
+    {
+        JS_FreeValue(env->context, object);
+
+        return (NAPIExceptionStatus)status;
     }
+    *result = (NAPIValue)handle;
+    // 不能先设置回调，万一出错，业务方也会收到回调
+    externalInfo->finalizeCallback = finalizeCB;
 
     return NAPIExceptionOK;
 }
 
-// NAPIMemoryError
-NAPIErrorStatus napi_open_handle_scope(NAPIEnv env, NAPIHandleScope *result)
+NAPIErrorStatus napi_get_value_external(NAPIEnv env, NAPIValue value, void **result)
 {
 
     CHECK_ARG(env, Error)
+    CHECK_ARG(value, Error)
     CHECK_ARG(result, Error)
 
-    NAPIHandleScope handleScope = malloc(sizeof(struct OpaqueNAPIHandleScope));
-    RETURN_STATUS_IF_FALSE(handleScope, NAPIErrorMemoryError)
-    *result = handleScope;
-    SLIST_INIT(&(*result)->handleList);
-    LIST_INSERT_HEAD(&env->handleScopeList, *result, node);
+    if (__builtin_expect(!env->runtime->externalClassId, false))
+    {
+        assert(false && "externalClassId must not be 0.");
+
+        return NAPIErrorGenericFailure;
+    }
+    ExternalInfo *externalInfo = JS_GetOpaque(*((JSValue *)value), env->runtime->externalClassId);
+    *result = externalInfo ? externalInfo->data : NULL;
 
     return NAPIErrorOK;
 }
 
-NAPICommonStatus napi_close_handle_scope(NAPIEnv env, NAPIHandleScope scope)
+// NAPIPendingException + addValueToHandleScope
+NAPIExceptionStatus napi_create_arraybuffer(NAPIEnv env, size_t byteLength, void **data, NAPIValue *result)
 {
 
-    CHECK_ARG(env, Common)
-    CHECK_ARG(scope, Common)
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(result, Exception)
 
-    // 先入后出 stack 规则
-    assert(LIST_FIRST(&env->handleScopeList) == scope &&
-           "napi_close_handle_scope() or napi_close_escapable_handle_scope() should follow FILO rule.");
-    struct Handle *handle, *tempHandle;
-    SLIST_FOREACH_SAFE(handle, &scope->handleList, node, tempHandle)
+    // buf 传入 NULL 会分配并初始化为 0
+    JSValue arrayBufferValue = JS_NewArrayBufferCopy(env->context, NULL, byteLength);
+    RETURN_STATUS_IF_FALSE(!JS_IsException(arrayBufferValue), NAPIExceptionPendingException)
+    JSValue *handle;
+    NAPIErrorStatus status = addValueToHandleScope(env, arrayBufferValue, &handle);
+    if (__builtin_expect(status != NAPIErrorOK, false))
     {
-        JS_FreeValue(env->context, handle->value);
-        free(handle);
+        JS_FreeValue(env->context, arrayBufferValue);
+
+        return (NAPIExceptionStatus)status;
     }
-    // 这里和前面的 assert 要求 env->handleScopeList 必须是 LIST 双向链表
-    LIST_REMOVE(scope, node);
-    free(scope);
+    if (data)
+    {
+        size_t size;
+        *data = JS_GetArrayBuffer(env->context, &size, arrayBufferValue);
+    }
+    *result = (NAPIValue)handle;
 
-    return NAPICommonOK;
+    return NAPIExceptionOK;
 }
 
-struct OpaqueNAPIEscapableHandleScope
+static void arrayBufferFinalize(__attribute__((unused)) JSRuntime *rt, void *opaque, void *ptr)
 {
-    struct OpaqueNAPIHandleScope handleScope;
-    bool escapeCalled;
-};
+    ExternalInfo *externalInfo = opaque;
+    if (externalInfo->finalizeCallback)
+    {
+        externalInfo->finalizeCallback(ptr, externalInfo->finalizeHint);
+    }
+    free(externalInfo);
+}
 
-// NAPIMemoryError
-NAPIErrorStatus napi_open_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandleScope *result)
+// NAPIMemoryError/NAPIPendingException + addValueToHandleScope
+NAPIExceptionStatus napi_create_external_arraybuffer(NAPIEnv env, void *externalData, size_t byteLength,
+                                                     NAPIFinalize finalizeCB, void *finalizeHint, NAPIValue *result,
+                                                     bool *copied)
 {
 
-    CHECK_ARG(env, Error)
-    CHECK_ARG(result, Error)
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(result, Exception)
 
-    // 万一前面的 handleScope 被 close 了，会导致当前 EscapableHandleScope 变成最上层
-    // handleScope，这里的判断就没有意义了
-    //    RETURN_STATUS_IF_FALSE(LIST_FIRST(&env->handleScopeList), NAPIHandleScopeMismatch);
-    *result = malloc(sizeof(struct OpaqueNAPIEscapableHandleScope));
-    RETURN_STATUS_IF_FALSE(*result, NAPIErrorMemoryError)
-    (*result)->escapeCalled = false;
-    SLIST_INIT(&(*result)->handleScope.handleList);
-    LIST_INSERT_HEAD(&env->handleScopeList, &(*result)->handleScope, node);
+    ExternalInfo *externalInfo = malloc(sizeof(ExternalInfo));
+    RETURN_STATUS_IF_FALSE(externalInfo, NAPIExceptionMemoryError)
+    externalInfo->data = externalData;
+    externalInfo->finalizeHint = finalizeHint;
+    externalInfo->finalizeCallback = NULL;
+    JSValue arrayBufferValue =
+        JS_NewArrayBuffer(env->context, externalData, byteLength, arrayBufferFinalize, externalInfo, false);
+    if (__builtin_expect(JS_IsException(arrayBufferValue), false))
+    {
+        free(externalInfo);
 
-    return NAPIErrorOK;
-}
+        return NAPIExceptionPendingException;
+    }
+    JSValue *handle;
+    NAPIErrorStatus status = addValueToHandleScope(env, arrayBufferValue, &handle);
+    if (__builtin_expect(status != NAPIErrorOK, false))
+    {
+        // 会触发 arrayBufferFinalize 释放 externalInfo
+        JS_FreeValue(env->context, arrayBufferValue);
 
-NAPICommonStatus napi_close_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandleScope scope)
-{
-    return napi_close_handle_scope(env, (NAPIHandleScope)scope);
+        return (NAPIExceptionStatus)status;
+    }
+    *result = (NAPIValue)handle;
+    // 不能先设置回调，万一出错，业务方也会收到回调
+    externalInfo->finalizeCallback = finalizeCB;
+    if (copied)
+    {
+        *copied = false;
+    }
+
+    return NAPIExceptionOK;
 }
 
-// NAPIMemoryError/NAPIEscapeCalledTwice/NAPIHandleScopeEmpty
-NAPIErrorStatus napi_escape_handle(NAPIEnv env, NAPIEscapableHandleScope scope, NAPIValue escapee, NAPIValue *result)
+NAPICommonStatus napi_is_arraybuffer(NAPIEnv env, NAPIValue value, bool *result)
 {
 
-    CHECK_ARG(env, Error)
-    CHECK_ARG(scope, Error)
-    CHECK_ARG(escapee, Error)
-    CHECK_ARG(result, Error)
-
-    RETURN_STATUS_IF_FALSE(!scope->escapeCalled, NAPIErrorEscapeCalledTwice)
+    CHECK_ARG(env, Common)
+    CHECK_ARG(value, Common)
+    CHECK_ARG(result, Common)
 
-    NAPIHandleScope handleScope = LIST_NEXT(&scope->handleScope, node);
-    RETURN_STATUS_IF_FALSE(handleScope, NAPIErrorHandleScopeEmpty)
-    struct Handle *handle = malloc(sizeof(struct Handle));
-    RETURN_STATUS_IF_FALSE(handle, NAPIErrorMemoryError)
-    scope->escapeCalled = true;
-    handle->value = JS_DupValue(env->context, *((JSValue *)escapee));
-    SLIST_INSERT_HEAD(&handleScope->handleList, handle, node);
-    *result = (NAPIValue)&handle->value;
+    size_t byteLength;
+    // JS_PeekArrayBuffer 来自 quickjs_patch.diff，只检查 class，不会抛出异常，也不会清除已有的异常
+    // 分离后的 ArrayBuffer 也会返回 false
+    *result = JS_PeekArrayBuffer(&byteLength, *((JSValue *)value));
 
-    return NAPIErrorOK;
+    return NAPICommonOK;
 }
 
-NAPIExceptionStatus napi_throw(NAPIEnv env, NAPIValue error)
+NAPIErrorStatus napi_get_arraybuffer_info(NAPIEnv env, NAPIValue arraybuffer, void **data, size_t *byteLength)
 {
 
-    NAPI_PREAMBLE(env)
-    CHECK_ARG(error, Exception)
+    CHECK_ARG(env, Error)
+    CHECK_ARG(arraybuffer, Error)
 
-    if (!JS_IsNull(*((JSValue *)error)))
+    size_t size;
+    uint8_t *arrayBufferData = JS_PeekArrayBuffer(&size, *((JSValue *)arraybuffer));
+    RETURN_STATUS_IF_FALSE(arrayBufferData, NAPIErrorInvalidArg)
+    if (data)
     {
-        JS_Throw(env->context, JS_DupValue(env->context, *((JSValue *)error)));
+        *data = arrayBufferData;
     }
-    else
+    if (byteLength)
     {
-        env->isThrowNull = true;
+        *byteLength = size;
     }
 
-    return NAPIExceptionOK;
+    return NAPIErrorOK;
 }
 
-// + addValueToHandleScope
-NAPIErrorStatus napi_get_and_clear_last_exception(NAPIEnv env, NAPIValue *result)
-{
+static const uint8_t typedArrayElementSizes[] = {1, 1, 1, 2, 2, 4, 4, 4, 8};
 
-    // 这里不能用 NAPI_PREAMBLE(env)
-    CHECK_ARG(env, Error)
-    CHECK_ARG(result, Error)
+static const char *const typedArrayNames[] = {"Int8Array",   "Uint8Array",   "Uint8ClampedArray",
+                                              "Int16Array",  "Uint16Array",  "Int32Array",
+                                              "Uint32Array", "Float32Array", "Float64Array"};
 
-    // JS_GetException
-    CHECK_ARG(env->context, Error)
+// NAPIPendingException + addValueToHandleScope
+NAPIExceptionStatus napi_create_typedarray(NAPIEnv env, NAPITypedArrayType type, size_t length, NAPIValue arraybuffer,
+                                           size_t byteOffset, NAPIValue *result)
+{
 
-    JSValue exceptionValue = JS_GetException(env->context);
-    if (JS_IsNull(exceptionValue) && !env->isThrowNull)
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(arraybuffer, Exception)
+    CHECK_ARG(result, Exception)
+    RETURN_STATUS_IF_FALSE(type >= NAPIInt8Array && type <= NAPIFloat64Array, NAPIExceptionInvalidArg)
+
+    size_t byteLength;
+    RETURN_STATUS_IF_FALSE(JS_PeekArrayBuffer(&byteLength, *((JSValue *)arraybuffer)), NAPIExceptionInvalidArg)
+    size_t elementSize = typedArrayElementSizes[type];
+    if (byteOffset % elementSize)
     {
-        *result = (NAPIValue)&undefinedValue;
+        JS_ThrowRangeError(env->context, "start offset of %s should be a multiple of %zu", typedArrayNames[type],
+                           elementSize);
 
-        return NAPIErrorOK;
+        return NAPIExceptionPendingException;
     }
-    if (env->isThrowNull)
+    if (byteOffset > byteLength || length > (byteLength - byteOffset) / elementSize)
     {
-        env->isThrowNull = false;
-        *result = (NAPIValue)&nullValue;
+        JS_ThrowRangeError(env->context, "invalid typed array length");
 
-        return NAPIErrorOK;
+        return NAPIExceptionPendingException;
     }
-    struct Handle *exceptionHandle;
-    NAPIErrorStatus status = addValueToHandleScope(env, exceptionValue, &exceptionHandle);
+    // 使用原始构造函数，不受 JS 修改全局对象影响
+    JSValue typedArrayValue =
+        JS_NewTypedArray(env->context, (JSTypedArrayEnum)type, *((JSValue *)arraybuffer), byteOffset, length);
+    RETURN_STATUS_IF_FALSE(!JS_IsException(typedArrayValue), NAPIExceptionPendingException)
+    JSValue *handle;
+    NAPIErrorStatus status = addValueToHandleScope(env, typedArrayValue, &handle);
     if (__builtin_expect(status != NAPIErrorOK, false))
     {
-        JS_Throw(env->context, exceptionValue);
+        JS_FreeValue(env->context, typedArrayValue);
 
-        return status;
+        return (NAPIExceptionStatus)status;
     }
-    *result = (NAPIValue)&exceptionHandle->value;
+    *result = (NAPIValue)handle;
 
-    return NAPIErrorOK;
+    return NAPIExceptionOK;
 }
 
-NAPICommonStatus NAPIClearLastException(NAPIEnv env)
+NAPICommonStatus napi_is_typedarray(NAPIEnv env, NAPIValue value, bool *result)
 {
 
-    // 这里不能用 NAPI_PREAMBLE(env)
     CHECK_ARG(env, Common)
+    CHECK_ARG(value, Common)
+    CHECK_ARG(result, Common)
 
-    JS_FreeValue(env->context, JS_GetException(env->context));
+    *result = JS_GetTypedArrayType(*((JSValue *)value)) >= 0;
 
     return NAPICommonOK;
 }
 
-// NAPIPendingException + addValueToHandleScope
-NAPIExceptionStatus NAPIRunScript(NAPIEnv env, const char *script, const char *sourceUrl, NAPIValue *result)
+// NAPIInvalidArg + addValueToHandleScope
+NAPIErrorStatus napi_get_typedarray_info(NAPIEnv env, NAPIValue typedarray, NAPITypedArrayType *type, size_t *length,
+                                         void **data, NAPIValue *arraybuffer, size_t *byteOffset)
 {
 
-    NAPI_PREAMBLE(env)
+    CHECK_ARG(env, Error)
+    CHECK_ARG(typedarray, Error)
 
-    // script 传入 NULL 会崩
-    if (!script)
+    int typedArrayType = JS_GetTypedArrayType(*((JSValue *)typedarray));
+    RETURN_STATUS_IF_FALSE(typedArrayType >= 0, NAPIErrorInvalidArg)
+    // 已经分离时会抛出异常，不能覆盖调用前已经存在的异常
+    JSValue exceptionValue = JS_GetException(env->context);
+    size_t offset, byteLength, elementSize;
+    JSValue arrayBufferValue =
+        JS_GetTypedArrayBuffer(env->context, *((JSValue *)typedarray), &offset, &byteLength, &elementSize);
+    if (JS_IsException(arrayBufferValue))
     {
-        script = "";
+        JS_FreeValue(env->context, JS_GetException(env->context));
     }
-    // utf8SourceUrl 传入 NULL 会导致崩溃，JS_NewAtom 调用 strlen，因此不能传入 NULL
-    if (!sourceUrl)
+    if (!JS_IsNull(exceptionValue))
     {
-        sourceUrl = "";
+        JS_Throw(env->context, exceptionValue);
     }
-    JSValue returnValue = JS_Eval(env->context, script, strlen(script), sourceUrl, JS_EVAL_TYPE_GLOBAL);
-    if (JS_IsException(returnValue))
+    RETURN_STATUS_IF_FALSE(!JS_IsException(arrayBufferValue), NAPIErrorInvalidArg)
+    if (data)
     {
-        JSValue exceptionValue = JS_GetException(env->context);
-        processPendingTask(env);
-        if (JS_IsNull(exceptionValue))
-        {
-            env->isThrowNull = true;
-        }
-        else
-        {
-            JS_Throw(env->context, exceptionValue);
-        }
-
-        return NAPIExceptionPendingException;
+        size_t size;
+        uint8_t *arrayBufferData = JS_PeekArrayBuffer(&size, arrayBufferValue);
+        // 分离后 data 为 NULL
+        *data = arrayBufferData ? arrayBufferData + offset : NULL;
     }
-    processPendingTask(env);
-    if (result)
+    if (arraybuffer)
     {
-        struct Handle *returnHandle;
-        NAPIErrorStatus status = addValueToHandleScope(env, returnValue, &returnHandle);
+        JSValue *handle;
+        NAPIErrorStatus status = addValueToHandleScope(env, arrayBufferValue, &handle);
         if (__builtin_expect(status != NAPIErrorOK, false))
         {
-            JS_FreeValue(env->context, returnValue);
+            JS_FreeValue(env->context, arrayBufferValue);
 
-            return (NAPIExceptionStatus)status;
+            return status;
         }
-        *result = (NAPIValue)&returnHandle->value;
+        *arraybuffer = (NAPIValue)handle;
     }
     else
     {
-        JS_FreeValue(env->context, returnValue);
+        JS_FreeValue(env->context, arrayBufferValue);
+    }
+    if (type)
+    {
+        *type = (NAPITypedArrayType)typedArrayType;
+    }
+    if (length)
+    {
+        *length = byteLength / elementSize;
+    }
+    if (byteOffset)
+    {
+        *byteOffset = offset;
     }
 
-    return NAPIExceptionOK;
+    return NAPIErrorOK;
 }
 
-static void functionFinalizer(JSRuntime *rt, JSValue val)
+// static uint8_t contextCount = 0;
+
+static void referenceFinalize(void *finalizeData, void *finalizeHint)
 {
-    NAPIRuntime runtime = JS_GetRuntimeOpaque(rt);
-    if (__builtin_expect(!runtime->functionClassId, false))
+    // finalizeHint => env 不可靠
+    if (!finalizeData)
     {
-        assert(false && FUNCTION_CLASS_ID_ZERO);
+        assert(false);
 
         return;
     }
-    FunctionInfo *functionInfo = JS_GetOpaque(val, runtime->functionClassId);
-    free(functionInfo);
+    struct WeakReference *referenceInfo = finalizeData;
+    // isEnvFreed 需要存在，因为有三种情况
+    // 1. env 被析构
+    // 2. env 还在，也有 referenceInfo，但是没有 weakRef
+    // 3. env 还在，也有 referenceInfo，也有 weakRef
+    if (!referenceInfo->isEnvFreed)
+    {
+        NAPIRef reference, temp;
+        LIST_FOREACH_SAFE(reference, &referenceInfo->weakRefList, node, temp)
+        {
+            // 如果进入循环，说明 env 是有效的
+            assert(!reference->referenceCount);
+            reference->value = undefinedValue;
+            LIST_REMOVE(reference, node);
+            // 所以这里 finalizeHint 还是有效的 env
+            LIST_INSERT_HEAD(&((NAPIEnv)finalizeHint)->valueList, reference, node);
+        }
+        // 当前不是 last GC
+        // LIST_REMOVE 会影响 env 结构体
+        LIST_REMOVE(referenceInfo, node);
+    }
+
+    free(referenceInfo);
 }
 
-static void externalFinalizer(JSRuntime *rt, JSValue val)
+// NAPINameExpected/NAPIMemoryError/NAPIGenericFailure + napi_create_string_utf8 + napi_get_property + napi_typeof +
+// napi_create_external
+// + napi_get_value_external + napi_set_property
+static NAPIExceptionStatus setWeak(NAPIEnv env, NAPIValue value, NAPIRef ref)
 {
-    NAPIRuntime runtime = JS_GetRuntimeOpaque(rt);
-    if (__builtin_expect(!runtime->externalClassId, false))
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(value, Exception)
+    CHECK_ARG(ref, Exception)
+
+    RETURN_STATUS_IF_FALSE(JS_IsSymbol(env->referenceSymbolValue), NAPIExceptionNameExpected)
+
+    // TODO(ChasonTang): napi_open_handle_scope()
+
+    NAPIValue referenceValue;
+    CHECK_NAPI(napi_get_property(env, value, (NAPIValue)&env->referenceSymbolValue, &referenceValue), Exception,
+               Exception)
+    NAPIValueType valueType;
+    CHECK_NAPI(napi_typeof(env, referenceValue, &valueType), Common, Exception)
+    RETURN_STATUS_IF_FALSE(valueType == NAPIUndefined || valueType == NAPIExternal, NAPIExceptionGenericFailure)
+    struct WeakReference *referenceInfo;
+    if (valueType == NAPIUndefined)
     {
-        assert(false && FUNCTION_CLASS_ID_ZERO);
+        referenceInfo = malloc(sizeof(struct WeakReference));
+        RETURN_STATUS_IF_FALSE(referenceInfo, NAPIExceptionMemoryError)
+        referenceInfo->isEnvFreed = false;
+        LIST_INIT(&referenceInfo->weakRefList);
+        {
+            NAPIExceptionStatus status =
+                napi_create_external(env, referenceInfo, referenceFinalize, env, &referenceValue);
+            if (__builtin_expect(status != NAPIExceptionOK, false))
+            {
+                free(referenceInfo);
 
-        return;
+                return status;
+            }
+        }
+        CHECK_NAPI(napi_set_property(env, value, (NAPIValue)&env->referenceSymbolValue, referenceValue), Exception,
+                   Exception)
+        LIST_INSERT_HEAD(&env->weakReferenceList, referenceInfo, node);
     }
-    ExternalInfo *externalInfo = JS_GetOpaque(val, runtime->externalClassId);
-    if (externalInfo && externalInfo->finalizeCallback)
+    else
     {
-        externalInfo->finalizeCallback(externalInfo->data, externalInfo->finalizeHint);
+        CHECK_NAPI(napi_get_value_external(env, referenceValue, (void **)&referenceInfo), Error, Exception)
+        if (__builtin_expect(!referenceInfo, false))
+        {
+            assert(false);
+
+            return NAPIExceptionGenericFailure;
+        }
     }
-    free(externalInfo);
+    LIST_INSERT_HEAD(&referenceInfo->weakRefList, ref, node);
+
+    return NAPIExceptionOK;
 }
 
-// static JSRuntime *runtime = NULL;
+// NAPIMemoryError + setWeak
+NAPIExceptionStatus napi_create_reference(NAPIEnv env, NAPIValue value, uint32_t initialRefCount, NAPIRef *result)
+{
 
-typedef struct
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(value, Exception)
+    CHECK_ARG(result, Exception)
+
+    *result = malloc(sizeof(struct OpaqueNAPIRef));
+    RETURN_STATUS_IF_FALSE(*result, NAPIExceptionMemoryError)
+    // 标量 && 弱引用
+    if (!JS_IsObject(*((JSValue *)value)) && !initialRefCount)
+    {
+        (*result)->referenceCount = 0;
+        (*result)->value = undefinedValue;
+        LIST_INSERT_HEAD(&env->valueList, *result, node);
+
+        return NAPIExceptionOK;
+    }
+    // 对象 || 强引用
+    (*result)->value = *((JSValue *)value);
+    (*result)->referenceCount = initialRefCount;
+    // 强引用
+    if (initialRefCount)
+    {
+        (*result)->value = JS_DupValue(env->context, (*result)->value);
+        LIST_INSERT_HEAD(&env->strongRefList, *result, node);
+
+        return NAPIExceptionOK;
+    }
+    // 对象 && 弱引用
+    // setWeak
+    NAPIExceptionStatus status = setWeak(env, value, *result);
+    if (__builtin_expect(status != NAPIExceptionOK, false))
+    {
+        free(*result);
+
+        return status;
+    }
+
+    return NAPIExceptionOK;
+}
+
+// NAPINameExpected/NAPIGenericFailure + napi_create_string_utf8 + napi_get_property + napi_get_value_external +
+// napi_delete_property
+static NAPIExceptionStatus clearWeak(NAPIEnv env, NAPIRef ref)
 {
-    FunctionInfo functionInfo;
-    JSClassID classId; // uint32_t
-} ConstructorInfo;
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(ref, Exception)
 
-// static JSClassID constructorClassId = 0;
+    RETURN_STATUS_IF_FALSE(JS_IsSymbol(env->referenceSymbolValue), NAPIExceptionNameExpected)
+
+    // TODO(ChasonTang): napi_open_handle_scope()
+
+    NAPIValue externalValue;
+    CHECK_NAPI(napi_get_property(env, (NAPIValue)&ref->value, (NAPIValue)&env->referenceSymbolValue, &externalValue),
+               Exception, Exception)
+    struct WeakReference *referenceInfo;
+    CHECK_NAPI(napi_get_value_external(env, externalValue, (void **)&referenceInfo), Error, Exception)
+    if (__builtin_expect(!referenceInfo, false))
+    {
+        assert(false);
+
+        return NAPIExceptionGenericFailure;
+    }
+    bool needDelete = LIST_FIRST(&referenceInfo->weakRefList) == ref && !LIST_NEXT(ref, node);
+    LIST_REMOVE(ref, node);
+    if (needDelete)
+    {
+        bool deleteResult;
+        // 一定不会在这里触发 GC
+        CHECK_NAPI(
+            napi_delete_property(env, (NAPIValue)&ref->value, (NAPIValue)&env->referenceSymbolValue, &deleteResult),
+            Exception, Exception)
+        RETURN_STATUS_IF_FALSE(deleteResult, NAPIExceptionGenericFailure)
+    }
+
+    return NAPIExceptionOK;
+}
+
+// NAPIGenericFailure + clearWeak
+NAPIExceptionStatus napi_delete_reference(NAPIEnv env, NAPIRef ref)
+{
+
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(ref, Exception)
+
+    // 标量 && 弱引用（被 GC 也会这样）
+    if (!JS_IsObject(ref->value) && !ref->referenceCount)
+    {
+        LIST_REMOVE(ref, node);
+        free(ref);
+
+        return NAPIExceptionOK;
+    }
+    // 对象 || 强引用
+    if (ref->referenceCount)
+    {
+        LIST_REMOVE(ref, node);
+        JS_FreeValue(env->context, ref->value);
+        free(ref);
+
+        return NAPIExceptionOK;
+    }
+    // 对象 && 弱引用
+    CHECK_NAPI(clearWeak(env, ref), Exception, Exception)
+    free(ref);
+
+    return NAPIExceptionOK;
+}
+
+// NAPIGenericFailure + clearWeak
+NAPIExceptionStatus napi_reference_ref(NAPIEnv env, NAPIRef ref, uint32_t *result)
+{
+
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(ref, Exception)
+
+    if (!ref->referenceCount)
+    {
+        // 弱引用
+        JSValue value = JS_DupValue(env->context, ref->value);
+        if (JS_IsObject(ref->value))
+        {
+            CHECK_NAPI(clearWeak(env, ref), Exception, Exception)
+        }
+        else
+        {
+            LIST_REMOVE(ref, node);
+        }
+        LIST_INSERT_HEAD(&env->strongRefList, ref, node);
+        ref->value = value;
+    }
+    uint8_t count = ++ref->referenceCount;
+    if (result)
+    {
+        *result = count;
+    }
+
+    return NAPIExceptionOK;
+}
+
+// NAPIGenericFailure + setWeak
+NAPIExceptionStatus napi_reference_unref(NAPIEnv env, NAPIRef ref, uint32_t *result)
+{
+
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(ref, Exception)
+
+    RETURN_STATUS_IF_FALSE(ref->referenceCount, NAPIExceptionGenericFailure)
+
+    if (ref->referenceCount == 1)
+    {
+        LIST_REMOVE(ref, node);
+        if (JS_IsObject(ref->value))
+        {
+            CHECK_NAPI(setWeak(env, (NAPIValue)&ref->value, ref), Exception, Exception)
+            JS_FreeValue(env->context, ref->value);
+        }
+        else
+        {
+            LIST_INSERT_HEAD(&env->valueList, ref, node);
+            JS_FreeValue(env->context, ref->value);
+            ref->value = undefinedValue;
+        }
+    }
+    uint8_t count = --ref->referenceCount;
+    if (result)
+    {
+        *result = count;
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_get_reference_value(NAPIEnv env, NAPIRef ref, NAPIValue *result)
+{
+
+    CHECK_ARG(env, Exception)
+    CHECK_ARG(ref, Exception)
+    CHECK_ARG(result, Exception)
+
+    if (!ref->referenceCount && JS_IsUndefined(ref->value))
+    {
+        *result = NULL;
+    }
+    else
+    {
+        JSValue strongValue = JS_DupValue(env->context, ref->value);
+        JSValue *handle;
+        NAPIErrorStatus errorStatus = addValueToHandleScope(env, strongValue, &handle);
+        if (__builtin_expect(errorStatus != NAPIErrorOK, false))
+        {
+            JS_FreeValue(env->context, strongValue);
+
+            return NAPIExceptionHandleScopeEmpty;
+        }
+        *result = (NAPIValue)handle;
+    }
+
+    return NAPIExceptionOK;
+}
+
+// 优先从空闲链表中取，返回 NULL 代表内存分配失败
+static NAPIHandleScope acquireHandleScope(NAPIEnv env)
+{
+    NAPIHandleScope handleScope = LIST_FIRST(&env->freeHandleScopeList);
+    if (handleScope)
+    {
+        LIST_REMOVE(handleScope, node);
+
+        return handleScope;
+    }
+
+    return malloc(sizeof(struct OpaqueNAPIEscapableHandleScope));
+}
+
+// NAPIMemoryError
+NAPIErrorStatus napi_open_handle_scope(NAPIEnv env, NAPIHandleScope *result)
+{
+
+    CHECK_ARG(env, Error)
+    CHECK_ARG(result, Error)
+
+    NAPIHandleScope handleScope = acquireHandleScope(env);
+    RETURN_STATUS_IF_FALSE(handleScope, NAPIErrorMemoryError)
+    *result = handleScope;
+    (*result)->handleBlock = env->handleBlock;
+    (*result)->handleIndex = env->handleIndex;
+    LIST_INSERT_HEAD(&env->handleScopeList, *result, node);
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus napi_close_handle_scope(NAPIEnv env, NAPIHandleScope scope)
+{
+
+    CHECK_ARG(env, Common)
+    CHECK_ARG(scope, Common)
+
+    // 先入后出 stack 规则
+    assert(LIST_FIRST(&env->handleScopeList) == scope &&
+           "napi_close_handle_scope() or napi_close_escapable_handle_scope() should follow FILO rule.");
+    popHandlesToWatermark(env, scope->handleBlock, scope->handleIndex);
+    // 这里和前面的 assert 要求 env->handleScopeList 必须是 LIST 双向链表
+    LIST_REMOVE(scope, node);
+    LIST_INSERT_HEAD(&env->freeHandleScopeList, scope, node);
+
+    return NAPICommonOK;
+}
+
+// NAPIHandleScopeMismatch
+NAPIErrorStatus napi_reset_handle_scope(NAPIEnv env, NAPIHandleScope scope)
+{
+
+    CHECK_ARG(env, Error)
+    CHECK_ARG(scope, Error)
+
+    RETURN_STATUS_IF_FALSE(LIST_FIRST(&env->handleScopeList) == scope, NAPIErrorHandleScopeMismatch)
+    popHandlesToWatermark(env, scope->handleBlock, scope->handleIndex);
+
+    return NAPIErrorOK;
+}
+
+// NAPIMemoryError
+NAPIErrorStatus napi_open_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandleScope *result)
+{
+
+    CHECK_ARG(env, Error)
+    CHECK_ARG(result, Error)
+
+    // 万一前面的 handleScope 被 close 了，会导致当前 EscapableHandleScope 变成最上层
+    // handleScope，这里的判断就没有意义了
+    //    RETURN_STATUS_IF_FALSE(LIST_FIRST(&env->handleScopeList), NAPIHandleScopeMismatch);
+    NAPIEscapableHandleScope escapableHandleScope = (NAPIEscapableHandleScope)acquireHandleScope(env);
+    RETURN_STATUS_IF_FALSE(escapableHandleScope, NAPIErrorMemoryError)
+    escapableHandleScope->escapeSlot = NULL;
+    if (!LIST_EMPTY(&env->handleScopeList))
+    {
+        // 先占位 undefined，位置在水位线之下，属于上层 handleScope
+        NAPIErrorStatus status = addValueToHandleScope(env, undefinedValue, &escapableHandleScope->escapeSlot);
+        if (__builtin_expect(status != NAPIErrorOK, false))
+        {
+            LIST_INSERT_HEAD(&env->freeHandleScopeList, &escapableHandleScope->handleScope, node);
+
+            return status;
+        }
+    }
+    escapableHandleScope->escapeCalled = false;
+    escapableHandleScope->handleScope.handleBlock = env->handleBlock;
+    escapableHandleScope->handleScope.handleIndex = env->handleIndex;
+    LIST_INSERT_HEAD(&env->handleScopeList, &escapableHandleScope->handleScope, node);
+    *result = escapableHandleScope;
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus napi_close_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandleScope scope)
+{
+    return napi_close_handle_scope(env, (NAPIHandleScope)scope);
+}
+
+// NAPIEscapeCalledTwice/NAPIHandleScopeEmpty
+NAPIErrorStatus napi_escape_handle(NAPIEnv env, NAPIEscapableHandleScope scope, NAPIValue escapee, NAPIValue *result)
+{
+
+    CHECK_ARG(env, Error)
+    CHECK_ARG(scope, Error)
+    CHECK_ARG(escapee, Error)
+    CHECK_ARG(result, Error)
+
+    RETURN_STATUS_IF_FALSE(!scope->escapeCalled, NAPIErrorEscapeCalledTwice)
+    RETURN_STATUS_IF_FALSE(scope->escapeSlot, NAPIErrorHandleScopeEmpty)
+    scope->escapeCalled = true;
+    // 预留位置存放的是 undefined，直接覆盖即可
+    *scope->escapeSlot = JS_DupValue(env->context, *((JSValue *)escapee));
+    *result = (NAPIValue)scope->escapeSlot;
+
+    return NAPIErrorOK;
+}
+
+NAPIExceptionStatus napi_throw(NAPIEnv env, NAPIValue error)
+{
+
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(error, Exception)
+
+    if (!JS_IsNull(*((JSValue *)error)))
+    {
+        JS_Throw(env->context, JS_DupValue(env->context, *((JSValue *)error)));
+    }
+    else
+    {
+        env->isThrowNull = true;
+    }
+
+    return NAPIExceptionOK;
+}
+
+// + addValueToHandleScope
+NAPIErrorStatus napi_get_and_clear_last_exception(NAPIEnv env, NAPIValue *result)
+{
+
+    // 这里不能用 NAPI_PREAMBLE(env)
+    CHECK_ARG(env, Error)
+    CHECK_ARG(result, Error)
+
+    // JS_GetException
+    CHECK_ARG(env->context, Error)
+
+    JSValue exceptionValue = JS_GetException(env->context);
+    if (JS_IsNull(exceptionValue) && !env->isThrowNull)
+    {
+        *result = (NAPIValue)&undefinedValue;
+
+        return NAPIErrorOK;
+    }
+    if (env->isThrowNull)
+    {
+        env->isThrowNull = false;
+        *result = (NAPIValue)&nullValue;
+
+        return NAPIErrorOK;
+    }
+    JSValue *exceptionHandle;
+    NAPIErrorStatus status = addValueToHandleScope(env, exceptionValue, &exceptionHandle);
+    if (__builtin_expect(status != NAPIErrorOK, false))
+    {
+        JS_Throw(env->context, exceptionValue);
+
+        return status;
+    }
+    *result = (NAPIValue)exceptionHandle;
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus NAPIClearLastException(NAPIEnv env)
+{
+
+    // 这里不能用 NAPI_PREAMBLE(env)
+    CHECK_ARG(env, Common)
+
+    JS_FreeValue(env->context, JS_GetException(env->context));
+
+    return NAPICommonOK;
+}
+
+// NAPIPendingException + addValueToHandleScope
+NAPIExceptionStatus NAPIRunScript(NAPIEnv env, const char *script, const char *sourceUrl, NAPIValue *result)
+{
+
+    NAPI_PREAMBLE(env)
+
+    if (env->codeCache)
+    {
+        return NAPICodeCacheRunScript(env, env->codeCache, script, sourceUrl, result);
+    }
+
+    return NAPIRunScriptWithOptions(env, script, sourceUrl, NULL, result);
+}
+
+// QuickJS 始终优化并立即编译，忽略 optimize 和 eager
+// JS_EVAL_FLAG_STRIP 设置顶层函数的 strip 模式，内部函数继承，会同时剥离调试信息和源码
+// script 和 sourceUrl 不能为 NULL
+static JSValue evalScriptWithOptions(NAPIEnv env, const char *script, const char *sourceUrl,
+                                     const NAPIScriptOptions *options, int evalFlags)
+{
+    size_t scriptLength = strlen(script);
+    if (!options)
+    {
+        return JS_Eval(env->context, script, scriptLength, sourceUrl, evalFlags | JS_EVAL_TYPE_GLOBAL);
+    }
+    evalFlags |= options->module ? JS_EVAL_TYPE_MODULE : JS_EVAL_TYPE_GLOBAL;
+    if (options->strict)
+    {
+        evalFlags |= JS_EVAL_FLAG_STRICT;
+    }
+    if (options->stripDebugInfo || options->stripSource)
+    {
+        evalFlags |= JS_EVAL_FLAG_STRIP;
+    }
+
+    return JS_Eval(env->context, script, scriptLength, sourceUrl, evalFlags);
+}
+
+NAPIExceptionStatus NAPIRunScriptWithOptions(NAPIEnv env, const char *script, const char *sourceUrl,
+                                             const NAPIScriptOptions *options, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+
+    // script 传入 NULL 会崩
+    if (!script)
+    {
+        script = "";
+    }
+    // utf8SourceUrl 传入 NULL 会导致崩溃，JS_NewAtom 调用 strlen，因此不能传入 NULL
+    if (!sourceUrl)
+    {
+        sourceUrl = "";
+    }
+    JSValue returnValue = evalScriptWithOptions(env, script, sourceUrl, options, 0);
+    if (JS_IsException(returnValue))
+    {
+        JSValue exceptionValue = JS_GetException(env->context);
+        processPendingTask(env);
+        if (JS_IsNull(exceptionValue))
+        {
+            env->isThrowNull = true;
+        }
+        else
+        {
+            JS_Throw(env->context, exceptionValue);
+        }
+
+        return NAPIExceptionPendingException;
+    }
+    processPendingTask(env);
+    if (result)
+    {
+        JSValue *returnHandle;
+        NAPIErrorStatus status = addValueToHandleScope(env, returnValue, &returnHandle);
+        if (__builtin_expect(status != NAPIErrorOK, false))
+        {
+            JS_FreeValue(env->context, returnValue);
+
+            return (NAPIExceptionStatus)status;
+        }
+        *result = (NAPIValue)returnHandle;
+    }
+    else
+    {
+        JS_FreeValue(env->context, returnValue);
+    }
+
+    return NAPIExceptionOK;
+}
+
+// NAPIPendingException + addValueToHandleScope
+NAPIExceptionStatus NAPIParseUTF8JSONString(NAPIEnv env, const char *utf8String, NAPIValue *result)
+{
+
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(utf8String, Exception)
+    CHECK_ARG(result, Exception)
+
+    // JS_ParseJSON 要求 buf[buf_len] == '\0'
+    JSValue value = JS_ParseJSON(env->context, utf8String, strlen(utf8String), "<json>");
+    RETURN_STATUS_IF_FALSE(!JS_IsException(value), NAPIExceptionPendingException)
+    JSValue *handle;
+    NAPIErrorStatus status = addValueToHandleScope(env, value, &handle);
+    if (__builtin_expect(status != NAPIErrorOK, false))
+    {
+        JS_FreeValue(env->context, value);
+
+        return (NAPIExceptionStatus)status;
+    }
+    *result = (NAPIValue)handle;
+
+    return NAPIExceptionOK;
+}
+
+static void functionFinalizer(JSRuntime *rt, JSValue val)
+{
+    NAPIRuntime runtime = JS_GetRuntimeOpaque(rt);
+    if (__builtin_expect(!runtime->functionClassId, false))
+    {
+        assert(false && FUNCTION_CLASS_ID_ZERO);
+
+        return;
+    }
+    FunctionInfo *functionInfo = JS_GetOpaque(val, runtime->functionClassId);
+    free(functionInfo);
+}
+
+static void externalFinalizer(JSRuntime *rt, JSValue val)
+{
+    NAPIRuntime runtime = JS_GetRuntimeOpaque(rt);
+    if (__builtin_expect(!runtime->externalClassId, false))
+    {
+        assert(false && FUNCTION_CLASS_ID_ZERO);
+
+        return;
+    }
+    ExternalInfo *externalInfo = JS_GetOpaque(val, runtime->externalClassId);
+    if (externalInfo)
+    {
+        --runtime->externalCount;
+    }
+    if (externalInfo && externalInfo->finalizeCallback)
+    {
+        externalInfo->finalizeCallback(externalInfo->data, externalInfo->finalizeHint);
+    }
+    free(externalInfo);
+}
+
+// static JSRuntime *runtime = NULL;
+
+typedef struct
+{
+    FunctionInfo functionInfo;
+    JSClassID classId; // uint32_t
+} ConstructorInfo;
+
+// static JSClassID constructorClassId = 0;
+
+static void constructorFinalizer(JSRuntime *rt, JSValue val)
+{
+    NAPIRuntime runtime = JS_GetRuntimeOpaque(rt);
+    if (__builtin_expect(!runtime->constructorClassId, false))
+    {
+        assert(false && CONSTRUCTOR_CLASS_ID_ZERO);
+
+        return;
+    }
+    ConstructorInfo *constructorInfo = JS_GetOpaque(val, runtime->constructorClassId);
+    free(constructorInfo);
+}
+
+static JSValue callAsConstructor(JSContext *ctx, JSValueConst newTarget, int argc, JSValueConst *argv)
+{
+    JSRuntime *rt = JS_GetRuntime(ctx);
+    NAPIRuntime runtime = JS_GetRuntimeOpaque(rt);
+    JSValue prototypeValue = JS_GetPropertyStr(ctx, newTarget, "prototype");
+    if (JS_IsException(prototypeValue))
+    {
+        assert(false && "callAsConstructor() use JS_GetPropertyStr() to get 'prototype' raise a exception.");
+
+        return prototypeValue;
+    }
+    if (__builtin_expect(!runtime->constructorClassId, false))
+    {
+        assert(false && CONSTRUCTOR_CLASS_ID_ZERO);
+
+        return undefinedValue;
+    }
+    ConstructorInfo *constructorInfo = JS_GetOpaque(prototypeValue, runtime->constructorClassId);
+    JS_FreeValue(ctx, prototypeValue);
+    if (__builtin_expect(!constructorInfo || !constructorInfo->functionInfo.baseInfo.env ||
+                             !constructorInfo->functionInfo.callback || !constructorInfo->classId,
+                         false))
+    {
+        assert(false);
+
+        return undefinedValue;
+    }
+    JSValue thisValue = JS_NewObjectClass(ctx, (int)constructorInfo->classId);
+    if (__builtin_expect(JS_IsException(thisValue), false))
+    {
+        return thisValue;
+    }
+    struct OpaqueNAPICallbackInfo callbackInfo = {newTarget, thisValue, argv,
+                                                  constructorInfo->functionInfo.baseInfo.data, argc};
+    NAPIHandleScope handleScope = NULL;
+    {
+        NAPIErrorStatus status = napi_open_handle_scope(constructorInfo->functionInfo.baseInfo.env, &handleScope);
+        assert(status == NAPIErrorOK);
+        (void)status;
+    }
+    NAPIValue retVal =
+        constructorInfo->functionInfo.callback(constructorInfo->functionInfo.baseInfo.env, &callbackInfo);
+    if (retVal && JS_IsObject(*((JSValue *)retVal)))
+    {
+        JSValue returnValue = JS_DupValue(ctx, *((JSValue *)retVal));
+        JS_FreeValue(ctx, thisValue);
+        thisValue = returnValue;
+    }
+    if (handleScope)
+    {
+        NAPICommonStatus commonStatus =
+            napi_close_handle_scope(constructorInfo->functionInfo.baseInfo.env, handleScope);
+        if (__builtin_expect(commonStatus != NAPICommonOK, false))
+        {
+            JS_FreeValue(ctx, thisValue);
+            assert(false && NAPI_CLOSE_HANDLE_SCOPE_ERROR);
+
+            // TODO(ChasonTang): 验证 undefined 的情况
+            return undefinedValue;
+        }
+    }
+    // 异常处理
+    JSValue exceptionValue = JS_GetException(ctx);
+    if (!JS_IsNull(exceptionValue))
+    {
+        JS_FreeValue(ctx, thisValue);
+
+        return JS_Throw(ctx, exceptionValue);
+    }
+    if (constructorInfo->functionInfo.baseInfo.env->isThrowNull)
+    {
+        JS_FreeValue(ctx, thisValue);
+        constructorInfo->functionInfo.baseInfo.env->isThrowNull = false;
+
+        return JS_EXCEPTION;
+    }
+
+    return thisValue;
+}
+
+// NAPIMemoryError/NAPIPendingException + addValueToHandleScope
+// JS_NewClassID 读写进程级别的计数器，不同线程的 runtime 会同时调用
+static pthread_mutex_t classIdMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static JSClassID newClassId(void)
+{
+    // JS_NewClassID only accept 0.
+    JSClassID classId = 0;
+    pthread_mutex_lock(&classIdMutex);
+    JS_NewClassID(&classId);
+    pthread_mutex_unlock(&classIdMutex);
+
+    return classId;
+}
+
+NAPIExceptionStatus NAPIDefineClass(NAPIEnv env, const char *utf8name, NAPICallback constructor, void *data,
+                                    NAPIValue *result)
+{
+
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(constructor, Exception)
+    CHECK_ARG(result, Exception)
+
+    ConstructorInfo *constructorInfo = malloc(sizeof(ConstructorInfo));
+    RETURN_STATUS_IF_FALSE(constructorInfo, NAPIExceptionMemoryError)
+    constructorInfo->functionInfo.baseInfo.env = env;
+    constructorInfo->functionInfo.baseInfo.data = data;
+    constructorInfo->functionInfo.callback = constructor;
+    constructorInfo->classId = newClassId();
+    JSClassDef classDef = {utf8name ?: "", NULL, NULL, NULL, NULL};
+    int status = JS_NewClass(env->runtime->runtime, constructorInfo->classId, &classDef);
+    if (__builtin_expect(status == -1, false))
+    {
+        free(constructorInfo);
+
+        return NAPIExceptionPendingException;
+    }
+    if (__builtin_expect(!env->runtime->constructorClassId, false))
+    {
+        assert(false && CONSTRUCTOR_CLASS_ID_ZERO);
+
+        return NAPIExceptionGenericFailure;
+    }
+    JSValue prototype = JS_NewObjectClass(env->context, (int)env->runtime->constructorClassId);
+    if (__builtin_expect(JS_IsException(prototype), false))
+    {
+        free(constructorInfo);
+
+        return NAPIExceptionPendingException;
+    }
+    JS_SetOpaque(prototype, constructorInfo);
+    // JS_NewCFunction2 -> JS_NewCFunction3 会正确处理 utf8name 为空情况
+    JSValue constructorValue = JS_NewCFunction2(env->context, callAsConstructor, utf8name, 0, JS_CFUNC_constructor, 0);
+    if (__builtin_expect(JS_IsException(constructorValue), false))
+    {
+        // prototype 会自己 free ConstructorInfo 结构体
+        JS_FreeValue(env->context, prototype);
+
+        return NAPIExceptionPendingException;
+    }
+    JSValue *handle;
+    NAPIErrorStatus addStatus = addValueToHandleScope(env, constructorValue, &handle);
+    if (__builtin_expect(addStatus != NAPIErrorOK, false))
+    {
+        JS_FreeValue(env->context, constructorValue);
+        JS_FreeValue(env->context, prototype);
+
+        return status;
+    }
+    *result = (NAPIValue)handle;
+    // .prototype .constructor
+    // 会自动引用计数 +1
+    JS_SetConstructor(env->context, constructorValue, prototype);
+    // context -> class_proto
+    // 转移所有权
+    JS_SetClassProto(env->context, constructorInfo->classId, prototype);
+
+    return NAPIExceptionOK;
+}
+
+// 和 QuickJS 默认的 js_def_malloc 等函数一致，只是在 malloc_size 中额外计入 external 内存
+// QuickJS 在分配对象前根据 malloc_size 判断是否需要 GC，因此 external 内存会让 GC 提前发生
+// external 内存不在 QuickJS 堆中，不受 maxHeapSize 限制，因此使用单独的 mallocSize 检查 malloc_limit
+#if defined(__APPLE__)
+#define MALLOC_OVERHEAD 0
+#else
+#define MALLOC_OVERHEAD 8
+#endif
+
+static size_t getMallocUsableSize(const void *ptr)
+{
+#if defined(__APPLE__)
+    return malloc_size(ptr);
+#elif defined(__linux__)
+    return malloc_usable_size((void *)ptr);
+#else
+    return 0;
+#endif
+}
+
+// JS_NewRuntime2 创建期间使用的是栈上的 JSMallocState，因此不保存指针，而是在每次分配时计入
+static inline void applyExternalMemorySize(JSMallocState *mallocState)
+{
+    NAPIRuntime runtime = mallocState->opaque;
+    if (__builtin_expect(runtime->pendingExternalMemorySize != 0, false))
+    {
+        mallocState->malloc_size += runtime->pendingExternalMemorySize;
+        runtime->pendingExternalMemorySize = 0;
+    }
+}
+
+static void *napiMalloc(JSMallocState *mallocState, size_t size)
+{
+    applyExternalMemorySize(mallocState);
+    NAPIRuntime runtime = mallocState->opaque;
+    if (__builtin_expect(runtime->mallocSize + size > mallocState->malloc_limit, false))
+    {
+        return NULL;
+    }
+    void *ptr = malloc(size);
+    if (!ptr)
+    {
+        return NULL;
+    }
+    ++mallocState->malloc_count;
+    size_t usableSize = getMallocUsableSize(ptr) + MALLOC_OVERHEAD;
+    mallocState->malloc_size += usableSize;
+    runtime->mallocSize += usableSize;
+    runtime->allocatedSize += usableSize;
+
+    return ptr;
+}
+
+static void napiFree(JSMallocState *mallocState, void *ptr)
+{
+    if (!ptr)
+    {
+        return;
+    }
+    applyExternalMemorySize(mallocState);
+    --mallocState->malloc_count;
+    size_t usableSize = getMallocUsableSize(ptr) + MALLOC_OVERHEAD;
+    mallocState->malloc_size -= usableSize;
+    ((NAPIRuntime)mallocState->opaque)->mallocSize -= usableSize;
+    free(ptr);
+}
+
+static void *napiRealloc(JSMallocState *mallocState, void *ptr, size_t size)
+{
+    if (!ptr)
+    {
+        return size ? napiMalloc(mallocState, size) : NULL;
+    }
+    if (!size)
+    {
+        napiFree(mallocState, ptr);
+
+        return NULL;
+    }
+    applyExternalMemorySize(mallocState);
+    NAPIRuntime runtime = mallocState->opaque;
+    size_t oldSize = getMallocUsableSize(ptr);
+    if (__builtin_expect(runtime->mallocSize + size - oldSize > mallocState->malloc_limit, false))
+    {
+        return NULL;
+    }
+    ptr = realloc(ptr, size);
+    if (!ptr)
+    {
+        return NULL;
+    }
+    size_t newSize = getMallocUsableSize(ptr);
+    mallocState->malloc_size += newSize - oldSize;
+    runtime->mallocSize += newSize - oldSize;
+    if (newSize > oldSize)
+    {
+        runtime->allocatedSize += newSize - oldSize;
+    }
+
+    return ptr;
+}
+
+static const JSMallocFunctions mallocFunctions = {napiMalloc, napiFree, napiRealloc, getMallocUsableSize};
+
+// 内置的三个 class 对所有 runtime 相同，进程内只分配一次，避免 class_array 随 runtime 数量增长
+static pthread_once_t runtimeClassIdOnce = PTHREAD_ONCE_INIT;
+
+static JSClassID runtimeConstructorClassId;
+
+static JSClassID runtimeFunctionClassId;
+
+static JSClassID runtimeExternalClassId;
+
+static void newRuntimeClassIds(void)
+{
+    runtimeConstructorClassId = newClassId();
+    runtimeFunctionClassId = newClassId();
+    runtimeExternalClassId = newClassId();
+}
+
+static inline bool isRuntimeOptionsValid(const NAPIRuntimeOptions *options)
+{
+    return !options || (options->version && options->version <= NAPI_RUNTIME_OPTIONS_VERSION);
+}
+
+NAPIErrorStatus NAPICreateRuntime(NAPIRuntime *runtime)
+{
+    return NAPICreateRuntimeWithOptions(NULL, runtime);
+}
+
+NAPIErrorStatus NAPICreateRuntimeWithOptions(const NAPIRuntimeOptions *options, NAPIRuntime *runtime)
+{
+    CHECK_ARG(runtime, Error)
+    RETURN_STATUS_IF_FALSE(isRuntimeOptionsValid(options), NAPIErrorInvalidArg)
+
+    *runtime = malloc(sizeof(struct OpaqueNAPIRuntime));
+    RETURN_STATUS_IF_FALSE(*runtime, NAPIErrorMemoryError)
+    (*runtime)->externalCount = 0;
+    (*runtime)->pendingExternalMemorySize = 0;
+    (*runtime)->mallocSize = 0;
+    (*runtime)->allocatedSize = 0;
+    (*runtime)->lastGCAllocatedSize = 0;
+    (*runtime)->runtime = JS_NewRuntime2(&mallocFunctions, *runtime);
+    if (!(*runtime)->runtime)
+    {
+        free(*runtime);
+
+        return NAPIErrorMemoryError;
+    }
+    JS_SetRuntimeOpaque((*runtime)->runtime, *runtime);
+    JS_SetMaxStackSize((*runtime)->runtime,
+                       options && options->stackSize ? options->stackSize : 4 * JS_DEFAULT_STACK_SIZE);
+    if (options && options->maxHeapSize)
+    {
+        JS_SetMemoryLimit((*runtime)->runtime, options->maxHeapSize);
+    }
+    if (options && options->gcThreshold)
+    {
+        JS_SetGCThreshold((*runtime)->runtime, options->gcThreshold);
+    }
+    // 一定成功
+    pthread_once(&runtimeClassIdOnce, newRuntimeClassIds);
+    (*runtime)->constructorClassId = runtimeConstructorClassId;
+    (*runtime)->functionClassId = runtimeFunctionClassId;
+    (*runtime)->externalClassId = runtimeExternalClassId;
+    JSClassDef classDef = {"External", externalFinalizer, NULL, NULL, NULL};
+    // JS_NewClass -> JS_NewClass1 返回值只有 -1 和 0
+    int status = JS_NewClass((*runtime)->runtime, (*runtime)->externalClassId, &classDef);
+    if (__builtin_expect(status == -1, false))
+    {
+        JS_FreeRuntime((*runtime)->runtime);
+        free(*runtime);
+
+        return NAPIErrorGenericFailure;
+    }
+
+    classDef.class_name = "FunctionData";
+    classDef.finalizer = functionFinalizer;
+    status = JS_NewClass((*runtime)->runtime, (*runtime)->functionClassId, &classDef);
+    if (__builtin_expect(status == -1, false))
+    {
+        JS_FreeRuntime((*runtime)->runtime);
+        free(*runtime);
+
+        return NAPIErrorGenericFailure;
+    }
+
+    classDef.class_name = "ConstructorPrototype";
+    classDef.finalizer = constructorFinalizer;
+    status = JS_NewClass((*runtime)->runtime, (*runtime)->constructorClassId, &classDef);
+    if (__builtin_expect(status == -1, false))
+    {
+        JS_FreeRuntime((*runtime)->runtime);
+        free(*runtime);
+
+        return NAPIErrorGenericFailure;
+    }
+
+    return NAPIErrorOK;
+}
+
+// NAPIGenericFailure/NAPIMemoryError
+// 堆和栈参数属于 JSRuntime，已经在 NAPICreateRuntimeWithOptions 中设置，这里只做校验
+NAPIErrorStatus NAPICreateEnvWithOptions(NAPIEnv *env, NAPIRuntime runtime, const NAPIRuntimeOptions *options)
+{
+    RETURN_STATUS_IF_FALSE(isRuntimeOptionsValid(options), NAPIErrorInvalidArg)
+
+    return NAPICreateEnv(env, runtime);
+}
+
+NAPIErrorStatus NAPICreateEnv(NAPIEnv *env, NAPIRuntime runtime)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(runtime, Error)
+
+    // Resource - NAPIEnv
+    *env = malloc(sizeof(struct OpaqueNAPIEnv));
+    RETURN_STATUS_IF_FALSE(*env, NAPIErrorMemoryError)
+    (*env)->runtime = runtime;
+
+    // Resource - JSContext
+    JSContext *context = JS_NewContext(runtime->runtime);
+    //    js_std_add_helpers(context, 0, NULL);
+    if (__builtin_expect(!context, false))
+    {
+        free(*env);
+
+        return NAPIErrorMemoryError;
+    }
+    JSValue prototype = JS_NewObject(context);
+    if (__builtin_expect(JS_IsException(prototype), false))
+    {
+        JS_FreeContext(context);
+        free(*env);
+
+        return NAPIErrorGenericFailure;
+    }
+    JS_SetClassProto(context, runtime->externalClassId, prototype);
+    prototype = JS_NewObject(context);
+    if (__builtin_expect(JS_IsException(prototype), false))
+    {
+        JS_FreeContext(context);
+        free(*env);
+
+        return NAPIErrorGenericFailure;
+    }
+    JS_SetClassProto(context, runtime->constructorClassId, prototype);
+    const char *string = "(function () { return Symbol(\"reference\") })();";
+    (*env)->referenceSymbolValue =
+        JS_Eval(context, string, strlen(string), "https://n-api.com/qjs_reference_symbol.js", JS_EVAL_TYPE_GLOBAL);
+    if (__builtin_expect(JS_IsException((*env)->referenceSymbolValue), false))
+    {
+        JS_FreeContext(context);
+        free(*env);
+
+        return NAPIErrorGenericFailure;
+    }
+    // JS_GetGlobalObject 返回已经引用计数 +1
+    (*env)->globalValue = JS_GetGlobalObject(context);
+    if (__builtin_expect(JS_IsException((*env)->globalValue), false))
+    {
+        JS_FreeValue(context, (*env)->referenceSymbolValue);
+        JS_FreeContext(context);
+        free(*env);
+
+        return NAPIErrorGenericFailure;
+    }
+    (*env)->context = context;
+    (*env)->isThrowNull = false;
+    LIST_INIT(&(*env)->handleScopeList);
+    LIST_INIT(&(*env)->freeHandleScopeList);
+    (*env)->firstHandleBlock.previous = NULL;
+    (*env)->firstHandleBlock.next = NULL;
+    (*env)->handleBlock = &(*env)->firstHandleBlock;
+    (*env)->handleIndex = 0;
+    (*env)->codeCache = NULL;
+    (*env)->lastGCNanoseconds = 0;
+    (*env)->externalMemorySize = 0;
+    LIST_INIT(&(*env)->weakReferenceList);
+    LIST_INIT(&(*env)->valueList);
+    LIST_INIT(&(*env)->strongRefList);
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus NAPIFreeEnv(NAPIEnv env)
+{
+    CHECK_ARG(env, Common)
+
+    popHandlesToWatermark(env, &env->firstHandleBlock, 0);
+    NAPIHandleScope handleScope, tempHandleScope;
+    LIST_FOREACH_SAFE(handleScope, &env->handleScopeList, node, tempHandleScope)
+    {
+        // 这里和前面的 assert 要求 env->handleScopeList 必须是 LIST 双向链表
+        LIST_REMOVE(handleScope, node);
+        free(handleScope);
+    }
+    LIST_FOREACH_SAFE(handleScope, &env->freeHandleScopeList, node, tempHandleScope)
+    {
+        LIST_REMOVE(handleScope, node);
+        free(handleScope);
+    }
+    struct HandleBlock *handleBlock = env->firstHandleBlock.next;
+    while (handleBlock)
+    {
+        struct HandleBlock *nextHandleBlock = handleBlock->next;
+        free(handleBlock);
+        handleBlock = nextHandleBlock;
+    }
+    NAPIRef ref, temp;
+    LIST_FOREACH_SAFE(ref, &env->strongRefList, node, temp)
+    {
+        LIST_REMOVE(ref, node);
+        JS_FreeValue(env->context, ref->value);
+        free(ref);
+    }
+    struct WeakReference *referenceInfo, *tempReferenceInfo;
+    LIST_FOREACH_SAFE(referenceInfo, &env->weakReferenceList, node, tempReferenceInfo)
+    {
+        LIST_FOREACH_SAFE(ref, &referenceInfo->weakRefList, node, temp)
+        {
+            LIST_REMOVE(ref, node);
+            free(ref);
+        }
+        LIST_REMOVE(referenceInfo, node);
+        referenceInfo->isEnvFreed = true;
+        // referenceInfo 本身不销毁，等到 GC 阶段销毁
+    }
+    // 到这一步，所有弱引用已经全部释放完成
+    LIST_FOREACH_SAFE(ref, &env->valueList, node, temp)
+    {
+        LIST_REMOVE(ref, node);
+        free(ref);
+    }
+    JS_FreeValue(env->context, env->referenceSymbolValue);
+    JS_FreeValue(env->context, env->globalValue);
+    JS_FreeContext(env->context);
+    // context 中的 external 已经全部执行 finalizer，剩余的登记由 env 一并撤销
+    env->runtime->pendingExternalMemorySize -= env->externalMemorySize;
+    NAPICodeCacheFree(env->codeCache);
+    free(env);
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIFreeRuntime(NAPIRuntime runtime)
+{
+    CHECK_ARG(runtime, Common)
+
+    JS_FreeRuntime(runtime->runtime);
+
+    return NAPICommonOK;
+}
+
+NAPIErrorStatus NAPIGetValueStringUTF8(NAPIEnv env, NAPIValue value, const char **result)
+{
+
+    CHECK_ARG(env, Error)
+    CHECK_ARG(value, Error)
+    CHECK_ARG(result, Error)
+
+    RETURN_STATUS_IF_FALSE(JS_IsString(*((JSValue *)value)), NAPIErrorStringExpected);
+
+    *result = JS_ToCString(env->context, *((JSValue *)value));
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus NAPIFreeUTF8String(NAPIEnv env, const char *cString)
+{
+
+    CHECK_ARG(env, Common)
+
+    JS_FreeCString(env->context, cString);
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIEnableDebugger(__attribute__((unused)) NAPIEnv env,
+                                    __attribute__((unused)) const char *debuggerTitle,
+                                    __attribute__((unused)) bool waitForDebugger)
+{
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIDisableDebugger(__attribute__((unused)) NAPIEnv env)
+{
+    return NAPICommonOK;
+}
+NAPICommonStatus NAPISetMessageQueueThread(__attribute__((unused)) NAPIEnv env,
+                                           __attribute__((unused)) MessageQueueThreadWrapper jsQueueWrapper)
+{
+    return NAPICommonOK;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPICompileToByteBuffer(NAPIEnv env, const char *script, const char *sourceUrl,
+                                                        const uint8_t **byteBuffer, size_t *bufferSize)
+{
+    return NAPICompileWithOptions(env, script, sourceUrl, NULL, byteBuffer, bufferSize);
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPICompileWithOptions(NAPIEnv env, const char *script, const char *sourceUrl,
+                                                       const NAPIScriptOptions *options, const uint8_t **byteBuffer,
+                                                       size_t *bufferSize)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(byteBuffer, Exception)
+
+    if (!script)
+    {
+        script = "";
+    }
+    if (!sourceUrl)
+    {
+        sourceUrl = "";
+    }
+    JSValue returnValue = evalScriptWithOptions(env, script, sourceUrl, options, JS_EVAL_FLAG_COMPILE_ONLY);
+    if (JS_IsException(returnValue))
+    {
+        goto exceptionHandler;
+    }
+    *byteBuffer = JS_WriteObject(env->context, bufferSize, returnValue, JS_WRITE_OBJ_BYTECODE);
+    JS_FreeValue(env->context, returnValue);
+    if (!*byteBuffer)
+    {
+        goto exceptionHandler;
+    }
+
+    return NAPIExceptionOK;
+
+exceptionHandler : {
+    JSValue exceptionValue = JS_GetException(env->context);
+    if (JS_IsNull(exceptionValue))
+    {
+        env->isThrowNull = true;
+    }
+    else
+    {
+        JS_Throw(env->context, exceptionValue);
+    }
+}
+
+    return NAPIExceptionPendingException;
+}
+
+NAPI_EXPORT NAPICommonStatus NAPIFreeByteBuffer(NAPIEnv env, const uint8_t *byteBuffer)
+{
+    CHECK_ARG(env, Common)
+
+    js_free(env->context, (void *)byteBuffer);
+
+    return NAPICommonOK;
+}
+
+// JS_EvalFunction 会释放 functionValue
+static NAPIExceptionStatus evalFunction(NAPIEnv env, JSValue functionValue, NAPIValue *result)
+{
+    JSValue returnValue = JS_EvalFunction(env->context, functionValue);
+    if (JS_IsException(returnValue))
+    {
+        goto exceptionHandlerWithProcess;
+    }
+    processPendingTask(env);
+    if (result)
+    {
+        JSValue *returnHandle;
+        NAPIErrorStatus status = addValueToHandleScope(env, returnValue, &returnHandle);
+        if (__builtin_expect(status != NAPIErrorOK, false))
+        {
+            JS_FreeValue(env->context, returnValue);
+
+            return (NAPIExceptionStatus)status;
+        }
+        *result = (NAPIValue)returnHandle;
+    }
+    else
+    {
+        JS_FreeValue(env->context, returnValue);
+    }
+
+    return NAPIExceptionOK;
+
+exceptionHandlerWithProcess : {
+    JSValue exceptionValue = JS_GetException(env->context);
+    processPendingTask(env);
+    if (JS_IsNull(exceptionValue))
+    {
+        env->isThrowNull = true;
+    }
+    else
+    {
+        JS_Throw(env->context, exceptionValue);
+    }
+}
+
+    return NAPIExceptionPendingException;
+}
+
+// readFlags 必须包含 JS_READ_OBJ_BYTECODE
+// functionValue 为 JS_ReadObject 的返回值
+static NAPIExceptionStatus evalReadObject(NAPIEnv env, JSValue functionValue, NAPIValue *result)
+{
+    if (JS_IsException(functionValue))
+    {
+        JSValue exceptionValue = JS_GetException(env->context);
+        if (JS_IsNull(exceptionValue))
+        {
+            env->isThrowNull = true;
+        }
+        else
+        {
+            JS_Throw(env->context, exceptionValue);
+        }
+
+        return NAPIExceptionPendingException;
+    }
+
+    return evalFunction(env, functionValue, result);
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBuffer(NAPIEnv env, const uint8_t *byteBuffer, size_t bufferSize,
+                                                  NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+
+    return evalReadObject(env, JS_ReadObject(env->context, byteBuffer, bufferSize, JS_READ_OBJ_BYTECODE), result);
+}
 
-static void constructorFinalizer(JSRuntime *rt, JSValue val)
+NAPIExceptionStatus NAPIRunCachedByteBuffer(NAPIEnv env, const uint8_t *byteBuffer, size_t bufferSize,
+                                            NAPIValue *result)
 {
-    NAPIRuntime runtime = JS_GetRuntimeOpaque(rt);
-    if (__builtin_expect(!runtime->constructorClassId, false))
+    NAPI_PREAMBLE(env)
+
+    // JS_ReadObject 会检查 BC_VERSION，失败时抛出的异常由这里产生，可以直接清除
+    JSValue functionValue = JS_ReadObject(env->context, byteBuffer, bufferSize, JS_READ_OBJ_BYTECODE);
+    if (JS_IsException(functionValue))
     {
-        assert(false && CONSTRUCTOR_CLASS_ID_ZERO);
+        JS_FreeValue(env->context, JS_GetException(env->context));
 
-        return;
+        return NAPIExceptionGenericFailure;
     }
-    ConstructorInfo *constructorInfo = JS_GetOpaque(val, runtime->constructorClassId);
-    free(constructorInfo);
+
+    return evalFunction(env, functionValue, result);
 }
 
-static JSValue callAsConstructor(JSContext *ctx, JSValueConst newTarget, int argc, JSValueConst *argv)
+NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBufferFile(NAPIEnv env, const char *path, NAPIValue *result)
 {
-    JSRuntime *rt = JS_GetRuntime(ctx);
-    NAPIRuntime runtime = JS_GetRuntimeOpaque(rt);
-    JSValue prototypeValue = JS_GetPropertyStr(ctx, newTarget, "prototype");
-    if (JS_IsException(prototypeValue))
-    {
-        assert(false && "callAsConstructor() use JS_GetPropertyStr() to get 'prototype' raise a exception.");
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(path, Exception)
 
-        return prototypeValue;
-    }
-    if (__builtin_expect(!runtime->constructorClassId, false))
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    RETURN_STATUS_IF_FALSE(fd >= 0, NAPIExceptionGenericFailure)
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) || fileStat.st_size <= 0)
     {
-        assert(false && CONSTRUCTOR_CLASS_ID_ZERO);
+        close(fd);
 
-        return undefinedValue;
+        return NAPIExceptionGenericFailure;
     }
-    ConstructorInfo *constructorInfo = JS_GetOpaque(prototypeValue, runtime->constructorClassId);
-    JS_FreeValue(ctx, prototypeValue);
-    if (__builtin_expect(!constructorInfo || !constructorInfo->functionInfo.baseInfo.env ||
-                             !constructorInfo->functionInfo.callback || !constructorInfo->classId,
-                         false))
-    {
-        assert(false);
+    // JS_READ_OBJ_ROM_DATA 会让函数字节码引用输入内存并原地改写其中的 atom，不能用于映射内存
+    // 因此使用普通读取，JS_ReadObject 返回后字节码已经全部拷贝，可以立即解除映射
+    size_t length = (size_t)fileStat.st_size;
+    void *address = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    RETURN_STATUS_IF_FALSE(address != MAP_FAILED, NAPIExceptionGenericFailure)
+    JSValue functionValue = JS_ReadObject(env->context, address, length, JS_READ_OBJ_BYTECODE);
+    munmap(address, length);
 
-        return undefinedValue;
-    }
-    JSValue thisValue = JS_NewObjectClass(ctx, (int)constructorInfo->classId);
-    if (__builtin_expect(JS_IsException(thisValue), false))
-    {
-        return thisValue;
-    }
-    struct OpaqueNAPICallbackInfo callbackInfo = {newTarget, thisValue, argv,
-                                                  constructorInfo->functionInfo.baseInfo.data, argc};
-    NAPIHandleScope handleScope = NULL;
+    return evalReadObject(env, functionValue, result);
+}
+
+NAPIExceptionStatus NAPICompileScript(NAPIEnv env, const char *script, const char *sourceUrl, NAPIScript *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(result, Exception)
+
+    if (!script)
     {
-        NAPIErrorStatus status = napi_open_handle_scope(constructorInfo->functionInfo.baseInfo.env, &handleScope);
-        assert(status == NAPIErrorOK);
-        (void)status;
+        script = "";
     }
-    NAPIValue retVal =
-        constructorInfo->functionInfo.callback(constructorInfo->functionInfo.baseInfo.env, &callbackInfo);
-    if (retVal && JS_IsObject(*((JSValue *)retVal)))
+    if (!sourceUrl)
     {
-        JSValue returnValue = JS_DupValue(ctx, *((JSValue *)retVal));
-        JS_FreeValue(ctx, thisValue);
-        thisValue = returnValue;
+        sourceUrl = "";
     }
-    if (handleScope)
+    *result = malloc(sizeof(struct OpaqueNAPIScript));
+    RETURN_STATUS_IF_FALSE(*result, NAPIExceptionMemoryError)
+    JSValue functionValue = evalScriptWithOptions(env, script, sourceUrl, NULL, JS_EVAL_FLAG_COMPILE_ONLY);
+    if (JS_IsException(functionValue))
     {
-        NAPICommonStatus commonStatus =
-            napi_close_handle_scope(constructorInfo->functionInfo.baseInfo.env, handleScope);
-        if (__builtin_expect(commonStatus != NAPICommonOK, false))
+        free(*result);
+        JSValue exceptionValue = JS_GetException(env->context);
+        if (JS_IsNull(exceptionValue))
         {
-            JS_FreeValue(ctx, thisValue);
-            assert(false && NAPI_CLOSE_HANDLE_SCOPE_ERROR);
-
-            // TODO(ChasonTang): 验证 undefined 的情况
-            return undefinedValue;
+            env->isThrowNull = true;
+        }
+        else
+        {
+            JS_Throw(env->context, exceptionValue);
         }
-    }
-    // 异常处理
-    JSValue exceptionValue = JS_GetException(ctx);
-    if (!JS_IsNull(exceptionValue))
-    {
-        JS_FreeValue(ctx, thisValue);
 
-        return JS_Throw(ctx, exceptionValue);
+        return NAPIExceptionPendingException;
     }
-    if (constructorInfo->functionInfo.baseInfo.env->isThrowNull)
-    {
-        JS_FreeValue(ctx, thisValue);
-        constructorInfo->functionInfo.baseInfo.env->isThrowNull = false;
+    (*result)->functionValue = functionValue;
 
-        return JS_EXCEPTION;
-    }
+    return NAPIExceptionOK;
+}
 
-    return thisValue;
+NAPIExceptionStatus NAPIRunCompiledScript(NAPIEnv env, NAPIScript script, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(script, Exception)
+
+    // 字节码由 script 持有，JS_EvalFunction 只消耗新增的引用
+    return evalFunction(env, JS_DupValue(env->context, script->functionValue), result);
 }
 
-// NAPIMemoryError/NAPIPendingException + addValueToHandleScope
-NAPIExceptionStatus NAPIDefineClass(NAPIEnv env, const char *utf8name, NAPICallback constructor, void *data,
-                                    NAPIValue *result)
+NAPICommonStatus NAPIFreeScript(NAPIEnv env, NAPIScript script)
 {
+    CHECK_ARG(env, Common)
+    CHECK_ARG(script, Common)
 
-    NAPI_PREAMBLE(env)
-    CHECK_ARG(constructor, Exception)
-    CHECK_ARG(result, Exception)
+    JS_FreeValue(env->context, script->functionValue);
+    free(script);
 
-    ConstructorInfo *constructorInfo = malloc(sizeof(ConstructorInfo));
-    RETURN_STATUS_IF_FALSE(constructorInfo, NAPIExceptionMemoryError)
-    constructorInfo->functionInfo.baseInfo.env = env;
-    constructorInfo->functionInfo.baseInfo.data = data;
-    constructorInfo->functionInfo.callback = constructor;
-    constructorInfo->classId = 0;
-    JS_NewClassID(&constructorInfo->classId);
-    JSClassDef classDef = {utf8name ?: "", NULL, NULL, NULL, NULL};
-    int status = JS_NewClass(env->runtime->runtime, constructorInfo->classId, &classDef);
-    if (__builtin_expect(status == -1, false))
-    {
-        free(constructorInfo);
+    return NAPICommonOK;
+}
 
-        return NAPIExceptionPendingException;
-    }
-    if (__builtin_expect(!env->runtime->constructorClassId, false))
-    {
-        assert(false && CONSTRUCTOR_CLASS_ID_ZERO);
+// JS_NewRuntime 记录的是创建线程的栈顶，不更新的话栈溢出检查会在其他线程上误判或失效
+void NAPIAttachEnvToCurrentThread(NAPIEnv env)
+{
+    JS_UpdateStackTop(env->runtime->runtime);
+}
 
-        return NAPIExceptionGenericFailure;
-    }
-    JSValue prototype = JS_NewObjectClass(env->context, (int)env->runtime->constructorClassId);
-    if (__builtin_expect(JS_IsException(prototype), false))
-    {
-        free(constructorInfo);
+NAPIErrorStatus NAPISetCodeCacheDirectory(NAPIEnv env, const char *directory)
+{
+    CHECK_ARG(env, Error)
 
-        return NAPIExceptionPendingException;
-    }
-    JS_SetOpaque(prototype, constructorInfo);
-    // JS_NewCFunction2 -> JS_NewCFunction3 会正确处理 utf8name 为空情况
-    JSValue constructorValue = JS_NewCFunction2(env->context, callAsConstructor, utf8name, 0, JS_CFUNC_constructor, 0);
-    if (__builtin_expect(JS_IsException(constructorValue), false))
+    NAPICodeCache *codeCache = NULL;
+    if (directory)
     {
-        // prototype 会自己 free ConstructorInfo 结构体
-        JS_FreeValue(env->context, prototype);
+        // JS_WriteObject 格式随 QuickJS 版本和 CONFIG_BIGNUM 变化，JS_GetBytecodeVersion 来自 quickjs_patch.diff
+        codeCache = NAPICodeCacheCreate(directory, JS_GetBytecodeVersion());
+        RETURN_STATUS_IF_FALSE(codeCache, NAPIErrorMemoryError)
+    }
+    NAPICodeCacheFree(env->codeCache);
+    env->codeCache = codeCache;
 
-        return NAPIExceptionPendingException;
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus NAPIGetCodeCacheStatistics(NAPIEnv env, NAPICodeCacheStatistics *result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(result, Error)
+
+    if (env->codeCache)
+    {
+        NAPICodeCacheGetStatistics(env->codeCache, result);
     }
-    struct Handle *handle;
-    NAPIErrorStatus addStatus = addValueToHandleScope(env, constructorValue, &handle);
-    if (__builtin_expect(addStatus != NAPIErrorOK, false))
+    else
     {
-        JS_FreeValue(env->context, constructorValue);
-        JS_FreeValue(env->context, prototype);
-
-        return status;
+        memset(result, 0, sizeof(NAPICodeCacheStatistics));
     }
-    *result = (NAPIValue)&handle->value;
-    // .prototype .constructor
-    // 会自动引用计数 +1
-    JS_SetConstructor(env->context, constructorValue, prototype);
-    // context -> class_proto
-    // 转移所有权
-    JS_SetClassProto(env->context, constructorInfo->classId, prototype);
 
-    return NAPIExceptionOK;
+    return NAPIErrorOK;
 }
 
-NAPIErrorStatus NAPICreateRuntime(NAPIRuntime *runtime)
+NAPIErrorStatus NAPIGetHeapStatistics(NAPIEnv env, NAPIHeapStatistics *result)
 {
-    CHECK_ARG(runtime, Error)
+    CHECK_ARG(env, Error)
+    CHECK_ARG(result, Error)
 
-    *runtime = malloc(sizeof(struct OpaqueNAPIRuntime));
-    RETURN_STATUS_IF_FALSE(*runtime, NAPIErrorMemoryError)
-    (*runtime)->runtime = JS_NewRuntime();
-    // JS_NewClassID only accept 0.
-    // So we initialize classId field to 0.
-    (*runtime)->constructorClassId = 0;
-    (*runtime)->functionClassId = 0;
-    (*runtime)->externalClassId = 0;
-    if (!(*runtime)->runtime)
-    {
-        free(*runtime);
+    memset(result, 0, sizeof(NAPIHeapStatistics));
+    // O(堆大小)，对象数量等字段只能通过遍历得到
+    JSMemoryUsage memoryUsage;
+    JS_ComputeMemoryUsage(env->runtime->runtime, &memoryUsage);
+    result->usedHeapSize = memoryUsage.memory_used_size;
+    result->externalMemorySize = env->externalMemorySize;
+    // malloc_size 中包含已经计入的 external 内存，和 externalMemorySize 重复，因此使用 mallocSize
+    result->totalHeapSize = env->runtime->mallocSize;
+    result->mallocCount = memoryUsage.malloc_count;
+    result->objectCount = memoryUsage.obj_count;
+    result->objectSize = memoryUsage.obj_size;
+    result->stringCount = memoryUsage.str_count;
+    result->stringSize = memoryUsage.str_size;
+    result->atomCount = memoryUsage.atom_count;
+    result->atomSize = memoryUsage.atom_size;
+    result->functionCount = memoryUsage.js_func_count;
+    result->bytecodeSize = memoryUsage.js_func_code_size;
 
-        return NAPIErrorMemoryError;
+    // handle 栈中当前块之前的块都是满的
+    for (struct HandleBlock *handleBlock = env->handleBlock->previous; handleBlock; handleBlock = handleBlock->previous)
+    {
+        result->handleCount += HANDLE_BLOCK_CAPACITY;
     }
-    JS_SetRuntimeOpaque((*runtime)->runtime, *runtime);
-    JS_SetMaxStackSize((*runtime)->runtime, 4 * JS_DEFAULT_STACK_SIZE);
-    // 一定成功
-    JS_NewClassID(&(*runtime)->constructorClassId);
-    JS_NewClassID(&(*runtime)->functionClassId);
-    JS_NewClassID(&(*runtime)->externalClassId);
-    JSClassDef classDef = {"External", externalFinalizer, NULL, NULL, NULL};
-    // JS_NewClass -> JS_NewClass1 返回值只有 -1 和 0
-    int status = JS_NewClass((*runtime)->runtime, (*runtime)->externalClassId, &classDef);
-    if (__builtin_expect(status == -1, false))
+    result->handleCount += env->handleIndex;
+    struct OpaqueNAPIHandleScope *handleScope;
+    LIST_FOREACH(handleScope, &env->handleScopeList, node)
     {
-        JS_FreeRuntime((*runtime)->runtime);
-        free(*runtime);
-
-        return NAPIErrorGenericFailure;
+        ++result->handleScopeCount;
     }
-
-    classDef.class_name = "FunctionData";
-    classDef.finalizer = functionFinalizer;
-    status = JS_NewClass((*runtime)->runtime, (*runtime)->functionClassId, &classDef);
-    if (__builtin_expect(status == -1, false))
+    NAPIRef ref;
+    LIST_FOREACH(ref, &env->strongRefList, node)
     {
-        JS_FreeRuntime((*runtime)->runtime);
-        free(*runtime);
-
-        return NAPIErrorGenericFailure;
+        ++result->strongReferenceCount;
     }
-
-    classDef.class_name = "ConstructorPrototype";
-    classDef.finalizer = constructorFinalizer;
-    status = JS_NewClass((*runtime)->runtime, (*runtime)->constructorClassId, &classDef);
-    if (__builtin_expect(status == -1, false))
+    struct WeakReference *referenceInfo;
+    LIST_FOREACH(referenceInfo, &env->weakReferenceList, node)
     {
-        JS_FreeRuntime((*runtime)->runtime);
-        free(*runtime);
-
-        return NAPIErrorGenericFailure;
+        LIST_FOREACH(ref, &referenceInfo->weakRefList, node)
+        {
+            ++result->weakReferenceCount;
+        }
     }
+    LIST_FOREACH(ref, &env->valueList, node)
+    {
+        ++result->valueReferenceCount;
+    }
+    result->externalCount = env->runtime->externalCount;
 
     return NAPIErrorOK;
 }
 
-// NAPIGenericFailure/NAPIMemoryError
-NAPIErrorStatus NAPICreateEnv(NAPIEnv *env, NAPIRuntime runtime)
+static uint64_t getNanoseconds(void)
+{
+    struct timespec timeSpec;
+    clock_gettime(CLOCK_MONOTONIC, &timeSpec);
+
+    return (uint64_t)timeSpec.tv_sec * 1000000000 + (uint64_t)timeSpec.tv_nsec;
+}
+
+// QuickJS 的 GC 只有一种，会回收整个 JSRuntime 中的循环引用
+static void runGC(NAPIEnv env)
+{
+    uint64_t begin = getNanoseconds();
+    JS_RunGC(env->runtime->runtime);
+    env->lastGCNanoseconds = getNanoseconds() - begin;
+    // GC 本身也可能分配（例如 finalizer 中），取 GC 完成后的值
+    env->runtime->lastGCAllocatedSize = env->runtime->allocatedSize;
+}
+
+NAPIErrorStatus NAPIRunGC(NAPIEnv env, NAPIGCMode mode)
 {
     CHECK_ARG(env, Error)
-    CHECK_ARG(runtime, Error)
+    RETURN_STATUS_IF_FALSE(mode == NAPIFullGC || mode == NAPIYoungGC, NAPIErrorInvalidArg)
 
-    // Resource - NAPIEnv
-    *env = malloc(sizeof(struct OpaqueNAPIEnv));
-    RETURN_STATUS_IF_FALSE(*env, NAPIErrorMemoryError)
-    (*env)->runtime = runtime;
+    runGC(env);
 
-    // Resource - JSContext
-    JSContext *context = JS_NewContext(runtime->runtime);
-    //    js_std_add_helpers(context, 0, NULL);
-    if (__builtin_expect(!context, false))
-    {
-        free(*env);
+    return NAPIErrorOK;
+}
 
-        return NAPIErrorMemoryError;
-    }
-    JSValue prototype = JS_NewObject(context);
-    if (__builtin_expect(JS_IsException(prototype), false))
+NAPIErrorStatus NAPIIdleNotification(NAPIEnv env, uint64_t idleMicroseconds, bool *hasMoreWork)
+{
+    CHECK_ARG(env, Error)
+
+    // 上一次 GC 之后没有新的分配时不会产生新的垃圾，跳过
+    if (env->runtime->allocatedSize == env->runtime->lastGCAllocatedSize)
     {
-        JS_FreeContext(context);
-        free(*env);
+        if (hasMoreWork)
+        {
+            *hasMoreWork = false;
+        }
 
-        return NAPIErrorGenericFailure;
+        return NAPIErrorOK;
     }
-    JS_SetClassProto(context, runtime->externalClassId, prototype);
-    prototype = JS_NewObject(context);
-    if (__builtin_expect(JS_IsException(prototype), false))
+    // 还没有执行过 GC 时无法估计，直接执行
+    bool canRun = env->lastGCNanoseconds <= idleMicroseconds * 1000;
+    if (canRun)
     {
-        JS_FreeContext(context);
-        free(*env);
-
-        return NAPIErrorGenericFailure;
+        runGC(env);
     }
-    JS_SetClassProto(context, runtime->constructorClassId, prototype);
-    const char *string = "(function () { return Symbol(\"reference\") })();";
-    (*env)->referenceSymbolValue =
-        JS_Eval(context, string, strlen(string), "https://n-api.com/qjs_reference_symbol.js", JS_EVAL_TYPE_GLOBAL);
-    if (__builtin_expect(JS_IsException((*env)->referenceSymbolValue), false))
+    if (hasMoreWork)
     {
-        JS_FreeContext(context);
-        free(*env);
-
-        return NAPIErrorGenericFailure;
+        *hasMoreWork = !canRun;
     }
-    (*env)->context = context;
-    (*env)->isThrowNull = false;
-    LIST_INIT(&(*env)->handleScopeList);
-    LIST_INIT(&(*env)->weakReferenceList);
-    LIST_INIT(&(*env)->valueList);
-    LIST_INIT(&(*env)->strongRefList);
 
     return NAPIErrorOK;
 }
 
-NAPICommonStatus NAPIFreeEnv(NAPIEnv env)
+// 释放空闲链表中的 handleScope 和当前栈顶之后的 HandleBlock，返回释放的字节数
+static size_t trimHandleScopes(NAPIEnv env)
 {
-    CHECK_ARG(env, Common)
-
+    size_t reclaimedBytes = 0;
     NAPIHandleScope handleScope, tempHandleScope;
-    LIST_FOREACH_SAFE(handleScope, &env->handleScopeList, node, tempHandleScope)
+    LIST_FOREACH_SAFE(handleScope, &env->freeHandleScopeList, node, tempHandleScope)
     {
-        struct Handle *handle, *tempHandle;
-        SLIST_FOREACH_SAFE(handle, &handleScope->handleList, node, tempHandle)
-        {
-            JS_FreeValue(env->context, handle->value);
-            free(handle);
-        }
-        // 这里和前面的 assert 要求 env->handleScopeList 必须是 LIST 双向链表
         LIST_REMOVE(handleScope, node);
         free(handleScope);
+        reclaimedBytes += sizeof(struct OpaqueNAPIEscapableHandleScope);
     }
-    NAPIRef ref, temp;
-    LIST_FOREACH_SAFE(ref, &env->strongRefList, node, temp)
+    struct HandleBlock *handleBlock = env->handleBlock->next;
+    env->handleBlock->next = NULL;
+    while (handleBlock)
     {
-        LIST_REMOVE(ref, node);
-        JS_FreeValue(env->context, ref->value);
-        free(ref);
+        struct HandleBlock *nextHandleBlock = handleBlock->next;
+        free(handleBlock);
+        reclaimedBytes += sizeof(struct HandleBlock);
+        handleBlock = nextHandleBlock;
     }
-    struct WeakReference *referenceInfo, *tempReferenceInfo;
-    LIST_FOREACH_SAFE(referenceInfo, &env->weakReferenceList, node, tempReferenceInfo)
+
+    return reclaimedBytes;
+}
+
+NAPIErrorStatus NAPINotifyMemoryPressure(NAPIEnv env, NAPIMemoryPressureLevel level, size_t *reclaimedBytes)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(level == NAPIModerateMemoryPressure || level == NAPICriticalMemoryPressure,
+                           NAPIErrorInvalidArg)
+
+    size_t totalReclaimedBytes = trimHandleScopes(env);
+    if (level == NAPICriticalMemoryPressure)
     {
-        LIST_FOREACH_SAFE(ref, &referenceInfo->weakRefList, node, temp)
+        // mallocSize 不包含 external 内存，GC 期间 finalizer 撤销 external 登记不会被算作回收
+        size_t mallocSize = env->runtime->mallocSize;
+        runGC(env);
+        if (mallocSize > env->runtime->mallocSize)
         {
-            LIST_REMOVE(ref, node);
-            free(ref);
+            totalReclaimedBytes += mallocSize - env->runtime->mallocSize;
         }
-        LIST_REMOVE(referenceInfo, node);
-        referenceInfo->isEnvFreed = true;
-        // referenceInfo 本身不销毁，等到 GC 阶段销毁
+#ifdef __GLIBC__
+        // QuickJS 直接使用 malloc，释放的内存留在 glibc 的空闲链表中
+        malloc_trim(0);
+#endif
     }
-    // 到这一步，所有弱引用已经全部释放完成
-    LIST_FOREACH_SAFE(ref, &env->valueList, node, temp)
+    if (reclaimedBytes)
     {
-        LIST_REMOVE(ref, node);
-        free(ref);
+        *reclaimedBytes = totalReclaimedBytes;
     }
-    JS_FreeValue(env->context, env->referenceSymbolValue);
-    JS_FreeContext(env->context);
-    free(env);
 
-    return NAPICommonOK;
+    return NAPIErrorOK;
 }
 
-NAPICommonStatus NAPIFreeRuntime(NAPIRuntime runtime)
+NAPIErrorStatus napi_adjust_external_memory(NAPIEnv env, int64_t changeInBytes, int64_t *adjustedValue)
 {
-    CHECK_ARG(runtime, Common)
+    CHECK_ARG(env, Error)
+    CHECK_ARG(adjustedValue, Error)
 
-    JS_FreeRuntime(runtime->runtime);
+    // 释放的字节数超过登记的总数时按总数撤销
+    if (changeInBytes < -env->externalMemorySize)
+    {
+        changeInBytes = -env->externalMemorySize;
+    }
+    env->externalMemorySize += changeInBytes;
+    env->runtime->pendingExternalMemorySize += changeInBytes;
+    // external 内存增长同样意味着可能有新的垃圾需要 GC 回收
+    if (changeInBytes > 0)
+    {
+        env->runtime->allocatedSize += changeInBytes;
+    }
+    *adjustedValue = env->externalMemorySize;
 
-    return NAPICommonOK;
+    return NAPIErrorOK;
 }
 
-NAPIErrorStatus NAPIGetValueStringUTF8(NAPIEnv env, NAPIValue value, const char **result)
-{
+// 快照中字符串节点和属性名的最大字节数，超出部分截断
+#define HEAP_SNAPSHOT_MAX_NAME_LENGTH 256
 
-    CHECK_ARG(env, Error)
-    CHECK_ARG(value, Error)
-    CHECK_ARG(result, Error)
+// 整个过程中不执行 JS，也不会创建或释放 GC 对象，节点地址在写入前保持有效，不需要持有引用
+struct HeapSnapshotBuilder
+{
+    NAPIEnv env;                // size_t
+    NAPIHeapSnapshot *snapshot; // size_t
+    // JS_WalkHeap 连续回调同一个对象的子节点，缓存上一次查找的结果
+    const void *fromAddress; // size_t
+    size_t fromIndex;        // size_t
+    size_t internalIndex;    // size_t
+    bool isMemoryError;
+};
 
-    RETURN_STATUS_IF_FALSE(JS_IsString(*((JSValue *)value)), NAPIErrorStringExpected);
+// 按 UTF-8 字符边界截断
+static void copySnapshotName(char *buffer, const char *string, size_t length)
+{
+    if (length > HEAP_SNAPSHOT_MAX_NAME_LENGTH)
+    {
+        length = HEAP_SNAPSHOT_MAX_NAME_LENGTH;
+        while (length && ((unsigned char)string[length] & 0xC0) == 0x80)
+        {
+            --length;
+        }
+    }
+    memcpy(buffer, string, length);
+    buffer[length] = '\0';
+}
 
-    *result = JS_ToCString(env->context, *((JSValue *)value));
+// 字符串以外的值不修改 buffer
+static void copySnapshotNameFromValue(JSContext *context, char *buffer, JSValueConst value)
+{
+    if (!JS_IsString(value))
+    {
+        return;
+    }
+    size_t length = 0;
+    const char *string = JS_ToCStringLen(context, &length, value);
+    if (!string)
+    {
+        JS_FreeValue(context, JS_GetException(context));
 
-    return NAPIErrorOK;
+        return;
+    }
+    copySnapshotName(buffer, string, length);
+    JS_FreeCString(context, string);
 }
 
-NAPICommonStatus NAPIFreeUTF8String(NAPIEnv env, const char *cString)
+static void copySnapshotNameFromAtom(JSContext *context, char *buffer, JSAtom atom)
 {
+    const char *string = JS_AtomToCString(context, atom);
+    if (!string)
+    {
+        JS_FreeValue(context, JS_GetException(context));
 
-    CHECK_ARG(env, Common)
+        return;
+    }
+    copySnapshotName(buffer, string, strlen(string));
+    JS_FreeCString(context, string);
+}
 
-    JS_FreeCString(env->context, cString);
+// parentIndex 为 NAPI_HEAP_SNAPSHOT_INVALID_NODE 时只创建节点，否则从 parentIndex 添加一条 element 边
+static size_t addSyntheticSnapshotNode(struct HeapSnapshotBuilder *builder, size_t parentIndex, size_t index,
+                                       const char *name)
+{
+    if (builder->isMemoryError)
+    {
+        return NAPI_HEAP_SNAPSHOT_INVALID_NODE;
+    }
+    size_t nodeIndex =
+        NAPIHeapSnapshotAddNode(builder->snapshot, NULL, NAPIHeapSnapshotSyntheticNode, name, 0, NULL);
+    if (nodeIndex == NAPI_HEAP_SNAPSHOT_INVALID_NODE ||
+        (parentIndex != NAPI_HEAP_SNAPSHOT_INVALID_NODE &&
+         !NAPIHeapSnapshotAddIndexedEdge(builder->snapshot, parentIndex, nodeIndex, NAPIHeapSnapshotElementEdge,
+                                         index)))
+    {
+        builder->isMemoryError = true;
 
-    return NAPICommonOK;
+        return NAPI_HEAP_SNAPSHOT_INVALID_NODE;
+    }
+
+    return nodeIndex;
 }
 
-NAPICommonStatus NAPIEnableDebugger(__attribute__((unused)) NAPIEnv env,
-                                    __attribute__((unused)) const char *debuggerTitle,
-                                    __attribute__((unused)) bool waitForDebugger)
+// GC 对象的节点在第一次遍历时已经创建，字符串和 Symbol 不是 GC 对象，在第一次引用时创建
+// 其他值返回 NAPI_HEAP_SNAPSHOT_INVALID_NODE
+static size_t addSnapshotValue(struct HeapSnapshotBuilder *builder, JSValueConst value)
 {
-    return NAPICommonOK;
+    int tag = JS_VALUE_GET_TAG(value);
+    if (builder->isMemoryError)
+    {
+        return NAPI_HEAP_SNAPSHOT_INVALID_NODE;
+    }
+    if (tag == JS_TAG_OBJECT || tag == JS_TAG_FUNCTION_BYTECODE)
+    {
+        return NAPIHeapSnapshotFindNode(builder->snapshot, JS_VALUE_GET_PTR(value));
+    }
+    if (tag != JS_TAG_STRING && tag != JS_TAG_SYMBOL)
+    {
+        return NAPI_HEAP_SNAPSHOT_INVALID_NODE;
+    }
+    size_t nodeIndex = NAPIHeapSnapshotFindNode(builder->snapshot, JS_VALUE_GET_PTR(value));
+    if (nodeIndex != NAPI_HEAP_SNAPSHOT_INVALID_NODE)
+    {
+        return nodeIndex;
+    }
+    JSContext *context = builder->env->context;
+    char name[HEAP_SNAPSHOT_MAX_NAME_LENGTH + 1] = "";
+    NAPIHeapSnapshotNodeType type;
+    size_t selfSize = 0;
+    if (tag == JS_TAG_STRING)
+    {
+        type = NAPIHeapSnapshotStringNode;
+        size_t length = 0;
+        const char *string = JS_ToCStringLen(context, &length, value);
+        if (string)
+        {
+            copySnapshotName(name, string, length);
+            // UTF-8 长度，和 QuickJS 内部的 Latin-1/UTF-16 存储大小近似
+            selfSize = length;
+            JS_FreeCString(context, string);
+        }
+        else
+        {
+            JS_FreeValue(context, JS_GetException(context));
+        }
+    }
+    else
+    {
+        type = NAPIHeapSnapshotSymbolNode;
+        JSAtom atom = JS_ValueToAtom(context, value);
+        if (atom != JS_ATOM_NULL)
+        {
+            copySnapshotNameFromAtom(context, name, atom);
+            JS_FreeAtom(context, atom);
+        }
+        else
+        {
+            JS_FreeValue(context, JS_GetException(context));
+        }
+    }
+    nodeIndex = NAPIHeapSnapshotAddNode(builder->snapshot, JS_VALUE_GET_PTR(value), type, name, selfSize, NULL);
+    if (nodeIndex == NAPI_HEAP_SNAPSHOT_INVALID_NODE)
+    {
+        builder->isMemoryError = true;
+    }
+
+    return nodeIndex;
 }
 
-NAPICommonStatus NAPIDisableDebugger(__attribute__((unused)) NAPIEnv env)
+// name 为 NULL 时使用 index
+static void addSnapshotEdge(struct HeapSnapshotBuilder *builder, size_t from, JSValueConst value,
+                            NAPIHeapSnapshotEdgeType type, const char *name, size_t index)
 {
-    return NAPICommonOK;
+    if (from == NAPI_HEAP_SNAPSHOT_INVALID_NODE)
+    {
+        return;
+    }
+    size_t to = addSnapshotValue(builder, value);
+    if (to == NAPI_HEAP_SNAPSHOT_INVALID_NODE)
+    {
+        return;
+    }
+    bool isAdded = name ? NAPIHeapSnapshotAddEdge(builder->snapshot, from, to, type, name)
+                        : NAPIHeapSnapshotAddIndexedEdge(builder->snapshot, from, to, type, index);
+    if (!isAdded)
+    {
+        builder->isMemoryError = true;
+    }
 }
-NAPICommonStatus NAPISetMessageQueueThread(__attribute__((unused)) NAPIEnv env,
-                                           __attribute__((unused)) MessageQueueThreadWrapper jsQueueWrapper)
+
+// 规范的数组下标，不包含前导 0
+static bool parseArrayIndex(const char *name, size_t *index)
 {
-    return NAPICommonOK;
+    size_t length = strlen(name);
+    if (!length || length > 10 || (name[0] == '0' && length > 1))
+    {
+        return false;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (name[i] < '0' || name[i] > '9')
+        {
+            return false;
+        }
+        value = value * 10 + (uint64_t)(name[i] - '0');
+    }
+    if (value >= UINT32_MAX)
+    {
+        return false;
+    }
+    *index = (size_t)value;
+
+    return true;
 }
 
-NAPI_EXPORT NAPIExceptionStatus NAPICompileToByteBuffer(NAPIEnv env, const char *script, const char *sourceUrl,
-                                                        const uint8_t **byteBuffer, size_t *bufferSize)
+static void addSnapshotPropertyEdge(struct HeapSnapshotBuilder *builder, size_t from, JSValueConst value,
+                                    const char *prefix, const char *name)
 {
-    NAPI_PREAMBLE(env)
-    CHECK_ARG(byteBuffer, Exception)
+    size_t index;
+    if (!prefix && parseArrayIndex(name, &index))
+    {
+        addSnapshotEdge(builder, from, value, NAPIHeapSnapshotElementEdge, NULL, index);
 
-    if (!script)
+        return;
+    }
+    char edgeName[HEAP_SNAPSHOT_MAX_NAME_LENGTH + 1];
+    snprintf(edgeName, sizeof(edgeName), "%s%s", prefix ? prefix : "", name);
+    addSnapshotEdge(builder, from, value, NAPIHeapSnapshotPropertyEdge, edgeName, 0);
+}
+
+// 函数和对象优先使用函数名和构造函数名，其他 GC 对象使用固定名称
+static void walkSnapshotObject(void *opaque, JSGCObjectHeader *gp, JSHeapObjectTypeEnum type, JSAtom className,
+                                  JSValueConst nameValue, size_t size)
+{
+    struct HeapSnapshotBuilder *builder = opaque;
+    if (builder->isMemoryError)
     {
-        script = "";
+        return;
     }
-    if (!sourceUrl)
+    JSContext *context = builder->env->context;
+    char name[HEAP_SNAPSHOT_MAX_NAME_LENGTH + 1] = "";
+    NAPIHeapSnapshotNodeType nodeType;
+    switch (type)
     {
-        sourceUrl = "";
+    case JS_HEAP_OBJECT_ARRAY:
+        nodeType = NAPIHeapSnapshotArrayNode;
+        break;
+    case JS_HEAP_OBJECT_FUNCTION:
+        nodeType = NAPIHeapSnapshotClosureNode;
+        break;
+    case JS_HEAP_OBJECT_FUNCTION_BYTECODE:
+        nodeType = NAPIHeapSnapshotCodeNode;
+        strcpy(name, "(bytecode)");
+        break;
+    case JS_HEAP_OBJECT_VAR_REF:
+        nodeType = NAPIHeapSnapshotHiddenNode;
+        strcpy(name, "(closure variable)");
+        break;
+    case JS_HEAP_OBJECT_ASYNC_FUNCTION:
+        nodeType = NAPIHeapSnapshotHiddenNode;
+        strcpy(name, "(async function frame)");
+        break;
+    case JS_HEAP_OBJECT_CONTEXT:
+        nodeType = NAPIHeapSnapshotHiddenNode;
+        strcpy(name, "(context)");
+        break;
+    default:
+        nodeType = NAPIHeapSnapshotObjectNode;
+        break;
     }
-    JSValue returnValue =
-        JS_Eval(env->context, script, strlen(script), sourceUrl, JS_EVAL_FLAG_COMPILE_ONLY | JS_EVAL_TYPE_GLOBAL);
-    if (JS_IsException(returnValue))
+    if (className != JS_ATOM_NULL)
     {
-        goto exceptionHandler;
+        copySnapshotNameFromAtom(context, name, className);
+        copySnapshotNameFromValue(context, name, nameValue);
     }
-    *byteBuffer = JS_WriteObject(env->context, bufferSize, returnValue, JS_WRITE_OBJ_BYTECODE);
-    JS_FreeValue(env->context, returnValue);
-    if (!*byteBuffer)
+    if (NAPIHeapSnapshotAddNode(builder->snapshot, gp, nodeType, name, size, NULL) == NAPI_HEAP_SNAPSHOT_INVALID_NODE)
     {
-        goto exceptionHandler;
+        builder->isMemoryError = true;
     }
+}
 
-    return NAPIExceptionOK;
+static size_t findSnapshotFromNode(struct HeapSnapshotBuilder *builder, JSGCObjectHeader *gp)
+{
+    if (builder->fromAddress != gp)
+    {
+        builder->fromAddress = gp;
+        builder->fromIndex = NAPIHeapSnapshotFindNode(builder->snapshot, gp);
+        builder->internalIndex = 0;
+    }
 
-exceptionHandler : {
-    JSValue exceptionValue = JS_GetException(env->context);
-    if (JS_IsNull(exceptionValue))
+    return builder->fromIndex;
+}
+
+static void walkSnapshotProperty(void *opaque, JSGCObjectHeader *gp, JSHeapPropertyEnum type, JSAtom prop,
+                                    uint32_t index, JSValueConst value)
+{
+    struct HeapSnapshotBuilder *builder = opaque;
+    size_t from = findSnapshotFromNode(builder, gp);
+    if (builder->isMemoryError || from == NAPI_HEAP_SNAPSHOT_INVALID_NODE)
     {
-        env->isThrowNull = true;
+        return;
     }
-    else
+    if (type == JS_HEAP_PROPERTY_ELEMENT)
     {
-        JS_Throw(env->context, exceptionValue);
+        addSnapshotEdge(builder, from, value, NAPIHeapSnapshotElementEdge, NULL, index);
+
+        return;
     }
-}
+    if (type == JS_HEAP_PROPERTY_PROTO)
+    {
+        addSnapshotEdge(builder, from, value, NAPIHeapSnapshotPropertyEdge, "__proto__", 0);
 
-    return NAPIExceptionPendingException;
+        return;
+    }
+    char name[HEAP_SNAPSHOT_MAX_NAME_LENGTH + 1] = "";
+    copySnapshotNameFromAtom(builder->env->context, name, prop);
+    const char *prefix = NULL;
+    if (type == JS_HEAP_PROPERTY_GETTER)
+    {
+        prefix = "get ";
+    }
+    else if (type == JS_HEAP_PROPERTY_SETTER)
+    {
+        prefix = "set ";
+    }
+    addSnapshotPropertyEdge(builder, from, value, prefix, name);
 }
 
-NAPI_EXPORT NAPICommonStatus NAPIFreeByteBuffer(NAPIEnv env, const uint8_t *byteBuffer)
+// 闭包变量、Map/Set 的元素、Promise 的回调等内部引用没有名称，使用 hidden 类型的边
+static void walkSnapshotInternal(void *opaque, JSGCObjectHeader *gp, JSGCObjectHeader *child)
 {
-    CHECK_ARG(env, Common)
-
-    js_free(env->context, (void *)byteBuffer);
-
-    return NAPICommonOK;
+    struct HeapSnapshotBuilder *builder = opaque;
+    size_t from = findSnapshotFromNode(builder, gp);
+    size_t to = NAPIHeapSnapshotFindNode(builder->snapshot, child);
+    if (builder->isMemoryError || from == NAPI_HEAP_SNAPSHOT_INVALID_NODE || to == NAPI_HEAP_SNAPSHOT_INVALID_NODE)
+    {
+        return;
+    }
+    if (!NAPIHeapSnapshotAddIndexedEdge(builder->snapshot, from, to, NAPIHeapSnapshotHiddenEdge,
+                                        builder->internalIndex++))
+    {
+        builder->isMemoryError = true;
+    }
 }
 
-NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBuffer(NAPIEnv env, const uint8_t *byteBuffer, size_t bufferSize,
-                                                  NAPIValue *result)
+// 通过 JS_WalkHeap 遍历 JSRuntime 中的所有 GC 对象，不执行 JS，Proxy 的 trap 和 getter 都不会被调用
+// 第一次遍历创建节点，第二次遍历添加边，被引用的对象总是已经有节点
+NAPIErrorStatus NAPIWriteHeapSnapshot(NAPIEnv env, const char *path)
 {
-    NAPI_PREAMBLE(env)
+    CHECK_ARG(env, Error)
+    CHECK_ARG(path, Error)
+
+    struct HeapSnapshotBuilder builder;
+    memset(&builder, 0, sizeof(struct HeapSnapshotBuilder));
+    builder.env = env;
+    builder.snapshot = NAPIHeapSnapshotCreate();
+    RETURN_STATUS_IF_FALSE(builder.snapshot, NAPIErrorMemoryError)
+    // 内存不足等错误会清除异常，先取出调用前未处理的异常，结束后恢复
+    JSValue exceptionValue = JS_GetException(env->context);
 
-    JSValue functionValue = JS_ReadObject(env->context, byteBuffer, bufferSize, JS_READ_OBJ_BYTECODE);
-    if (JS_IsException(functionValue))
+    // 绑定层持有的值按来源分组，作为根节点下的合成节点
+    size_t rootIndex = addSyntheticSnapshotNode(&builder, NAPI_HEAP_SNAPSHOT_INVALID_NODE, 0, "");
+    size_t strongReferencesIndex = addSyntheticSnapshotNode(&builder, rootIndex, 1, "(Strong references)");
+    size_t handleScopesIndex = addSyntheticSnapshotNode(&builder, rootIndex, 2, "(Handle scopes)");
+    size_t weakReferencesIndex = addSyntheticSnapshotNode(&builder, rootIndex, 3, "(Weak references)");
+    size_t bindingInternalsIndex = addSyntheticSnapshotNode(&builder, rootIndex, 4, "(Binding internals)");
+    if (!builder.isMemoryError)
     {
-        goto exceptionHandler;
+        const JSHeapWalkFuncs nodeFuncs = {walkSnapshotObject, NULL, NULL};
+        JS_WalkHeap(env->runtime->runtime, &nodeFuncs, &builder);
     }
 
-    JSValue returnValue = JS_EvalFunction(env->context, functionValue);
-    if (JS_IsException(returnValue))
+    // JSContext 持有全局对象和内置对象的原型
+    size_t contextIndex = NAPIHeapSnapshotFindNode(builder.snapshot, env->context);
+    if (!builder.isMemoryError && contextIndex != NAPI_HEAP_SNAPSHOT_INVALID_NODE &&
+        !NAPIHeapSnapshotAddIndexedEdge(builder.snapshot, rootIndex, contextIndex, NAPIHeapSnapshotElementEdge, 5))
     {
-        goto exceptionHandlerWithProcess;
+        builder.isMemoryError = true;
     }
-    processPendingTask(env);
-    if (result)
+    addSnapshotEdge(&builder, rootIndex, env->globalValue, NAPIHeapSnapshotShortcutEdge, "global", 0);
+    size_t index = 0;
+    NAPIRef ref;
+    LIST_FOREACH(ref, &env->strongRefList, node)
     {
-        struct Handle *returnHandle;
-        NAPIErrorStatus status = addValueToHandleScope(env, returnValue, &returnHandle);
-        if (__builtin_expect(status != NAPIErrorOK, false))
+        addSnapshotEdge(&builder, strongReferencesIndex, ref->value, NAPIHeapSnapshotElementEdge, NULL, index++);
+    }
+    // handle 栈中当前块之前的块都是满的
+    index = 0;
+    for (struct HandleBlock *handleBlock = &env->firstHandleBlock; handleBlock;
+         handleBlock = handleBlock == env->handleBlock ? NULL : handleBlock->next)
+    {
+        size_t handleCount = handleBlock == env->handleBlock ? env->handleIndex : HANDLE_BLOCK_CAPACITY;
+        for (size_t i = 0; i < handleCount; ++i)
         {
-            JS_FreeValue(env->context, returnValue);
-
-            return (NAPIExceptionStatus)status;
+            addSnapshotEdge(&builder, handleScopesIndex, handleBlock->values[i], NAPIHeapSnapshotElementEdge, NULL,
+                            index++);
         }
-        *result = (NAPIValue)&returnHandle->value;
     }
-    else
+    // weak 类型的边只能使用名称
+    index = 0;
+    struct WeakReference *referenceInfo;
+    LIST_FOREACH(referenceInfo, &env->weakReferenceList, node)
     {
-        JS_FreeValue(env->context, returnValue);
+        LIST_FOREACH(ref, &referenceInfo->weakRefList, node)
+        {
+            char edgeName[24];
+            snprintf(edgeName, sizeof(edgeName), "%zu", index++);
+            addSnapshotEdge(&builder, weakReferencesIndex, ref->value, NAPIHeapSnapshotWeakEdge, edgeName, 0);
+        }
     }
-
-    return NAPIExceptionOK;
-
-exceptionHandler : {
-    JSValue exceptionValue = JS_GetException(env->context);
-    if (JS_IsNull(exceptionValue))
+    addSnapshotEdge(&builder, bindingInternalsIndex, env->referenceSymbolValue, NAPIHeapSnapshotInternalEdge,
+                    "referenceSymbol", 0);
+    if (!builder.isMemoryError)
     {
-        env->isThrowNull = true;
+        const JSHeapWalkFuncs edgeFuncs = {NULL, walkSnapshotProperty, walkSnapshotInternal};
+        JS_WalkHeap(env->runtime->runtime, &edgeFuncs, &builder);
     }
-    else
+
+    NAPIErrorStatus status = NAPIErrorOK;
+    if (builder.isMemoryError)
     {
-        JS_Throw(env->context, exceptionValue);
+        status = NAPIErrorMemoryError;
     }
-}
-    return NAPIExceptionPendingException;
-
-exceptionHandlerWithProcess : {
-    JSValue exceptionValue = JS_GetException(env->context);
-    processPendingTask(env);
-    if (JS_IsNull(exceptionValue))
+    else if (!NAPIHeapSnapshotWrite(builder.snapshot, path))
     {
-        env->isThrowNull = true;
+        status = NAPIErrorGenericFailure;
     }
-    else
+    NAPIHeapSnapshotFree(builder.snapshot);
+    if (!JS_IsNull(exceptionValue))
     {
         JS_Throw(env->context, exceptionValue);
     }
-}
 
-    return NAPIExceptionPendingException;
+    return status;
 }
\ No newline at end of file
@@ -0,0 +1,510 @@
+#include "js_native_api_unicode.h"
+
+// x86_64 默认启用 SSE2，AArch64 默认启用 NEON，不需要额外编译参数
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define NAPI_UNICODE_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define NAPI_UNICODE_NEON 1
+#endif
+
+#define REPLACEMENT_CHARACTER 0xFFFD
+
+// 向量化处理以 16 字节（8 个 UTF-16 code unit）为一块，无法整块处理时回退到标量逻辑一个块的长度
+#define BLOCK_SIZE 16
+
+// 返回 string 开头连续 ASCII 字节的数量
+static inline size_t asciiPrefixLength(const uint8_t *string, size_t length)
+{
+    size_t i = 0;
+#if NAPI_UNICODE_SSE2
+    for (; i + BLOCK_SIZE <= length; i += BLOCK_SIZE)
+    {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(string + i)));
+        if (mask)
+        {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#elif NAPI_UNICODE_NEON
+    for (; i + BLOCK_SIZE <= length; i += BLOCK_SIZE)
+    {
+        if (vmaxvq_u8(vld1q_u8(string + i)) >= 0x80)
+        {
+            break;
+        }
+    }
+#endif
+    while (i < length && string[i] < 0x80)
+    {
+        ++i;
+    }
+
+    return i;
+}
+
+// 任意字节零扩展为 code unit，ASCII 和 Latin-1 共用
+static inline void widenBytes(const uint8_t *string, size_t length, uint16_t *buffer)
+{
+    size_t i = 0;
+#if NAPI_UNICODE_SSE2
+    __m128i zero = _mm_setzero_si128();
+    for (; i + BLOCK_SIZE <= length; i += BLOCK_SIZE)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(string + i));
+        _mm_storeu_si128((__m128i *)(buffer + i), _mm_unpacklo_epi8(chunk, zero));
+        _mm_storeu_si128((__m128i *)(buffer + i + 8), _mm_unpackhi_epi8(chunk, zero));
+    }
+#elif NAPI_UNICODE_NEON
+    for (; i + BLOCK_SIZE <= length; i += BLOCK_SIZE)
+    {
+        uint8x16_t chunk = vld1q_u8(string + i);
+        vst1q_u16(buffer + i, vmovl_u8(vget_low_u8(chunk)));
+        vst1q_u16(buffer + i + 8, vmovl_high_u8(chunk));
+    }
+#endif
+    for (; i < length; ++i)
+    {
+        buffer[i] = string[i];
+    }
+}
+
+// 连续 ASCII code unit 按块收窄为字节，返回处理的 code unit 数量，可能小于实际 ASCII 前缀长度
+static inline size_t narrowASCIIBlocks(const uint16_t *string, size_t length, uint8_t *buffer)
+{
+    size_t i = 0;
+#if NAPI_UNICODE_SSE2
+    __m128i nonASCIIMask = _mm_set1_epi16((short)0xFF80);
+    for (; i + BLOCK_SIZE <= length; i += BLOCK_SIZE)
+    {
+        __m128i low = _mm_loadu_si128((const __m128i *)(string + i));
+        __m128i high = _mm_loadu_si128((const __m128i *)(string + i + 8));
+        __m128i nonASCII = _mm_and_si128(_mm_or_si128(low, high), nonASCIIMask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(nonASCII, _mm_setzero_si128())) != 0xFFFF)
+        {
+            break;
+        }
+        _mm_storeu_si128((__m128i *)(buffer + i), _mm_packus_epi16(low, high));
+    }
+#elif NAPI_UNICODE_NEON
+    for (; i + BLOCK_SIZE <= length; i += BLOCK_SIZE)
+    {
+        uint16x8_t low = vld1q_u16(string + i);
+        uint16x8_t high = vld1q_u16(string + i + 8);
+        if (vmaxvq_u16(vorrq_u16(low, high)) >= 0x80)
+        {
+            break;
+        }
+        vst1q_u8(buffer + i, vcombine_u8(vmovn_u16(low), vmovn_u16(high)));
+    }
+#else
+    (void)string;
+    (void)length;
+    (void)buffer;
+#endif
+
+    return i;
+}
+
+// 8 个 code unit 均不是代理项时返回 true，并通过 *utf8Length 返回对应的 UTF-8 字节数
+static inline bool utf8LengthOfBMPBlock(const uint16_t *string, size_t *utf8Length)
+{
+#if NAPI_UNICODE_SSE2
+    __m128i chunk = _mm_loadu_si128((const __m128i *)string);
+    __m128i zero = _mm_setzero_si128();
+    __m128i upperBits = _mm_and_si128(chunk, _mm_set1_epi16((short)0xF800));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(upperBits, _mm_set1_epi16((short)0xD800))))
+    {
+        return false;
+    }
+    // movemask 每个 code unit 对应两位
+    int asciiMask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(chunk, _mm_set1_epi16((short)0xFF80)), zero));
+    int twoBytesMask = _mm_movemask_epi8(_mm_cmpeq_epi16(upperBits, zero));
+    *utf8Length = 24 - (__builtin_popcount(asciiMask) + __builtin_popcount(twoBytesMask)) / 2;
+
+    return true;
+#elif NAPI_UNICODE_NEON
+    uint16x8_t chunk = vld1q_u16(string);
+    uint16x8_t upperBits = vandq_u16(chunk, vdupq_n_u16(0xF800));
+    if (vmaxvq_u16(vceqq_u16(upperBits, vdupq_n_u16(0xD800))))
+    {
+        return false;
+    }
+    // 1 + (>= 0x80) + (>= 0x800)
+    uint16x8_t lengths = vaddq_u16(vshrq_n_u16(vcgeq_u16(chunk, vdupq_n_u16(0x80)), 15),
+                                   vshrq_n_u16(vcgeq_u16(chunk, vdupq_n_u16(0x800)), 15));
+    *utf8Length = 8 + vaddvq_u16(lengths);
+
+    return true;
+#else
+    (void)string;
+    (void)utf8Length;
+
+    return false;
+#endif
+}
+
+// 返回码点，非法序列返回 U+FFFD，*consumed 为消耗的字节数（按最大合法子序列计算）
+static inline uint32_t decodeUTF8(const uint8_t *string, const uint8_t *end, size_t *consumed)
+{
+    uint8_t first = string[0];
+    if (first < 0x80)
+    {
+        *consumed = 1;
+
+        return first;
+    }
+    // 中文等 BMP 字符以三字节序列为主，单独处理
+    if ((first & 0xF0) == 0xE0 && end - string >= 3 && (string[1] & 0xC0) == 0x80 && (string[2] & 0xC0) == 0x80)
+    {
+        uint32_t codePoint =
+            ((uint32_t)(first & 0x0F) << 12) | ((uint32_t)(string[1] & 0x3F) << 6) | (string[2] & 0x3F);
+        // 排除过长编码和代理项
+        if (codePoint >= 0x800 && (codePoint < 0xD800 || codePoint > 0xDFFF))
+        {
+            *consumed = 3;
+
+            return codePoint;
+        }
+    }
+    size_t continuationCount;
+    uint8_t lowerBoundary = 0x80;
+    uint8_t upperBoundary = 0xBF;
+    uint32_t codePoint;
+    if (first >= 0xC2 && first <= 0xDF)
+    {
+        continuationCount = 1;
+        codePoint = first & 0x1F;
+    }
+    else if (first >= 0xE0 && first <= 0xEF)
+    {
+        continuationCount = 2;
+        codePoint = first & 0x0F;
+        if (first == 0xE0)
+        {
+            lowerBoundary = 0xA0;
+        }
+        else if (first == 0xED)
+        {
+            // 排除代理项
+            upperBoundary = 0x9F;
+        }
+    }
+    else if (first >= 0xF0 && first <= 0xF4)
+    {
+        continuationCount = 3;
+        codePoint = first & 0x07;
+        if (first == 0xF0)
+        {
+            lowerBoundary = 0x90;
+        }
+        else if (first == 0xF4)
+        {
+            upperBoundary = 0x8F;
+        }
+    }
+    else
+    {
+        *consumed = 1;
+
+        return REPLACEMENT_CHARACTER;
+    }
+    size_t i = 1;
+    for (; i <= continuationCount; ++i)
+    {
+        if (string + i >= end || string[i] < lowerBoundary || string[i] > upperBoundary)
+        {
+            *consumed = i;
+
+            return REPLACEMENT_CHARACTER;
+        }
+        codePoint = (codePoint << 6) | (string[i] & 0x3F);
+        lowerBoundary = 0x80;
+        upperBoundary = 0xBF;
+    }
+    *consumed = i;
+
+    return codePoint;
+}
+
+bool NAPIUnicodeIsASCII(const char *string, size_t length)
+{
+    return asciiPrefixLength((const uint8_t *)string, length) == length;
+}
+
+size_t NAPIUnicodeUTF16LengthOfUTF8(const char *utf8String, size_t length)
+{
+    const uint8_t *string = (const uint8_t *)utf8String;
+    const uint8_t *end = string + length;
+    size_t utf16Length = 0;
+    while (string < end)
+    {
+        // 遇到 ASCII 才进入向量化逻辑，ASCII 字节对应一个 code unit
+        if (*string < 0x80)
+        {
+            size_t asciiLength = asciiPrefixLength(string, end - string);
+            string += asciiLength;
+            utf16Length += asciiLength;
+            continue;
+        }
+        size_t consumed;
+        uint32_t codePoint = decodeUTF8(string, end, &consumed);
+        string += consumed;
+        utf16Length += codePoint >= 0x10000 ? 2 : 1;
+    }
+
+    return utf16Length;
+}
+
+size_t NAPIUnicodeConvertUTF8ToUTF16(const char *utf8String, size_t length, uint16_t *buffer)
+{
+    return NAPIUnicodeConvertUTF8ToUTF16Partial(utf8String, length, buffer, SIZE_MAX);
+}
+
+size_t NAPIUnicodeConvertUTF8ToUTF16Partial(const char *utf8String, size_t length, uint16_t *buffer, size_t capacity)
+{
+    const uint8_t *string = (const uint8_t *)utf8String;
+    const uint8_t *end = string + length;
+    uint16_t *output = buffer;
+    size_t remaining = capacity;
+    while (string < end)
+    {
+        if (*string < 0x80)
+        {
+            if (!remaining)
+            {
+                break;
+            }
+            size_t asciiLength = asciiPrefixLength(string, end - string);
+            if (asciiLength > remaining)
+            {
+                asciiLength = remaining;
+            }
+            widenBytes(string, asciiLength, output);
+            string += asciiLength;
+            output += asciiLength;
+            remaining -= asciiLength;
+            continue;
+        }
+        size_t consumed;
+        uint32_t codePoint = decodeUTF8(string, end, &consumed);
+        if (codePoint >= 0x10000)
+        {
+            if (remaining < 2)
+            {
+                break;
+            }
+            remaining -= 2;
+            codePoint -= 0x10000;
+            *output++ = (uint16_t)(0xD800 | (codePoint >> 10));
+            *output++ = (uint16_t)(0xDC00 | (codePoint & 0x3FF));
+        }
+        else
+        {
+            if (!remaining)
+            {
+                break;
+            }
+            --remaining;
+            *output++ = (uint16_t)codePoint;
+        }
+        string += consumed;
+    }
+
+    return output - buffer;
+}
+
+// 返回码点，孤立代理项返回 U+FFFD，*consumed 为消耗的 code unit 数量
+static inline uint32_t decodeUTF16(const uint16_t *string, const uint16_t *end, size_t *consumed)
+{
+    uint16_t first = string[0];
+    *consumed = 1;
+    if (first < 0xD800 || first > 0xDFFF)
+    {
+        return first;
+    }
+    if (first <= 0xDBFF && string + 1 < end && string[1] >= 0xDC00 && string[1] <= 0xDFFF)
+    {
+        *consumed = 2;
+
+        return 0x10000 + (((uint32_t)first - 0xD800) << 10) + (string[1] - 0xDC00);
+    }
+
+    return REPLACEMENT_CHARACTER;
+}
+
+size_t NAPIUnicodeUTF8LengthOfUTF16(const uint16_t *utf16String, size_t length)
+{
+    const uint16_t *end = utf16String + length;
+    size_t utf8Length = 0;
+    while (utf16String < end)
+    {
+        size_t blockUTF8Length;
+        if (end - utf16String >= 8 && utf8LengthOfBMPBlock(utf16String, &blockUTF8Length))
+        {
+            utf8Length += blockUTF8Length;
+            utf16String += 8;
+            continue;
+        }
+        // 块内存在代理项或者不足一块，标量处理到块结束
+        const uint16_t *blockEnd = end - utf16String > 8 ? utf16String + 8 : end;
+        while (utf16String < blockEnd)
+        {
+            size_t consumed;
+            uint32_t codePoint = decodeUTF16(utf16String, end, &consumed);
+            utf16String += consumed;
+            utf8Length += codePoint < 0x80 ? 1 : codePoint < 0x800 ? 2 : codePoint < 0x10000 ? 3 : 4;
+        }
+    }
+
+    return utf8Length;
+}
+
+size_t NAPIUnicodeConvertUTF16ToUTF8(const uint16_t *utf16String, size_t length, char *buffer)
+{
+    return NAPIUnicodeConvertUTF16ToUTF8Partial(utf16String, length, buffer, SIZE_MAX);
+}
+
+size_t NAPIUnicodeConvertUTF16ToUTF8Partial(const uint16_t *utf16String, size_t length, char *buffer, size_t capacity)
+{
+    const uint16_t *end = utf16String + length;
+    uint8_t *output = (uint8_t *)buffer;
+    size_t remaining = capacity;
+    while (utf16String < end)
+    {
+        if (*utf16String < 0x80)
+        {
+            if (!remaining)
+            {
+                break;
+            }
+            size_t unitCount = end - utf16String;
+            size_t asciiLength = narrowASCIIBlocks(utf16String, unitCount < remaining ? unitCount : remaining, output);
+            utf16String += asciiLength;
+            output += asciiLength;
+            remaining -= asciiLength;
+            // 不足一块的 ASCII 标量处理，避免逐个 code unit 重复进入向量化逻辑
+            while (utf16String < end && *utf16String < 0x80 && remaining)
+            {
+                *output++ = (uint8_t)*utf16String++;
+                --remaining;
+            }
+            continue;
+        }
+        size_t consumed;
+        uint32_t codePoint = decodeUTF16(utf16String, end, &consumed);
+        size_t codePointLength = codePoint < 0x80 ? 1 : codePoint < 0x800 ? 2 : codePoint < 0x10000 ? 3 : 4;
+        if (remaining < codePointLength)
+        {
+            break;
+        }
+        remaining -= codePointLength;
+        utf16String += consumed;
+        switch (codePointLength)
+        {
+        case 1:
+            *output++ = (uint8_t)codePoint;
+            break;
+        case 2:
+            *output++ = (uint8_t)(0xC0 | (codePoint >> 6));
+            *output++ = (uint8_t)(0x80 | (codePoint & 0x3F));
+            break;
+        case 3:
+            *output++ = (uint8_t)(0xE0 | (codePoint >> 12));
+            *output++ = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+            *output++ = (uint8_t)(0x80 | (codePoint & 0x3F));
+            break;
+        default:
+            *output++ = (uint8_t)(0xF0 | (codePoint >> 18));
+            *output++ = (uint8_t)(0x80 | ((codePoint >> 12) & 0x3F));
+            *output++ = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+            *output++ = (uint8_t)(0x80 | (codePoint & 0x3F));
+            break;
+        }
+    }
+
+    return output - (uint8_t *)buffer;
+}
+
+size_t NAPIUnicodeUTF8LengthOfLatin1(const char *latin1String, size_t length)
+{
+    const uint8_t *string = (const uint8_t *)latin1String;
+    size_t utf8Length = length;
+    size_t i = 0;
+#if NAPI_UNICODE_SSE2
+    for (; i + BLOCK_SIZE <= length; i += BLOCK_SIZE)
+    {
+        utf8Length += __builtin_popcount(_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(string + i))));
+    }
+#elif NAPI_UNICODE_NEON
+    for (; i + BLOCK_SIZE <= length; i += BLOCK_SIZE)
+    {
+        utf8Length += vaddvq_u8(vshrq_n_u8(vld1q_u8(string + i), 7));
+    }
+#endif
+    for (; i < length; ++i)
+    {
+        // 0x80 ~ 0xFF 需要两个字节
+        utf8Length += string[i] >> 7;
+    }
+
+    return utf8Length;
+}
+
+size_t NAPIUnicodeConvertLatin1ToUTF8(const char *latin1String, size_t length, char *buffer)
+{
+    uint8_t *output = (uint8_t *)buffer;
+    for (size_t i = 0; i < length; ++i)
+    {
+        uint8_t character = (uint8_t)latin1String[i];
+        if (character < 0x80)
+        {
+            *output++ = character;
+        }
+        else
+        {
+            *output++ = (uint8_t)(0xC0 | (character >> 6));
+            *output++ = (uint8_t)(0x80 | (character & 0x3F));
+        }
+    }
+
+    return output - (uint8_t *)buffer;
+}
+
+void NAPIUnicodeConvertLatin1ToUTF16(const char *latin1String, size_t length, uint16_t *buffer)
+{
+    widenBytes((const uint8_t *)latin1String, length, buffer);
+}
+
+size_t NAPIUnicodeTruncateUTF8(const char *utf8String, size_t length, size_t capacity)
+{
+    if (length <= capacity)
+    {
+        return length;
+    }
+    // 回退到码点起始字节
+    size_t truncatedLength = capacity;
+    while (truncatedLength && ((uint8_t)utf8String[truncatedLength] & 0xC0) == 0x80)
+    {
+        --truncatedLength;
+    }
+
+    return truncatedLength;
+}
+
+size_t NAPIUnicodeTruncateUTF16(const uint16_t *utf16String, size_t length, size_t capacity)
+{
+    if (length <= capacity)
+    {
+        return length;
+    }
+    // 不拆分代理对
+    if (capacity && utf16String[capacity - 1] >= 0xD800 && utf16String[capacity - 1] <= 0xDBFF &&
+        utf16String[capacity] >= 0xDC00 && utf16String[capacity] <= 0xDFFF)
+    {
+        return capacity - 1;
+    }
+
+    return capacity;
+}
@@ -0,0 +1,49 @@
+#ifndef SRC_JS_NATIVE_API_UNICODE_H_
+#define SRC_JS_NATIVE_API_UNICODE_H_
+
+// 内部使用的编码转换函数，不对外导出
+// 非法 UTF-8 序列和孤立代理项都会被替换为 U+FFFD
+
+#include <napi/js_native_api_types.h>
+
+EXTERN_C_START
+
+#include <stdbool.h> // NOLINT(modernize-deprecated-headers)
+#include <stddef.h>  // NOLINT(modernize-deprecated-headers)
+#include <stdint.h>  // NOLINT(modernize-deprecated-headers)
+
+bool NAPIUnicodeIsASCII(const char *string, size_t length);
+
+size_t NAPIUnicodeUTF16LengthOfUTF8(const char *utf8String, size_t length);
+
+// buffer 大小至少为 NAPIUnicodeUTF16LengthOfUTF8()，返回写入的 code unit 数量
+size_t NAPIUnicodeConvertUTF8ToUTF16(const char *utf8String, size_t length, uint16_t *buffer);
+
+// 最多写入 capacity 个 code unit，不拆分码点，返回写入的 code unit 数量
+size_t NAPIUnicodeConvertUTF8ToUTF16Partial(const char *utf8String, size_t length, uint16_t *buffer, size_t capacity);
+
+size_t NAPIUnicodeUTF8LengthOfUTF16(const uint16_t *utf16String, size_t length);
+
+// buffer 大小至少为 NAPIUnicodeUTF8LengthOfUTF16()，返回写入的字节数，不写入 \0
+size_t NAPIUnicodeConvertUTF16ToUTF8(const uint16_t *utf16String, size_t length, char *buffer);
+
+// 最多写入 capacity 个字节，不拆分码点，返回写入的字节数，不写入 \0
+size_t NAPIUnicodeConvertUTF16ToUTF8Partial(const uint16_t *utf16String, size_t length, char *buffer, size_t capacity);
+
+size_t NAPIUnicodeUTF8LengthOfLatin1(const char *latin1String, size_t length);
+
+// buffer 大小至少为 NAPIUnicodeUTF8LengthOfLatin1()，返回写入的字节数，不写入 \0
+size_t NAPIUnicodeConvertLatin1ToUTF8(const char *latin1String, size_t length, char *buffer);
+
+// buffer 大小至少为 length
+void NAPIUnicodeConvertLatin1ToUTF16(const char *latin1String, size_t length, uint16_t *buffer);
+
+// 返回不超过 capacity 且不拆分码点的前缀长度，utf8String 需为合法 UTF-8
+size_t NAPIUnicodeTruncateUTF8(const char *utf8String, size_t length, size_t capacity);
+
+// 返回不超过 capacity 且不拆分代理对的前缀长度
+size_t NAPIUnicodeTruncateUTF16(const uint16_t *utf16String, size_t length, size_t capacity);
+
+EXTERN_C_END
+
+#endif // SRC_JS_NATIVE_API_UNICODE_H_
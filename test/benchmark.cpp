@@ -0,0 +1,321 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <string>
+#include <test.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr size_t kBenchmarkBatchCount = 100;
+
+constexpr size_t kBenchmarkBatchSize = 1000;
+
+// 返回每秒调用次数，每批调用使用一个 handleScope 避免句柄持续增长
+double measureCallFunction(NAPIValue functionValue, size_t argc, const NAPIValue *argv)
+{
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kBenchmarkBatchCount; ++i)
+    {
+        NAPIHandleScope batchHandleScope;
+        EXPECT_EQ(napi_open_handle_scope(globalEnv, &batchHandleScope), NAPIErrorOK);
+        for (size_t j = 0; j < kBenchmarkBatchSize; ++j)
+        {
+            NAPIValue returnValue;
+            EXPECT_EQ(napi_call_function(globalEnv, nullptr, functionValue, argc, argv, &returnValue),
+                      NAPIExceptionOK);
+        }
+        EXPECT_EQ(napi_close_handle_scope(globalEnv, batchHandleScope), NAPICommonOK);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    return (double)(kBenchmarkBatchCount * kBenchmarkBatchSize) / elapsed.count();
+}
+
+// 用于生成一段足够大的脚本，放大解析和编译的开销
+std::string makeBenchmarkScript(const char *functionPrefix, size_t functionCount)
+{
+    std::string script;
+    for (size_t i = 0; i < functionCount; ++i)
+    {
+        auto index = std::to_string(i);
+        script += std::string("function ") + functionPrefix + index + "(a) { var b = [a, " + index +
+                  "]; return b[0] + b[1]; }\n";
+    }
+    script += functionPrefix + std::to_string(functionCount - 1) + "(1);";
+
+    return script;
+}
+
+void removeDirectory(const char *directory)
+{
+    DIR *dir = opendir(directory);
+    if (dir)
+    {
+        while (struct dirent *entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            if (name != "." && name != "..")
+            {
+                unlink((std::string(directory) + "/" + name).c_str());
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(directory);
+}
+
+// 创建临时缓存目录，析构时取消 globalEnv 的缓存目录并删除，ASSERT 提前返回也不会影响后续测试
+struct CodeCacheDirectoryGuard
+{
+    CodeCacheDirectoryGuard() : isCreated(mkdtemp(path) != nullptr)
+    {
+    }
+
+    ~CodeCacheDirectoryGuard()
+    {
+        if (isCreated)
+        {
+            EXPECT_EQ(NAPISetCodeCacheDirectory(globalEnv, nullptr), NAPIErrorOK);
+            removeDirectory(path);
+        }
+    }
+
+    char path[sizeof("/tmp/napi_code_cache_XXXXXX")] = "/tmp/napi_code_cache_XXXXXX";
+    const bool isCreated;
+};
+} // namespace
+
+TEST_F(Test, CallFunctionBenchmark)
+{
+    NAPIValue functionValue;
+    ASSERT_EQ(NAPIRunScript(globalEnv, "(function () { return arguments.length; })",
+                            "https://n-api.com/call_function_benchmark.js", &functionValue),
+              NAPIExceptionOK);
+    NAPIValue argv[8];
+    for (size_t i = 0; i < 8; ++i)
+    {
+        ASSERT_EQ(napi_create_double(globalEnv, (double)i, &argv[i]), NAPIErrorOK);
+    }
+    // 预热
+    measureCallFunction(functionValue, 8, argv);
+    for (size_t argc : {0, 2, 8})
+    {
+        double callsPerSecond = measureCallFunction(functionValue, argc, argv);
+        // 只记录结果，吞吐量和机器负载有关，不作为测试是否通过的条件
+        RecordProperty("callsPerSecondWith" + std::to_string(argc) + "Arguments",
+                       std::to_string((long long)callsPerSecond));
+    }
+}
+
+TEST_F(Test, GetElementBenchmark)
+{
+    constexpr uint32_t kArrayLength = 10000;
+    NAPIValue arrayValue;
+    ASSERT_EQ(NAPIRunScript(globalEnv, "Array.from({length: 10000}, (_, i) => i)",
+                            "https://n-api.com/get_element_benchmark.js", &arrayValue),
+              NAPIExceptionOK);
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kBenchmarkBatchCount; ++i)
+    {
+        NAPIHandleScope batchHandleScope;
+        EXPECT_EQ(napi_open_handle_scope(globalEnv, &batchHandleScope), NAPIErrorOK);
+        for (uint32_t j = 0; j < kArrayLength; ++j)
+        {
+            NAPIValue elementValue;
+            EXPECT_EQ(napi_get_element(globalEnv, arrayValue, j, &elementValue), NAPIExceptionOK);
+        }
+        EXPECT_EQ(napi_close_handle_scope(globalEnv, batchHandleScope), NAPICommonOK);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    double elementsPerSecond = (double)(kBenchmarkBatchCount * kArrayLength) / elapsed.count();
+    RecordProperty("elementsPerSecond", std::to_string((long long)elementsPerSecond));
+}
+
+TEST_F(Test, StringBenchmark)
+{
+    // 约 1KB 的 ASCII、中英混合、纯中文语料
+    const std::pair<const char *, std::string> corpora[] = {
+        {"ascii", "The quick brown fox jumps over the lazy dog. "},
+        {"mixed", "Hummer 页面渲染完成，耗时 16ms. "},
+        {"cjk", "我能吞下玻璃而不伤身体。"},
+    };
+    for (const auto &corpus : corpora)
+    {
+        std::string text;
+        while (text.size() < 1024)
+        {
+            text += corpus.second;
+        }
+        std::string buffer(text.size() + 1, '\0');
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < kBenchmarkBatchCount; ++i)
+        {
+            NAPIHandleScope batchHandleScope;
+            EXPECT_EQ(napi_open_handle_scope(globalEnv, &batchHandleScope), NAPIErrorOK);
+            for (size_t j = 0; j < kBenchmarkBatchSize; ++j)
+            {
+                NAPIValue stringValue;
+                EXPECT_EQ(napi_create_string_utf8_len(globalEnv, text.data(), text.size(), &stringValue),
+                          NAPIExceptionOK);
+                size_t length;
+                EXPECT_EQ(napi_get_value_string_utf8(globalEnv, stringValue, &buffer[0], buffer.size(), &length),
+                          NAPIErrorOK);
+                EXPECT_EQ(length, text.size());
+            }
+            EXPECT_EQ(napi_close_handle_scope(globalEnv, batchHandleScope), NAPICommonOK);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        // 往返一次按两倍字节数计算
+        double megabytesPerSecond =
+            (double)(kBenchmarkBatchCount * kBenchmarkBatchSize * text.size() * 2) / elapsed.count() / 1e6;
+        RecordProperty(std::string(corpus.first) + "MegabytesPerSecond",
+                       std::to_string((long long)megabytesPerSecond));
+    }
+}
+
+TEST_F(Test, ByteBufferBenchmark)
+{
+    constexpr size_t kFunctionCount = 500;
+    constexpr size_t kRunCount = 20;
+    std::string script = makeBenchmarkScript("byteBufferFunction", kFunctionCount);
+    const char *sourceUrl = "https://n-api.com/byte_buffer_benchmark.js";
+
+    const uint8_t *byteBuffer = nullptr;
+    size_t bufferSize = 0;
+    ASSERT_EQ(NAPICompileToByteBuffer(globalEnv, script.c_str(), sourceUrl, &byteBuffer, &bufferSize),
+              NAPIExceptionOK);
+    if (!byteBuffer)
+    {
+        // 当前引擎不支持字节码
+        return;
+    }
+    NAPIValue value;
+    ASSERT_EQ(NAPIRunByteBuffer(globalEnv, byteBuffer, bufferSize, &value), NAPIExceptionOK);
+    double doubleValue;
+    ASSERT_EQ(napi_get_value_double(globalEnv, value, &doubleValue), NAPIErrorOK);
+    ASSERT_EQ(doubleValue, (double)kFunctionCount);
+
+    char path[] = "/tmp/napi_byte_buffer_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(write(fd, byteBuffer, bufferSize), (ssize_t)bufferSize);
+    ASSERT_EQ(close(fd), 0);
+    EXPECT_EQ(NAPIFreeByteBuffer(globalEnv, byteBuffer), NAPICommonOK);
+    ASSERT_EQ(NAPIRunByteBufferFile(globalEnv, path, &value), NAPIExceptionOK);
+    ASSERT_EQ(napi_get_value_double(globalEnv, value, &doubleValue), NAPIErrorOK);
+    ASSERT_EQ(doubleValue, (double)kFunctionCount);
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kRunCount; ++i)
+    {
+        NAPIHandleScope runHandleScope;
+        EXPECT_EQ(napi_open_handle_scope(globalEnv, &runHandleScope), NAPIErrorOK);
+        EXPECT_EQ(NAPIRunByteBufferFile(globalEnv, path, nullptr), NAPIExceptionOK);
+        EXPECT_EQ(napi_close_handle_scope(globalEnv, runHandleScope), NAPICommonOK);
+    }
+    std::chrono::duration<double, std::milli> byteBufferFileElapsed = std::chrono::steady_clock::now() - begin;
+    // Hermes 的映射由 RuntimeModule 持有，删除目录项不影响已映射的页面
+    unlink(path);
+    ASSERT_EQ(NAPIRunByteBufferFile(globalEnv, path, nullptr), NAPIExceptionGenericFailure);
+
+    RecordProperty("byteBufferSize", std::to_string(bufferSize));
+    RecordProperty("runByteBufferFileMilliseconds", std::to_string(byteBufferFileElapsed.count() / kRunCount));
+}
+
+TEST_F(Test, CodeCacheBenchmark)
+{
+    constexpr size_t kFunctionCount = 500;
+    std::string script = makeBenchmarkScript("codeCacheFunction", kFunctionCount);
+    const char *sourceUrl = "https://n-api.com/code_cache_benchmark.js";
+    CodeCacheDirectoryGuard directory;
+    ASSERT_TRUE(directory.isCreated);
+    ASSERT_EQ(NAPISetCodeCacheDirectory(globalEnv, directory.path), NAPIErrorOK);
+
+    // 第一次执行未命中并写入缓存，第二次直接加载字节码
+    double elapsedMilliseconds[2];
+    for (double &milliseconds : elapsedMilliseconds)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        NAPIValue value;
+        ASSERT_EQ(NAPIRunScript(globalEnv, script.c_str(), sourceUrl, &value), NAPIExceptionOK);
+        milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        double doubleValue;
+        ASSERT_EQ(napi_get_value_double(globalEnv, value, &doubleValue), NAPIErrorOK);
+        ASSERT_EQ(doubleValue, (double)kFunctionCount);
+    }
+    // 源码变化后不能命中旧缓存
+    ASSERT_EQ(NAPIRunScript(globalEnv, "1 + 1", sourceUrl, nullptr), NAPIExceptionOK);
+    NAPICodeCacheStatistics statistics;
+    ASSERT_EQ(NAPIGetCodeCacheStatistics(globalEnv, &statistics), NAPIErrorOK);
+    if (!statistics.writeCount)
+    {
+        // 当前引擎不支持字节码
+        ASSERT_EQ(statistics.hitCount, 0u);
+        ASSERT_EQ(statistics.missCount, 0u);
+
+        return;
+    }
+    // 第二次执行命中缓存，跳过了解析和编译
+    ASSERT_EQ(statistics.hitCount, 1u);
+    ASSERT_EQ(statistics.missCount, 2u);
+    ASSERT_EQ(statistics.rejectCount, 0u);
+    ASSERT_EQ(statistics.writeCount, 2u);
+
+    // 耗时和机器负载有关，只记录不作为测试是否通过的条件
+    RecordProperty("coldMilliseconds", std::to_string(elapsedMilliseconds[0]));
+    RecordProperty("warmMilliseconds", std::to_string(elapsedMilliseconds[1]));
+}
+
+TEST_F(Test, CodeCacheReject)
+{
+    const char *script = "[1, 2, 3].reduce((a, b) => a + b)";
+    const char *sourceUrl = "https://n-api.com/code_cache_reject.js";
+    CodeCacheDirectoryGuard directory;
+    ASSERT_TRUE(directory.isCreated);
+    ASSERT_EQ(NAPISetCodeCacheDirectory(globalEnv, directory.path), NAPIErrorOK);
+    NAPIValue value;
+    ASSERT_EQ(NAPIRunScript(globalEnv, script, sourceUrl, &value), NAPIExceptionOK);
+
+    // 翻转缓存文件的最后一个字节
+    std::string path;
+    DIR *dir = opendir(directory.path);
+    ASSERT_TRUE(dir);
+    while (struct dirent *entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..")
+        {
+            path = std::string(directory.path) + "/" + name;
+        }
+    }
+    closedir(dir);
+    if (path.empty())
+    {
+        // 当前引擎不支持字节码
+        return;
+    }
+    FILE *file = fopen(path.c_str(), "r+b");
+    ASSERT_TRUE(file);
+    ASSERT_EQ(fseek(file, -1, SEEK_END), 0);
+    int lastByte = fgetc(file);
+    ASSERT_NE(lastByte, EOF);
+    ASSERT_EQ(fseek(file, -1, SEEK_END), 0);
+    ASSERT_NE(fputc(lastByte ^ 0xFF, file), EOF);
+    ASSERT_EQ(fclose(file), 0);
+
+    // 损坏的缓存被丢弃，脚本依旧执行，并重新写入缓存
+    ASSERT_EQ(NAPIRunScript(globalEnv, script, sourceUrl, &value), NAPIExceptionOK);
+    double doubleValue;
+    ASSERT_EQ(napi_get_value_double(globalEnv, value, &doubleValue), NAPIErrorOK);
+    ASSERT_EQ(doubleValue, 6);
+    ASSERT_EQ(NAPIRunScript(globalEnv, script, sourceUrl, &value), NAPIExceptionOK);
+    ASSERT_EQ(napi_get_value_double(globalEnv, value, &doubleValue), NAPIErrorOK);
+    ASSERT_EQ(doubleValue, 6);
+    NAPICodeCacheStatistics statistics;
+    ASSERT_EQ(NAPIGetCodeCacheStatistics(globalEnv, &statistics), NAPIErrorOK);
+    ASSERT_EQ(statistics.missCount, 2u);
+    ASSERT_EQ(statistics.rejectCount, 1u);
+    ASSERT_EQ(statistics.writeCount, 2u);
+    ASSERT_EQ(statistics.hitCount, 1u);
+}
@@ -38,6 +38,47 @@ static NAPIValue toString(NAPIEnv env, NAPICallbackInfo info)
     return output;
 }
 
+static void countFinalize(void * /*finalizeData*/, void *finalizeHint)
+{
+    ++*(int *)finalizeHint;
+}
+
+// 同时追加码点的 UTF-8 和 UTF-16 编码
+static void appendCodePoint(uint32_t codePoint, std::string *utf8String, std::u16string *utf16String)
+{
+    if (codePoint < 0x80)
+    {
+        utf8String->push_back((char)codePoint);
+    }
+    else if (codePoint < 0x800)
+    {
+        utf8String->push_back((char)(0xC0 | (codePoint >> 6)));
+        utf8String->push_back((char)(0x80 | (codePoint & 0x3F)));
+    }
+    else if (codePoint < 0x10000)
+    {
+        utf8String->push_back((char)(0xE0 | (codePoint >> 12)));
+        utf8String->push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+        utf8String->push_back((char)(0x80 | (codePoint & 0x3F)));
+    }
+    else
+    {
+        utf8String->push_back((char)(0xF0 | (codePoint >> 18)));
+        utf8String->push_back((char)(0x80 | ((codePoint >> 12) & 0x3F)));
+        utf8String->push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+        utf8String->push_back((char)(0x80 | (codePoint & 0x3F)));
+    }
+    if (codePoint < 0x10000)
+    {
+        utf16String->push_back((char16_t)codePoint);
+    }
+    else
+    {
+        utf16String->push_back((char16_t)(0xD800 | ((codePoint - 0x10000) >> 10)));
+        utf16String->push_back((char16_t)(0xDC00 | ((codePoint - 0x10000) & 0x3FF)));
+    }
+}
+
 EXTERN_C_END
 
 TEST_F(Test, Conversion)
@@ -88,4 +129,202 @@ TEST_F(Test, Conversion)
             "globalThis.assert(Object.is(globalThis.addon.toString([1,2,3]),\"1,2,3\"))})();",
             "https://www.napi.com/conversion.js", nullptr),
         NAPIExceptionOK);
-}
\ No newline at end of file
+}
+
+TEST_F(Test, CreateString)
+{
+    NAPIValue stringValue;
+    // 显式长度不要求 \0 结尾
+    ASSERT_EQ(napi_create_string_utf8_len(globalEnv, "hello world", 5, &stringValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_set_named_property(globalEnv, addonValue, "utf8", stringValue), NAPIExceptionOK);
+    // 非法 UTF-8 替换为 U+FFFD
+    ASSERT_EQ(napi_create_string_utf8_len(globalEnv, "\xe4\xbd\xa0\xff", NAPI_AUTO_LENGTH, &stringValue),
+              NAPIExceptionOK);
+    ASSERT_EQ(napi_set_named_property(globalEnv, addonValue, "invalidUTF8", stringValue), NAPIExceptionOK);
+    // 截断的序列只替换已读取的部分，之后的 ASCII 保留；编码的代理项每个字节各替换一次
+    ASSERT_EQ(napi_create_string_utf8_len(globalEnv, "\xe4\xbd" "A\xed\xa0\x80", NAPI_AUTO_LENGTH, &stringValue),
+              NAPIExceptionOK);
+    ASSERT_EQ(napi_set_named_property(globalEnv, addonValue, "truncatedUTF8", stringValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_create_string_latin1(globalEnv, "caf\xe9", NAPI_AUTO_LENGTH, &stringValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_set_named_property(globalEnv, addonValue, "latin1", stringValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_create_string_utf16(globalEnv, u"你好\U0001f600", NAPI_AUTO_LENGTH, &stringValue),
+              NAPIExceptionOK);
+    ASSERT_EQ(napi_set_named_property(globalEnv, addonValue, "utf16", stringValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_create_string_utf16(globalEnv, nullptr, 0, &stringValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_set_named_property(globalEnv, addonValue, "empty", stringValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_create_string_latin1(globalEnv, nullptr, 1, &stringValue), NAPIExceptionInvalidArg);
+    ASSERT_EQ(
+        NAPIRunScript(globalEnv,
+                      "(()=>{\"use strict\";globalThis.assert(globalThis.addon.utf8===\"hello\"),globalThis.assert("
+                      "globalThis.addon.invalidUTF8===\"\\u4f60\\ufffd\"),globalThis.assert("
+                      "globalThis.addon.truncatedUTF8===\"\\ufffdA\\ufffd\\ufffd\\ufffd\"),globalThis.assert("
+                      "globalThis.addon.latin1==="
+                      "\"caf\\u00e9\"),globalThis.assert(globalThis.addon.utf16===\"\\u4f60\\u597d\\ud83d\\ude00\"),"
+                      "globalThis.assert(globalThis.addon.empty===\"\")})();",
+                      "https://www.napi.com/create_string.js", nullptr),
+        NAPIExceptionOK);
+}
+
+TEST_F(Test, GetValueString)
+{
+    NAPIValue stringValue;
+    ASSERT_EQ(NAPIRunScript(globalEnv, "\"a\\u4f60\\ud83d\\ude00\"", "https://www.napi.com/get_value_string.js",
+                            &stringValue),
+              NAPIExceptionOK);
+    size_t length;
+    ASSERT_EQ(napi_get_value_string_utf8(globalEnv, stringValue, nullptr, 0, &length), NAPIErrorOK);
+    ASSERT_EQ(length, 8u);
+    char buffer[16];
+    ASSERT_EQ(napi_get_value_string_utf8(globalEnv, stringValue, buffer, sizeof(buffer), &length), NAPIErrorOK);
+    ASSERT_EQ(length, 8u);
+    ASSERT_STREQ(buffer, "a\xe4\xbd\xa0\xf0\x9f\x98\x80");
+    // 截断时不拆分码点
+    ASSERT_EQ(napi_get_value_string_utf8(globalEnv, stringValue, buffer, 7, &length), NAPIErrorOK);
+    ASSERT_EQ(length, 4u);
+    ASSERT_STREQ(buffer, "a\xe4\xbd\xa0");
+
+    ASSERT_EQ(napi_get_value_string_utf16(globalEnv, stringValue, nullptr, 0, &length), NAPIErrorOK);
+    ASSERT_EQ(length, 4u);
+    char16_t utf16Buffer[16];
+    ASSERT_EQ(napi_get_value_string_utf16(globalEnv, stringValue, utf16Buffer, 16, &length), NAPIErrorOK);
+    ASSERT_EQ(length, 4u);
+    ASSERT_EQ(std::u16string(utf16Buffer), u"a你\U0001f600");
+    // 截断时不拆分代理对
+    ASSERT_EQ(napi_get_value_string_utf16(globalEnv, stringValue, utf16Buffer, 4, &length), NAPIErrorOK);
+    ASSERT_EQ(length, 2u);
+    ASSERT_EQ(std::u16string(utf16Buffer), u"a你");
+
+    NAPIValue numberValue;
+    ASSERT_EQ(napi_create_double(globalEnv, 1, &numberValue), NAPIErrorOK);
+    ASSERT_EQ(napi_get_value_string_utf8(globalEnv, numberValue, buffer, sizeof(buffer), &length),
+              NAPIErrorStringExpected);
+}
+
+// 三个引擎都保留孤立代理项，不替换为 U+FFFD
+TEST_F(Test, LoneSurrogate)
+{
+    NAPIValue stringValue;
+    ASSERT_EQ(napi_create_string_utf16(globalEnv, u"a\xd800" u"b", 3, &stringValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_set_named_property(globalEnv, addonValue, "loneSurrogate", stringValue), NAPIExceptionOK);
+    ASSERT_EQ(NAPIRunScript(globalEnv,
+                            "(()=>{\"use strict\";const s=globalThis.addon.loneSurrogate;globalThis.assert(s.length==="
+                            "3),globalThis.assert(s.charCodeAt(1)===0xd800),globalThis.assert(s===\"a\\ud800b\")})();",
+                            "https://www.napi.com/lone_surrogate.js", nullptr),
+              NAPIExceptionOK);
+
+    size_t length;
+    char16_t utf16Buffer[4];
+    ASSERT_EQ(napi_get_value_string_utf16(globalEnv, stringValue, utf16Buffer, 4, &length), NAPIErrorOK);
+    ASSERT_EQ(length, 3u);
+    ASSERT_EQ(utf16Buffer[1], u'\xd800');
+    ASSERT_EQ(std::u16string(utf16Buffer), u"a\xd800" u"b");
+
+    ASSERT_EQ(NAPIRunScript(globalEnv, "\"\\udc00\"", "https://www.napi.com/lone_surrogate.js", &stringValue),
+              NAPIExceptionOK);
+    ASSERT_EQ(napi_get_value_string_utf16(globalEnv, stringValue, utf16Buffer, 4, &length), NAPIErrorOK);
+    ASSERT_EQ(length, 1u);
+    ASSERT_EQ(utf16Buffer[0], u'\xdc00');
+}
+
+TEST_F(Test, ExternalString)
+{
+    int finalizeCount = 0;
+    char latin1String[] = "caf\xe9";
+    NAPIValue stringValue;
+    bool copied = false;
+    ASSERT_EQ(napi_create_external_string_latin1(globalEnv, latin1String, NAPI_AUTO_LENGTH, countFinalize,
+                                                 &finalizeCount, &stringValue, &copied),
+              NAPIExceptionOK);
+    // 拷贝后立即调用 finalizeCB
+    ASSERT_TRUE(copied);
+    ASSERT_EQ(finalizeCount, 1);
+    ASSERT_EQ(napi_set_named_property(globalEnv, addonValue, "latin1", stringValue), NAPIExceptionOK);
+    char16_t utf16String[] = u"\u4f60\u597d";
+    ASSERT_EQ(napi_create_external_string_utf16(globalEnv, utf16String, 2, countFinalize, &finalizeCount,
+                                                &stringValue, nullptr),
+              NAPIExceptionOK);
+    ASSERT_EQ(finalizeCount, 2);
+    ASSERT_EQ(napi_set_named_property(globalEnv, addonValue, "utf16", stringValue), NAPIExceptionOK);
+    // 失败时不调用 finalizeCB
+    ASSERT_EQ(napi_create_external_string_utf16(globalEnv, nullptr, 1, countFinalize, &finalizeCount, &stringValue,
+                                                nullptr),
+              NAPIExceptionInvalidArg);
+    ASSERT_EQ(finalizeCount, 2);
+    ASSERT_EQ(NAPIRunScript(globalEnv,
+                            "(()=>{\"use strict\";globalThis.assert(globalThis.addon.latin1===\"caf\\u00e9\"),"
+                            "globalThis.assert(globalThis.addon.utf16===\"\\u4f60\\u597d\")})();",
+                            "https://www.napi.com/external_string.js", nullptr),
+              NAPIExceptionOK);
+}
+
+// 向量化逻辑以 16 字节（8 个 code unit）为一块，非 ASCII 字符和代理对分别放在块边界前后
+TEST_F(Test, UnicodeBlockBoundary)
+{
+    const size_t lengths[] = {15, 16, 17, 31, 32, 33};
+    const uint32_t codePoints[] = {0xE9, 0x4F60, 0x1F600};
+    for (bool isUTF16Input : {false, true})
+    {
+        for (size_t length : lengths)
+        {
+            for (uint32_t codePoint : codePoints)
+            {
+                // position 为码点起始位置，UTF-8 输入以字节计，UTF-16 输入以 code unit 计，覆盖所有块边界前后
+                for (size_t position = 0; position < length; ++position)
+                {
+                    std::string utf8String;
+                    std::u16string utf16String;
+                    while ((isUTF16Input ? utf16String.size() : utf8String.size()) < position)
+                    {
+                        appendCodePoint('a', &utf8String, &utf16String);
+                    }
+                    appendCodePoint(codePoint, &utf8String, &utf16String);
+                    while ((isUTF16Input ? utf16String.size() : utf8String.size()) < length)
+                    {
+                        appendCodePoint('b', &utf8String, &utf16String);
+                    }
+                    // 码点跨过结尾
+                    if ((isUTF16Input ? utf16String.size() : utf8String.size()) != length)
+                    {
+                        continue;
+                    }
+                    SCOPED_TRACE("utf16Input=" + std::to_string((int)isUTF16Input) + " length=" +
+                                 std::to_string(length) + " codePoint=" + std::to_string(codePoint) +
+                                 " position=" + std::to_string(position));
+
+                    NAPIValue stringValue;
+                    if (isUTF16Input)
+                    {
+                        ASSERT_EQ(napi_create_string_utf16(globalEnv, utf16String.c_str(), utf16String.size(),
+                                                           &stringValue),
+                                  NAPIExceptionOK);
+                    }
+                    else
+                    {
+                        ASSERT_EQ(napi_create_string_utf8_len(globalEnv, utf8String.c_str(), utf8String.size(),
+                                                              &stringValue),
+                                  NAPIExceptionOK);
+                    }
+                    size_t resultLength;
+                    ASSERT_EQ(napi_get_value_string_utf8(globalEnv, stringValue, nullptr, 0, &resultLength),
+                              NAPIErrorOK);
+                    ASSERT_EQ(resultLength, utf8String.size());
+                    std::string utf8Buffer(utf8String.size() + 1, '\0');
+                    ASSERT_EQ(napi_get_value_string_utf8(globalEnv, stringValue, &utf8Buffer[0], utf8Buffer.size(),
+                                                         &resultLength),
+                              NAPIErrorOK);
+                    utf8Buffer.resize(resultLength);
+                    ASSERT_EQ(utf8Buffer, utf8String);
+                    ASSERT_EQ(napi_get_value_string_utf16(globalEnv, stringValue, nullptr, 0, &resultLength),
+                              NAPIErrorOK);
+                    ASSERT_EQ(resultLength, utf16String.size());
+                    std::u16string utf16Buffer(utf16String.size() + 1, u'\0');
+                    ASSERT_EQ(napi_get_value_string_utf16(globalEnv, stringValue, &utf16Buffer[0],
+                                                          utf16Buffer.size(), &resultLength),
+                              NAPIErrorOK);
+                    utf16Buffer.resize(resultLength);
+                    ASSERT_EQ(utf16Buffer, utf16String);
+                }
+            }
+        }
+    }
+}
@@ -1,4 +1,7 @@
+#include <cstdio>
+#include <string>
 #include <test.h>
+#include <unistd.h>
 
 EXTERN_C_START
 
@@ -135,4 +138,372 @@ TEST_F(Test, General)
             "doInstanceOf({},Array)),globalThis.assert(globalThis.addon.doInstanceOf([],Array))})();",
             "https://www.napi.com/general.js", nullptr),
         NAPIExceptionOK);
-}
\ No newline at end of file
+}
+
+TEST_F(Test, StrictEquals)
+{
+    NAPIValue arrayValue;
+    ASSERT_EQ(NAPIRunScript(globalEnv,
+                            "globalThis.addon.is = Object.is, Object.is = () => false, [NaN, NaN, 0, -0, 1, 1.0, "
+                            "'hello', 'hel' + 'lo', 'world', {}, null, undefined, '\\u4f60\\u597d', "
+                            "'\\u4f60' + '\\u597d', '\\u4f60\\u4eec']",
+                            "https://www.napi.com/strict_equals.js", &arrayValue),
+              NAPIExceptionOK);
+    NAPIValue values[15];
+    for (uint32_t i = 0; i < 15; ++i)
+    {
+        ASSERT_EQ(napi_get_element(globalEnv, arrayValue, i, &values[i]), NAPIExceptionOK);
+    }
+    // 第一列和第二列为比较对象，第三列为期望结果
+    const int expectations[][3] = {{0, 1, true}, {2, 3, false}, {2, 2, true},   {4, 5, true},
+                                   {6, 7, true}, {6, 8, false}, {9, 9, true},   {9, 10, false},
+                                   {10, 11, false}, {11, 11, true}, {4, 6, false}, {12, 13, true},
+                                   {12, 14, false}, {6, 12, false}};
+    for (const auto &expectation : expectations)
+    {
+        bool result;
+        ASSERT_EQ(napi_strict_equals(globalEnv, values[expectation[0]], values[expectation[1]], &result),
+                  NAPIExceptionOK);
+        ASSERT_EQ(result, (bool)expectation[2]) << expectation[0] << " " << expectation[1];
+    }
+    ASSERT_EQ(
+        NAPIRunScript(globalEnv, "Object.is = globalThis.addon.is", "https://www.napi.com/strict_equals.js", nullptr),
+        NAPIExceptionOK);
+}
+
+TEST_F(Test, ParseJSON)
+{
+    ASSERT_EQ(NAPIRunScript(globalEnv, "globalThis.addon.parse = JSON.parse, JSON.parse = () => null",
+                            "https://www.napi.com/parse_json.js", nullptr),
+              NAPIExceptionOK);
+    NAPIValue objectValue;
+    ASSERT_EQ(NAPIParseUTF8JSONString(globalEnv, "{\"hello\": [1, \"world\"]}", &objectValue), NAPIExceptionOK);
+    NAPIValue arrayValue, value;
+    ASSERT_EQ(napi_get_named_property(globalEnv, objectValue, "hello", &arrayValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_get_element(globalEnv, arrayValue, 1, &value), NAPIExceptionOK);
+    const char *string;
+    ASSERT_EQ(NAPIGetValueStringUTF8(globalEnv, value, &string), NAPIErrorOK);
+    ASSERT_STREQ(string, "world");
+    ASSERT_EQ(NAPIFreeUTF8String(globalEnv, string), NAPICommonOK);
+
+    ASSERT_EQ(NAPIParseUTF8JSONString(globalEnv, "{hello}", &objectValue), NAPIExceptionPendingException);
+    NAPIValue exceptionValue;
+    ASSERT_EQ(napi_get_and_clear_last_exception(globalEnv, &exceptionValue), NAPIErrorOK);
+    NAPIValue globalValue, syntaxErrorValue;
+    ASSERT_EQ(napi_get_global(globalEnv, &globalValue), NAPIErrorOK);
+    ASSERT_EQ(napi_get_named_property(globalEnv, globalValue, "SyntaxError", &syntaxErrorValue), NAPIExceptionOK);
+    bool isSyntaxError;
+    ASSERT_EQ(napi_instanceof(globalEnv, exceptionValue, syntaxErrorValue, &isSyntaxError), NAPIExceptionOK);
+    ASSERT_TRUE(isSyntaxError);
+    ASSERT_EQ(NAPIRunScript(globalEnv, "JSON.parse = globalThis.addon.parse", "https://www.napi.com/parse_json.js",
+                            nullptr),
+              NAPIExceptionOK);
+}
+
+TEST_F(Test, RunScriptWithOptions)
+{
+    const char *script = "(function () { return this === undefined; })()";
+    NAPIValue value;
+    bool result;
+    ASSERT_EQ(NAPIRunScriptWithOptions(globalEnv, script, "https://www.napi.com/run_script_with_options.js", nullptr,
+                                       &value),
+              NAPIExceptionOK);
+    ASSERT_EQ(napi_get_value_bool(globalEnv, value, &result), NAPIErrorOK);
+    ASSERT_FALSE(result);
+
+    NAPIScriptOptions options = {};
+    options.strict = true;
+    ASSERT_EQ(NAPIRunScriptWithOptions(globalEnv, script, "https://www.napi.com/run_script_with_options.js", &options,
+                                       &value),
+              NAPIExceptionOK);
+    ASSERT_EQ(napi_get_value_bool(globalEnv, value, &result), NAPIErrorOK);
+    ASSERT_TRUE(result);
+
+    // 剥离时不能改变脚本的返回值
+    options = {};
+    options.stripDebugInfo = true;
+    options.stripSource = true;
+    ASSERT_EQ(NAPIRunScriptWithOptions(globalEnv, "var runScriptWithOptionsStripped = 1;",
+                                       "https://www.napi.com/run_script_with_options.js", &options, &value),
+              NAPIExceptionOK);
+    NAPIValueType valueType;
+    ASSERT_EQ(napi_typeof(globalEnv, value, &valueType), NAPICommonOK);
+    ASSERT_EQ(valueType, NAPIUndefined);
+
+    // 剥离调试信息后字节码不应变大
+    options = {};
+    const uint8_t *fullByteBuffer = nullptr, *strippedByteBuffer = nullptr;
+    size_t fullBufferSize = 0, strippedBufferSize = 0;
+    ASSERT_EQ(NAPICompileWithOptions(globalEnv, "function add(a, b) { return a + b; }\nadd(1, 2);",
+                                     "https://www.napi.com/compile_with_options.js", &options, &fullByteBuffer,
+                                     &fullBufferSize),
+              NAPIExceptionOK);
+    options.stripDebugInfo = true;
+    options.stripSource = true;
+    ASSERT_EQ(NAPICompileWithOptions(globalEnv, "function add(a, b) { return a + b; }\nadd(1, 2);",
+                                     "https://www.napi.com/compile_with_options.js", &options, &strippedByteBuffer,
+                                     &strippedBufferSize),
+              NAPIExceptionOK);
+    if (!fullByteBuffer)
+    {
+        // 当前引擎不支持字节码
+        return;
+    }
+    ASSERT_LE(strippedBufferSize, fullBufferSize);
+    ASSERT_EQ(NAPIRunByteBuffer(globalEnv, strippedByteBuffer, strippedBufferSize, &value), NAPIExceptionOK);
+    double doubleValue;
+    ASSERT_EQ(napi_get_value_double(globalEnv, value, &doubleValue), NAPIErrorOK);
+    ASSERT_EQ(doubleValue, 3);
+    ASSERT_EQ(NAPIFreeByteBuffer(globalEnv, fullByteBuffer), NAPICommonOK);
+    ASSERT_EQ(NAPIFreeByteBuffer(globalEnv, strippedByteBuffer), NAPICommonOK);
+}
+
+TEST_F(Test, RunByteBufferFile)
+{
+    // 非内置的标识符和属性名会在读取字节码时创建 atom，函数返回后再调用也需要保持有效
+    const char *script = "(function () { const byteBufferFileState = { byteBufferFileCount: 0 }; return function "
+                         "byteBufferFileIncrement(byteBufferFileStep) { byteBufferFileState.byteBufferFileCount += "
+                         "byteBufferFileStep; return \"byteBufferFile\" + byteBufferFileState.byteBufferFileCount; "
+                         "}; })()";
+    const uint8_t *byteBuffer = nullptr;
+    size_t bufferSize = 0;
+    ASSERT_EQ(NAPICompileToByteBuffer(globalEnv, script, "https://www.napi.com/run_byte_buffer_file.js", &byteBuffer,
+                                      &bufferSize),
+              NAPIExceptionOK);
+    if (!byteBuffer)
+    {
+        // 当前引擎不支持字节码
+        ASSERT_EQ(NAPIRunByteBufferFile(globalEnv, "/dev/null", nullptr), NAPIExceptionGenericFailure);
+
+        return;
+    }
+    char path[] = "/tmp/napi_byte_buffer_file_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(write(fd, byteBuffer, bufferSize), (ssize_t)bufferSize);
+    ASSERT_EQ(close(fd), 0);
+    ASSERT_EQ(NAPIFreeByteBuffer(globalEnv, byteBuffer), NAPICommonOK);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        NAPIValue functionValue;
+        ASSERT_EQ(NAPIRunByteBufferFile(globalEnv, path, &functionValue), NAPIExceptionOK);
+        ASSERT_EQ(NAPIRunGC(globalEnv, NAPIFullGC), NAPIErrorOK);
+        NAPIValue stepValue;
+        ASSERT_EQ(napi_create_double(globalEnv, 2, &stepValue), NAPIErrorOK);
+        for (int j = 1; j <= 2; ++j)
+        {
+            NAPIValue value;
+            ASSERT_EQ(napi_call_function(globalEnv, nullptr, functionValue, 1, &stepValue, &value), NAPIExceptionOK);
+            char buffer[32];
+            ASSERT_EQ(napi_get_value_string_utf8(globalEnv, value, buffer, sizeof(buffer), nullptr), NAPIErrorOK);
+            ASSERT_EQ(std::string(buffer), "byteBufferFile" + std::to_string(j * 2));
+        }
+    }
+    unlink(path);
+    ASSERT_EQ(NAPIRunByteBufferFile(globalEnv, path, nullptr), NAPIExceptionGenericFailure);
+}
+
+TEST_F(Test, CompiledScript)
+{
+    NAPIScript script;
+    ASSERT_EQ(NAPICompileScript(globalEnv, "globalThis.compiledScriptCount = (globalThis.compiledScriptCount || 0) + 1",
+                                "https://www.napi.com/compiled_script.js", &script),
+              NAPIExceptionOK);
+    NAPIValue value;
+    for (int i = 1; i <= 3; ++i)
+    {
+        ASSERT_EQ(NAPIRunCompiledScript(globalEnv, script, &value), NAPIExceptionOK);
+        double doubleValue;
+        ASSERT_EQ(napi_get_value_double(globalEnv, value, &doubleValue), NAPIErrorOK);
+        ASSERT_EQ(doubleValue, i);
+    }
+    ASSERT_EQ(NAPIFreeScript(globalEnv, script), NAPICommonOK);
+    ASSERT_EQ(NAPIRunScript(globalEnv, "delete globalThis.compiledScriptCount",
+                            "https://www.napi.com/compiled_script.js", nullptr),
+              NAPIExceptionOK);
+
+    ASSERT_EQ(NAPICompileScript(globalEnv, "(", "https://www.napi.com/compiled_script.js", &script),
+              NAPIExceptionPendingException);
+    NAPIValue exceptionValue;
+    ASSERT_EQ(napi_get_and_clear_last_exception(globalEnv, &exceptionValue), NAPIErrorOK);
+}
+
+TEST_F(Test, EnvPool)
+{
+    NAPIEnvPool pool;
+    ASSERT_EQ(NAPICreateEnvPool(0, &pool), NAPIErrorInvalidArg);
+    ASSERT_EQ(NAPICreateEnvPool(2, &pool), NAPIErrorOK);
+    NAPIEnv envs[3];
+    for (NAPIEnv &env : envs)
+    {
+        ASSERT_EQ(NAPIEnvPoolAcquire(pool, &env), NAPIErrorOK);
+        NAPIHandleScope envHandleScope;
+        ASSERT_EQ(napi_open_handle_scope(env, &envHandleScope), NAPIErrorOK);
+        NAPIValue value;
+        ASSERT_EQ(NAPIRunScript(env, "1 + 2", "https://www.napi.com/env_pool.js", &value), NAPIExceptionOK);
+        double doubleValue;
+        ASSERT_EQ(napi_get_value_double(env, value, &doubleValue), NAPIErrorOK);
+        ASSERT_EQ(doubleValue, 3);
+        ASSERT_EQ(napi_close_handle_scope(env, envHandleScope), NAPICommonOK);
+    }
+    for (NAPIEnv env : envs)
+    {
+        ASSERT_EQ(NAPIEnvPoolRelease(pool, env), NAPIErrorOK);
+    }
+    ASSERT_EQ(NAPIEnvPoolRelease(pool, globalEnv), NAPIErrorInvalidArg);
+    NAPIEnvPoolStatistics statistics;
+    ASSERT_EQ(NAPIGetEnvPoolStatistics(pool, &statistics), NAPIErrorOK);
+    ASSERT_EQ(statistics.hitCount + statistics.missCount, 3u);
+    ASSERT_GE(statistics.createCount, 3u);
+    ASSERT_GT(statistics.maxCreateNanoseconds, 0u);
+    ASSERT_GE(statistics.totalCreateNanoseconds, statistics.maxCreateNanoseconds);
+    ASSERT_EQ(NAPIFreeEnvPool(pool), NAPICommonOK);
+}
+
+TEST_F(Test, EnvPoolStackTop)
+{
+    NAPIEnvPool pool;
+    ASSERT_EQ(NAPICreateEnvPool(1, &pool), NAPIErrorOK);
+    // 等待后台线程创建完成，保证取出的 env 来自其他线程
+    NAPIEnvPoolStatistics statistics = {};
+    for (int i = 0; i < 1000 && !statistics.createCount; ++i)
+    {
+        usleep(10000);
+        ASSERT_EQ(NAPIGetEnvPoolStatistics(pool, &statistics), NAPIErrorOK);
+    }
+    ASSERT_EQ(statistics.createCount, 1u);
+    NAPIEnv env;
+    ASSERT_EQ(NAPIEnvPoolAcquire(pool, &env), NAPIErrorOK);
+    ASSERT_EQ(NAPIGetEnvPoolStatistics(pool, &statistics), NAPIErrorOK);
+    ASSERT_EQ(statistics.hitCount, 1u);
+    ASSERT_EQ(statistics.missCount, 0u);
+
+    // 栈顶仍是后台线程的话，正常深度的递归会被误判为栈溢出，或者无限递归检测不到溢出而崩溃
+    NAPIHandleScope envHandleScope;
+    ASSERT_EQ(napi_open_handle_scope(env, &envHandleScope), NAPIErrorOK);
+    NAPIValue value;
+    ASSERT_EQ(NAPIRunScript(env,
+                            "(function () { function depth(n) { return n ? depth(n - 1) + 1 : 0; } function infinite() "
+                            "{ return infinite() + 1; } let isOverflowed = false; try { infinite(); } catch (e) { "
+                            "isOverflowed = true; } return depth(1000) === 1000 && isOverflowed; })()",
+                            "https://www.napi.com/env_pool_stack_top.js", &value),
+              NAPIExceptionOK);
+    bool result;
+    ASSERT_EQ(napi_get_value_bool(env, value, &result), NAPIErrorOK);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(napi_close_handle_scope(env, envHandleScope), NAPICommonOK);
+    ASSERT_EQ(NAPIEnvPoolRelease(pool, env), NAPIErrorOK);
+    ASSERT_EQ(NAPIFreeEnvPool(pool), NAPICommonOK);
+}
+
+TEST_F(Test, CreateWithOptions)
+{
+    NAPIRuntimeOptions options = {};
+    NAPIRuntime runtime;
+    ASSERT_EQ(NAPICreateRuntimeWithOptions(&options, &runtime), NAPIErrorInvalidArg);
+    options.version = NAPI_RUNTIME_OPTIONS_VERSION;
+    options.maxHeapSize = 64 << 20;
+    options.initialHeapSize = 4 << 20;
+    options.gcThreshold = 1 << 20;
+    options.stackSize = 1 << 20;
+    ASSERT_EQ(NAPICreateRuntimeWithOptions(&options, &runtime), NAPIErrorOK);
+    NAPIEnv env;
+    ASSERT_EQ(NAPICreateEnvWithOptions(&env, runtime, &options), NAPIErrorOK);
+    NAPIHandleScope envHandleScope;
+    ASSERT_EQ(napi_open_handle_scope(env, &envHandleScope), NAPIErrorOK);
+    NAPIValue value;
+    ASSERT_EQ(NAPIRunScript(env, "new Array(1000).fill(1).reduce((a, b) => a + b)",
+                            "https://www.napi.com/create_with_options.js", &value),
+              NAPIExceptionOK);
+    double doubleValue;
+    ASSERT_EQ(napi_get_value_double(env, value, &doubleValue), NAPIErrorOK);
+    ASSERT_EQ(doubleValue, 1000);
+    ASSERT_EQ(napi_close_handle_scope(env, envHandleScope), NAPICommonOK);
+    ASSERT_EQ(NAPIFreeEnv(env), NAPICommonOK);
+    ASSERT_EQ(NAPIFreeRuntime(runtime), NAPICommonOK);
+}
+
+TEST_F(Test, HeapStatistics)
+{
+    NAPIHeapStatistics before;
+    ASSERT_EQ(NAPIGetHeapStatistics(globalEnv, &before), NAPIErrorOK);
+    NAPIValue object;
+    ASSERT_EQ(NAPIRunScript(globalEnv, "({})", "https://www.napi.com/heap_statistics.js", &object), NAPIExceptionOK);
+    NAPIRef ref;
+    ASSERT_EQ(napi_create_reference(globalEnv, object, 1, &ref), NAPIExceptionOK);
+    NAPIHeapStatistics after;
+    ASSERT_EQ(NAPIGetHeapStatistics(globalEnv, &after), NAPIErrorOK);
+    ASSERT_EQ(after.strongReferenceCount, before.strongReferenceCount + 1);
+    ASSERT_GE(after.handleCount, before.handleCount);
+    ASSERT_GE(after.totalHeapSize, after.usedHeapSize);
+    ASSERT_EQ(napi_delete_reference(globalEnv, ref), NAPIExceptionOK);
+    ASSERT_EQ(NAPIGetHeapStatistics(globalEnv, &after), NAPIErrorOK);
+    ASSERT_EQ(after.strongReferenceCount, before.strongReferenceCount);
+}
+
+TEST_F(Test, GarbageCollection)
+{
+    ASSERT_EQ(NAPIRunGC(globalEnv, NAPIFullGC), NAPIErrorOK);
+    ASSERT_EQ(NAPIRunGC(globalEnv, NAPIYoungGC), NAPIErrorOK);
+    ASSERT_EQ(NAPIRunGC(globalEnv, (NAPIGCMode)-1), NAPIErrorInvalidArg);
+    bool hasMoreWork = true;
+    // 1 秒的预算足够完成一次 GC
+    ASSERT_EQ(NAPIIdleNotification(globalEnv, 1000000, &hasMoreWork), NAPIErrorOK);
+    ASSERT_FALSE(hasMoreWork);
+    ASSERT_EQ(NAPIIdleNotification(globalEnv, 0, nullptr), NAPIErrorOK);
+    // 上一次 GC 之后没有新的分配，预算为 0 也不需要再执行
+    ASSERT_EQ(NAPIRunGC(globalEnv, NAPIFullGC), NAPIErrorOK);
+    hasMoreWork = true;
+    ASSERT_EQ(NAPIIdleNotification(globalEnv, 0, &hasMoreWork), NAPIErrorOK);
+    ASSERT_FALSE(hasMoreWork);
+}
+
+TEST_F(Test, MemoryPressure)
+{
+    // 关闭后的 handleScope 进入空闲链表
+    NAPIEscapableHandleScope escapableHandleScope;
+    ASSERT_EQ(napi_open_escapable_handle_scope(globalEnv, &escapableHandleScope), NAPIErrorOK);
+    ASSERT_EQ(napi_close_escapable_handle_scope(globalEnv, escapableHandleScope), NAPICommonOK);
+    size_t reclaimedBytes = 0;
+    ASSERT_EQ(NAPINotifyMemoryPressure(globalEnv, NAPIModerateMemoryPressure, &reclaimedBytes), NAPIErrorOK);
+    ASSERT_GT(reclaimedBytes, 0u);
+    ASSERT_EQ(NAPINotifyMemoryPressure(globalEnv, NAPICriticalMemoryPressure, nullptr), NAPIErrorOK);
+    ASSERT_EQ(NAPINotifyMemoryPressure(globalEnv, (NAPIMemoryPressureLevel)-1, nullptr), NAPIErrorInvalidArg);
+    // 释放之后依旧可以正常打开 handleScope
+    NAPIHandleScope envHandleScope;
+    ASSERT_EQ(napi_open_handle_scope(globalEnv, &envHandleScope), NAPIErrorOK);
+    NAPIValue value;
+    ASSERT_EQ(NAPIRunScript(globalEnv, "1 + 2", "https://www.napi.com/memory_pressure.js", &value), NAPIExceptionOK);
+    ASSERT_EQ(napi_close_handle_scope(globalEnv, envHandleScope), NAPICommonOK);
+}
+
+TEST_F(Test, HeapSnapshot)
+{
+    NAPIValue object;
+    ASSERT_EQ(NAPIRunScript(globalEnv, "({ heapSnapshotMarker: 'napi_heap_snapshot' })",
+                            "https://www.napi.com/heap_snapshot.js", &object),
+              NAPIExceptionOK);
+    NAPIRef ref;
+    ASSERT_EQ(napi_create_reference(globalEnv, object, 1, &ref), NAPIExceptionOK);
+    ASSERT_EQ(NAPIWriteHeapSnapshot(globalEnv, nullptr), NAPIErrorInvalidArg);
+    std::string content;
+    NAPIErrorStatus status = writeHeapSnapshot(globalEnv, &content);
+    ASSERT_EQ(napi_delete_reference(globalEnv, ref), NAPIExceptionOK);
+    if (status == NAPIErrorGenericFailure)
+    {
+        // JavaScriptCore
+        return;
+    }
+    ASSERT_EQ(status, NAPIErrorOK);
+    // nodes 和 edges 是扁平数组，长度为数量乘以字段数
+    ASSERT_EQ(checkHeapSnapshot(globalEnv, content,
+                                "snapshot => { const meta = snapshot.snapshot.meta; "
+                                "if (snapshot.snapshot.node_count * meta.node_fields.length !== "
+                                "snapshot.nodes.length) { return 'node_count'; } "
+                                "if (snapshot.snapshot.edge_count * meta.edge_fields.length !== "
+                                "snapshot.edges.length) { return 'edge_count'; } "
+                                "return snapshot.strings.indexOf('heapSnapshotMarker') < 0 ? "
+                                "'heapSnapshotMarker' : ''; }"),
+              "");
+}
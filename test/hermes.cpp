@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <test.h>
+
+namespace
+{
+constexpr size_t kColdStartCount = 10;
+
+constexpr size_t kFunctionCount = 2000;
+
+// 每次测量都创建新的 runtime 和 env，包含引擎初始化和首次执行的全部开销
+// byteBuffer 为 nullptr 时执行源码
+double measureColdStart(const std::string &script, const char *sourceUrl, const uint8_t *byteBuffer,
+                        size_t bufferSize, double *result)
+{
+    auto begin = std::chrono::steady_clock::now();
+    NAPIRuntime runtime;
+    EXPECT_EQ(NAPICreateRuntime(&runtime), NAPIErrorOK);
+    NAPIEnv env;
+    EXPECT_EQ(NAPICreateEnv(&env, runtime), NAPIErrorOK);
+    NAPIHandleScope envHandleScope;
+    EXPECT_EQ(napi_open_handle_scope(env, &envHandleScope), NAPIErrorOK);
+    NAPIValue value;
+    if (byteBuffer)
+    {
+        EXPECT_EQ(NAPIRunByteBuffer(env, byteBuffer, bufferSize, &value), NAPIExceptionOK);
+    }
+    else
+    {
+        EXPECT_EQ(NAPIRunScript(env, script.c_str(), sourceUrl, &value), NAPIExceptionOK);
+    }
+    EXPECT_EQ(napi_get_value_double(env, value, result), NAPIErrorOK);
+    EXPECT_EQ(napi_close_handle_scope(env, envHandleScope), NAPICommonOK);
+    EXPECT_EQ(NAPIFreeEnv(env), NAPICommonOK);
+    EXPECT_EQ(NAPIFreeRuntime(runtime), NAPICommonOK);
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+} // namespace
+
+TEST_F(Test, ByteBufferColdStart)
+{
+    std::string script;
+    for (size_t i = 0; i < kFunctionCount; ++i)
+    {
+        auto index = std::to_string(i);
+        script += "function coldStartFunction" + index + "(a) { var b = [a, " + index + "]; return b[0] + b[1]; }\n";
+    }
+    script += "coldStartFunction" + std::to_string(kFunctionCount - 1) + "(1);";
+    const char *sourceUrl = "https://n-api.com/byte_buffer_cold_start.js";
+
+    const uint8_t *byteBuffer = nullptr;
+    size_t bufferSize = 0;
+    ASSERT_EQ(NAPICompileToByteBuffer(globalEnv, script.c_str(), sourceUrl, &byteBuffer, &bufferSize),
+              NAPIExceptionOK);
+    ASSERT_TRUE(byteBuffer);
+
+    // 取多次测量的最小值，排除调度和缺页的干扰
+    double scriptMilliseconds = 0, byteBufferMilliseconds = 0;
+    for (size_t i = 0; i < kColdStartCount; ++i)
+    {
+        double scriptResult = 0, byteBufferResult = 0;
+        double milliseconds = measureColdStart(script, sourceUrl, nullptr, 0, &scriptResult);
+        scriptMilliseconds = i ? std::min(scriptMilliseconds, milliseconds) : milliseconds;
+        milliseconds = measureColdStart(script, sourceUrl, byteBuffer, bufferSize, &byteBufferResult);
+        byteBufferMilliseconds = i ? std::min(byteBufferMilliseconds, milliseconds) : milliseconds;
+        // 字节码执行结果必须和源码一致
+        EXPECT_EQ(scriptResult, (double)kFunctionCount);
+        EXPECT_EQ(byteBufferResult, scriptResult);
+    }
+    EXPECT_EQ(NAPIFreeByteBuffer(globalEnv, byteBuffer), NAPICommonOK);
+
+    // 字节码跳过了词法分析、语法分析和代码生成，但耗时和机器负载有关，只记录不作为测试是否通过的条件
+    RecordProperty("byteBufferSize", std::to_string(bufferSize));
+    RecordProperty("runScriptColdStartMilliseconds", std::to_string(scriptMilliseconds));
+    RecordProperty("runByteBufferColdStartMilliseconds", std::to_string(byteBufferMilliseconds));
+}
@@ -3,6 +3,7 @@
 
 #include <gtest/gtest.h>
 #include <napi/js_native_api.h>
+#include <string>
 
 class Test : public ::testing::Test
 {
@@ -20,4 +21,10 @@ extern bool finalizeIsCalled;
 
 extern NAPIEnv globalEnv;
 
+// 写入临时文件后读取内容，引擎不支持时返回 NAPIErrorGenericFailure
+NAPIErrorStatus writeHeapSnapshot(NAPIEnv env, std::string *content);
+
+// checkScript 求值得到一个函数，以 JSON.parse 之后的快照调用，返回空字符串代表通过，否则为失败原因
+std::string checkHeapSnapshot(NAPIEnv env, const std::string &content, const char *checkScript);
+
 #endif // SKIA_TEST_H
@@ -237,4 +237,326 @@ TEST_F(Test, Object)
             "Object.getOwnPropertyDescriptor(b,0))})();",
             "https://www.napi.com/object.js", nullptr),
         NAPIExceptionOK);
-}
\ No newline at end of file
+}
+
+TEST_F(Test, PropertyKey)
+{
+    NAPIValue objectValue;
+    ASSERT_EQ(NAPIRunScript(globalEnv, "({hello: 'world'})", "https://www.napi.com/property_key.js", &objectValue),
+              NAPIExceptionOK);
+    NAPIPropertyKey helloKey, fooKey;
+    ASSERT_EQ(NAPICreatePropertyKey(globalEnv, "hello", &helloKey), NAPIExceptionOK);
+    ASSERT_EQ(NAPICreatePropertyKey(globalEnv, "foo", &fooKey), NAPIExceptionOK);
+
+    NAPIValue value;
+    ASSERT_EQ(NAPIGetPropertyWithKey(globalEnv, objectValue, helloKey, &value), NAPIExceptionOK);
+    const char *string;
+    ASSERT_EQ(NAPIGetValueStringUTF8(globalEnv, value, &string), NAPIErrorOK);
+    ASSERT_STREQ(string, "world");
+    ASSERT_EQ(NAPIFreeUTF8String(globalEnv, string), NAPICommonOK);
+
+    bool result;
+    ASSERT_EQ(NAPIHasPropertyWithKey(globalEnv, objectValue, fooKey, &result), NAPIExceptionOK);
+    ASSERT_FALSE(result);
+    NAPIValue numberValue;
+    ASSERT_EQ(napi_create_double(globalEnv, 42, &numberValue), NAPIErrorOK);
+    ASSERT_EQ(NAPISetPropertyWithKey(globalEnv, objectValue, fooKey, numberValue), NAPIExceptionOK);
+    ASSERT_EQ(NAPIHasPropertyWithKey(globalEnv, objectValue, fooKey, &result), NAPIExceptionOK);
+    ASSERT_TRUE(result);
+    NAPIValue stringValue;
+    ASSERT_EQ(napi_create_string_utf8(globalEnv, "foo", &stringValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_get_property(globalEnv, objectValue, stringValue, &value), NAPIExceptionOK);
+    double doubleValue;
+    ASSERT_EQ(napi_get_value_double(globalEnv, value, &doubleValue), NAPIErrorOK);
+    ASSERT_EQ(doubleValue, 42);
+
+    ASSERT_EQ(NAPIDeletePropertyWithKey(globalEnv, objectValue, fooKey, &result), NAPIExceptionOK);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(NAPIHasPropertyWithKey(globalEnv, objectValue, fooKey, &result), NAPIExceptionOK);
+    ASSERT_FALSE(result);
+
+    ASSERT_EQ(NAPIFreePropertyKey(globalEnv, helloKey), NAPICommonOK);
+    ASSERT_EQ(NAPIFreePropertyKey(globalEnv, fooKey), NAPICommonOK);
+}
+
+
+EXTERN_C_START
+
+static NAPIValue returnData(NAPIEnv env, NAPICallbackInfo callbackInfo)
+{
+    void *data;
+    assert(napi_get_cb_info(env, callbackInfo, nullptr, nullptr, nullptr, &data) == NAPICommonOK);
+    NAPIValue result;
+    assert(napi_create_double(env, (double)(uintptr_t)data, &result) == NAPIErrorOK);
+
+    return result;
+}
+
+EXTERN_C_END
+
+TEST_F(Test, DefineProperties)
+{
+    NAPIValue objectValue, stringValue, nameValue;
+    ASSERT_EQ(NAPIRunScript(globalEnv, "({})", "https://www.napi.com/define_properties.js", &objectValue),
+              NAPIExceptionOK);
+    ASSERT_EQ(napi_create_string_utf8(globalEnv, "hello", &stringValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_create_string_utf8(globalEnv, "name", &nameValue), NAPIExceptionOK);
+    NAPIPropertyDescriptor descriptors[] = {
+        {"readonly", nullptr, nullptr, nullptr, nullptr, stringValue, NAPIEnumerable, nullptr},
+        {nullptr, nameValue, nullptr, nullptr, nullptr, stringValue, NAPIDefaultJSProperty, nullptr},
+        {"method", nullptr, returnData, nullptr, nullptr, nullptr, NAPIDefaultMethod, (void *)1},
+        {"getter", nullptr, nullptr, returnData, nullptr, nullptr, NAPIConfigurable, (void *)2},
+        {"toString", nullptr, returnData, nullptr, nullptr, nullptr, NAPIDefaultMethod, (void *)3},
+    };
+    ASSERT_EQ(napi_define_properties(globalEnv, objectValue, sizeof(descriptors) / sizeof(descriptors[0]), descriptors),
+              NAPIExceptionOK);
+    ASSERT_EQ(napi_create_string_utf8(globalEnv, "definePropertiesObject", &stringValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_set_property(globalEnv, addonValue, stringValue, objectValue), NAPIExceptionOK);
+    ASSERT_EQ(NAPIRunScript(
+                  globalEnv,
+                  "(()=>{var o=globalThis.addon.definePropertiesObject,d=Object.getOwnPropertyDescriptor(o,\"readonly\""
+                  ");globalThis.assert(\"hello\"===d.value),globalThis.assert(d.enumerable),globalThis.assert(!d.writab"
+                  "le),globalThis.assert(!d.configurable),globalThis.assert(\"hello\"===o.name),globalThis.assert(1===o"
+                  ".method()),globalThis.assert(!Object.getOwnPropertyDescriptor(o,\"method\").enumerable),globalThis.a"
+                  "ssert(2===o.getter),d=Object.getOwnPropertyDescriptor(o,\"getter\"),globalThis.assert(\"function\"=="
+                  "=typeof d.get),globalThis.assert(void 0===d.set),globalThis.assert(d.configurable),globalThis.assert"
+                  "(3===o.toString()),globalThis.assert(Object.prototype.hasOwnProperty.call(o,\"toString\"))})();",
+                  "https://www.napi.com/define_properties.js", nullptr),
+              NAPIExceptionOK);
+}
+
+
+TEST_F(Test, Element)
+{
+    NAPIValue arrayValue;
+    ASSERT_EQ(NAPIRunScript(globalEnv, "[1, 2, 3]", "https://www.napi.com/element.js", &arrayValue), NAPIExceptionOK);
+    NAPIValue value;
+    ASSERT_EQ(napi_get_element(globalEnv, arrayValue, 1, &value), NAPIExceptionOK);
+    double doubleValue;
+    ASSERT_EQ(napi_get_value_double(globalEnv, value, &doubleValue), NAPIErrorOK);
+    ASSERT_EQ(doubleValue, 2);
+    ASSERT_EQ(napi_get_element(globalEnv, arrayValue, 10, &value), NAPIExceptionOK);
+    NAPIValueType valueType;
+    ASSERT_EQ(napi_typeof(globalEnv, value, &valueType), NAPICommonOK);
+    ASSERT_EQ(valueType, NAPIUndefined);
+
+    bool result;
+    ASSERT_EQ(napi_has_element(globalEnv, arrayValue, 2, &result), NAPIExceptionOK);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(napi_has_element(globalEnv, arrayValue, 3, &result), NAPIExceptionOK);
+    ASSERT_FALSE(result);
+
+    NAPIValue numberValue;
+    ASSERT_EQ(napi_create_double(globalEnv, 4, &numberValue), NAPIErrorOK);
+    ASSERT_EQ(napi_set_element(globalEnv, arrayValue, 3, numberValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_get_element(globalEnv, arrayValue, 3, &value), NAPIExceptionOK);
+    ASSERT_EQ(napi_get_value_double(globalEnv, value, &doubleValue), NAPIErrorOK);
+    ASSERT_EQ(doubleValue, 4);
+
+    ASSERT_EQ(napi_delete_element(globalEnv, arrayValue, 0, &result), NAPIExceptionOK);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(napi_has_element(globalEnv, arrayValue, 0, &result), NAPIExceptionOK);
+    ASSERT_FALSE(result);
+}
+
+TEST_F(Test, ArrayBuffer)
+{
+    NAPIValue arrayBufferValue;
+    void *data;
+    ASSERT_EQ(napi_create_arraybuffer(globalEnv, 16, &data, &arrayBufferValue), NAPIExceptionOK);
+    auto bytes = static_cast<uint8_t *>(data);
+    for (uint8_t i = 0; i < 16; ++i)
+    {
+        ASSERT_EQ(bytes[i], 0);
+        bytes[i] = i;
+    }
+    bool result;
+    ASSERT_EQ(napi_is_arraybuffer(globalEnv, arrayBufferValue, &result), NAPICommonOK);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(napi_is_typedarray(globalEnv, arrayBufferValue, &result), NAPICommonOK);
+    ASSERT_FALSE(result);
+    size_t byteLength;
+    void *infoData;
+    ASSERT_EQ(napi_get_arraybuffer_info(globalEnv, arrayBufferValue, &infoData, &byteLength), NAPIErrorOK);
+    ASSERT_EQ(infoData, data);
+    ASSERT_EQ(byteLength, 16u);
+
+    NAPIValue typedArrayValue;
+    ASSERT_EQ(napi_create_typedarray(globalEnv, NAPIUint16Array, 4, arrayBufferValue, 4, &typedArrayValue),
+              NAPIExceptionOK);
+    ASSERT_EQ(napi_is_typedarray(globalEnv, typedArrayValue, &result), NAPICommonOK);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(napi_is_arraybuffer(globalEnv, typedArrayValue, &result), NAPICommonOK);
+    ASSERT_FALSE(result);
+    NAPITypedArrayType type;
+    size_t length, byteOffset;
+    NAPIValue infoArrayBufferValue;
+    ASSERT_EQ(napi_get_typedarray_info(globalEnv, typedArrayValue, &type, &length, &infoData, &infoArrayBufferValue,
+                                       &byteOffset),
+              NAPIErrorOK);
+    ASSERT_EQ(type, NAPIUint16Array);
+    ASSERT_EQ(length, 4u);
+    ASSERT_EQ(infoData, bytes + 4);
+    ASSERT_EQ(byteOffset, 4u);
+    ASSERT_EQ(napi_strict_equals(globalEnv, infoArrayBufferValue, arrayBufferValue, &result), NAPIExceptionOK);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(napi_set_named_property(globalEnv, addonValue, "typedArray", typedArrayValue), NAPIExceptionOK);
+
+    // 偏移不对齐
+    ASSERT_EQ(napi_create_typedarray(globalEnv, NAPIInt32Array, 1, arrayBufferValue, 2, &typedArrayValue),
+              NAPIExceptionPendingException);
+    NAPIValue exceptionValue, globalValue, rangeErrorValue;
+    ASSERT_EQ(napi_get_and_clear_last_exception(globalEnv, &exceptionValue), NAPIErrorOK);
+    ASSERT_EQ(napi_get_global(globalEnv, &globalValue), NAPIErrorOK);
+    ASSERT_EQ(napi_get_named_property(globalEnv, globalValue, "RangeError", &rangeErrorValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_instanceof(globalEnv, exceptionValue, rangeErrorValue, &result), NAPIExceptionOK);
+    ASSERT_TRUE(result);
+    // 越界
+    ASSERT_EQ(napi_create_typedarray(globalEnv, NAPIUint8Array, 16, arrayBufferValue, 1, &typedArrayValue),
+              NAPIExceptionPendingException);
+    ASSERT_EQ(napi_get_and_clear_last_exception(globalEnv, &exceptionValue), NAPIErrorOK);
+
+    ASSERT_EQ(NAPIRunScript(globalEnv,
+                            "(()=>{\"use strict\";const a=globalThis.addon.typedArray;globalThis.assert(a instanceof "
+                            "Uint16Array),globalThis.assert(a.length===4),globalThis.assert(a.byteOffset===4),"
+                            "globalThis.assert(new Uint8Array(a.buffer)[15]===15),globalThis.addon.float64Array=new "
+                            "Float64Array(2)})();",
+                            "https://www.napi.com/array_buffer.js", nullptr),
+              NAPIExceptionOK);
+    ASSERT_EQ(napi_get_named_property(globalEnv, addonValue, "float64Array", &typedArrayValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_get_typedarray_info(globalEnv, typedArrayValue, &type, &length, &infoData, nullptr, nullptr),
+              NAPIErrorOK);
+    ASSERT_EQ(type, NAPIFloat64Array);
+    ASSERT_EQ(length, 2u);
+    // 直接写入，JS 侧可见
+    static_cast<double *>(infoData)[1] = 1.5;
+    ASSERT_EQ(NAPIRunScript(globalEnv, "globalThis.assert(globalThis.addon.float64Array[1]===1.5)",
+                            "https://www.napi.com/array_buffer.js", nullptr),
+              NAPIExceptionOK);
+
+    NAPIValue objectValue;
+    ASSERT_EQ(NAPIRunScript(globalEnv, "({})", "https://www.napi.com/array_buffer.js", &objectValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_get_arraybuffer_info(globalEnv, objectValue, &infoData, &byteLength), NAPIErrorInvalidArg);
+    ASSERT_EQ(napi_get_typedarray_info(globalEnv, objectValue, &type, nullptr, nullptr, nullptr, nullptr),
+              NAPIErrorInvalidArg);
+}
+
+EXTERN_C_START
+
+static int arrayBufferFinalizeCount = 0;
+
+static void arrayBufferFinalize(void *finalizeData, void *finalizeHint)
+{
+    assert(finalizeData == finalizeHint);
+    ++arrayBufferFinalizeCount;
+}
+
+EXTERN_C_END
+
+TEST_F(Test, ExternalArrayBuffer)
+{
+    static uint8_t externalData[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    NAPIValue arrayBufferValue;
+    bool copied;
+    ASSERT_EQ(napi_create_external_arraybuffer(globalEnv, externalData, sizeof(externalData), nullptr, nullptr,
+                                               &arrayBufferValue, &copied),
+              NAPIExceptionOK);
+    size_t byteLength;
+    void *data;
+    ASSERT_EQ(napi_get_arraybuffer_info(globalEnv, arrayBufferValue, &data, &byteLength), NAPIErrorOK);
+    ASSERT_EQ(byteLength, sizeof(externalData));
+    // 只有拷贝时数据块地址不同
+    ASSERT_EQ(data != externalData, copied);
+    ASSERT_EQ(memcmp(data, externalData, sizeof(externalData)), 0);
+    ASSERT_EQ(napi_set_named_property(globalEnv, addonValue, "arrayBuffer", arrayBufferValue), NAPIExceptionOK);
+    ASSERT_EQ(NAPIRunScript(globalEnv,
+                            "(()=>{\"use strict\";const a=new "
+                            "Uint8Array(globalThis.addon.arrayBuffer);globalThis.assert(a.length===8),globalThis."
+                            "assert(a[7]===8)})();",
+                            "https://www.napi.com/external_array_buffer.js", nullptr),
+              NAPIExceptionOK);
+
+    // 独立的 runtime 释放时一定会回收 ArrayBuffer，Hermes 拷贝后会立即调用 finalizeCB
+    NAPIRuntime runtime;
+    ASSERT_EQ(NAPICreateRuntime(&runtime), NAPIErrorOK);
+    NAPIEnv env;
+    ASSERT_EQ(NAPICreateEnv(&env, runtime), NAPIErrorOK);
+    NAPIHandleScope envHandleScope;
+    ASSERT_EQ(napi_open_handle_scope(env, &envHandleScope), NAPIErrorOK);
+    arrayBufferFinalizeCount = 0;
+    ASSERT_EQ(napi_create_external_arraybuffer(env, externalData, sizeof(externalData), arrayBufferFinalize,
+                                               externalData, &arrayBufferValue, &copied),
+              NAPIExceptionOK);
+    // 拷贝时已经同步调用 finalizeCB
+    ASSERT_EQ(arrayBufferFinalizeCount, copied ? 1 : 0);
+    ASSERT_EQ(napi_close_handle_scope(env, envHandleScope), NAPICommonOK);
+    ASSERT_EQ(NAPIFreeEnv(env), NAPICommonOK);
+    ASSERT_EQ(NAPIFreeRuntime(runtime), NAPICommonOK);
+    ASSERT_EQ(arrayBufferFinalizeCount, 1);
+}
+
+EXTERN_C_START
+
+static size_t externalMemoryFinalizeCount = 0;
+
+// finalizeData 为登记的字节数，finalizeHint 为 env
+static void externalMemoryFinalize(void *finalizeData, void *finalizeHint)
+{
+    int64_t adjustedValue;
+    // 不能把调用写在 assert 中，NDEBUG 下会被整体去掉
+    NAPIErrorStatus status =
+        napi_adjust_external_memory((NAPIEnv)finalizeHint, -(int64_t)(uintptr_t)finalizeData, &adjustedValue);
+    assert(status == NAPIErrorOK);
+    (void)status;
+    ++externalMemoryFinalizeCount;
+}
+
+EXTERN_C_END
+
+TEST_F(Test, ExternalMemory)
+{
+    int64_t initialValue;
+    ASSERT_EQ(napi_adjust_external_memory(globalEnv, 0, &initialValue), NAPIErrorOK);
+    int64_t adjustedValue;
+    ASSERT_EQ(napi_adjust_external_memory(globalEnv, 1, &adjustedValue), NAPIErrorOK);
+    ASSERT_EQ(adjustedValue, initialValue + 1);
+    NAPIHeapStatistics statistics;
+    ASSERT_EQ(NAPIGetHeapStatistics(globalEnv, &statistics), NAPIErrorOK);
+    // 超出登记总数的释放按总数撤销
+    ASSERT_EQ(napi_adjust_external_memory(globalEnv, INT64_MIN, &adjustedValue), NAPIErrorOK);
+    ASSERT_EQ(adjustedValue, 0);
+    ASSERT_EQ(napi_adjust_external_memory(globalEnv, initialValue, &adjustedValue), NAPIErrorOK);
+    // 引擎没有接入 GC 统计
+    if (!statistics.externalMemorySize)
+    {
+        return;
+    }
+
+    // 循环引用只有 GC 才能回收，包装对象本身很小，不登记时循环结束前不会触发 GC
+    NAPIValue retainValue;
+    ASSERT_EQ(NAPIRunScript(globalEnv,
+                            "(function (external) { const object = { external, array: new Array(1024).fill(0) }; "
+                            "object.self = object; })",
+                            "https://www.napi.com/external_memory.js", &retainValue),
+              NAPIExceptionOK);
+    const size_t externalSize = 4 << 20;
+    const size_t externalCount = 64;
+    externalMemoryFinalizeCount = 0;
+    for (size_t i = 0; i < externalCount; ++i)
+    {
+        NAPIHandleScope loopHandleScope;
+        ASSERT_EQ(napi_open_handle_scope(globalEnv, &loopHandleScope), NAPIErrorOK);
+        NAPIValue externalValue;
+        ASSERT_EQ(napi_create_external(globalEnv, (void *)(uintptr_t)externalSize, externalMemoryFinalize, globalEnv,
+                                       &externalValue),
+                  NAPIExceptionOK);
+        ASSERT_EQ(napi_adjust_external_memory(globalEnv, externalSize, &adjustedValue), NAPIErrorOK);
+        ASSERT_EQ(napi_call_function(globalEnv, nullptr, retainValue, 1, &externalValue, nullptr), NAPIExceptionOK);
+        ASSERT_EQ(napi_close_handle_scope(globalEnv, loopHandleScope), NAPICommonOK);
+    }
+    ASSERT_GT(externalMemoryFinalizeCount, 0u);
+    ASSERT_EQ(NAPIRunGC(globalEnv, NAPIFullGC), NAPIErrorOK);
+    ASSERT_EQ(externalMemoryFinalizeCount, externalCount);
+    ASSERT_EQ(napi_adjust_external_memory(globalEnv, 0, &adjustedValue), NAPIErrorOK);
+    ASSERT_EQ(adjustedValue, initialValue);
+}
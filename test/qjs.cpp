@@ -0,0 +1,100 @@
+#include <test.h>
+
+// 闭包变量和 Map 的元素只有内部引用，Proxy 的 trap 一旦执行就会抛出异常
+TEST_F(Test, HeapSnapshotInternalReferences)
+{
+    NAPIValue object;
+    ASSERT_EQ(NAPIRunScript(globalEnv,
+                            "(function () { const captured = new (class HeapSnapshotCaptured {})(); "
+                            "const map = new Map([[1, new (class HeapSnapshotMapValue {})()]]); "
+                            "const trap = () => { throw new Error('trap'); }; "
+                            "const proxy = new Proxy({}, { ownKeys: trap, getPrototypeOf: trap, get: trap, "
+                            "getOwnPropertyDescriptor: trap }); "
+                            "return { closure: () => captured, map, proxy }; })()",
+                            "https://www.napi.com/heap_snapshot_internal_references.js", &object),
+              NAPIExceptionOK);
+    NAPIRef ref;
+    ASSERT_EQ(napi_create_reference(globalEnv, object, 1, &ref), NAPIExceptionOK);
+    // 调用前未处理的异常保持不变
+    NAPIValue exceptionValue;
+    ASSERT_EQ(napi_create_string_utf8(globalEnv, "pending", &exceptionValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_throw(globalEnv, exceptionValue), NAPIExceptionOK);
+    std::string content;
+    ASSERT_EQ(writeHeapSnapshot(globalEnv, &content), NAPIErrorOK);
+    ASSERT_EQ(napi_get_and_clear_last_exception(globalEnv, &exceptionValue), NAPIErrorOK);
+    char exception[16];
+    size_t length = 0;
+    ASSERT_EQ(napi_get_value_string_utf8(globalEnv, exceptionValue, exception, sizeof(exception), &length),
+              NAPIErrorOK);
+    ASSERT_EQ(std::string(exception, length), "pending");
+
+    // 从 (Strong references) 出发沿非 weak 边可以到达闭包捕获的对象和 Map 的值
+    ASSERT_EQ(checkHeapSnapshot(
+                  globalEnv, content,
+                  "snapshot => { const meta = snapshot.snapshot.meta; "
+                  "const nodes = snapshot.nodes, edges = snapshot.edges, strings = snapshot.strings; "
+                  "const nodeFieldCount = meta.node_fields.length, edgeFieldCount = meta.edge_fields.length; "
+                  "const typeOffset = meta.node_fields.indexOf('type'); "
+                  "const nameOffset = meta.node_fields.indexOf('name'); "
+                  "const edgeCountOffset = meta.node_fields.indexOf('edge_count'); "
+                  "const edgeTypeOffset = meta.edge_fields.indexOf('type'); "
+                  "const toNodeOffset = meta.edge_fields.indexOf('to_node'); "
+                  "const weakType = meta.edge_types[0].indexOf('weak'); "
+                  "const objectType = meta.node_types[0].indexOf('object'); "
+                  "if (snapshot.snapshot.node_count * nodeFieldCount !== nodes.length) { return 'node_count'; } "
+                  "if (snapshot.snapshot.edge_count * edgeFieldCount !== edges.length) { return 'edge_count'; } "
+                  "const firstEdges = []; "
+                  "for (let i = 0, edgeIndex = 0; i < nodes.length; i += nodeFieldCount) { "
+                  "firstEdges.push(edgeIndex); edgeIndex += nodes[i + edgeCountOffset] * edgeFieldCount; } "
+                  "const children = node => { const result = []; const begin = firstEdges[node / nodeFieldCount]; "
+                  "for (let i = 0; i < nodes[node + edgeCountOffset]; ++i) { "
+                  "const edge = begin + i * edgeFieldCount; "
+                  "if (edges[edge + edgeTypeOffset] !== weakType) { result.push(edges[edge + toNodeOffset]); } } "
+                  "return result; }; "
+                  "const nameOf = node => strings[nodes[node + nameOffset]]; "
+                  "const roots = children(0); "
+                  "if (!roots.some(node => nameOf(node) === '(Handle scopes)')) { return '(Handle scopes)'; } "
+                  "const strongReferences = roots.find(node => nameOf(node) === '(Strong references)'); "
+                  "if (strongReferences === undefined) { return '(Strong references)'; } "
+                  "const visited = new Set([strongReferences]); const queue = [strongReferences]; "
+                  "while (queue.length) { for (const node of children(queue.shift())) { "
+                  "if (!visited.has(node)) { visited.add(node); queue.push(node); } } } "
+                  "const isReachable = name => [...visited].some(node => "
+                  "nodes[node + typeOffset] === objectType && nameOf(node) === name); "
+                  "if (!isReachable('HeapSnapshotCaptured')) { return 'HeapSnapshotCaptured'; } "
+                  "return isReachable('HeapSnapshotMapValue') ? '' : 'HeapSnapshotMapValue'; }"),
+              "");
+    ASSERT_EQ(napi_delete_reference(globalEnv, ref), NAPIExceptionOK);
+}
+
+// external 内存只让 GC 提前发生，不计入 maxHeapSize
+TEST_F(Test, ExternalMemoryHeapLimit)
+{
+    NAPIRuntimeOptions options = {};
+    options.version = NAPI_RUNTIME_OPTIONS_VERSION;
+    options.maxHeapSize = 16 << 20;
+    NAPIRuntime runtime;
+    ASSERT_EQ(NAPICreateRuntimeWithOptions(&options, &runtime), NAPIErrorOK);
+    NAPIEnv env;
+    ASSERT_EQ(NAPICreateEnv(&env, runtime), NAPIErrorOK);
+    NAPIHandleScope envHandleScope;
+    ASSERT_EQ(napi_open_handle_scope(env, &envHandleScope), NAPIErrorOK);
+    int64_t adjustedValue;
+    ASSERT_EQ(napi_adjust_external_memory(env, 64 << 20, &adjustedValue), NAPIErrorOK);
+    NAPIValue value;
+    ASSERT_EQ(NAPIRunScript(env, "new Array(1000).fill(1).reduce((a, b) => a + b)",
+                            "https://www.napi.com/external_memory_heap_limit.js", &value),
+              NAPIExceptionOK);
+    double doubleValue;
+    ASSERT_EQ(napi_get_value_double(env, value, &doubleValue), NAPIErrorOK);
+    ASSERT_EQ(doubleValue, 1000);
+    NAPIHeapStatistics statistics;
+    ASSERT_EQ(NAPIGetHeapStatistics(env, &statistics), NAPIErrorOK);
+    ASSERT_EQ(statistics.externalMemorySize, (uint64_t)(64 << 20));
+    // external 内存不重复计入 totalHeapSize
+    ASSERT_LT(statistics.totalHeapSize, (uint64_t)options.maxHeapSize);
+    ASSERT_EQ(napi_adjust_external_memory(env, -(64 << 20), &adjustedValue), NAPIErrorOK);
+    ASSERT_EQ(napi_close_handle_scope(env, envHandleScope), NAPICommonOK);
+    ASSERT_EQ(NAPIFreeEnv(env), NAPICommonOK);
+    ASSERT_EQ(NAPIFreeRuntime(runtime), NAPICommonOK);
+}
@@ -62,4 +62,37 @@ TEST_F(Test, EscapableHandleScope)
     ASSERT_EQ(NAPIGetValueStringUTF8(globalEnv, otherValue, &string), NAPIErrorOK);
     ASSERT_STREQ(string, "");
     ASSERT_EQ(NAPIFreeUTF8String(globalEnv, string), NAPICommonOK);
-}
\ No newline at end of file
+}
+
+TEST_F(Test, ResetHandleScope)
+{
+    NAPIHandleScope handleScope;
+    ASSERT_EQ(napi_open_handle_scope(globalEnv, &handleScope), NAPIErrorOK);
+    for (int i = 0; i < 10; ++i)
+    {
+        for (int j = 0; j < 100; ++j)
+        {
+            NAPIValue numberValue;
+            ASSERT_EQ(napi_create_double(globalEnv, j, &numberValue), NAPIErrorOK);
+        }
+        ASSERT_EQ(napi_reset_handle_scope(globalEnv, handleScope), NAPIErrorOK);
+    }
+    NAPIValue stringValue;
+    ASSERT_EQ(napi_create_string_utf8(globalEnv, "reset", &stringValue), NAPIExceptionOK);
+    const char *string;
+    ASSERT_EQ(NAPIGetValueStringUTF8(globalEnv, stringValue, &string), NAPIErrorOK);
+    ASSERT_STREQ(string, "reset");
+    ASSERT_EQ(NAPIFreeUTF8String(globalEnv, string), NAPICommonOK);
+    ASSERT_EQ(napi_close_handle_scope(globalEnv, handleScope), NAPICommonOK);
+
+    // 关闭后重新打开会复用之前的 handleScope
+    for (int i = 0; i < 10; ++i)
+    {
+        NAPIEscapableHandleScope escapableHandleScope;
+        ASSERT_EQ(napi_open_escapable_handle_scope(globalEnv, &escapableHandleScope), NAPIErrorOK);
+        NAPIValue nullValue, escapedValue;
+        ASSERT_EQ(napi_get_null(globalEnv, &nullValue), NAPICommonOK);
+        ASSERT_EQ(napi_escape_handle(globalEnv, escapableHandleScope, nullValue, &escapedValue), NAPIErrorOK);
+        ASSERT_EQ(napi_close_escapable_handle_scope(globalEnv, escapableHandleScope), NAPICommonOK);
+    }
+}
@@ -1,6 +1,8 @@
 #include <cassert>
+#include <cstdio>
 #include <napi/js_native_api_debugger.h>
 #include <test.h>
+#include <unistd.h>
 
 NAPIEnv globalEnv = nullptr;
 
@@ -89,3 +91,68 @@ void ::Test::TearDown()
     ::testing::Test::TearDown();
     napi_close_handle_scope(globalEnv, handleScope);
 }
+
+NAPIErrorStatus writeHeapSnapshot(NAPIEnv env, std::string *content)
+{
+    char path[] = "/tmp/napi_heap_snapshot_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        return NAPIErrorGenericFailure;
+    }
+    close(fd);
+    NAPIErrorStatus status = NAPIWriteHeapSnapshot(env, path);
+    FILE *file = status == NAPIErrorOK ? fopen(path, "r") : nullptr;
+    if (file)
+    {
+        char buffer[4096];
+        size_t readLength;
+        while ((readLength = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            content->append(buffer, readLength);
+        }
+        fclose(file);
+    }
+    unlink(path);
+
+    return status;
+}
+
+std::string checkHeapSnapshot(NAPIEnv env, const std::string &content, const char *checkScript)
+{
+    NAPIHandleScope checkHandleScope;
+    if (napi_open_handle_scope(env, &checkHandleScope) != NAPIErrorOK)
+    {
+        return "napi_open_handle_scope";
+    }
+    std::string script = "(function (content) { return (";
+    script += checkScript;
+    script += ")(JSON.parse(content)); })";
+    std::string result;
+    NAPIValue checkValue, contentValue, resultValue;
+    if (NAPIRunScript(env, script.c_str(), "https://www.napi.com/check_heap_snapshot.js", &checkValue) !=
+            NAPIExceptionOK ||
+        napi_create_string_utf8_len(env, content.c_str(), content.size(), &contentValue) != NAPIExceptionOK ||
+        napi_call_function(env, nullptr, checkValue, 1, &contentValue, &resultValue) != NAPIExceptionOK)
+    {
+        NAPIValue exceptionValue;
+        napi_get_and_clear_last_exception(env, &exceptionValue);
+        result = "exception";
+    }
+    else
+    {
+        char buffer[256];
+        size_t length = 0;
+        if (napi_get_value_string_utf8(env, resultValue, buffer, sizeof(buffer), &length) != NAPIErrorOK)
+        {
+            result = "result is not a string";
+        }
+        else
+        {
+            result.assign(buffer, length);
+        }
+    }
+    napi_close_handle_scope(env, checkHandleScope);
+
+    return result;
+}